@@ -50,6 +50,7 @@ namespace NApi {
         static auto FromBytes(std::span<const std::byte, kSerializedSize>) noexcept
           -> std::variant<Self, UnknownResultError>;
         using DeserializationError = UnknownResultError;
+        auto operator==(const Message& other) const -> bool = default;
     };
     using JoinGameResponse = Message<MessageType::JoinGameResponse>;
 } // namespace NApi
@@ -0,0 +1,393 @@
+#include "archive.hpp"
+#include "move_coder.hpp"
+
+#include "../utils/integer_serialization.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/stat.h>
+#include <tuple>
+#include <unistd.h>
+#include <utility>
+
+
+namespace {
+    using namespace NArchive;
+
+    static constexpr auto kStartFen =
+        std::string_view{"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"};
+    // Games handed to a reading thread at a time
+    static constexpr auto kGamesPerTask = uint64_t{64};
+
+    template <std::integral I>
+    auto AppendInt(std::vector<uint8_t>& out, I x) -> void {
+        out.resize(out.size() + sizeof(I));
+        IntToBytes(x, std::span<std::byte, sizeof(I)>{reinterpret_cast<std::byte*>(out.data() + out.size() - sizeof(I)), sizeof(I)});
+    }
+
+    template <std::integral I>
+    auto ReadInt(const uint8_t* p) noexcept -> I {
+        return IntFromBytes<I>(std::span<const std::byte, sizeof(I)>{reinterpret_cast<const std::byte*>(p), sizeof(I)});
+    }
+
+    auto AppendString(std::vector<uint8_t>& out, std::string_view s) -> void {
+        out.push_back(uint8_t(s.size()));
+        out.insert(out.end(), s.begin(), s.end());
+    }
+
+    auto MakeHeader(std::string_view magic) noexcept -> NFormat::FileHeader {
+        auto header = NFormat::FileHeader{};
+        std::memcpy(header.Magic, magic.data(), sizeof(header.Magic));
+        header.Version = NFormat::kVersion;
+        return header;
+    }
+
+    auto CheckHeader(std::span<const std::byte> file, std::string_view magic) noexcept -> std::optional<std::string> {
+        auto header = NFormat::FileHeader{};
+        if (file.size() < sizeof(header)) return "file is too short";
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::string_view{header.Magic, sizeof(header.Magic)} != magic) return "wrong magic";
+        if (header.Version != NFormat::kVersion) return "unsupported version " + std::to_string(header.Version);
+        return std::nullopt;
+    }
+
+    auto PreadAll(int fd, void* data, size_t size, uint64_t offset) noexcept -> std::optional<SystemError> {
+        for (auto done = size_t{0}; done < size;) {
+            const auto n = pread(fd, static_cast<char*>(data) + done, size - done, off_t(offset + done));
+            if (n == -1 && errno == EINTR) continue;
+            if (n == -1) {
+                return SystemError{
+                    .Value = std::errc{errno},
+                    .ContextMessage = "pread() syscall failed (" SOURCE_LOCATION ")",
+                };
+            }
+            if (n == 0) {
+                return SystemError{
+                    .Value = std::errc::io_error,
+                    .ContextMessage = "unexpected end of file (" SOURCE_LOCATION ")",
+                };
+            }
+            done += size_t(n);
+        }
+        return std::nullopt;
+    }
+
+    auto PwriteAll(int fd, const void* data, size_t size, uint64_t offset) noexcept -> std::optional<SystemError> {
+        for (auto done = size_t{0}; done < size;) {
+            const auto n = pwrite(fd, static_cast<const char*>(data) + done, size - done, off_t(offset + done));
+            if (n == -1 && errno == EINTR) continue;
+            if (n == -1) {
+                return SystemError{
+                    .Value = std::errc{errno},
+                    .ContextMessage = "pwrite() syscall failed (" SOURCE_LOCATION ")",
+                };
+            }
+            done += size_t(n);
+        }
+        return std::nullopt;
+    }
+
+    auto FileSize(int fd) noexcept -> std::variant<uint64_t, SystemError> {
+        struct stat st;
+        if (fstat(fd, &st) == -1) {
+            return SystemError{
+                .Value = std::errc{errno},
+                .ContextMessage = "fstat() syscall failed (" SOURCE_LOCATION ")",
+            };
+        }
+        return uint64_t(st.st_size);
+    }
+
+    auto Truncate(int fd, uint64_t size) noexcept -> std::optional<SystemError> {
+        if (ftruncate(fd, off_t(size)) == -1) {
+            return SystemError{
+                .Value = std::errc{errno},
+                .ContextMessage = "ftruncate() syscall failed (" SOURCE_LOCATION ")",
+            };
+        }
+        return std::nullopt;
+    }
+
+    /* Checks or creates the headers and drops what an interrupted writer
+     * may have left: a partial index entry and unindexed records.
+     * Returns the sizes of the data and index files.
+     */
+    auto Recover(int dataFd, int indexFd, const std::string& path) noexcept
+      -> std::variant<std::pair<uint64_t, uint64_t>, SystemError, GenericError> {
+        const auto bad = [&path](std::string what) {
+            return GenericError{
+                .Value = std::move(what),
+                .ContextMessage = "Bad game archive \"" + path + "\"",
+            };
+        };
+        uint64_t sizes[2];
+        for (const auto i : {0, 1}) {
+            auto sizeOrError = FileSize(i == 0 ? dataFd : indexFd);
+            if (std::holds_alternative<SystemError>(sizeOrError)) return std::get<SystemError>(std::move(sizeOrError));
+            sizes[i] = std::get<uint64_t>(sizeOrError);
+        }
+        auto [dataSize, indexSize] = sizes;
+        const auto headerSize = sizeof(NFormat::FileHeader);
+
+        if (dataSize == 0 && indexSize == 0) {
+            const auto dataHeader = MakeHeader(NFormat::kDataMagic);
+            const auto indexHeader = MakeHeader(NFormat::kIndexMagic);
+            if (auto err = PwriteAll(dataFd, &dataHeader, headerSize, 0)) return std::move(*err);
+            if (auto err = PwriteAll(indexFd, &indexHeader, headerSize, 0)) return std::move(*err);
+            return std::pair{uint64_t{headerSize}, uint64_t{headerSize}};
+        }
+        for (const auto& [fd, size, magic] : {
+                 std::tuple{dataFd, dataSize, NFormat::kDataMagic},
+                 std::tuple{indexFd, indexSize, NFormat::kIndexMagic}}) {
+            auto header = std::array<std::byte, sizeof(NFormat::FileHeader)>{};
+            if (size < headerSize) return bad("file is too short");
+            if (auto err = PreadAll(fd, header.data(), header.size(), 0)) return std::move(*err);
+            if (auto what = CheckHeader(header, magic)) return bad(std::move(*what));
+        }
+
+        indexSize -= (indexSize - headerSize) % sizeof(uint64_t);
+        auto dataEnd = uint64_t{headerSize};
+        if (indexSize > headerSize) {
+            auto offset = uint64_t{0};
+            auto recordSize = uint32_t{0};
+            if (auto err = PreadAll(indexFd, &offset, sizeof(offset), indexSize - sizeof(offset))) return std::move(*err);
+            if (offset + sizeof(recordSize) > dataSize) return bad("the index points past the end of the data");
+            if (auto err = PreadAll(dataFd, &recordSize, sizeof(recordSize), offset)) return std::move(*err);
+            dataEnd = offset + recordSize;
+            if (dataEnd > dataSize) return bad("the last game is truncated");
+        }
+        if (auto err = Truncate(indexFd, indexSize)) return std::move(*err);
+        if (auto err = Truncate(dataFd, dataEnd)) return std::move(*err);
+        return std::pair{dataEnd, indexSize};
+    }
+} // anonymous namespace
+
+
+namespace NArchive {
+    ArchiveWriter::ArchiveWriter(int dataFd, int indexFd, uint64_t dataFileSize, uint64_t indexFileSize)
+        : DataFd_(dataFd)
+        , IndexFd_(indexFd)
+        , DataFileSize_(dataFileSize)
+        , IndexFileSize_(indexFileSize)
+        , NumGames_((indexFileSize - sizeof(NFormat::FileHeader)) / sizeof(uint64_t))
+    {
+        DataBuffer_.reserve(kFlushThreshold + (size_t{1} << 16));
+    }
+
+    ArchiveWriter::ArchiveWriter(ArchiveWriter&& other) noexcept
+        : DataFd_(std::exchange(other.DataFd_, -1))
+        , IndexFd_(std::exchange(other.IndexFd_, -1))
+        , DataFileSize_(other.DataFileSize_)
+        , IndexFileSize_(other.IndexFileSize_)
+        , NumGames_(other.NumGames_)
+        , DataBuffer_(std::move(other.DataBuffer_))
+        , IndexBuffer_(std::move(other.IndexBuffer_))
+        , Pos_(std::move(other.Pos_))
+    {
+    }
+
+    ArchiveWriter& ArchiveWriter::operator=(ArchiveWriter&& other) noexcept {
+        std::swap(DataFd_, other.DataFd_);
+        std::swap(IndexFd_, other.IndexFd_);
+        std::swap(DataFileSize_, other.DataFileSize_);
+        std::swap(IndexFileSize_, other.IndexFileSize_);
+        std::swap(NumGames_, other.NumGames_);
+        std::swap(DataBuffer_, other.DataBuffer_);
+        std::swap(IndexBuffer_, other.IndexBuffer_);
+        std::swap(Pos_, other.Pos_);
+        return *this;
+    }
+
+    ArchiveWriter::~ArchiveWriter() noexcept {
+        if (DataFd_ == -1) return;
+        [[maybe_unused]] const auto err = Flush();
+        close(DataFd_);
+        close(IndexFd_);
+    }
+
+    auto ArchiveWriter::Open(const std::string& path) noexcept
+      -> std::variant<ArchiveWriter, SystemError, GenericError> {
+        const auto indexPath = path + std::string{NFormat::kIndexSuffix};
+        const auto dataFd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (dataFd == -1) {
+            return SystemError{
+                .Value = std::errc{errno},
+                .ContextMessage = "open() syscall failed for \"" + path + "\" (" SOURCE_LOCATION ")",
+            };
+        }
+        const auto indexFd = open(indexPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (indexFd == -1) {
+            const auto err = errno;
+            close(dataFd);
+            return SystemError{
+                .Value = std::errc{err},
+                .ContextMessage = "open() syscall failed for \"" + indexPath + "\" (" SOURCE_LOCATION ")",
+            };
+        }
+        auto sizesOrError = Recover(dataFd, indexFd, path);
+        if (!std::holds_alternative<std::pair<uint64_t, uint64_t>>(sizesOrError)) {
+            close(dataFd);
+            close(indexFd);
+            if (auto* err = std::get_if<SystemError>(&sizesOrError)) return std::move(*err);
+            return std::get<GenericError>(std::move(sizesOrError));
+        }
+        const auto [dataSize, indexSize] = std::get<std::pair<uint64_t, uint64_t>>(sizesOrError);
+        return ArchiveWriter{dataFd, indexFd, dataSize, indexSize};
+    }
+
+    auto ArchiveWriter::Append(const GameRecord& game) -> std::optional<std::variant<SystemError, GenericError>> {
+        if (game.White.size() > NFormat::kMaxStringLength || game.Black.size() > NFormat::kMaxStringLength
+            || game.Fen.size() > NFormat::kMaxStringLength) {
+            return GenericError{"a player name or the FEN is too long"};
+        }
+        if (const auto err = Pos_.SetFromFen(game.Fen.empty() ? kStartFen : std::string_view{game.Fen})) {
+            return GenericError{"bad FEN: " + std::string{Describe(err->Value)}};
+        }
+
+        const auto start = DataBuffer_.size();
+        AppendInt(DataBuffer_, uint32_t{0});
+        AppendInt(DataBuffer_, game.Id.GetValue());
+        AppendInt(DataBuffer_, uint8_t(game.Result));
+        AppendInt(DataBuffer_, game.Fen.empty() ? uint8_t{0} : NFormat::kHasFen);
+        AppendInt(DataBuffer_, game.Control.BaseSeconds);
+        AppendInt(DataBuffer_, game.Control.IncrementSeconds);
+        AppendInt(DataBuffer_, uint32_t(game.Moves.size()));
+        AppendString(DataBuffer_, game.White);
+        AppendString(DataBuffer_, game.Black);
+        if (!game.Fen.empty()) AppendString(DataBuffer_, game.Fen);
+        if (!EncodeMoves(Pos_, game.Moves, DataBuffer_)) {
+            DataBuffer_.resize(start);
+            return GenericError{"the game has an illegal move"};
+        }
+        const auto recordSize = uint32_t(DataBuffer_.size() - start);
+        std::memcpy(DataBuffer_.data() + start, &recordSize, sizeof(recordSize));
+        AppendInt(IndexBuffer_, DataFileSize_ + start);
+        ++NumGames_;
+
+        if (DataBuffer_.size() >= kFlushThreshold) {
+            if (auto err = Flush()) return std::move(*err);
+        }
+        return std::nullopt;
+    }
+
+    auto ArchiveWriter::Flush() noexcept -> std::optional<SystemError> {
+        // The records go first, so the index never points to missing data
+        if (auto err = PwriteAll(DataFd_, DataBuffer_.data(), DataBuffer_.size(), DataFileSize_)) return err;
+        DataFileSize_ += DataBuffer_.size();
+        DataBuffer_.clear();
+        if (auto err = PwriteAll(IndexFd_, IndexBuffer_.data(), IndexBuffer_.size(), IndexFileSize_)) return err;
+        IndexFileSize_ += IndexBuffer_.size();
+        IndexBuffer_.clear();
+        return std::nullopt;
+    }
+
+    auto GameDecoder::Decode(std::span<const uint8_t> record, GameRecord& game) -> std::optional<GenericError> {
+        const auto corrupt = [](const char* what) { return GenericError{what}; };
+        if (record.size() < NFormat::kFixedRecordSize) return corrupt("the record is too short");
+        const auto* p = record.data();
+        const auto* end = p + record.size();
+        p += sizeof(uint32_t);
+        game.Id = GameId{ReadInt<uint64_t>(p)};
+        p += sizeof(uint64_t);
+        const auto result = *p++;
+        const auto flags = *p++;
+        if (result > uint8_t(EGameResult::Unknown)) return corrupt("bad game result");
+        game.Result = EGameResult(result);
+        game.Control.BaseSeconds = ReadInt<uint32_t>(p);
+        game.Control.IncrementSeconds = ReadInt<uint32_t>(p + 4);
+        const auto numPlies = ReadInt<uint32_t>(p + 8);
+        p += 12;
+
+        const auto readString = [&p, end](std::string& s) {
+            if (p == end || end - p - 1 < *p) return false;
+            s.assign(reinterpret_cast<const char*>(p + 1), *p);
+            p += 1 + *p;
+            return true;
+        };
+        if (!readString(game.White) || !readString(game.Black)) return corrupt("truncated player names");
+        game.Fen.clear();
+        if ((flags & NFormat::kHasFen) && !readString(game.Fen)) return corrupt("truncated FEN");
+        if (Pos_.SetFromFen(game.Fen.empty() ? kStartFen : std::string_view{game.Fen})) return corrupt("bad FEN");
+        if (!DecodeMoves(Pos_, std::span{p, end}, numPlies, game.Moves)) return corrupt("bad moves");
+        return std::nullopt;
+    }
+
+    Archive::Archive(MappedFile data, MappedFile index, uint64_t numGames) noexcept
+        : Data_(std::move(data))
+        , Index_(std::move(index))
+        , NumGames_(numGames)
+    {
+    }
+
+    auto Archive::Open(const std::string& path) noexcept -> std::variant<Archive, SystemError, GenericError> {
+        const auto indexPath = path + std::string{NFormat::kIndexSuffix};
+        auto dataOrError = MappedFile::OpenReadOnly(path, MappedFile::EAccessPattern::Random);
+        if (std::holds_alternative<SystemError>(dataOrError)) return std::get<SystemError>(std::move(dataOrError));
+        auto indexOrError = MappedFile::OpenReadOnly(indexPath);
+        if (std::holds_alternative<SystemError>(indexOrError)) return std::get<SystemError>(std::move(indexOrError));
+        auto& data = std::get<MappedFile>(dataOrError);
+        auto& index = std::get<MappedFile>(indexOrError);
+
+        for (const auto& [file, magic, filePath] : {
+                 std::tuple{&data, NFormat::kDataMagic, &path}, std::tuple{&index, NFormat::kIndexMagic, &indexPath}}) {
+            if (auto what = CheckHeader(file->GetData(), magic)) {
+                return GenericError{
+                    .Value = std::move(*what),
+                    .ContextMessage = "Bad game archive \"" + *filePath + "\"",
+                };
+            }
+        }
+        // A trailing partial entry is left by an interrupted writer
+        const auto numGames = (index.GetData().size() - sizeof(NFormat::FileHeader)) / sizeof(uint64_t);
+        return Archive{std::move(data), std::move(index), numGames};
+    }
+
+    auto Archive::GetRecord(uint64_t n) const noexcept -> std::optional<std::span<const uint8_t>> {
+        const auto data = Data_.GetData();
+        const auto* entry = reinterpret_cast<const uint8_t*>(Index_.GetData().data())
+            + sizeof(NFormat::FileHeader) + n * sizeof(uint64_t);
+        const auto offset = ReadInt<uint64_t>(entry);
+        if (offset > data.size() || data.size() - offset < sizeof(uint32_t)) return std::nullopt;
+        const auto* record = reinterpret_cast<const uint8_t*>(data.data()) + offset;
+        const auto size = ReadInt<uint32_t>(record);
+        if (size > data.size() - offset) return std::nullopt;
+        return std::span{record, size};
+    }
+
+    auto Archive::ReadGame(uint64_t n, GameDecoder& decoder, GameRecord& game) const -> std::optional<GenericError> {
+        const auto record = GetRecord(n);
+        auto err = record ? decoder.Decode(*record, game) : GenericError{"the index points outside the data"};
+        if (err) err->ContextMessage = "Corrupt game " + std::to_string(n);
+        return err;
+    }
+
+    auto Archive::ReadGames(uint64_t first, uint64_t last, ThreadPool& pool, const ArchiveGameCallback& onGame) const
+      -> std::optional<GenericError> {
+        last = std::min(last, NumGames_);
+        auto next = std::atomic<uint64_t>{first};
+        auto failed = std::atomic<bool>{false};
+        auto error = std::optional<GenericError>{};
+        auto errorMutex = std::mutex{};
+        pool.ForkJoin(pool.GetConcurrency(), [&](int) {
+            auto decoder = GameDecoder{};
+            auto game = GameRecord{};
+            while (!failed.load(std::memory_order_relaxed)) {
+                const auto begin = next.fetch_add(kGamesPerTask, std::memory_order_relaxed);
+                if (begin >= last) break;
+                for (auto n = begin; n < std::min(begin + kGamesPerTask, last); ++n) {
+                    if (auto err = ReadGame(n, decoder, game)) {
+                        const auto lock = std::scoped_lock{errorMutex};
+                        if (!error) error = std::move(err);
+                        failed.store(true, std::memory_order_relaxed);
+                        return;
+                    }
+                    onGame(n, game);
+                }
+            }
+        });
+        return error;
+    }
+} // namespace NArchive
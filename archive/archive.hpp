@@ -0,0 +1,160 @@
+#pragma once
+
+
+#include "../chess/position.hpp"
+#include "../chess/types.hpp"
+#include "../primitives/game_id/game_id.hpp"
+#include "../utils/error.hpp"
+#include "../utils/mapped_file/mapped_file.hpp"
+#include "../utils/thread_pool/thread_pool.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+
+namespace NArchive {
+    enum class EGameResult : uint8_t {
+        WhiteWins,
+        BlackWins,
+        Draw,
+        Unknown,
+    };
+
+    struct TimeControl {
+        // Both 0 if unknown
+        uint32_t BaseSeconds = 0;
+        uint32_t IncrementSeconds = 0;
+    };
+
+    struct GameRecord {
+        GameId Id = GameId{0};
+        // At most `NFormat::kMaxStringLength` bytes each
+        std::string White;
+        std::string Black;
+        EGameResult Result = EGameResult::Unknown;
+        TimeControl Control;
+        // Empty for the standard starting position
+        std::string Fen;
+        std::vector<NChess::Move> Moves;
+    };
+
+    /* An archive is two append-only files:
+     *   "<path>": a `FileHeader`, then the game records back to back
+     *   "<path>.idx": a `FileHeader`, then the `uint64_t` offset of every
+     *     game record in the data file, so game `n` is found in O(1)
+     * A record (all integers little-endian) is:
+     *   u32 record size in bytes, u64 game id, u8 result, u8 flags,
+     *   u32 base seconds, u32 increment seconds, u32 number of plies,
+     *   u8 length + bytes of the white and black player names,
+     *   u8 length + bytes of the FEN if `kHasFen` is set,
+     *   the moves (see "move_coder.hpp")
+     * A game is only added to the index after its record is written, so
+     * an interrupted writer leaves, at worst, unreachable bytes at the
+     * end of the data file, which the next writer truncates.
+     */
+    namespace NFormat {
+        static constexpr auto kDataMagic = std::string_view{"CGA1"};
+        static constexpr auto kIndexMagic = std::string_view{"CGI1"};
+        static constexpr auto kVersion = uint32_t{1};
+        static constexpr auto kIndexSuffix = std::string_view{".idx"};
+        static constexpr auto kMaxStringLength = size_t{255};
+        static constexpr auto kHasFen = uint8_t{1};
+        // Up to the player names
+        static constexpr auto kFixedRecordSize = size_t{4 + 8 + 1 + 1 + 4 + 4 + 4};
+
+        struct FileHeader {
+            char Magic[4];
+            uint32_t Version;
+            uint64_t Reserved;
+        };
+        static_assert(sizeof(FileHeader) == 16);
+    } // namespace NFormat
+
+    /* Appends games to an archive, creating it if it doesn't exist.
+     *
+     * Records are encoded into a buffer and written in large batches, so
+     * `Append` only does I/O once the buffer is full. Only one writer may
+     * have an archive open at a time.
+     */
+    class ArchiveWriter {
+    private:
+        static constexpr auto kFlushThreshold = size_t{1} << 20;
+
+        int DataFd_;
+        int IndexFd_;
+        // What has been written so far
+        uint64_t DataFileSize_;
+        uint64_t IndexFileSize_;
+        uint64_t NumGames_;
+        // Not written yet
+        std::vector<uint8_t> DataBuffer_;
+        std::vector<uint8_t> IndexBuffer_;
+        NChess::Position Pos_;
+    private:
+        ArchiveWriter(int dataFd, int indexFd, uint64_t dataFileSize, uint64_t indexFileSize);
+    public:
+        ArchiveWriter(const ArchiveWriter&) = delete;
+        ArchiveWriter(ArchiveWriter&& other) noexcept;
+        ArchiveWriter& operator=(ArchiveWriter&& other) noexcept;
+        // Flushes, ignoring errors: call `Flush()` to see them
+        ~ArchiveWriter() noexcept;
+
+        [[nodiscard]] static auto Open(const std::string& path) noexcept
+          -> std::variant<ArchiveWriter, SystemError, GenericError>;
+
+        // Fails on a bad FEN, an illegal move or a too long name, in which
+        // case nothing is appended, or on a failed write
+        [[nodiscard]] auto Append(const GameRecord& game) -> std::optional<std::variant<SystemError, GenericError>>;
+        [[nodiscard]] auto Flush() noexcept -> std::optional<SystemError>;
+        // Including the games not flushed yet
+        [[nodiscard]] auto GetNumGames() const noexcept -> uint64_t { return NumGames_; }
+    };
+
+    /* Decodes games of an archive, reusing its buffers from game to game.
+     * Each thread reading games needs its own.
+     */
+    class GameDecoder {
+    private:
+        NChess::Position Pos_;
+    public:
+        [[nodiscard]] auto Decode(std::span<const uint8_t> record, GameRecord& game) -> std::optional<GenericError>;
+    };
+
+    // Called concurrently from the reading threads with the game number
+    using ArchiveGameCallback = std::function<void(uint64_t, const GameRecord&)>;
+
+    // A memory-mapped, read-only view of an archive
+    class Archive {
+    private:
+        MappedFile Data_;
+        MappedFile Index_;
+        uint64_t NumGames_;
+    private:
+        Archive(MappedFile data, MappedFile index, uint64_t numGames) noexcept;
+    public:
+        [[nodiscard]] static auto Open(const std::string& path) noexcept
+          -> std::variant<Archive, SystemError, GenericError>;
+
+        [[nodiscard]] auto GetNumGames() const noexcept -> uint64_t { return NumGames_; }
+        [[nodiscard]] auto GetDataSize() const noexcept -> uint64_t { return Data_.GetData().size(); }
+
+        // The raw record of game `n < GetNumGames()`, or nothing if the
+        // index points outside the data file
+        [[nodiscard]] auto GetRecord(uint64_t n) const noexcept -> std::optional<std::span<const uint8_t>>;
+        [[nodiscard]] auto ReadGame(uint64_t n, GameDecoder& decoder, GameRecord& game) const
+          -> std::optional<GenericError>;
+
+        /* Decodes games `[first, last)` on the threads of `pool`, which
+         * take runs of consecutive games, and passes each to `onGame`.
+         * Stops at the first corrupt game and returns its error.
+         */
+        [[nodiscard]] auto ReadGames(uint64_t first, uint64_t last, ThreadPool& pool, const ArchiveGameCallback& onGame)
+          const -> std::optional<GenericError>;
+    };
+} // namespace NArchive
@@ -0,0 +1,149 @@
+#include "move_coder.hpp"
+
+#include "../chess/bitboard.hpp"
+#include "../chess/movegen.hpp"
+
+#include <algorithm>
+#include <bit>
+
+
+namespace {
+    using namespace NChess;
+
+    static constexpr auto kPieceValue = std::array<int, kNumPieceTypes>{1, 3, 3, 5, 9, 0};
+    // An Exp-Golomb code with more leading zeros would encode a
+    // rank far beyond the number of legal moves of any position
+    static constexpr auto kMaxLeadingZeros = 16;
+
+    constexpr auto Centrality(Square s) noexcept -> int {
+        return std::min(FileOf(s), 7 - FileOf(s)) + std::min(RankOf(s), 7 - RankOf(s));
+    }
+
+    /* The likelihood order as one integer: more likely moves have smaller
+     * keys and ties are broken by the raw move, so that the order doesn't
+     * depend on the move generator.
+     */
+    auto SortKey(const Position& pos, Move m) noexcept -> uint64_t {
+        static constexpr auto kBias = int64_t{1} << 30;
+        return uint64_t(kBias - NArchive::MoveLikelihood(pos, m)) << 16 | m.GetRaw();
+    }
+} // anonymous namespace
+
+
+namespace NArchive {
+    auto BitWriter::Write(uint32_t value, int numBits) -> void {
+        Pending_ = Pending_ << numBits | value;
+        NumPending_ += numBits;
+        while (NumPending_ >= 8) {
+            NumPending_ -= 8;
+            Out_.push_back(uint8_t(Pending_ >> NumPending_));
+        }
+    }
+
+    auto BitWriter::WriteExpGolomb(uint32_t value) -> void {
+        const auto shifted = value + (uint32_t{1} << kExpGolombOrder);
+        const auto width = int(std::bit_width(shifted));
+        Write(0, width - 1 - kExpGolombOrder);
+        Write(shifted, width);
+    }
+
+    auto BitWriter::Finish() -> void {
+        if (NumPending_ > 0) Out_.push_back(uint8_t(Pending_ << (8 - NumPending_)));
+        NumPending_ = 0;
+    }
+
+    auto BitReader::Refill() noexcept -> void {
+        while (NumBits_ <= 56 && Next_ != End_) {
+            Window_ |= uint64_t(*Next_++) << (56 - NumBits_);
+            NumBits_ += 8;
+        }
+    }
+
+    auto BitReader::ReadExpGolomb(uint32_t& value) noexcept -> bool {
+        Refill();
+        const auto zeros = std::countl_zero(Window_);
+        if (zeros > kMaxLeadingZeros) return false;
+        const auto width = zeros + 1 + kExpGolombOrder;
+        if (zeros + width > NumBits_) return false;
+        const auto shifted = uint32_t(Window_ << zeros >> (64 - width));
+        Window_ <<= zeros + width;
+        NumBits_ -= zeros + width;
+        value = shifted - (uint32_t{1} << kExpGolombOrder);
+        return true;
+    }
+
+    auto MoveLikelihood(const Position& pos, Move m) noexcept -> int {
+        const auto us = pos.SideToMove();
+        const auto pt = TypeOf(pos.PieceOn(m.From()));
+        if (m.Kind() == Move::Promotion) {
+            // Underpromotions are rare, even compared to quiet moves
+            return m.PromotionType() == Queen ? 2000 : -2000 + kPieceValue[m.PromotionType()];
+        }
+        if (m.Kind() == Move::Castling) return 500;
+
+        auto score = 4 * (Centrality(m.To()) - Centrality(m.From()));
+        if (pt == Pawn) {
+            score += 2;
+        } else if (PawnAttacks(us, m.To()) & pos.Pieces(~us, Pawn)) {
+            // Usually loses the piece to the pawn
+            score -= 50 * kPieceValue[pt];
+        }
+        if (pt == King) score -= 10;
+        if (pos.IsCapture(m)) {
+            const auto captured = m.Kind() == Move::EnPassant ? Pawn : TypeOf(pos.PieceOn(m.To()));
+            score += 1000 + 16 * kPieceValue[captured] - kPieceValue[pt];
+        }
+        return score;
+    }
+
+    auto MoveRank(const Position& pos, Move m) noexcept -> int {
+        auto list = MoveList{};
+        GenerateLegal(pos, list);
+        const auto key = SortKey(pos, m);
+        auto rank = 0;
+        for (const auto other : list) rank += SortKey(pos, other) < key;
+        return rank;
+    }
+
+    auto MoveAtRank(const Position& pos, int rank) noexcept -> Move {
+        auto list = MoveList{};
+        GenerateLegal(pos, list);
+        if (rank < 0 || rank >= list.Size) return Move::None();
+        std::array<uint64_t, kMaxMoves> keys;
+        for (auto i = 0; i < list.Size; ++i) keys[i] = SortKey(pos, list.Moves[i]);
+        // Counting smaller keys is branch-free and vectorizes, which beats
+        // `std::nth_element` on lists of a few dozen moves
+        for (auto i = 0; i < list.Size; ++i) {
+            auto smaller = 0;
+            for (auto j = 0; j < list.Size; ++j) smaller += keys[j] < keys[i];
+            if (smaller == rank) return Move{uint16_t(keys[i])};
+        }
+        return Move::None();
+    }
+
+    auto EncodeMoves(Position& pos, std::span<const Move> moves, std::vector<uint8_t>& out) -> bool {
+        auto writer = BitWriter{out};
+        for (const auto m : moves) {
+            if (!m || !pos.IsPseudoLegal(m) || !pos.IsLegal(m)) return false;
+            writer.WriteExpGolomb(uint32_t(MoveRank(pos, m)));
+            pos.MakeMove(m);
+        }
+        writer.Finish();
+        return true;
+    }
+
+    auto DecodeMoves(Position& pos, std::span<const uint8_t> bytes, uint32_t numPlies, std::vector<Move>& moves)
+      -> bool {
+        moves.clear();
+        auto reader = BitReader{bytes};
+        for (auto ply = uint32_t{0}; ply < numPlies; ++ply) {
+            auto rank = uint32_t{0};
+            if (!reader.ReadExpGolomb(rank)) return false;
+            const auto m = MoveAtRank(pos, int(std::min<uint32_t>(rank, kMaxMoves)));
+            if (!m) return false;
+            pos.MakeMove(m);
+            moves.push_back(m);
+        }
+        return true;
+    }
+} // namespace NArchive
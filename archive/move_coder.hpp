@@ -0,0 +1,76 @@
+#pragma once
+
+
+#include "../chess/position.hpp"
+#include "../chess/types.hpp"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+/* Moves are stored as their rank among the legal moves of the position,
+ * ordered by a fixed guess of how likely each move is to be played, and
+ * the ranks are written with an Exp-Golomb code: the likely moves, which
+ * are most moves of real games, take 3 to 5 bits.
+ *
+ * The ordering is part of the file format: changing `MoveLikelihood`
+ * makes old archives unreadable, so it must come with a new version.
+ */
+namespace NArchive {
+    // Exp-Golomb order: ranks 0-3 take 3 bits, 4-11 take 5 bits, ...
+    static constexpr auto kExpGolombOrder = 2;
+
+    // Appends bits most significant first to a byte buffer
+    class BitWriter {
+    private:
+        std::vector<uint8_t>& Out_;
+        uint64_t Pending_ = 0;
+        int NumPending_ = 0;
+    public:
+        explicit BitWriter(std::vector<uint8_t>& out) noexcept : Out_(out) {}
+
+        // `numBits <= 32`
+        auto Write(uint32_t value, int numBits) -> void;
+        auto WriteExpGolomb(uint32_t value) -> void;
+        // Pads the last byte with zeros
+        auto Finish() -> void;
+    };
+
+    class BitReader {
+    private:
+        const uint8_t* Next_;
+        const uint8_t* End_;
+        // The next bits, left-aligned
+        uint64_t Window_ = 0;
+        int NumBits_ = 0;
+    private:
+        auto Refill() noexcept -> void;
+    public:
+        explicit BitReader(std::span<const uint8_t> bytes) noexcept
+            : Next_(bytes.data())
+            , End_(bytes.data() + bytes.size())
+        {
+        }
+
+        // False if the input ends or the code is too long to be valid
+        [[nodiscard]] auto ReadExpGolomb(uint32_t& value) noexcept -> bool;
+    };
+
+    // Higher for moves that are more often played
+    [[nodiscard]] auto MoveLikelihood(const NChess::Position& pos, NChess::Move m) noexcept -> int;
+
+    // The position of the legal move `m` in the likelihood order
+    [[nodiscard]] auto MoveRank(const NChess::Position& pos, NChess::Move m) noexcept -> int;
+    // `Move::None()` if there are at most `rank` legal moves
+    [[nodiscard]] auto MoveAtRank(const NChess::Position& pos, int rank) noexcept -> NChess::Move;
+
+    /* Both play the moves on `pos` and leave it at the end of the game.
+     * Encoding fails on an illegal move, decoding on a corrupt stream.
+     */
+    [[nodiscard]] auto EncodeMoves(NChess::Position& pos, std::span<const NChess::Move> moves, std::vector<uint8_t>& out)
+      -> bool;
+    [[nodiscard]] auto DecodeMoves(
+        NChess::Position& pos, std::span<const uint8_t> bytes, uint32_t numPlies, std::vector<NChess::Move>& moves
+    ) -> bool;
+} // namespace NArchive
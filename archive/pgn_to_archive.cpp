@@ -0,0 +1,102 @@
+#include "archive.hpp"
+
+#include "../pgn/pgn_importer.hpp"
+#include "../utils/cli_args.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+
+namespace {
+    using namespace NArchive;
+
+    auto ToGameResult(NPgn::EResult result) noexcept -> EGameResult {
+        switch (result) {
+            case NPgn::EResult::WhiteWins: return EGameResult::WhiteWins;
+            case NPgn::EResult::BlackWins: return EGameResult::BlackWins;
+            case NPgn::EResult::Draw: return EGameResult::Draw;
+            case NPgn::EResult::Unknown: return EGameResult::Unknown;
+        }
+        return EGameResult::Unknown;
+    }
+
+    // "300+2" or "300", as in the PGN standard
+    auto ParseTimeControl(std::string_view tag) noexcept -> TimeControl {
+        auto control = TimeControl{};
+        const auto* end = tag.data() + tag.size();
+        const auto [plus, ec] = std::from_chars(tag.data(), end, control.BaseSeconds);
+        if (ec == std::errc{} && plus != end && *plus == '+') {
+            std::from_chars(plus + 1, end, control.IncrementSeconds);
+        }
+        return control;
+    }
+} // anonymous namespace
+
+
+// Usage: pgn_to_archive <file.pgn> <archive> [threads = all cores]
+// Appends the games of the PGN file to the archive, then reads the
+// whole archive back and reports the size per ply and the throughput
+auto main(int argc, char** argv) -> int {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <file.pgn> <archive> [threads = all cores]\n";
+        return EXIT_FAILURE;
+    }
+    const auto defaultThreads = int(std::max(std::thread::hardware_concurrency(), 1u));
+    const auto numThreads = std::max(argc > 3 ? ParseIntArg(argv[3], defaultThreads) : defaultThreads, 1);
+    // This thread works too
+    auto pool = ThreadPool{numThreads - 1};
+
+    {
+        auto writerOrError = ArchiveWriter::Open(argv[2]);
+        if (auto* err = std::get_if<SystemError>(&writerOrError)) LogErrorAndExit(*err);
+        if (auto* err = std::get_if<GenericError>(&writerOrError)) LogErrorAndExit(*err);
+        auto& writer = std::get<ArchiveWriter>(writerOrError);
+
+        // The games come from several threads, so their
+        // order in the archive is not the order in the file
+        auto mutex = std::mutex{};
+        auto record = GameRecord{};
+        auto statsOrError = NPgn::ImportFile(argv[1], pool, [&](const NPgn::Game& game) {
+            const auto lock = std::scoped_lock{mutex};
+            record.Id = GameId::CreateRandom();
+            record.White = game.FindTag("White").value_or("").substr(0, NFormat::kMaxStringLength);
+            record.Black = game.FindTag("Black").value_or("").substr(0, NFormat::kMaxStringLength);
+            record.Result = ToGameResult(game.Result);
+            record.Control = ParseTimeControl(game.FindTag("TimeControl").value_or(""));
+            record.Fen = game.Fen;
+            record.Moves.assign(game.Moves.begin(), game.Moves.end());
+            if (auto err = writer.Append(record)) {
+                std::visit([](const auto& e) { LogErrorAndExit(e); }, *err);
+            }
+        });
+        if (auto* err = std::get_if<SystemError>(&statsOrError)) LogErrorAndExit(*err);
+        if (auto err = writer.Flush()) LogErrorAndExit(*err);
+        std::cout << "Imported:   " << std::get<NPgn::ImportStats>(statsOrError).Games << " games\n";
+    }
+
+    auto archiveOrError = Archive::Open(argv[2]);
+    if (auto* err = std::get_if<SystemError>(&archiveOrError)) LogErrorAndExit(*err);
+    if (auto* err = std::get_if<GenericError>(&archiveOrError)) LogErrorAndExit(*err);
+    const auto& archive = std::get<Archive>(archiveOrError);
+
+    const auto start = std::chrono::steady_clock::now();
+    auto plies = std::atomic<uint64_t>{0};
+    const auto err = archive.ReadGames(0, archive.GetNumGames(), pool, [&plies](uint64_t, const GameRecord& game) {
+        plies.fetch_add(game.Moves.size(), std::memory_order_relaxed);
+    });
+    if (err) LogErrorAndExit(*err);
+    const auto ms = std::max<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count(), 1);
+    std::cout << "Archive:    " << archive.GetNumGames() << " games, " << plies << " plies, "
+              << archive.GetDataSize() << " bytes\n"
+              << "Per ply:    " << double(archive.GetDataSize()) / double(std::max<uint64_t>(plies, 1))
+              << " bytes, including the game headers\n"
+              << "Read time:  " << ms << "ms on " << numThreads << " threads, "
+              << plies * 1000 / ms << " plies/s\n";
+}
@@ -0,0 +1,343 @@
+#include "position_index.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <queue>
+#include <unistd.h>
+#include <vector>
+
+
+namespace {
+    using namespace NArchive;
+
+    static constexpr auto kStartFen =
+        std::string_view{"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"};
+    // Games handed to a replaying thread at a time
+    static constexpr auto kGamesPerTask = uint64_t{64};
+
+    struct Run {
+        // In entries, in the runs file
+        uint64_t Offset;
+        uint64_t Size;
+    };
+
+    auto MakeSystemError(ErrorContext what) -> SystemError {
+        return SystemError{.Value = std::errc{errno}, .ContextMessage = std::move(what)};
+    }
+
+    auto PwriteAll(int fd, const void* data, size_t size, uint64_t offset) noexcept -> std::optional<SystemError> {
+        for (auto done = size_t{0}; done < size;) {
+            const auto n = pwrite(fd, static_cast<const char*>(data) + done, size - done, off_t(offset + done));
+            if (n == -1 && errno == EINTR) continue;
+            if (n == -1) return MakeSystemError("pwrite() syscall failed (" SOURCE_LOCATION ")");
+            done += size_t(n);
+        }
+        return std::nullopt;
+    }
+
+    // Writes a section of a file sequentially in large blocks
+    class SectionWriter {
+    private:
+        static constexpr auto kBufferSize = size_t{1} << 20;
+
+        int Fd_;
+        uint64_t Offset_;
+        std::vector<char> Buffer_;
+        std::optional<SystemError> Error_;
+    public:
+        SectionWriter(int fd, uint64_t offset) : Fd_(fd), Offset_(offset) {
+            Buffer_.reserve(kBufferSize);
+        }
+
+        template <class T>
+        auto Write(const T& value) -> void {
+            const auto* bytes = reinterpret_cast<const char*>(&value);
+            Buffer_.insert(Buffer_.end(), bytes, bytes + sizeof(T));
+            if (Buffer_.size() >= kBufferSize) Flush();
+        }
+
+        auto Flush() -> void {
+            if (!Error_) Error_ = PwriteAll(Fd_, Buffer_.data(), Buffer_.size(), Offset_);
+            Offset_ += Buffer_.size();
+            Buffer_.clear();
+        }
+
+        // The first error of all writes
+        auto Finish() -> std::optional<SystemError> {
+            Flush();
+            return std::move(Error_);
+        }
+    };
+
+    // Calls `onEntry` with the entries of all runs in sorted order
+    template <class F>
+    auto MergeRuns(std::span<const PositionEntry> runsData, std::span<const Run> runs, F&& onEntry) -> void {
+        using Head = std::pair<PositionEntry, size_t>;
+        auto heap = std::priority_queue<Head, std::vector<Head>, std::greater<Head>>{};
+        auto positions = std::vector<uint64_t>(runs.size());
+        for (auto i = size_t{0}; i < runs.size(); ++i) {
+            if (runs[i].Size > 0) heap.emplace(runsData[runs[i].Offset], i);
+        }
+        while (!heap.empty()) {
+            const auto [entry, run] = heap.top();
+            heap.pop();
+            onEntry(entry);
+            if (++positions[run] < runs[run].Size) {
+                heap.emplace(runsData[runs[run].Offset + positions[run]], run);
+            }
+        }
+    }
+
+    // The index of the first key that is not less than `key`
+    auto LowerBound(std::span<const uint64_t> keys, uint64_t key) noexcept -> size_t {
+        if (keys.empty()) return 0;
+        const auto* base = keys.data();
+        auto size = keys.size();
+        while (size > 1) {
+            const auto half = size / 2;
+            // The next probe is in one of the two halves: fetching both
+            // hides most of the cache misses of a large index
+            __builtin_prefetch(base + half / 2);
+            __builtin_prefetch(base + half + half / 2);
+            base = base[half] < key ? base + half : base;
+            size -= half;
+        }
+        return size_t(base - keys.data()) + (*base < key);
+    }
+} // anonymous namespace
+
+
+namespace NArchive {
+    auto BuildPositionIndex(const Archive& archive, const std::string& path, ThreadPool& pool, size_t entriesPerRun)
+      -> std::variant<PositionIndexStats, SystemError, GenericError> {
+        const auto start = std::chrono::steady_clock::now();
+        const auto numGames = archive.GetNumGames();
+        if (numGames > UINT32_MAX) return GenericError{"too many games for a position index"};
+        entriesPerRun = std::max<size_t>(entriesPerRun, 1);
+
+        const auto runsPath = path + ".runs.tmp";
+        const auto runsFd = open(runsPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (runsFd == -1) {
+            return SystemError{
+                .Value = std::errc{errno},
+                .ContextMessage = "open() syscall failed for \"" + runsPath + "\" (" SOURCE_LOCATION ")",
+            };
+        }
+        const auto cleanUp = [&runsPath, runsFd]() {
+            close(runsFd);
+            std::remove(runsPath.c_str());
+        };
+
+        // Replay every game, spilling sorted runs of entries
+        auto runs = std::vector<Run>{};
+        auto runsEnd = uint64_t{0};
+        auto nextGame = std::atomic<uint64_t>{0};
+        auto failed = std::atomic<bool>{false};
+        auto error = std::optional<std::variant<SystemError, GenericError>>{};
+        auto mutex = std::mutex{};
+        const auto fail = [&](std::variant<SystemError, GenericError> err) {
+            const auto lock = std::scoped_lock{mutex};
+            if (!error) error = std::move(err);
+            failed.store(true, std::memory_order_relaxed);
+        };
+        // One run buffer per task, each taking games in turn
+        pool.ForkJoin(pool.GetConcurrency(), [&](int) {
+            auto decoder = GameDecoder{};
+            auto game = GameRecord{};
+            auto pos = NChess::Position{};
+            auto gameKeys = std::vector<uint64_t>{};
+            auto entries = std::vector<PositionEntry>{};
+            entries.reserve(entriesPerRun);
+
+            const auto spill = [&]() {
+                std::sort(entries.begin(), entries.end());
+                auto offset = uint64_t{0};
+                {
+                    const auto lock = std::scoped_lock{mutex};
+                    offset = runsEnd;
+                    runsEnd += entries.size();
+                    runs.push_back(Run{.Offset = offset, .Size = entries.size()});
+                }
+                const auto bytes = entries.size() * sizeof(PositionEntry);
+                if (auto err = PwriteAll(runsFd, entries.data(), bytes, offset * sizeof(PositionEntry))) {
+                    fail(std::move(*err));
+                }
+                entries.clear();
+            };
+            // Positions can only repeat since the last irreversible
+            // move, so only those are checked for a repetition
+            const auto add = [&](uint32_t gameNumber, int ply) {
+                const auto key = pos.Key();
+                const auto window = std::min<size_t>(size_t(pos.Rule50()), gameKeys.size());
+                if (std::find(gameKeys.end() - window, gameKeys.end(), key) == gameKeys.end()) {
+                    entries.push_back(PositionEntry{
+                        .Key = key,
+                        .Game = gameNumber,
+                        .Ply = uint16_t(ply),
+                        .Result = game.Result,
+                    });
+                    if (entries.size() == entriesPerRun) spill();
+                }
+                gameKeys.push_back(key);
+            };
+
+            while (!failed.load(std::memory_order_relaxed)) {
+                const auto begin = nextGame.fetch_add(kGamesPerTask, std::memory_order_relaxed);
+                if (begin >= numGames) break;
+                for (auto n = begin; n < std::min(begin + kGamesPerTask, numGames); ++n) {
+                    if (auto err = archive.ReadGame(n, decoder, game)) return fail(std::move(*err));
+                    if (pos.SetFromFen(game.Fen.empty() ? kStartFen : std::string_view{game.Fen})) {
+                        return fail(GenericError{"bad FEN in game " + std::to_string(n)});
+                    }
+                    gameKeys.clear();
+                    const auto numPlies = std::min<size_t>(game.Moves.size(), UINT16_MAX);
+                    add(uint32_t(n), 0);
+                    for (auto ply = size_t{0}; ply < numPlies; ++ply) {
+                        pos.MakeMove(game.Moves[ply]);
+                        add(uint32_t(n), int(ply + 1));
+                    }
+                }
+            }
+            if (!entries.empty()) spill();
+        });
+        if (error) {
+            cleanUp();
+            return std::visit([](auto&& err) -> std::variant<PositionIndexStats, SystemError, GenericError> {
+                return std::move(err);
+            }, std::move(*error));
+        }
+
+        auto runsFileOrError = MappedFile::OpenReadOnly(runsPath, MappedFile::EAccessPattern::Normal);
+        if (std::holds_alternative<SystemError>(runsFileOrError)) {
+            cleanUp();
+            return std::get<SystemError>(std::move(runsFileOrError));
+        }
+        const auto& runsFile = std::get<MappedFile>(runsFileOrError);
+        const auto runsData = std::span{
+            reinterpret_cast<const PositionEntry*>(runsFile.GetData().data()),
+            runsFile.GetData().size() / sizeof(PositionEntry),
+        };
+
+        // The sections are laid out by the number of distinct keys, so
+        // the runs are merged once to count them and once to write
+        auto numKeys = uint64_t{0};
+        auto lastKey = uint64_t{0};
+        MergeRuns(runsData, runs, [&](const PositionEntry& entry) {
+            numKeys += numKeys == 0 || entry.Key != lastKey;
+            lastKey = entry.Key;
+        });
+
+        const auto tmpPath = path + ".tmp";
+        const auto fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd == -1) {
+            const auto err = errno;
+            cleanUp();
+            return SystemError{
+                .Value = std::errc{err},
+                .ContextMessage = "open() syscall failed for \"" + tmpPath + "\" (" SOURCE_LOCATION ")",
+            };
+        }
+        const auto header = NPositionFormat::FileHeader{
+            .Magic = {'C', 'P', 'I', '1'},
+            .Version = NPositionFormat::kVersion,
+            .NumKeys = numKeys,
+            .NumEntries = runsEnd,
+            .Reserved = 0,
+        };
+        const auto statsOffset = sizeof(header) + numKeys * sizeof(uint64_t);
+        const auto entriesOffset = statsOffset + numKeys * sizeof(PositionStats);
+        auto keysWriter = SectionWriter{fd, sizeof(header)};
+        auto statsWriter = SectionWriter{fd, statsOffset};
+        auto entriesWriter = SectionWriter{fd, entriesOffset};
+        auto stats = PositionStats{};
+        auto numEntries = uint64_t{0};
+        MergeRuns(runsData, runs, [&](const PositionEntry& entry) {
+            if (numEntries == 0 || entry.Key != lastKey) {
+                if (numEntries > 0) statsWriter.Write(stats);
+                keysWriter.Write(entry.Key);
+                stats = PositionStats{.FirstEntry = numEntries, .Results = {}};
+                lastKey = entry.Key;
+            }
+            ++stats.Results[uint8_t(entry.Result)];
+            entriesWriter.Write(entry);
+            ++numEntries;
+        });
+        if (numEntries > 0) statsWriter.Write(stats);
+
+        auto writeError = PwriteAll(fd, &header, sizeof(header), 0);
+        for (auto* writer : {&keysWriter, &statsWriter, &entriesWriter}) {
+            auto err = writer->Finish();
+            if (!writeError) writeError = std::move(err);
+        }
+        close(fd);
+        cleanUp();
+        if (writeError) return std::move(*writeError);
+        if (std::rename(tmpPath.c_str(), path.c_str()) == -1) {
+            return SystemError{
+                .Value = std::errc{errno},
+                .ContextMessage = "rename() failed for \"" + tmpPath + "\" (" SOURCE_LOCATION ")",
+            };
+        }
+        return PositionIndexStats{
+            .Games = numGames,
+            .Entries = numEntries,
+            .Keys = numKeys,
+            .Runs = runs.size(),
+            .Time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start),
+        };
+    }
+
+    PositionIndex::PositionIndex(MappedFile file) noexcept
+        : File_(std::move(file))
+    {
+        // `Open` has checked the sizes, and the sections are 8-byte aligned
+        const auto* data = File_.GetData().data();
+        auto header = NPositionFormat::FileHeader{};
+        std::memcpy(&header, data, sizeof(header));
+        const auto* keys = data + sizeof(header);
+        const auto* stats = keys + header.NumKeys * sizeof(uint64_t);
+        const auto* entries = stats + header.NumKeys * sizeof(PositionStats);
+        Keys_ = {reinterpret_cast<const uint64_t*>(keys), header.NumKeys};
+        Stats_ = {reinterpret_cast<const PositionStats*>(stats), header.NumKeys};
+        Entries_ = {reinterpret_cast<const PositionEntry*>(entries), header.NumEntries};
+    }
+
+    auto PositionIndex::Open(const std::string& path) noexcept
+      -> std::variant<PositionIndex, SystemError, GenericError> {
+        auto fileOrError = MappedFile::OpenReadOnly(path, MappedFile::EAccessPattern::Random);
+        if (std::holds_alternative<SystemError>(fileOrError)) {
+            return std::get<SystemError>(std::move(fileOrError));
+        }
+        auto& file = std::get<MappedFile>(fileOrError);
+        const auto data = file.GetData();
+        const auto bad = [&path](std::string what) {
+            return GenericError{
+                .Value = std::move(what),
+                .ContextMessage = "Bad position index \"" + path + "\"",
+            };
+        };
+
+        auto header = NPositionFormat::FileHeader{};
+        if (data.size() < sizeof(header)) return bad("file is too short");
+        std::memcpy(&header, data.data(), sizeof(header));
+        if (std::string_view{header.Magic, 4} != NPositionFormat::kMagic) return bad("wrong magic");
+        if (header.Version != NPositionFormat::kVersion) {
+            return bad("unsupported version " + std::to_string(header.Version));
+        }
+        const auto expectedSize = sizeof(header) + header.NumKeys * (sizeof(uint64_t) + sizeof(PositionStats))
+            + header.NumEntries * sizeof(PositionEntry);
+        if (header.NumKeys > header.NumEntries || data.size() != expectedSize) return bad("wrong file size");
+        return PositionIndex{std::move(file)};
+    }
+
+    auto PositionIndex::Find(uint64_t key) const noexcept -> std::optional<PositionStats> {
+        const auto i = LowerBound(Keys_, key);
+        if (i == Keys_.size() || Keys_[i] != key) return std::nullopt;
+        return Stats_[i];
+    }
+} // namespace NArchive
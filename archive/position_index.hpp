@@ -0,0 +1,115 @@
+#pragma once
+
+
+#include "archive.hpp"
+
+#include "../utils/error.hpp"
+#include "../utils/mapped_file/mapped_file.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <variant>
+
+
+/* An index of every position reached in the games of an archive, to
+ * answer "which games went through this position, and how did they end"
+ * without replaying anything.
+ */
+namespace NArchive {
+    // One game reaching a position; a game that repeats
+    // a position only has an entry for the first time
+    struct PositionEntry {
+        // `Position::Key()`
+        uint64_t Key;
+        uint32_t Game;
+        uint16_t Ply;
+        EGameResult Result;
+        uint8_t Reserved = 0;
+
+        auto operator<=>(const PositionEntry&) const noexcept = default;
+    };
+    static_assert(sizeof(PositionEntry) == 16);
+
+    struct PositionStats {
+        // Index of the first entry of the position
+        uint64_t FirstEntry;
+        // Number of games by `EGameResult`
+        std::array<uint32_t, 4> Results;
+
+        auto GetNumGames() const noexcept -> uint64_t {
+            return uint64_t(Results[0]) + Results[1] + Results[2] + Results[3];
+        }
+    };
+    static_assert(sizeof(PositionStats) == 24);
+
+    /* The ".pos" file: a `FileHeader`, then three sections
+     *   keys: the `NumKeys` distinct position keys, sorted
+     *   stats: the `PositionStats` of each key, in the same order
+     *   entries: the `NumEntries` entries sorted by key, game and ply
+     * all little-endian and 8-byte aligned, so they are used in place.
+     */
+    namespace NPositionFormat {
+        static constexpr auto kMagic = std::string_view{"CPI1"};
+        static constexpr auto kVersion = uint32_t{1};
+        static constexpr auto kSuffix = std::string_view{".pos"};
+
+        struct FileHeader {
+            char Magic[4];
+            uint32_t Version;
+            uint64_t NumKeys;
+            uint64_t NumEntries;
+            uint64_t Reserved;
+        };
+        static_assert(sizeof(FileHeader) == 32);
+    } // namespace NPositionFormat
+
+    struct PositionIndexStats {
+        uint64_t Games = 0;
+        uint64_t Entries = 0;
+        uint64_t Keys = 0;
+        // Sorted runs spilled to disk and merged
+        uint64_t Runs = 0;
+        std::chrono::milliseconds Time{0};
+    };
+
+    /* Replays the games on the threads of `pool`, each collecting entries
+     * until it holds `entriesPerRun` of them, then sorting them and
+     * appending them as a run to a temporary file. The runs are merged
+     * into the index, so memory use doesn't depend on the archive size.
+     * The index is written next to its final path and renamed, so that
+     * readers never see a partial one.
+     */
+    [[nodiscard]] auto BuildPositionIndex(
+        const Archive& archive,
+        const std::string& path,
+        ThreadPool& pool,
+        size_t entriesPerRun = size_t{1} << 22
+    ) -> std::variant<PositionIndexStats, SystemError, GenericError>;
+
+    class PositionIndex {
+    private:
+        MappedFile File_;
+        std::span<const uint64_t> Keys_;
+        std::span<const PositionStats> Stats_;
+        std::span<const PositionEntry> Entries_;
+    private:
+        explicit PositionIndex(MappedFile file) noexcept;
+    public:
+        [[nodiscard]] static auto Open(const std::string& path) noexcept
+          -> std::variant<PositionIndex, SystemError, GenericError>;
+
+        [[nodiscard]] auto GetNumKeys() const noexcept -> uint64_t { return Keys_.size(); }
+        [[nodiscard]] auto GetNumEntries() const noexcept -> uint64_t { return Entries_.size(); }
+
+        // A branch-free binary search over the keys
+        [[nodiscard]] auto Find(uint64_t key) const noexcept -> std::optional<PositionStats>;
+        // The games reaching the position, by game number
+        [[nodiscard]] auto GetEntries(const PositionStats& stats) const noexcept -> std::span<const PositionEntry> {
+            return Entries_.subspan(stats.FirstEntry, stats.GetNumGames());
+        }
+    };
+} // namespace NArchive
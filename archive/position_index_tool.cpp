@@ -0,0 +1,87 @@
+#include "archive.hpp"
+#include "position_index.hpp"
+
+#include "../utils/cli_args.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string_view>
+#include <thread>
+
+
+namespace {
+    using namespace NArchive;
+
+    auto OpenArchive(const std::string& path) -> Archive {
+        auto archiveOrError = Archive::Open(path);
+        if (auto* err = std::get_if<SystemError>(&archiveOrError)) LogErrorAndExit(*err);
+        if (auto* err = std::get_if<GenericError>(&archiveOrError)) LogErrorAndExit(*err);
+        return std::get<Archive>(std::move(archiveOrError));
+    }
+
+    auto Build(const std::string& archivePath, int numThreads) -> void {
+        const auto archive = OpenArchive(archivePath);
+        // This thread works too
+        auto pool = ThreadPool{numThreads - 1};
+        auto statsOrError = BuildPositionIndex(archive, archivePath + std::string{NPositionFormat::kSuffix}, pool);
+        if (auto* err = std::get_if<SystemError>(&statsOrError)) LogErrorAndExit(*err);
+        if (auto* err = std::get_if<GenericError>(&statsOrError)) LogErrorAndExit(*err);
+        const auto& stats = std::get<PositionIndexStats>(statsOrError);
+        std::cout << "Games:     " << stats.Games << "\n"
+                  << "Entries:   " << stats.Entries << "\n"
+                  << "Positions: " << stats.Keys << "\n"
+                  << "Runs:      " << stats.Runs << "\n"
+                  << "Time:      " << stats.Time.count() << "ms on " << numThreads << " threads\n";
+    }
+
+    auto Query(const std::string& archivePath, std::string_view fen, int maxGames) -> void {
+        auto pos = NChess::Position{};
+        if (auto err = pos.SetFromFen(fen)) LogErrorAndExit(*err);
+        auto indexOrError = PositionIndex::Open(archivePath + std::string{NPositionFormat::kSuffix});
+        if (auto* err = std::get_if<SystemError>(&indexOrError)) LogErrorAndExit(*err);
+        if (auto* err = std::get_if<GenericError>(&indexOrError)) LogErrorAndExit(*err);
+        const auto& index = std::get<PositionIndex>(indexOrError);
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto stats = index.Find(pos.Key());
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        if (!stats) {
+            std::cout << "No game reaches this position (" << us.count() << "us)\n";
+            return;
+        }
+        std::cout << stats->GetNumGames() << " games (" << us.count() << "us): +"
+                  << stats->Results[uint8_t(EGameResult::WhiteWins)] << " ="
+                  << stats->Results[uint8_t(EGameResult::Draw)] << " -"
+                  << stats->Results[uint8_t(EGameResult::BlackWins)] << " *"
+                  << stats->Results[uint8_t(EGameResult::Unknown)] << "\n";
+
+        const auto archive = OpenArchive(archivePath);
+        auto decoder = GameDecoder{};
+        auto game = GameRecord{};
+        for (const auto& entry : index.GetEntries(*stats).first(std::min<uint64_t>(stats->GetNumGames(), maxGames))) {
+            if (auto err = archive.ReadGame(entry.Game, decoder, game)) LogErrorAndExit(*err);
+            std::cout << "  #" << entry.Game << " " << game.Id << " " << game.White << " - " << game.Black
+                      << ", ply " << entry.Ply << "\n";
+        }
+    }
+} // anonymous namespace
+
+
+// Usage: position_index build <archive> [threads = all cores]
+//        position_index query <archive> <fen> [max games = 10]
+// The index of "<archive>" is "<archive>.pos"
+auto main(int argc, char** argv) -> int {
+    const auto command = std::string_view{argc > 1 ? argv[1] : ""};
+    if (argc < 3 || (command != "build" && command != "query") || (command == "query" && argc < 4)) {
+        std::cerr << "Usage: " << argv[0] << " build <archive> [threads = all cores]\n"
+                  << "       " << argv[0] << " query <archive> <fen> [max games = 10]\n";
+        return EXIT_FAILURE;
+    }
+    if (command == "build") {
+        const auto defaultThreads = int(std::max(std::thread::hardware_concurrency(), 1u));
+        Build(argv[2], std::max(argc > 3 ? ParseIntArg(argv[3], defaultThreads) : defaultThreads, 1));
+    } else {
+        Query(argv[2], argv[3], std::max(argc > 4 ? ParseIntArg(argv[4], 10) : 10, 0));
+    }
+}
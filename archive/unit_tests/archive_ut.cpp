@@ -0,0 +1,213 @@
+#include "../archive.hpp"
+#include "../move_coder.hpp"
+
+#include "../../chess/movegen.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <vector>
+
+
+namespace {
+using namespace NArchive;
+using namespace NChess;
+
+static const auto kPath = std::string{"/tmp/archive_ut.cga"};
+
+auto RemoveArchive() -> void {
+    std::remove(kPath.c_str());
+    std::remove((kPath + ".idx").c_str());
+}
+
+// A game of random legal moves, so that all kinds of moves and ranks show up
+auto RandomGame(std::mt19937_64& rng, uint64_t id) -> GameRecord {
+    auto game = GameRecord{
+        .Id = GameId{id},
+        .White = "white " + std::to_string(id),
+        .Black = std::string(id % 3 == 0 ? 255 : 0, 'b'),
+        .Result = EGameResult(id % 4),
+        .Control = TimeControl{.BaseSeconds = uint32_t(id), .IncrementSeconds = 2},
+        .Fen = {},
+        .Moves = {},
+    };
+    if (id % 5 == 0) game.Fen = "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1";
+    auto pos = Position{};
+    assert(!pos.SetFromFen(game.Fen.empty() ? "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1" : game.Fen));
+    const auto length = rng() % 120;
+    for (auto ply = uint64_t{0}; ply < length; ++ply) {
+        auto list = MoveList{};
+        GenerateLegal(pos, list);
+        if (list.Size == 0) break;
+        const auto m = list.Moves[rng() % list.Size];
+        pos.MakeMove(m);
+        game.Moves.push_back(m);
+    }
+    return game;
+}
+
+auto SameGame(const GameRecord& a, const GameRecord& b) -> bool {
+    return a.Id == b.Id && a.White == b.White && a.Black == b.Black && a.Result == b.Result
+        && a.Control.BaseSeconds == b.Control.BaseSeconds && a.Control.IncrementSeconds == b.Control.IncrementSeconds
+        && a.Fen == b.Fen && a.Moves == b.Moves;
+}
+
+auto OpenArchive() -> Archive {
+    auto archiveOrError = Archive::Open(kPath);
+    assert(std::holds_alternative<Archive>(archiveOrError));
+    return std::get<Archive>(std::move(archiveOrError));
+}
+} // anonymous namespace
+
+
+namespace NTests {
+auto TestExpGolomb() -> void {
+    auto bytes = std::vector<uint8_t>{};
+    auto writer = BitWriter{bytes};
+    for (auto v = uint32_t{0}; v < 1000; ++v) writer.WriteExpGolomb(v);
+    writer.Finish();
+    auto reader = BitReader{bytes};
+    for (auto v = uint32_t{0}; v < 1000; ++v) {
+        auto read = uint32_t{0};
+        assert(reader.ReadExpGolomb(read) && read == v);
+    }
+    auto read = uint32_t{0};
+    assert(!reader.ReadExpGolomb(read));
+
+    // Ranks 0-3 take 3 bits
+    bytes.clear();
+    auto small = BitWriter{bytes};
+    for (auto i = 0; i < 8; ++i) small.WriteExpGolomb(uint32_t(i % 4));
+    small.Finish();
+    assert(bytes.size() == 3);
+    std::cerr << "TestExpGolomb OK\n";
+}
+
+auto TestMoveRanks() -> void {
+    auto pos = Position{};
+    assert(!pos.SetFromFen("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1"));
+    auto list = MoveList{};
+    GenerateLegal(pos, list);
+    auto seen = std::vector<bool>(list.Size);
+    for (const auto m : list) {
+        const auto rank = MoveRank(pos, m);
+        assert(rank >= 0 && rank < list.Size && !seen[rank]);
+        seen[rank] = true;
+        assert(MoveAtRank(pos, rank) == m);
+    }
+    assert(MoveAtRank(pos, list.Size) == Move::None());
+    // The queen promotion with capture beats the quiet moves
+    assert(MoveRank(pos, Move{B2, A1, Move::Promotion, Queen}) < 3
+        || MoveRank(pos, Move{B7, A8, Move::Promotion, Queen}) < 3);
+    std::cerr << "TestMoveRanks OK\n";
+}
+
+auto TestWriteAndRead() -> void {
+    RemoveArchive();
+    auto rng = std::mt19937_64{42};
+    auto games = std::vector<GameRecord>{};
+    for (auto id = uint64_t{0}; id < 300; ++id) games.push_back(RandomGame(rng, id));
+    {
+        auto writerOrError = ArchiveWriter::Open(kPath);
+        assert(std::holds_alternative<ArchiveWriter>(writerOrError));
+        auto& writer = std::get<ArchiveWriter>(writerOrError);
+        for (auto i = 0; i < 200; ++i) assert(!writer.Append(games[i]));
+        assert(writer.GetNumGames() == 200);
+
+        // Nothing is appended for a bad game
+        auto bad = games[0];
+        bad.Moves.push_back(Move{A1, A1});
+        assert(writer.Append(bad));
+        bad = games[0];
+        bad.Fen = "8/8/8/8/8/8/8/8 w - - 0 1";
+        assert(writer.Append(bad));
+        assert(writer.GetNumGames() == 200);
+    }
+    {
+        // Appending to an existing archive
+        auto writerOrError = ArchiveWriter::Open(kPath);
+        assert(std::holds_alternative<ArchiveWriter>(writerOrError));
+        auto& writer = std::get<ArchiveWriter>(writerOrError);
+        assert(writer.GetNumGames() == 200);
+        for (auto i = 200; i < 300; ++i) assert(!writer.Append(games[i]));
+        assert(!writer.Flush());
+    }
+
+    const auto archive = OpenArchive();
+    assert(archive.GetNumGames() == 300);
+    auto decoder = GameDecoder{};
+    auto game = GameRecord{};
+    for (const auto n : {0, 1, 150, 299, 5, 10}) {
+        assert(!archive.ReadGame(n, decoder, game));
+        assert(SameGame(game, games[n]));
+    }
+
+    for (const auto threads : {1, 4}) {
+        auto mutex = std::mutex{};
+        auto seen = std::vector<bool>(300);
+        auto pool = ThreadPool{threads - 1};
+        const auto err = archive.ReadGames(10, 1000, pool, [&](uint64_t n, const GameRecord& g) {
+            const auto lock = std::scoped_lock{mutex};
+            assert(!seen[n] && SameGame(g, games[n]));
+            seen[n] = true;
+        });
+        assert(!err);
+        for (auto n = 0; n < 300; ++n) assert(seen[n] == (n >= 10));
+    }
+    std::cerr << "TestWriteAndRead OK\n";
+}
+
+// A writer that died mid-write leaves unindexed bytes and maybe a partial
+// index entry: readers ignore them and the next writer drops them
+auto TestInterruptedWrite() -> void {
+    RemoveArchive();
+    auto rng = std::mt19937_64{7};
+    const auto first = RandomGame(rng, 1);
+    const auto second = RandomGame(rng, 2);
+    {
+        auto writerOrError = ArchiveWriter::Open(kPath);
+        assert(!std::get<ArchiveWriter>(writerOrError).Append(first));
+    }
+    {
+        auto data = std::ofstream{kPath, std::ios::binary | std::ios::app};
+        data << "garbage from a record that was never indexed";
+        auto index = std::ofstream{kPath + ".idx", std::ios::binary | std::ios::app};
+        index << "abc";
+    }
+    assert(OpenArchive().GetNumGames() == 1);
+    {
+        auto writerOrError = ArchiveWriter::Open(kPath);
+        assert(std::holds_alternative<ArchiveWriter>(writerOrError));
+        assert(!std::get<ArchiveWriter>(writerOrError).Append(second));
+    }
+    const auto archive = OpenArchive();
+    assert(archive.GetNumGames() == 2);
+    auto decoder = GameDecoder{};
+    auto game = GameRecord{};
+    assert(!archive.ReadGame(1, decoder, game) && SameGame(game, second));
+
+    // Not an archive
+    {
+        auto data = std::ofstream{kPath, std::ios::binary | std::ios::trunc};
+        data << "not an archive at all";
+    }
+    assert(std::holds_alternative<GenericError>(Archive::Open(kPath)));
+    assert(std::holds_alternative<GenericError>(ArchiveWriter::Open(kPath)));
+    RemoveArchive();
+    assert(std::holds_alternative<SystemError>(Archive::Open(kPath)));
+    std::cerr << "TestInterruptedWrite OK\n";
+}
+} // namespace NTests
+
+
+auto main() -> int {
+    using namespace NTests;
+    TestExpGolomb();
+    TestMoveRanks();
+    TestWriteAndRead();
+    TestInterruptedWrite();
+    std::cerr << "All tests passed.\n";
+}
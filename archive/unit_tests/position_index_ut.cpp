@@ -0,0 +1,172 @@
+#include "../archive.hpp"
+#include "../position_index.hpp"
+
+#include "../../chess/movegen.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+
+namespace {
+using namespace NArchive;
+using namespace NChess;
+
+static const auto kPath = std::string{"/tmp/position_index_ut.cga"};
+static const auto kIndexPath = kPath + ".pos";
+static constexpr auto kStartFen =
+    std::string_view{"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"};
+
+struct Expected {
+    std::array<uint32_t, 4> Results = {};
+    // Game and first ply
+    std::set<std::pair<uint32_t, uint16_t>> Games;
+};
+
+auto RemoveFiles() -> void {
+    for (const auto& path : {kPath, kPath + ".idx", kIndexPath}) std::remove(path.c_str());
+}
+
+// Short games from few openings, so that positions are shared between
+// games, plus a knight shuffle that repeats positions within a game
+auto MakeGames() -> std::vector<GameRecord> {
+    auto rng = std::mt19937_64{3};
+    auto games = std::vector<GameRecord>{};
+    for (auto id = uint64_t{0}; id < 400; ++id) {
+        auto game = GameRecord{};
+        game.Id = GameId{id};
+        game.Result = EGameResult(rng() % 4);
+        auto pos = Position{};
+        assert(!pos.SetFromFen(kStartFen));
+        const auto length = rng() % 12;
+        for (auto ply = uint64_t{0}; ply < length; ++ply) {
+            auto list = MoveList{};
+            GenerateLegal(pos, list);
+            if (list.Size == 0) break;
+            const auto m = list.Moves[rng() % std::min(list.Size, 3)];
+            pos.MakeMove(m);
+            game.Moves.push_back(m);
+        }
+        games.push_back(std::move(game));
+    }
+    auto shuffle = GameRecord{};
+    shuffle.Id = GameId{1000};
+    shuffle.Result = EGameResult::Draw;
+    for (auto i = 0; i < 3; ++i) {
+        for (const auto m : {Move{G1, F3}, Move{G8, F6}, Move{F3, G1}, Move{F6, G8}}) shuffle.Moves.push_back(m);
+    }
+    games.push_back(shuffle);
+    return games;
+}
+
+// The index computed the slow way
+auto Replay(const std::vector<GameRecord>& games) -> std::map<uint64_t, Expected> {
+    auto expected = std::map<uint64_t, Expected>{};
+    for (auto n = uint32_t{0}; n < games.size(); ++n) {
+        auto pos = Position{};
+        assert(!pos.SetFromFen(kStartFen));
+        auto seen = std::set<uint64_t>{};
+        const auto add = [&](uint16_t ply) {
+            if (!seen.insert(pos.Key()).second) return;
+            auto& e = expected[pos.Key()];
+            ++e.Results[uint8_t(games[n].Result)];
+            e.Games.emplace(n, ply);
+        };
+        add(0);
+        for (auto ply = size_t{0}; ply < games[n].Moves.size(); ++ply) {
+            pos.MakeMove(games[n].Moves[ply]);
+            add(uint16_t(ply + 1));
+        }
+    }
+    return expected;
+}
+
+auto OpenIndex() -> PositionIndex {
+    auto indexOrError = PositionIndex::Open(kIndexPath);
+    assert(std::holds_alternative<PositionIndex>(indexOrError));
+    return std::get<PositionIndex>(std::move(indexOrError));
+}
+} // anonymous namespace
+
+
+namespace NTests {
+// Any number of threads and any run size give the same index
+auto TestMatchesReplay() -> void {
+    RemoveFiles();
+    const auto games = MakeGames();
+    {
+        auto writerOrError = ArchiveWriter::Open(kPath);
+        auto& writer = std::get<ArchiveWriter>(writerOrError);
+        for (const auto& game : games) assert(!writer.Append(game));
+    }
+    auto archiveOrError = Archive::Open(kPath);
+    const auto& archive = std::get<Archive>(archiveOrError);
+    const auto expected = Replay(games);
+    auto numEntries = uint64_t{0};
+    for (const auto& [key, e] : expected) numEntries += e.Games.size();
+
+    for (const auto& [threads, entriesPerRun] : {std::pair{1, size_t{1} << 20}, std::pair{4, size_t{7}}}) {
+        auto pool = ThreadPool{threads - 1};
+        const auto statsOrError = BuildPositionIndex(archive, kIndexPath, pool, entriesPerRun);
+        assert(std::holds_alternative<PositionIndexStats>(statsOrError));
+        const auto& stats = std::get<PositionIndexStats>(statsOrError);
+        assert(stats.Games == games.size() && stats.Keys == expected.size() && stats.Entries == numEntries);
+
+        const auto index = OpenIndex();
+        assert(index.GetNumKeys() == expected.size() && index.GetNumEntries() == numEntries);
+        for (const auto& [key, e] : expected) {
+            const auto found = index.Find(key);
+            assert(found && found->Results == e.Results);
+            auto gamesFound = std::set<std::pair<uint32_t, uint16_t>>{};
+            for (const auto& entry : index.GetEntries(*found)) {
+                assert(entry.Key == key);
+                gamesFound.emplace(entry.Game, entry.Ply);
+            }
+            assert(gamesFound == e.Games);
+            assert(!index.Find(key + 1) || expected.contains(key + 1));
+            assert(!index.Find(key - 1) || expected.contains(key - 1));
+        }
+    }
+
+    // The start position is in every game, and the shuffle
+    // game repeats it but is only counted once
+    const auto index = OpenIndex();
+    auto pos = Position{};
+    assert(!pos.SetFromFen(kStartFen));
+    assert(index.Find(pos.Key())->GetNumGames() == games.size());
+    assert(!pos.SetFromFen("4k3/8/8/8/8/8/8/4K3 w - - 0 1"));
+    assert(!index.Find(pos.Key()));
+    std::cerr << "TestMatchesReplay OK\n";
+}
+
+auto TestEmptyAndBadFiles() -> void {
+    RemoveFiles();
+    {
+        auto writerOrError = ArchiveWriter::Open(kPath);
+        assert(std::holds_alternative<ArchiveWriter>(writerOrError));
+    }
+    auto archiveOrError = Archive::Open(kPath);
+    auto pool = ThreadPool{1};
+    const auto statsOrError = BuildPositionIndex(std::get<Archive>(archiveOrError), kIndexPath, pool);
+    assert(std::get<PositionIndexStats>(statsOrError).Keys == 0);
+    assert(!OpenIndex().Find(0));
+
+    std::remove(kIndexPath.c_str());
+    assert(std::holds_alternative<SystemError>(PositionIndex::Open(kIndexPath)));
+    assert(std::holds_alternative<GenericError>(PositionIndex::Open(kPath)));
+    RemoveFiles();
+    std::cerr << "TestEmptyAndBadFiles OK\n";
+}
+} // namespace NTests
+
+
+auto main() -> int {
+    using namespace NTests;
+    TestMatchesReplay();
+    TestEmptyAndBadFiles();
+    std::cerr << "All tests passed.\n";
+}
@@ -0,0 +1,155 @@
+#include "bitboard.hpp"
+
+#include <cstdlib>
+
+
+namespace NChess::NAttacksImpl {
+    Tables gTables;
+}
+
+
+namespace {
+    using namespace NChess;
+    using NAttacksImpl::Magic;
+
+    // Total number of distinct occupancy subsets over all squares
+    static constexpr auto kBishopTableSize = 0x1480;
+    static constexpr auto kRookTableSize = 0x19000;
+    Bitboard gBishopAttacks[kBishopTableSize];
+    Bitboard gRookAttacks[kRookTableSize];
+
+    auto SlidingAttacks(
+        const std::array<std::pair<int, int>, 4>& directions,
+        Square s,
+        Bitboard occupied
+    ) -> Bitboard {
+        auto attacks = Bitboard{0};
+        for (const auto& [df, dr] : directions) {
+            for (auto f = FileOf(s) + df, r = RankOf(s) + dr;
+                 f >= 0 && f < 8 && r >= 0 && r < 8;
+                 f += df, r += dr) {
+                const auto to = MakeSquare(f, r);
+                attacks |= SquareBb(to);
+                if (occupied & SquareBb(to)) break;
+            }
+        }
+        return attacks;
+    }
+
+    static constexpr auto kBishopDirections =
+        std::array<std::pair<int, int>, 4>{{{1, 1}, {1, -1}, {-1, 1}, {-1, -1}}};
+    static constexpr auto kRookDirections =
+        std::array<std::pair<int, int>, 4>{{{1, 0}, {-1, 0}, {0, 1}, {0, -1}}};
+
+    // A small xorshift generator, seeded with a fixed value so that
+    // the magic search is deterministic and takes the same time on
+    // every start-up
+    class SparseRng {
+    private:
+        uint64_t State_;
+        auto Next() noexcept -> uint64_t {
+            State_ ^= State_ >> 12;
+            State_ ^= State_ << 25;
+            State_ ^= State_ >> 27;
+            return State_ * 2685821657736338717ULL;
+        }
+    public:
+        explicit SparseRng(uint64_t seed) noexcept : State_(seed) {}
+        auto NextSparse() noexcept -> uint64_t {
+            return Next() & Next() & Next();
+        }
+    };
+
+    auto InitMagics(
+        const std::array<std::pair<int, int>, 4>& directions,
+        Bitboard* table,
+        std::array<Magic, kNumSquares>& magics
+    ) -> void {
+        Bitboard occupancy[4096];
+        Bitboard reference[4096];
+        int epoch[4096] = {};
+        auto curEpoch = 0;
+        auto rng = SparseRng{728};
+        auto* attacks = table;
+        for (auto s = int{A1}; s <= H8; ++s) {
+            const auto sq = Square(s);
+            const auto edges = ((RankBb(0) | RankBb(7)) & ~RankBb(RankOf(sq)))
+                             | ((FileBb(0) | FileBb(7)) & ~FileBb(FileOf(sq)));
+            auto& m = magics[s];
+            m.Mask = SlidingAttacks(directions, sq, 0) & ~edges;
+            m.Shift = 64 - PopCount(m.Mask);
+            m.Attacks = attacks;
+
+            // Enumerate all subsets of the mask (Carry-Rippler trick)
+            auto size = 0;
+            auto b = Bitboard{0};
+            do {
+                occupancy[size] = b;
+                reference[size] = SlidingAttacks(directions, sq, b);
+                ++size;
+                b = (b - m.Mask) & m.Mask;
+            } while (b);
+
+            for (auto found = false; !found;) {
+                do {
+                    m.Factor = rng.NextSparse();
+                } while (PopCount((m.Factor * m.Mask) >> 56) < 6);
+                ++curEpoch;
+                found = true;
+                for (auto i = 0; i < size; ++i) {
+                    const auto idx = m.Index(occupancy[i]);
+                    if (epoch[idx] < curEpoch) {
+                        epoch[idx] = curEpoch;
+                        attacks[idx] = reference[i];
+                    } else if (attacks[idx] != reference[i]) {
+                        found = false;
+                        break;
+                    }
+                }
+            }
+            attacks += size;
+        }
+    }
+
+    auto InitTables() -> void {
+        auto& t = NAttacksImpl::gTables;
+        for (auto s = int{A1}; s <= H8; ++s) {
+            const auto sq = Square(s);
+            const auto b = SquareBb(sq);
+            t.Pawn[White][s] = PawnAttacksBb<White>(b);
+            t.Pawn[Black][s] = PawnAttacksBb<Black>(b);
+            t.Knight[s] = t.King[s] = 0;
+            for (const auto& [df, dr] : std::array<std::pair<int, int>, 8>{{
+                     {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}}}) {
+                const auto f = FileOf(sq) + df, r = RankOf(sq) + dr;
+                if (f >= 0 && f < 8 && r >= 0 && r < 8) t.Knight[s] |= SquareBb(MakeSquare(f, r));
+            }
+            for (auto df = -1; df <= 1; ++df) {
+                for (auto dr = -1; dr <= 1; ++dr) {
+                    const auto f = FileOf(sq) + df, r = RankOf(sq) + dr;
+                    if ((df || dr) && f >= 0 && f < 8 && r >= 0 && r < 8) {
+                        t.King[s] |= SquareBb(MakeSquare(f, r));
+                    }
+                }
+            }
+        }
+        InitMagics(kBishopDirections, gBishopAttacks, t.BishopMagics);
+        InitMagics(kRookDirections, gRookAttacks, t.RookMagics);
+
+        for (auto a = int{A1}; a <= H8; ++a) {
+            for (auto b = int{A1}; b <= H8; ++b) {
+                t.Between[a][b] = t.Line[a][b] = 0;
+                if (a == b) continue;
+                const auto sa = Square(a), sb = Square(b);
+                for (const auto pt : {Bishop, Rook}) {
+                    if (Attacks(pt, sa, 0) & SquareBb(sb)) {
+                        t.Line[a][b] = (Attacks(pt, sa, 0) & Attacks(pt, sb, 0)) | SquareBb(sa) | SquareBb(sb);
+                        t.Between[a][b] = Attacks(pt, sa, SquareBb(sb)) & Attacks(pt, sb, SquareBb(sa));
+                    }
+                }
+            }
+        }
+    }
+
+    [[maybe_unused]] const auto gInitialized = (InitTables(), true);
+} // anonymous namespace
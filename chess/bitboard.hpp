@@ -0,0 +1,122 @@
+#pragma once
+
+
+#include "types.hpp"
+
+#include <bit>
+
+
+namespace NChess {
+    static constexpr auto kFileABb = Bitboard{0x0101010101010101};
+    static constexpr auto kRank1Bb = Bitboard{0xFF};
+
+    constexpr auto FileBb(int file) noexcept -> Bitboard {
+        return kFileABb << file;
+    }
+    constexpr auto RankBb(int rank) noexcept -> Bitboard {
+        return kRank1Bb << (8 * rank);
+    }
+
+    inline auto PopCount(Bitboard b) noexcept -> int {
+        return std::popcount(b);
+    }
+    inline auto Lsb(Bitboard b) noexcept -> Square {
+        return Square(std::countr_zero(b));
+    }
+    inline auto PopLsb(Bitboard& b) noexcept -> Square {
+        const auto s = Lsb(b);
+        b &= b - 1;
+        return s;
+    }
+    inline auto MoreThanOne(Bitboard b) noexcept -> bool {
+        return (b & (b - 1)) != 0;
+    }
+
+    template <int Delta>
+    constexpr auto Shift(Bitboard b) noexcept -> Bitboard {
+        if constexpr (Delta == 8) return b << 8;
+        else if constexpr (Delta == -8) return b >> 8;
+        else if constexpr (Delta == 9) return (b & ~FileBb(7)) << 9;
+        else if constexpr (Delta == 7) return (b & ~FileBb(0)) << 7;
+        else if constexpr (Delta == -7) return (b & ~FileBb(7)) >> 7;
+        else if constexpr (Delta == -9) return (b & ~FileBb(0)) >> 9;
+        else static_assert(Delta == 8, "unsupported shift");
+    }
+
+    template <Color C>
+    constexpr auto PawnAttacksBb(Bitboard pawns) noexcept -> Bitboard {
+        if constexpr (C == White) return Shift<7>(pawns) | Shift<9>(pawns);
+        else return Shift<-7>(pawns) | Shift<-9>(pawns);
+    }
+
+    namespace NAttacksImpl {
+        // "Fancy" magic bitboards: for every square, the relevant occupancy
+        // bits are hashed by a multiplication into an index into `Attacks`
+        struct Magic {
+            Bitboard Mask;
+            Bitboard Factor;
+            const Bitboard* Attacks;
+            unsigned Shift;
+            auto Index(Bitboard occupied) const noexcept -> unsigned {
+                return unsigned(((occupied & Mask) * Factor) >> Shift);
+            }
+        };
+
+        struct Tables {
+            std::array<std::array<Bitboard, kNumSquares>, 2> Pawn;
+            std::array<Bitboard, kNumSquares> Knight;
+            std::array<Bitboard, kNumSquares> King;
+            std::array<Magic, kNumSquares> BishopMagics;
+            std::array<Magic, kNumSquares> RookMagics;
+            // Squares strictly between two aligned squares (empty otherwise)
+            std::array<std::array<Bitboard, kNumSquares>, kNumSquares> Between;
+            // The whole line through two aligned squares (empty otherwise)
+            std::array<std::array<Bitboard, kNumSquares>, kNumSquares> Line;
+        };
+
+        // Filled once by a static initializer in `bitboard.cpp`;
+        // no other static initializer may depend on it
+        extern Tables gTables;
+    } // namespace NAttacksImpl
+
+    inline auto PawnAttacks(Color c, Square s) noexcept -> Bitboard {
+        return NAttacksImpl::gTables.Pawn[c][s];
+    }
+    inline auto KnightAttacks(Square s) noexcept -> Bitboard {
+        return NAttacksImpl::gTables.Knight[s];
+    }
+    inline auto KingAttacks(Square s) noexcept -> Bitboard {
+        return NAttacksImpl::gTables.King[s];
+    }
+    inline auto BishopAttacks(Square s, Bitboard occupied) noexcept -> Bitboard {
+        const auto& m = NAttacksImpl::gTables.BishopMagics[s];
+        return m.Attacks[m.Index(occupied)];
+    }
+    inline auto RookAttacks(Square s, Bitboard occupied) noexcept -> Bitboard {
+        const auto& m = NAttacksImpl::gTables.RookMagics[s];
+        return m.Attacks[m.Index(occupied)];
+    }
+    inline auto QueenAttacks(Square s, Bitboard occupied) noexcept -> Bitboard {
+        return BishopAttacks(s, occupied) | RookAttacks(s, occupied);
+    }
+    // Attacks of a non-pawn piece type from `s`
+    inline auto Attacks(PieceType pt, Square s, Bitboard occupied) noexcept -> Bitboard {
+        switch (pt) {
+            case Knight: return KnightAttacks(s);
+            case Bishop: return BishopAttacks(s, occupied);
+            case Rook:   return RookAttacks(s, occupied);
+            case Queen:  return QueenAttacks(s, occupied);
+            case King:   return KingAttacks(s);
+            default:     return 0;
+        }
+    }
+    inline auto Between(Square a, Square b) noexcept -> Bitboard {
+        return NAttacksImpl::gTables.Between[a][b];
+    }
+    inline auto Line(Square a, Square b) noexcept -> Bitboard {
+        return NAttacksImpl::gTables.Line[a][b];
+    }
+    inline auto Aligned(Square a, Square b, Square c) noexcept -> bool {
+        return (Line(a, b) & SquareBb(c)) != 0;
+    }
+} // namespace NChess
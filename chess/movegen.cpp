@@ -0,0 +1,152 @@
+#include "movegen.hpp"
+
+
+namespace {
+    using namespace NChess;
+
+    template <Color Us, EGenType Type>
+    auto GeneratePawnMoves(const Position& pos, MoveList& list) noexcept -> void {
+        constexpr auto Them = ~Us;
+        constexpr auto Up = PawnPush(Us);
+        constexpr auto UpLeft = Us == White ? 7 : -9;
+        constexpr auto UpRight = Us == White ? 9 : -7;
+        constexpr auto Rank7 = RankBb(RelativeRank(Us, 6));
+        constexpr auto Rank3 = RankBb(RelativeRank(Us, 2));
+
+        const auto empty = ~pos.Pieces();
+        const auto enemies = pos.Pieces(Them);
+        const auto pawns = pos.Pieces(Us, Pawn);
+        const auto promoting = pawns & Rank7;
+        const auto regular = pawns & ~Rank7;
+
+        if constexpr (Type != EGenType::Noisy) {
+            auto single = Shift<Up>(regular) & empty;
+            auto dbl = Shift<Up>(single & Rank3) & empty;
+            while (single) {
+                const auto to = PopLsb(single);
+                list.Push(Move{Square(to - Up), to});
+            }
+            while (dbl) {
+                const auto to = PopLsb(dbl);
+                list.Push(Move{Square(to - 2 * Up), to});
+            }
+        }
+
+        if constexpr (Type != EGenType::Quiet) {
+            auto pushPromotions = [&list](Bitboard targets, int delta) {
+                while (targets) {
+                    const auto to = PopLsb(targets);
+                    const auto from = Square(to - delta);
+                    for (const auto pt : {Queen, Knight, Rook, Bishop}) {
+                        list.Push(Move{from, to, Move::Promotion, pt});
+                    }
+                }
+            };
+            pushPromotions(Shift<Up>(promoting) & empty, Up);
+            pushPromotions(Shift<UpLeft>(promoting) & enemies, UpLeft);
+            pushPromotions(Shift<UpRight>(promoting) & enemies, UpRight);
+
+            auto left = Shift<UpLeft>(regular) & enemies;
+            auto right = Shift<UpRight>(regular) & enemies;
+            while (left) {
+                const auto to = PopLsb(left);
+                list.Push(Move{Square(to - UpLeft), to});
+            }
+            while (right) {
+                const auto to = PopLsb(right);
+                list.Push(Move{Square(to - UpRight), to});
+            }
+
+            if (const auto ep = pos.EnPassantSquare(); ep != NoSquare) {
+                auto attackers = regular & PawnAttacks(Them, ep);
+                while (attackers) {
+                    list.Push(Move{PopLsb(attackers), ep, Move::EnPassant});
+                }
+            }
+        }
+    }
+
+    template <Color Us>
+    auto GenerateCastling(const Position& pos, MoveList& list) noexcept -> void {
+        constexpr auto KingSide = Us == White ? WhiteKingSide : BlackKingSide;
+        constexpr auto QueenSide = Us == White ? WhiteQueenSide : BlackQueenSide;
+        constexpr auto KingFrom = Us == White ? E1 : E8;
+        if (pos.InCheck() || !(pos.Castling() & (KingSide | QueenSide))) return;
+
+        const auto occupied = pos.Pieces();
+        auto attacked = [&pos](Square s) {
+            return (pos.AttackersTo(s) & pos.Pieces(~Us)) != 0;
+        };
+        if ((pos.Castling() & KingSide)
+            && !(occupied & (SquareBb(Square(KingFrom + 1)) | SquareBb(Square(KingFrom + 2))))
+            && !attacked(Square(KingFrom + 1)) && !attacked(Square(KingFrom + 2))) {
+            list.Push(Move{KingFrom, Square(KingFrom + 2), Move::Castling});
+        }
+        if ((pos.Castling() & QueenSide)
+            && !(occupied & (SquareBb(Square(KingFrom - 1)) | SquareBb(Square(KingFrom - 2))
+                             | SquareBb(Square(KingFrom - 3))))
+            && !attacked(Square(KingFrom - 1)) && !attacked(Square(KingFrom - 2))) {
+            list.Push(Move{KingFrom, Square(KingFrom - 2), Move::Castling});
+        }
+    }
+
+    template <Color Us, EGenType Type>
+    auto Generate(const Position& pos, MoveList& list) noexcept -> void {
+        const auto targets = Type == EGenType::Noisy ? pos.Pieces(~Us)
+                           : Type == EGenType::Quiet ? ~pos.Pieces()
+                           : ~pos.Pieces(Us);
+        const auto occupied = pos.Pieces();
+
+        // With two checkers only king moves can be legal
+        if (!MoreThanOne(pos.Checkers())) {
+            GeneratePawnMoves<Us, Type>(pos, list);
+            for (const auto pt : {Knight, Bishop, Rook, Queen}) {
+                auto pieces = pos.Pieces(Us, pt);
+                while (pieces) {
+                    const auto from = PopLsb(pieces);
+                    auto attacks = Attacks(pt, from, occupied) & targets;
+                    while (attacks) list.Push(Move{from, PopLsb(attacks)});
+                }
+            }
+        }
+
+        const auto ksq = pos.KingSquare(Us);
+        auto attacks = KingAttacks(ksq) & targets;
+        while (attacks) list.Push(Move{ksq, PopLsb(attacks)});
+
+        if constexpr (Type != EGenType::Noisy) GenerateCastling<Us>(pos, list);
+    }
+} // anonymous namespace
+
+
+namespace NChess {
+    template <EGenType Type>
+    auto GeneratePseudoLegal(const Position& pos, MoveList& list) noexcept -> void {
+        if (pos.SideToMove() == White) Generate<White, Type>(pos, list);
+        else Generate<Black, Type>(pos, list);
+    }
+    template auto GeneratePseudoLegal<EGenType::Noisy>(const Position&, MoveList&) noexcept -> void;
+    template auto GeneratePseudoLegal<EGenType::Quiet>(const Position&, MoveList&) noexcept -> void;
+    template auto GeneratePseudoLegal<EGenType::All>(const Position&, MoveList&) noexcept -> void;
+
+    auto GenerateLegal(const Position& pos, MoveList& list) noexcept -> void {
+        auto pseudo = MoveList{};
+        GeneratePseudoLegal<EGenType::All>(pos, pseudo);
+        for (const auto m : pseudo) {
+            if (pos.IsLegal(m)) list.Push(m);
+        }
+    }
+
+    auto Perft(Position& pos, int depth) -> uint64_t {
+        auto list = MoveList{};
+        GenerateLegal(pos, list);
+        if (depth <= 1) return depth == 1 ? list.Size : 1;
+        auto nodes = uint64_t{0};
+        for (const auto m : list) {
+            pos.MakeMove(m);
+            nodes += Perft(pos, depth - 1);
+            pos.UnmakeMove(m);
+        }
+        return nodes;
+    }
+} // namespace NChess
@@ -0,0 +1,47 @@
+#pragma once
+
+
+#include "position.hpp"
+#include "types.hpp"
+
+#include <span>
+
+
+namespace NChess {
+    // A fixed-capacity list of moves living on the stack
+    struct MoveList {
+        std::array<Move, kMaxMoves> Moves;
+        int Size = 0;
+
+        auto Push(Move m) noexcept -> void { Moves[Size++] = m; }
+        auto begin() noexcept { return Moves.begin(); }
+        auto end() noexcept { return Moves.begin() + Size; }
+        auto begin() const noexcept { return Moves.begin(); }
+        auto end() const noexcept { return Moves.begin() + Size; }
+        auto AsSpan() const noexcept -> std::span<const Move> {
+            return {Moves.data(), size_t(Size)};
+        }
+        auto Contains(Move m) const noexcept -> bool {
+            for (const auto x : *this) if (x == m) return true;
+            return false;
+        }
+    };
+
+    enum class EGenType {
+        // Captures and all promotions
+        Noisy,
+        // Non-capturing non-promotions, including castling
+        Quiet,
+        All,
+    };
+
+    // Appends pseudo-legal moves to `list`: the
+    // moves still have to be checked with `IsLegal`
+    template <EGenType Type>
+    auto GeneratePseudoLegal(const Position& pos, MoveList& list) noexcept -> void;
+
+    auto GenerateLegal(const Position& pos, MoveList& list) noexcept -> void;
+
+    // Counts leaf nodes of the legal move tree of depth `depth`
+    auto Perft(Position& pos, int depth) -> uint64_t;
+} // namespace NChess
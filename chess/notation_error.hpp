@@ -0,0 +1,60 @@
+#pragma once
+
+
+#include "../utils/error.hpp"
+
+#include <cstdint>
+#include <string_view>
+
+
+namespace NChess {
+    // Why a FEN or SAN string was rejected
+    enum class ENotationError : uint8_t {
+        MalformedPiecePlacement,
+        UnexpectedCharacterInPiecePlacement,
+        RankTooLong,
+        IncompletePiecePlacement,
+        WrongNumberOfKings,
+        InvalidSideToMove,
+        InvalidCastlingRights,
+        InvalidEnPassantSquare,
+        InvalidMoveCounter,
+        SideNotToMoveInCheck,
+        MalformedSan,
+        IllegalSanMove,
+        AmbiguousSanMove,
+    };
+
+    /* The enum keeps the error itself free of allocations; callers that
+     * want more context can still set `ContextMessage`
+     */
+    using NotationError = ErrorWithContext<ENotationError>;
+
+    constexpr auto Describe(ENotationError err) noexcept -> std::string_view {
+        switch (err) {
+            case ENotationError::MalformedPiecePlacement: return "malformed piece placement";
+            case ENotationError::UnexpectedCharacterInPiecePlacement: return "unexpected character in piece placement";
+            case ENotationError::RankTooLong: return "rank is too long in piece placement";
+            case ENotationError::IncompletePiecePlacement: return "incomplete piece placement";
+            case ENotationError::WrongNumberOfKings: return "each side must have exactly one king";
+            case ENotationError::InvalidSideToMove: return "side to move must be 'w' or 'b'";
+            case ENotationError::InvalidCastlingRights: return "invalid castling rights";
+            case ENotationError::InvalidEnPassantSquare: return "invalid en passant square";
+            case ENotationError::InvalidMoveCounter: return "invalid move counter";
+            case ENotationError::SideNotToMoveInCheck: return "the side not to move is in check";
+            case ENotationError::MalformedSan: return "not a move in standard algebraic notation";
+            case ENotationError::IllegalSanMove: return "no legal move matches";
+            case ENotationError::AmbiguousSanMove: return "more than one legal move matches";
+        }
+        return "unknown notation error";
+    }
+
+    template <class OStream>
+    inline auto operator<<(OStream&& out, const NotationError& err) -> OStream&& {
+        if (!err.ContextMessage.Empty()) {
+            out << err.ContextMessage << ", got the following error: ";
+        }
+        out << Describe(err.Value);
+        return std::forward<OStream>(out);
+    }
+} // namespace NChess
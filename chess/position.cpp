@@ -0,0 +1,467 @@
+#include "position.hpp"
+
+#include "zobrist.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <tuple>
+#include <utility>
+
+
+namespace {
+    using namespace NChess;
+
+    static constexpr auto kStartFen =
+        std::string_view{"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"};
+
+    // `Castling & kCastlingMask[s]` clears the rights that are
+    // lost when a piece moves from or to the square `s`
+    static constexpr auto kCastlingMask = []() {
+        auto mask = std::array<uint8_t, kNumSquares>{};
+        mask.fill(AllCastling);
+        mask[E1] = AllCastling & ~(WhiteKingSide | WhiteQueenSide);
+        mask[H1] = AllCastling & ~WhiteKingSide;
+        mask[A1] = AllCastling & ~WhiteQueenSide;
+        mask[E8] = AllCastling & ~(BlackKingSide | BlackQueenSide);
+        mask[H8] = AllCastling & ~BlackKingSide;
+        mask[A8] = AllCastling & ~BlackQueenSide;
+        return mask;
+    }();
+
+    // For a king move `from -> to` that is a castling move,
+    // returns the origin and destination squares of the rook
+    constexpr auto CastlingRookSquares(Square kingTo) noexcept -> std::pair<Square, Square> {
+        switch (kingTo) {
+            case G1: return {H1, F1};
+            case C1: return {A1, D1};
+            case G8: return {H8, F8};
+            default: return {A8, D8}; // C8
+        }
+    }
+
+    constexpr auto PieceFromChar(char c) noexcept -> Piece {
+        switch (c) {
+            case 'P': return WhitePawn;   case 'p': return BlackPawn;
+            case 'N': return WhiteKnight; case 'n': return BlackKnight;
+            case 'B': return WhiteBishop; case 'b': return BlackBishop;
+            case 'R': return WhiteRook;   case 'r': return BlackRook;
+            case 'Q': return WhiteQueen;  case 'q': return BlackQueen;
+            case 'K': return WhiteKing;   case 'k': return BlackKing;
+            default:  return NoPiece;
+        }
+    }
+
+    constexpr auto PieceToChar(Piece p) noexcept -> char {
+        return (ColorOf(p) == White ? "PNBRQK" : "pnbrqk")[TypeOf(p)];
+    }
+
+    auto NextField(std::string_view& fen) noexcept -> std::string_view {
+        while (!fen.empty() && fen.front() == ' ') fen.remove_prefix(1);
+        const auto end = std::min(fen.find(' '), fen.size());
+        const auto field = fen.substr(0, end);
+        fen.remove_prefix(end);
+        return field;
+    }
+
+    // Leaves `value` as it is if the field is missing
+    auto ParseCounter(std::string_view field, int& value) noexcept -> bool {
+        if (field.empty()) return true;
+        const auto [end, ec] = std::from_chars(field.data(), field.data() + field.size(), value);
+        return ec == std::errc{} && end == field.data() + field.size() && value >= 0;
+    }
+} // anonymous namespace
+
+
+namespace NChess {
+    Position::Position() {
+        Clear();
+    }
+
+    auto Position::StartPosition() -> Position {
+        auto pos = Position{};
+        [[maybe_unused]] const auto err = pos.SetFromFen(kStartFen);
+        return pos;
+    }
+
+    auto Position::Clear() -> void {
+        ByType_.fill(0);
+        ByColor_.fill(0);
+        Board_.fill(NoPiece);
+        SideToMove_ = White;
+        GamePly_ = 0;
+        States_.clear();
+        // Enough for any realistic game plus the search
+        // tree on top of it, so that `MakeMove` doesn't
+        // reallocate in practice
+        States_.reserve(1024);
+        States_.emplace_back();
+    }
+
+    auto Position::SetFromFen(std::string_view fen) -> std::optional<NotationError> {
+        Clear();
+        const auto placement = NextField(fen);
+        auto file = 0, rank = 7;
+        for (const auto c : placement) {
+            if (c == '/') {
+                if (file != 8 || rank == 0) return NotationError{ENotationError::MalformedPiecePlacement};
+                file = 0;
+                --rank;
+            } else if (c >= '1' && c <= '8') {
+                file += c - '0';
+            } else if (const auto p = PieceFromChar(c); p != NoPiece && file < 8) {
+                PutPiece(p, MakeSquare(file++, rank));
+            } else {
+                return NotationError{ENotationError::UnexpectedCharacterInPiecePlacement};
+            }
+            if (file > 8) return NotationError{ENotationError::RankTooLong};
+        }
+        if (rank != 0 || file != 8) return NotationError{ENotationError::IncompletePiecePlacement};
+        if (PopCount(Pieces(White, King)) != 1 || PopCount(Pieces(Black, King)) != 1) {
+            return NotationError{ENotationError::WrongNumberOfKings};
+        }
+
+        const auto side = NextField(fen);
+        if (side == "w") SideToMove_ = White;
+        else if (side == "b") SideToMove_ = Black;
+        else return NotationError{ENotationError::InvalidSideToMove};
+
+        auto& st = States_.back();
+        for (const auto c : NextField(fen)) {
+            switch (c) {
+                case 'K': st.Castling |= WhiteKingSide; break;
+                case 'Q': st.Castling |= WhiteQueenSide; break;
+                case 'k': st.Castling |= BlackKingSide; break;
+                case 'q': st.Castling |= BlackQueenSide; break;
+                case '-': break;
+                default: return NotationError{ENotationError::InvalidCastlingRights};
+            }
+        }
+        // Drop castling rights that contradict the piece placement
+        for (const auto& [right, king, rook] : std::array<std::tuple<uint8_t, Piece, Square>, 4>{{
+                 {WhiteKingSide, WhiteKing, H1}, {WhiteQueenSide, WhiteKing, A1},
+                 {BlackKingSide, BlackKing, H8}, {BlackQueenSide, BlackKing, A8}}}) {
+            const auto kingSq = ColorOf(king) == White ? E1 : E8;
+            if (Board_[kingSq] != king || Board_[rook] != MakePiece(ColorOf(king), Rook)) {
+                st.Castling &= ~right;
+            }
+        }
+
+        const auto ep = NextField(fen);
+        if (ep.size() == 2 && ep[0] >= 'a' && ep[0] <= 'h' && (ep[1] == '3' || ep[1] == '6')) {
+            const auto epSq = MakeSquare(ep[0] - 'a', ep[1] - '1');
+            // Only remember the en passant square if a capture
+            // is actually possible, so that equal positions hash equally
+            if (PawnAttacks(~SideToMove_, epSq) & Pieces(SideToMove_, Pawn)) {
+                st.EnPassant = epSq;
+            }
+        } else if (ep != "-") {
+            return NotationError{ENotationError::InvalidEnPassantSquare};
+        }
+
+        // Move counters are optional
+        auto rule50 = 0;
+        if (!ParseCounter(NextField(fen), rule50)) return NotationError{ENotationError::InvalidMoveCounter};
+        st.Rule50 = uint8_t(std::clamp(rule50, 0, 255));
+        auto moveNumber = 1;
+        if (!ParseCounter(NextField(fen), moveNumber)) return NotationError{ENotationError::InvalidMoveCounter};
+        GamePly_ = 2 * (std::max(moveNumber, 1) - 1) + (SideToMove_ == Black);
+
+        st.Key = ComputeKey();
+        UpdateCheckInfo();
+        if (AttackersTo(KingSquare(~SideToMove_)) & Pieces(SideToMove_)) {
+            return NotationError{ENotationError::SideNotToMoveInCheck};
+        }
+        return std::nullopt;
+    }
+
+    auto Position::WriteFen(char* first, char* last) const noexcept -> std::to_chars_result {
+        // Everything but the move counters has a bounded length,
+        // which `to_chars` checks for
+        if (last - first < kMaxFenLength - 2 * std::numeric_limits<int>::digits10) {
+            return {last, std::errc::value_too_large};
+        }
+        auto* out = first;
+        for (auto rank = 7; rank >= 0; --rank) {
+            auto empty = 0;
+            for (auto file = 0; file < 8; ++file) {
+                const auto p = Board_[MakeSquare(file, rank)];
+                if (p == NoPiece) {
+                    ++empty;
+                    continue;
+                }
+                if (empty) *out++ = char('0' + std::exchange(empty, 0));
+                *out++ = PieceToChar(p);
+            }
+            if (empty) *out++ = char('0' + empty);
+            if (rank) *out++ = '/';
+        }
+        *out++ = ' ';
+        *out++ = SideToMove_ == White ? 'w' : 'b';
+        *out++ = ' ';
+        if (Castling() == NoCastling) *out++ = '-';
+        if (Castling() & WhiteKingSide) *out++ = 'K';
+        if (Castling() & WhiteQueenSide) *out++ = 'Q';
+        if (Castling() & BlackKingSide) *out++ = 'k';
+        if (Castling() & BlackQueenSide) *out++ = 'q';
+        *out++ = ' ';
+        if (EnPassantSquare() == NoSquare) {
+            *out++ = '-';
+        } else {
+            *out++ = char('a' + FileOf(EnPassantSquare()));
+            *out++ = char('1' + RankOf(EnPassantSquare()));
+        }
+        *out++ = ' ';
+        auto result = std::to_chars(out, last, Rule50());
+        if (result.ec != std::errc{} || result.ptr == last) return {last, std::errc::value_too_large};
+        *result.ptr++ = ' ';
+        return std::to_chars(result.ptr, last, GamePly_ / 2 + 1);
+    }
+
+    auto Position::ComputeKey() const noexcept -> uint64_t {
+        auto key = uint64_t{0};
+        for (auto b = Pieces(); b;) {
+            const auto s = PopLsb(b);
+            key ^= NZobrist::PieceSquare(Board_[s], s);
+        }
+        key ^= NZobrist::Castling(State().Castling);
+        if (State().EnPassant != NoSquare) key ^= NZobrist::EnPassantFile(FileOf(State().EnPassant));
+        if (SideToMove_ == Black) key ^= NZobrist::SideToMove();
+        return key;
+    }
+
+    auto Position::PutPiece(Piece p, Square s) noexcept -> void {
+        Board_[s] = p;
+        ByType_[TypeOf(p)] |= SquareBb(s);
+        ByColor_[ColorOf(p)] |= SquareBb(s);
+    }
+
+    auto Position::RemovePiece(Square s) noexcept -> void {
+        const auto p = Board_[s];
+        ByType_[TypeOf(p)] ^= SquareBb(s);
+        ByColor_[ColorOf(p)] ^= SquareBb(s);
+        Board_[s] = NoPiece;
+    }
+
+    auto Position::MovePiece(Square from, Square to) noexcept -> void {
+        const auto p = Board_[from];
+        const auto fromTo = SquareBb(from) | SquareBb(to);
+        ByType_[TypeOf(p)] ^= fromTo;
+        ByColor_[ColorOf(p)] ^= fromTo;
+        Board_[from] = NoPiece;
+        Board_[to] = p;
+    }
+
+    auto Position::AttackersTo(Square s, Bitboard occupied) const noexcept -> Bitboard {
+        return (PawnAttacks(Black, s) & Pieces(White, Pawn))
+             | (PawnAttacks(White, s) & Pieces(Black, Pawn))
+             | (KnightAttacks(s) & Pieces(Knight))
+             | (BishopAttacks(s, occupied) & (Pieces(Bishop) | Pieces(Queen)))
+             | (RookAttacks(s, occupied) & (Pieces(Rook) | Pieces(Queen)))
+             | (KingAttacks(s) & Pieces(King));
+    }
+
+    auto Position::UpdateCheckInfo() noexcept -> void {
+        auto& st = States_.back();
+        const auto us = SideToMove_, them = ~us;
+        const auto ksq = KingSquare(us);
+        st.Checkers = AttackersTo(ksq) & Pieces(them);
+        st.Pinned = 0;
+        auto snipers = ((RookAttacks(ksq, 0) & (Pieces(Rook) | Pieces(Queen)))
+                      | (BishopAttacks(ksq, 0) & (Pieces(Bishop) | Pieces(Queen))))
+                     & Pieces(them);
+        while (snipers) {
+            const auto blockers = Between(ksq, PopLsb(snipers)) & Pieces();
+            if (blockers && !MoreThanOne(blockers)) st.Pinned |= blockers & Pieces(us);
+        }
+    }
+
+    auto Position::IsLegal(Move m) const noexcept -> bool {
+        const auto us = SideToMove_, them = ~us;
+        const auto from = m.From(), to = m.To();
+        const auto ksq = KingSquare(us);
+
+        if (m.Kind() == Move::EnPassant) {
+            const auto capSq = Square(to - PawnPush(us));
+            const auto occupied = (Pieces() ^ SquareBb(from) ^ SquareBb(capSq)) | SquareBb(to);
+            return !(RookAttacks(ksq, occupied) & (Pieces(them, Rook) | Pieces(them, Queen)))
+                && !(BishopAttacks(ksq, occupied) & (Pieces(them, Bishop) | Pieces(them, Queen)));
+        }
+        if (from == ksq) {
+            // Castling moves are only generated when the
+            // king doesn't pass through an attacked square
+            return m.Kind() == Move::Castling
+                || !(AttackersTo(to, Pieces() ^ SquareBb(from)) & Pieces(them));
+        }
+        if (const auto checkers = Checkers()) {
+            if (MoreThanOne(checkers)) return false;
+            const auto checker = Lsb(checkers);
+            if (!((Between(ksq, checker) | checkers) & SquareBb(to))) return false;
+        }
+        return !(Pinned() & SquareBb(from)) || Aligned(from, to, ksq);
+    }
+
+    auto Position::IsPseudoLegal(Move m) const noexcept -> bool {
+        if (!m) return false;
+        const auto us = SideToMove_, them = ~us;
+        const auto from = m.From(), to = m.To();
+        const auto pc = Board_[from];
+        if (pc == NoPiece || ColorOf(pc) != us || (Pieces(us) & SquareBb(to))) return false;
+
+        switch (m.Kind()) {
+            case Move::Castling: {
+                if (TypeOf(pc) != King || InCheck()) return false;
+                const auto [rookFrom, rookTo] = CastlingRookSquares(to);
+                const auto right = to == G1 ? WhiteKingSide : to == C1 ? WhiteQueenSide
+                                 : to == G8 ? BlackKingSide : to == C8 ? BlackQueenSide : NoCastling;
+                const auto ourRights = us == White ? WhiteKingSide | WhiteQueenSide
+                                                   : BlackKingSide | BlackQueenSide;
+                if (!(Castling() & right & ourRights)) return false;
+                if ((Between(from, rookFrom) & Pieces())) return false;
+                return !(AttackersTo(rookTo) & Pieces(them)) && !(AttackersTo(to) & Pieces(them));
+            }
+            case Move::EnPassant:
+                return TypeOf(pc) == Pawn && to == EnPassantSquare()
+                    && (PawnAttacks(us, from) & SquareBb(to));
+            default:
+                break;
+        }
+
+        if (TypeOf(pc) == Pawn) {
+            if ((RelativeRank(us, RankOf(to)) == 7) != (m.Kind() == Move::Promotion)) return false;
+            if (PawnAttacks(us, from) & Pieces(them) & SquareBb(to)) return true;
+            if (Board_[to] != NoPiece) return false;
+            if (to == from + PawnPush(us)) return true;
+            return RelativeRank(us, RankOf(from)) == 1 && to == from + 2 * PawnPush(us)
+                && Board_[from + PawnPush(us)] == NoPiece;
+        }
+        if (m.Kind() != Move::Normal) return false;
+        return (Attacks(TypeOf(pc), from, Pieces()) & SquareBb(to)) != 0;
+    }
+
+    auto Position::MakeMove(Move m) -> void {
+        const auto& prev = States_.back();
+        auto next = StateInfo{
+            .Key = prev.Key ^ NZobrist::SideToMove(),
+            .EnPassant = NoSquare,
+            .Castling = prev.Castling,
+            .Rule50 = uint8_t(std::min(prev.Rule50 + 1, 255)),
+            .PliesFromNull = uint8_t(std::min(prev.PliesFromNull + 1, 255)),
+            .Captured = NoPiece,
+        };
+        if (prev.EnPassant != NoSquare) next.Key ^= NZobrist::EnPassantFile(FileOf(prev.EnPassant));
+
+        const auto us = SideToMove_, them = ~us;
+        const auto from = m.From(), to = m.To();
+        const auto pc = Board_[from];
+
+        if (m.Kind() == Move::Castling) {
+            const auto [rookFrom, rookTo] = CastlingRookSquares(to);
+            const auto rook = MakePiece(us, Rook);
+            MovePiece(from, to);
+            MovePiece(rookFrom, rookTo);
+            next.Key ^= NZobrist::PieceSquare(pc, from) ^ NZobrist::PieceSquare(pc, to)
+                      ^ NZobrist::PieceSquare(rook, rookFrom) ^ NZobrist::PieceSquare(rook, rookTo);
+        } else {
+            if (m.Kind() == Move::EnPassant) {
+                const auto capSq = Square(to - PawnPush(us));
+                next.Captured = Board_[capSq];
+                RemovePiece(capSq);
+                next.Key ^= NZobrist::PieceSquare(next.Captured, capSq);
+            } else if (Board_[to] != NoPiece) {
+                next.Captured = Board_[to];
+                RemovePiece(to);
+                next.Key ^= NZobrist::PieceSquare(next.Captured, to);
+            }
+            if (next.Captured != NoPiece) next.Rule50 = 0;
+            MovePiece(from, to);
+            next.Key ^= NZobrist::PieceSquare(pc, from) ^ NZobrist::PieceSquare(pc, to);
+
+            if (TypeOf(pc) == Pawn) {
+                next.Rule50 = 0;
+                if ((to ^ from) == 16) {
+                    const auto epSq = Square((from + to) / 2);
+                    if (PawnAttacks(us, epSq) & Pieces(them, Pawn)) {
+                        next.EnPassant = epSq;
+                        next.Key ^= NZobrist::EnPassantFile(FileOf(epSq));
+                    }
+                } else if (m.Kind() == Move::Promotion) {
+                    const auto promoted = MakePiece(us, m.PromotionType());
+                    RemovePiece(to);
+                    PutPiece(promoted, to);
+                    next.Key ^= NZobrist::PieceSquare(pc, to) ^ NZobrist::PieceSquare(promoted, to);
+                }
+            }
+        }
+
+        next.Castling &= kCastlingMask[from] & kCastlingMask[to];
+        next.Key ^= NZobrist::Castling(prev.Castling) ^ NZobrist::Castling(next.Castling);
+
+        SideToMove_ = them;
+        ++GamePly_;
+        States_.push_back(next);
+        UpdateCheckInfo();
+    }
+
+    auto Position::UnmakeMove(Move m) noexcept -> void {
+        SideToMove_ = ~SideToMove_;
+        --GamePly_;
+        const auto us = SideToMove_;
+        const auto from = m.From(), to = m.To();
+        const auto captured = States_.back().Captured;
+
+        if (m.Kind() == Move::Castling) {
+            const auto [rookFrom, rookTo] = CastlingRookSquares(to);
+            MovePiece(to, from);
+            MovePiece(rookTo, rookFrom);
+        } else {
+            if (m.Kind() == Move::Promotion) {
+                RemovePiece(to);
+                PutPiece(MakePiece(us, Pawn), to);
+            }
+            MovePiece(to, from);
+            if (captured != NoPiece) {
+                const auto capSq = m.Kind() == Move::EnPassant ? Square(to - PawnPush(us)) : to;
+                PutPiece(captured, capSq);
+            }
+        }
+        States_.pop_back();
+    }
+
+    auto Position::MakeNullMove() -> void {
+        const auto& prev = States_.back();
+        auto next = StateInfo{
+            .Key = prev.Key ^ NZobrist::SideToMove(),
+            .EnPassant = NoSquare,
+            .Castling = prev.Castling,
+            .Rule50 = uint8_t(std::min(prev.Rule50 + 1, 255)),
+            .PliesFromNull = 0,
+            .Captured = NoPiece,
+        };
+        if (prev.EnPassant != NoSquare) next.Key ^= NZobrist::EnPassantFile(FileOf(prev.EnPassant));
+        SideToMove_ = ~SideToMove_;
+        ++GamePly_;
+        States_.push_back(next);
+        UpdateCheckInfo();
+    }
+
+    auto Position::UnmakeNullMove() noexcept -> void {
+        SideToMove_ = ~SideToMove_;
+        --GamePly_;
+        States_.pop_back();
+    }
+
+    auto Position::IsDraw() const noexcept -> bool {
+        const auto& st = State();
+        if (st.Rule50 >= 100 && !st.Checkers) return true;
+
+        const auto end = std::min<size_t>(std::min(st.Rule50, st.PliesFromNull), States_.size() - 1);
+        for (auto i = size_t{4}; i <= end; i += 2) {
+            if (States_[States_.size() - 1 - i].Key == st.Key) return true;
+        }
+
+        // Insufficient material: bare kings or a single minor piece
+        if (Pieces(Pawn) | Pieces(Rook) | Pieces(Queen)) return false;
+        return !MoreThanOne(Pieces(Knight) | Pieces(Bishop));
+    }
+} // namespace NChess
@@ -0,0 +1,106 @@
+#pragma once
+
+
+#include "bitboard.hpp"
+#include "notation_error.hpp"
+#include "types.hpp"
+
+#include <charconv>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+
+namespace NChess {
+    // Enough for any position and move counters that fit in an int
+    static constexpr auto kMaxFenLength = 100;
+
+    class Position {
+    public:
+        // Everything that `MakeMove` can't recompute
+        // cheaply and `UnmakeMove` has to restore
+        struct StateInfo {
+            uint64_t Key = 0;
+            // Pieces giving check to the side to move
+            Bitboard Checkers = 0;
+            // Pieces of the side to move pinned to its own king
+            Bitboard Pinned = 0;
+            Square EnPassant = NoSquare;
+            uint8_t Castling = NoCastling;
+            uint8_t Rule50 = 0;
+            uint8_t PliesFromNull = 0;
+            Piece Captured = NoPiece;
+        };
+    private:
+        std::array<Bitboard, kNumPieceTypes> ByType_ = {};
+        std::array<Bitboard, 2> ByColor_ = {};
+        std::array<Piece, kNumSquares> Board_ = {};
+        Color SideToMove_ = White;
+        int GamePly_ = 0;
+        // `States_.back()` is the state of the current position
+        std::vector<StateInfo> States_;
+    public:
+        Position();
+        static auto StartPosition() -> Position;
+        /* Neither allocates once the position has been constructed, so
+         * both can be used on hot paths such as importing games. Move
+         * counters are optional in the input.
+         */
+        [[nodiscard]] auto SetFromFen(std::string_view fen) -> std::optional<NotationError>;
+        // Like `std::to_chars`: `errc::value_too_large` if
+        // the FEN doesn't fit in `[first, last)`
+        auto WriteFen(char* first, char* last) const noexcept -> std::to_chars_result;
+
+        auto PieceOn(Square s) const noexcept -> Piece { return Board_[s]; }
+        auto Pieces() const noexcept -> Bitboard { return ByColor_[White] | ByColor_[Black]; }
+        auto Pieces(Color c) const noexcept -> Bitboard { return ByColor_[c]; }
+        auto Pieces(PieceType pt) const noexcept -> Bitboard { return ByType_[pt]; }
+        auto Pieces(Color c, PieceType pt) const noexcept -> Bitboard { return ByColor_[c] & ByType_[pt]; }
+        auto KingSquare(Color c) const noexcept -> Square { return Lsb(Pieces(c, King)); }
+        auto SideToMove() const noexcept -> Color { return SideToMove_; }
+        auto GamePly() const noexcept -> int { return GamePly_; }
+
+        auto State() const noexcept -> const StateInfo& { return States_.back(); }
+        auto Key() const noexcept -> uint64_t { return State().Key; }
+        auto Checkers() const noexcept -> Bitboard { return State().Checkers; }
+        auto InCheck() const noexcept -> bool { return State().Checkers != 0; }
+        auto Pinned() const noexcept -> Bitboard { return State().Pinned; }
+        auto EnPassantSquare() const noexcept -> Square { return State().EnPassant; }
+        auto Castling() const noexcept -> uint8_t { return State().Castling; }
+        auto Rule50() const noexcept -> int { return State().Rule50; }
+        auto CapturedPiece() const noexcept -> Piece { return State().Captured; }
+
+        auto AttackersTo(Square s, Bitboard occupied) const noexcept -> Bitboard;
+        auto AttackersTo(Square s) const noexcept -> Bitboard { return AttackersTo(s, Pieces()); }
+        auto HasNonPawnMaterial(Color c) const noexcept -> bool {
+            return (Pieces(c) & ~Pieces(Pawn) & ~Pieces(King)) != 0;
+        }
+        auto IsCapture(Move m) const noexcept -> bool {
+            return Board_[m.To()] != NoPiece || m.Kind() == Move::EnPassant;
+        }
+
+        // Whether a move produced by the move generator
+        // doesn't leave the own king in check
+        auto IsLegal(Move m) const noexcept -> bool;
+        // Whether an arbitrary move (e.g. a killer move or a move from
+        // the transposition table) is a pseudo-legal move in this position
+        auto IsPseudoLegal(Move m) const noexcept -> bool;
+
+        auto MakeMove(Move m) -> void;
+        auto UnmakeMove(Move m) noexcept -> void;
+        auto MakeNullMove() -> void;
+        auto UnmakeNullMove() noexcept -> void;
+
+        // Fifty-move rule, repetition and insufficient material.
+        // Any repetition since the last irreversible move counts as a draw
+        auto IsDraw() const noexcept -> bool;
+    private:
+        auto PutPiece(Piece p, Square s) noexcept -> void;
+        auto RemovePiece(Square s) noexcept -> void;
+        auto MovePiece(Square from, Square to) noexcept -> void;
+        auto Clear() -> void;
+        // Recomputes `Checkers` and `Pinned` of the current state
+        auto UpdateCheckInfo() noexcept -> void;
+        auto ComputeKey() const noexcept -> uint64_t;
+    };
+} // namespace NChess
@@ -0,0 +1,198 @@
+#include "san.hpp"
+
+#include "movegen.hpp"
+
+#include <algorithm>
+
+
+namespace {
+    using namespace NChess;
+
+    constexpr auto PieceTypeFromLetter(char c) noexcept -> PieceType {
+        switch (c) {
+            case 'N': return Knight;
+            case 'B': return Bishop;
+            case 'R': return Rook;
+            case 'Q': return Queen;
+            case 'K': return King;
+            default:  return NoPieceType;
+        }
+    }
+
+    constexpr auto IsFileChar(char c) noexcept -> bool { return c >= 'a' && c <= 'h'; }
+    constexpr auto IsRankChar(char c) noexcept -> bool { return c >= '1' && c <= '8'; }
+
+    constexpr auto IsSuffixChar(char c) noexcept -> bool {
+        return c == '+' || c == '#' || c == '!' || c == '?';
+    }
+
+    using MoveOrError = std::variant<Move, NotationError>;
+
+    auto Illegal() noexcept -> MoveOrError { return NotationError{ENotationError::IllegalSanMove}; }
+
+    auto ResolveCastling(const Position& pos, bool kingSide) noexcept -> MoveOrError {
+        const auto us = pos.SideToMove();
+        const auto from = us == White ? E1 : E8;
+        if (pos.KingSquare(us) != from) return Illegal();
+        const auto m = Move{from, Square(kingSide ? from + 2 : from - 2), Move::Castling};
+        if (!pos.IsPseudoLegal(m) || !pos.IsLegal(m)) return Illegal();
+        return m;
+    }
+
+    auto ResolvePawnMove(
+        const Position& pos, Square to, int fromFile, int fromRank, PieceType promotion
+    ) noexcept -> MoveOrError {
+        const auto us = pos.SideToMove();
+        // Pawns never reach their first two ranks
+        if (RelativeRank(us, RankOf(to)) < 2) return Illegal();
+        if ((RelativeRank(us, RankOf(to)) == 7) != (promotion != NoPieceType)) return Illegal();
+        const auto kind = promotion != NoPieceType ? Move::Promotion : Move::Normal;
+        const auto promotionType = promotion != NoPieceType ? promotion : Knight;
+        const auto ourPawn = MakePiece(us, Pawn);
+
+        auto from = NoSquare;
+        auto m = Move{};
+        if (fromFile < 0 || fromFile == FileOf(to)) {
+            // A push: the pawn is right behind, or two squares behind
+            // from its starting rank
+            const auto behind = Square(to - PawnPush(us));
+            if (pos.PieceOn(behind) == ourPawn) {
+                from = behind;
+            } else if (pos.PieceOn(behind) == NoPiece && RelativeRank(us, RankOf(to)) == 3
+                       && pos.PieceOn(Square(behind - PawnPush(us))) == ourPawn) {
+                from = Square(behind - PawnPush(us));
+            } else {
+                return Illegal();
+            }
+            m = Move{from, to, kind, promotionType};
+        } else {
+            from = MakeSquare(fromFile, RankOf(to) - (us == White ? 1 : -1));
+            m = to == pos.EnPassantSquare() ? Move{from, to, Move::EnPassant} : Move{from, to, kind, promotionType};
+        }
+        if (fromRank >= 0 && RankOf(from) != fromRank) return Illegal();
+        if (!pos.IsPseudoLegal(m) || !pos.IsLegal(m)) return Illegal();
+        return m;
+    }
+
+    auto ResolvePieceMove(
+        const Position& pos, PieceType pt, Square to, int fromFile, int fromRank
+    ) noexcept -> MoveOrError {
+        const auto us = pos.SideToMove();
+        if (pos.Pieces(us) & SquareBb(to)) return Illegal();
+        // Attacks are symmetric: the pieces that can reach `to` are
+        // those that a piece of the same type on `to` attacks
+        auto candidates = pos.Pieces(us, pt) & Attacks(pt, to, pos.Pieces());
+        if (fromFile >= 0) candidates &= FileBb(fromFile);
+        if (fromRank >= 0) candidates &= RankBb(fromRank);
+        auto result = Move::None();
+        while (candidates) {
+            const auto m = Move{PopLsb(candidates), to};
+            if (!pos.IsLegal(m)) continue;
+            if (result) return NotationError{ENotationError::AmbiguousSanMove};
+            result = m;
+        }
+        if (!result) return Illegal();
+        return result;
+    }
+
+    // The file and/or rank of the origin square needed to tell `m` apart
+    // from the moves of the other pieces of its type to the same square
+    auto Disambiguation(const Position& pos, Move m, PieceType pt) noexcept -> std::pair<bool, bool> {
+        const auto us = pos.SideToMove();
+        auto others = pos.Pieces(us, pt) & Attacks(pt, m.To(), pos.Pieces()) & ~SquareBb(m.From());
+        auto sameFile = false, sameRank = false, any = false;
+        while (others) {
+            const auto from = PopLsb(others);
+            if (!pos.IsLegal(Move{from, m.To()})) continue;
+            any = true;
+            sameFile |= FileOf(from) == FileOf(m.From());
+            sameRank |= RankOf(from) == RankOf(m.From());
+        }
+        if (!any) return {false, false};
+        if (!sameFile) return {true, false};
+        if (!sameRank) return {false, true};
+        return {true, true};
+    }
+} // anonymous namespace
+
+
+namespace NChess {
+    auto ParseSan(const Position& pos, std::string_view san) noexcept -> std::variant<Move, NotationError> {
+        const auto malformed = NotationError{ENotationError::MalformedSan};
+        while (!san.empty() && IsSuffixChar(san.back())) san.remove_suffix(1);
+        if (san == "O-O" || san == "0-0") return ResolveCastling(pos, true);
+        if (san == "O-O-O" || san == "0-0-0") return ResolveCastling(pos, false);
+        if (san.size() < 2) return malformed;
+
+        auto promotion = NoPieceType;
+        if (const auto pt = PieceTypeFromLetter(san.back()); pt != NoPieceType && pt != King) {
+            san.remove_suffix(1);
+            if (!san.empty() && san.back() == '=') san.remove_suffix(1);
+            promotion = pt;
+        }
+        auto pieceType = Pawn;
+        if (const auto pt = PieceTypeFromLetter(san.front()); pt != NoPieceType) {
+            san.remove_prefix(1);
+            pieceType = pt;
+        }
+        if (san.size() < 2 || !IsFileChar(san[san.size() - 2]) || !IsRankChar(san.back())) return malformed;
+        const auto to = MakeSquare(san[san.size() - 2] - 'a', san.back() - '1');
+        san.remove_suffix(2);
+        if (!san.empty() && (san.back() == 'x' || san.back() == ':')) san.remove_suffix(1);
+
+        auto fromFile = -1, fromRank = -1;
+        if (san.size() > 2) return malformed;
+        for (const auto c : san) {
+            if (IsFileChar(c) && fromFile < 0) fromFile = c - 'a';
+            else if (IsRankChar(c) && fromRank < 0) fromRank = c - '1';
+            else return malformed;
+        }
+
+        if (pieceType == Pawn) return ResolvePawnMove(pos, to, fromFile, fromRank, promotion);
+        if (promotion != NoPieceType) return malformed;
+        return ResolvePieceMove(pos, pieceType, to, fromFile, fromRank);
+    }
+
+    auto WriteSan(char* first, char* last, Position& pos, Move m) noexcept -> std::to_chars_result {
+        auto buffer = std::array<char, kMaxSanLength>{};
+        auto* out = buffer.data();
+        const auto pt = TypeOf(pos.PieceOn(m.From()));
+        const auto file = [](Square s) { return char('a' + FileOf(s)); };
+        const auto rank = [](Square s) { return char('1' + RankOf(s)); };
+
+        if (m.Kind() == Move::Castling) {
+            out = std::copy_n(m.To() > m.From() ? "O-O" : "O-O-O", m.To() > m.From() ? 3 : 5, out);
+        } else if (pt == Pawn) {
+            if (pos.IsCapture(m)) {
+                *out++ = file(m.From());
+                *out++ = 'x';
+            }
+            *out++ = file(m.To());
+            *out++ = rank(m.To());
+            if (m.Kind() == Move::Promotion) {
+                *out++ = '=';
+                *out++ = "PNBRQK"[m.PromotionType()];
+            }
+        } else {
+            *out++ = "PNBRQK"[pt];
+            const auto [needFile, needRank] = Disambiguation(pos, m, pt);
+            if (needFile) *out++ = file(m.From());
+            if (needRank) *out++ = rank(m.From());
+            if (pos.IsCapture(m)) *out++ = 'x';
+            *out++ = file(m.To());
+            *out++ = rank(m.To());
+        }
+
+        pos.MakeMove(m);
+        if (pos.InCheck()) {
+            auto replies = MoveList{};
+            GenerateLegal(pos, replies);
+            *out++ = replies.Size == 0 ? '#' : '+';
+        }
+        pos.UnmakeMove(m);
+
+        const auto length = out - buffer.data();
+        if (last - first < length) return {last, std::errc::value_too_large};
+        return {std::copy_n(buffer.data(), length, first), std::errc{}};
+    }
+} // namespace NChess
@@ -0,0 +1,36 @@
+#pragma once
+
+
+#include "notation_error.hpp"
+#include "position.hpp"
+#include "types.hpp"
+
+#include <charconv>
+#include <string_view>
+#include <variant>
+
+
+namespace NChess {
+    // The longest SAN written by `WriteSan`, e.g. "Qh4xe1#" or "exd8=Q+"
+    static constexpr auto kMaxSanLength = 7;
+
+    /* Resolves a move in Standard Algebraic Notation ("Nbd7", "exd6",
+     * "e8=Q+", "O-O-O", ...) to the legal move of `pos` it denotes.
+     *
+     * The origin square is found from attack bitboards: the pieces of the
+     * right type that attack the destination square, narrowed by the
+     * disambiguation file/rank, are checked for legality one by one, so no
+     * move list is generated. Check and annotation suffixes ("+", "#",
+     * "!?") are accepted and ignored. Fails if the text is not SAN or
+     * denotes no legal move or more than one.
+     */
+    [[nodiscard]] auto ParseSan(const Position& pos, std::string_view san) noexcept
+      -> std::variant<Move, NotationError>;
+
+    /* Writes the legal move `m` of `pos` in SAN, with the minimal
+     * disambiguation and a "+" or "#" suffix, like `std::to_chars`.
+     * The move is made and unmade on `pos` to tell check from mate,
+     * which leaves `pos` as it was.
+     */
+    auto WriteSan(char* first, char* last, Position& pos, Move m) noexcept -> std::to_chars_result;
+} // namespace NChess
@@ -0,0 +1,170 @@
+#pragma once
+
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+
+namespace NChess {
+    // Plain (unscoped) enums are used on purpose in this namespace: squares,
+    // piece types and pieces are indices into bitboard and lookup tables on
+    // the hottest paths of move generation and search, and scoped enums
+    // would require a cast on every single table access.
+
+    using Bitboard = uint64_t;
+
+    enum Color : uint8_t {
+        White = 0,
+        Black = 1,
+    };
+    constexpr auto operator~(Color c) noexcept -> Color {
+        return Color(c ^ 1);
+    }
+
+    enum PieceType : uint8_t {
+        Pawn = 0,
+        Knight = 1,
+        Bishop = 2,
+        Rook = 3,
+        Queen = 4,
+        King = 5,
+        NoPieceType = 6,
+    };
+    static constexpr auto kNumPieceTypes = 6;
+
+    // `Piece` = 8 * color + piece type, so that
+    // `NoPiece` never collides with a real piece
+    enum Piece : uint8_t {
+        WhitePawn = 0, WhiteKnight, WhiteBishop, WhiteRook, WhiteQueen, WhiteKing,
+        BlackPawn = 8, BlackKnight, BlackBishop, BlackRook, BlackQueen, BlackKing,
+        NoPiece = 16,
+    };
+    static constexpr auto kNumPieceSlots = 16;
+
+    constexpr auto MakePiece(Color c, PieceType pt) noexcept -> Piece {
+        return Piece((c << 3) | pt);
+    }
+    constexpr auto TypeOf(Piece p) noexcept -> PieceType {
+        return PieceType(p & 7);
+    }
+    constexpr auto ColorOf(Piece p) noexcept -> Color {
+        return Color(p >> 3);
+    }
+
+    enum Square : int8_t {
+        A1, B1, C1, D1, E1, F1, G1, H1,
+        A2, B2, C2, D2, E2, F2, G2, H2,
+        A3, B3, C3, D3, E3, F3, G3, H3,
+        A4, B4, C4, D4, E4, F4, G4, H4,
+        A5, B5, C5, D5, E5, F5, G5, H5,
+        A6, B6, C6, D6, E6, F6, G6, H6,
+        A7, B7, C7, D7, E7, F7, G7, H7,
+        A8, B8, C8, D8, E8, F8, G8, H8,
+        NoSquare = 64,
+    };
+    static constexpr auto kNumSquares = 64;
+
+    constexpr auto MakeSquare(int file, int rank) noexcept -> Square {
+        return Square(rank * 8 + file);
+    }
+    constexpr auto FileOf(Square s) noexcept -> int {
+        return s & 7;
+    }
+    constexpr auto RankOf(Square s) noexcept -> int {
+        return s >> 3;
+    }
+    // Mirrors the square vertically (a1 <-> a8), which maps a
+    // square seen by white to the same square seen by black
+    constexpr auto FlipRank(Square s) noexcept -> Square {
+        return Square(s ^ 56);
+    }
+    constexpr auto RelativeRank(Color c, int rank) noexcept -> int {
+        return c == White ? rank : 7 - rank;
+    }
+    constexpr auto PawnPush(Color c) noexcept -> int {
+        return c == White ? 8 : -8;
+    }
+
+    constexpr auto SquareBb(Square s) noexcept -> Bitboard {
+        return Bitboard{1} << s;
+    }
+
+    enum CastlingRights : uint8_t {
+        NoCastling = 0,
+        WhiteKingSide = 1,
+        WhiteQueenSide = 2,
+        BlackKingSide = 4,
+        BlackQueenSide = 8,
+        AllCastling = 15,
+    };
+
+    /* A move packed into 16 bits:
+     *   bits 0-5:   origin square
+     *   bits 6-11:  destination square
+     *   bits 12-13: promotion piece type minus `Knight`
+     *   bits 14-15: move kind (see `EMoveKind`)
+     * Castling is encoded as a king move to its destination square
+     * (e.g. e1g1), the way it is written in UCI notation.
+     */
+    class Move {
+    public:
+        enum EMoveKind : uint16_t {
+            Normal = 0,
+            Promotion = 1,
+            EnPassant = 2,
+            Castling = 3,
+        };
+    private:
+        uint16_t Raw_ = 0;
+    public:
+        constexpr Move() noexcept = default;
+        constexpr explicit Move(uint16_t raw) noexcept : Raw_(raw) {}
+        constexpr Move(Square from, Square to, EMoveKind kind = Normal, PieceType promo = Knight) noexcept
+            : Raw_(uint16_t(from | (to << 6) | ((promo - Knight) << 12) | (kind << 14)))
+        {
+        }
+        static constexpr auto None() noexcept -> Move {
+            return Move{};
+        }
+        constexpr auto From() const noexcept -> Square {
+            return Square(Raw_ & 63);
+        }
+        constexpr auto To() const noexcept -> Square {
+            return Square((Raw_ >> 6) & 63);
+        }
+        constexpr auto Kind() const noexcept -> EMoveKind {
+            return EMoveKind(Raw_ >> 14);
+        }
+        constexpr auto PromotionType() const noexcept -> PieceType {
+            return PieceType(((Raw_ >> 12) & 3) + Knight);
+        }
+        constexpr auto GetRaw() const noexcept -> uint16_t {
+            return Raw_;
+        }
+        constexpr explicit operator bool() const noexcept {
+            return Raw_ != 0;
+        }
+        constexpr auto operator==(const Move&) const noexcept -> bool = default;
+    };
+
+    // Writes the move in UCI notation, e.g. "e2e4" or "e7e8q"
+    template <class OStream>
+    inline auto operator<<(OStream&& out, Move m) -> OStream&& {
+        if (!m) {
+            out << "0000";
+            return std::forward<OStream>(out);
+        }
+        const char str[] = {
+            char('a' + FileOf(m.From())), char('1' + RankOf(m.From())),
+            char('a' + FileOf(m.To())), char('1' + RankOf(m.To())),
+            m.Kind() == Move::Promotion ? "nbrq"[m.PromotionType() - Knight] : '\0',
+            '\0',
+        };
+        out << str;
+        return std::forward<OStream>(out);
+    }
+
+    static constexpr auto kMaxMoves = 256;
+    static constexpr auto kMaxPly = 128;
+} // namespace NChess
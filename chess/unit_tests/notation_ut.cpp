@@ -0,0 +1,218 @@
+#include "../movegen.hpp"
+#include "../position.hpp"
+#include "../san.hpp"
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string_view>
+
+
+namespace {
+using namespace NChess;
+
+// Counts the allocations of the whole program, to check
+// that parsing and formatting don't allocate
+static auto gNumAllocations = size_t{0};
+
+static constexpr auto kFens = std::array<std::string_view, 7>{{
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+}};
+
+auto ToFen(const Position& pos) -> std::string {
+    auto buffer = std::array<char, kMaxFenLength>{};
+    const auto [end, ec] = pos.WriteFen(buffer.data(), buffer.data() + buffer.size());
+    assert(ec == std::errc{});
+    return std::string(buffer.data(), end);
+}
+
+auto ToSan(Position& pos, Move m) -> std::string {
+    auto buffer = std::array<char, kMaxSanLength>{};
+    const auto [end, ec] = WriteSan(buffer.data(), buffer.data() + buffer.size(), pos, m);
+    assert(ec == std::errc{});
+    return std::string(buffer.data(), end);
+}
+
+auto SanError(const Position& pos, std::string_view san) -> std::optional<ENotationError> {
+    const auto moveOrError = ParseSan(pos, san);
+    if (const auto* err = std::get_if<NotationError>(&moveOrError)) return err->Value;
+    return std::nullopt;
+}
+
+// Every legal move in the tree survives formatting and parsing back
+auto CheckSanRoundTrip(Position& pos, int depth) -> void {
+    if (depth == 0) return;
+    auto list = MoveList{};
+    GenerateLegal(pos, list);
+    for (const auto m : list) {
+        const auto san = ToSan(pos, m);
+        const auto parsed = ParseSan(pos, san);
+        assert(std::holds_alternative<Move>(parsed) && std::get<Move>(parsed) == m);
+        pos.MakeMove(m);
+        CheckSanRoundTrip(pos, depth - 1);
+        pos.UnmakeMove(m);
+    }
+}
+} // anonymous namespace
+
+
+auto operator new(size_t size) -> void* {
+    ++gNumAllocations;
+    if (auto* p = std::malloc(size)) return p;
+    throw std::bad_alloc{};
+}
+
+auto operator delete(void* p) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete(void* p, size_t) noexcept -> void {
+    std::free(p);
+}
+
+
+namespace NTests {
+auto TestFenRoundTrip() -> void {
+    auto pos = Position{};
+    for (const auto fen : kFens) {
+        assert(!pos.SetFromFen(fen));
+        assert(ToFen(pos) == fen);
+    }
+    // The en passant square is dropped if no capture is possible,
+    // and missing counters get their defaults
+    assert(!pos.SetFromFen("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3"));
+    assert(ToFen(pos) == "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1");
+    std::cerr << "TestFenRoundTrip OK\n";
+}
+
+auto TestFenErrors() -> void {
+    auto pos = Position{};
+    const auto error = [&pos](std::string_view fen) {
+        const auto err = pos.SetFromFen(fen);
+        assert(err);
+        return err->Value;
+    };
+    using enum ENotationError;
+    assert(error("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq - 0 1") == IncompletePiecePlacement);
+    assert(error("rnbqkbnr/pppppppp/72/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1") == RankTooLong);
+    assert(error("rnbqkbnr/ppppxppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1") == UnexpectedCharacterInPiecePlacement);
+    assert(error("rnbqkbnr/ppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1") == MalformedPiecePlacement);
+    assert(error("8/8/8/8/8/8/8/8 w - - 0 1") == WrongNumberOfKings);
+    assert(error("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1") == InvalidSideToMove);
+    assert(error("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQxq - 0 1") == InvalidCastlingRights);
+    assert(error("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e4 0 1") == InvalidEnPassantSquare);
+    assert(error("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - x 1") == InvalidMoveCounter);
+    assert(error("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 -1") == InvalidMoveCounter);
+    assert(error("k7/8/8/8/8/8/8/K6Q w - - 0 1") == SideNotToMoveInCheck);
+
+    auto out = std::ostringstream{};
+    out << NotationError{InvalidSideToMove, "Bad FEN"};
+    assert(out.str() == "Bad FEN, got the following error: side to move must be 'w' or 'b'");
+    std::cerr << "TestFenErrors OK\n";
+}
+
+auto TestWriteSan() -> void {
+    auto pos = Position{};
+    const auto san = [&pos](std::string_view uci) {
+        auto list = MoveList{};
+        GenerateLegal(pos, list);
+        for (const auto m : list) {
+            auto out = std::ostringstream{};
+            out << m;
+            if (out.str() == uci) return ToSan(pos, m);
+        }
+        assert(false);
+        return std::string{};
+    };
+    assert(!pos.SetFromFen("r3k2r/8/8/8/8/2N3N1/8/R3K2R w KQkq - 0 1"));
+    assert(san("c3e4") == "Nce4");
+    assert(san("g3e2") == "Nge2");
+    assert(san("e1g1") == "O-O");
+    assert(san("e1c1") == "O-O-O");
+    assert(san("a1a8") == "Rxa8+");
+    // Same file, then same file and rank
+    assert(!pos.SetFromFen("1k6/8/8/8/Q6Q/8/8/K6Q w - - 0 1"));
+    assert(san("a4e4") == "Qae4");
+    assert(san("h4e4") == "Qh4e4");
+    assert(san("h1e4") == "Q1e4");
+    // The knight on d2 is pinned
+    assert(!pos.SetFromFen("4k3/8/8/b7/8/8/3N4/4K1N1 w - - 0 1"));
+    assert(san("g1f3") == "Nf3");
+    assert(!pos.SetFromFen("4k3/1P6/8/3pP3/8/8/8/4K3 w - d6 0 1"));
+    assert(san("e5d6") == "exd6");
+    assert(san("b7b8q") == "b8=Q+");
+    assert(san("b7b8n") == "b8=N");
+    assert(!pos.SetFromFen("r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR w KQkq - 2 3"));
+    assert(san("f3f7") == "Qxf7#");
+
+    auto tiny = std::array<char, 4>{};
+    assert(WriteSan(tiny.data(), tiny.data() + tiny.size(), pos, Move{F3, F7}).ec == std::errc::value_too_large);
+    assert(pos.WriteFen(tiny.data(), tiny.data() + tiny.size()).ec == std::errc::value_too_large);
+    std::cerr << "TestWriteSan OK\n";
+}
+
+auto TestSanErrors() -> void {
+    auto pos = Position{};
+    assert(!pos.SetFromFen("r3k2r/8/8/8/8/2N3N1/8/R3K2R w KQkq - 0 1"));
+    using enum ENotationError;
+    assert(SanError(pos, "Ne4") == AmbiguousSanMove);
+    assert(SanError(pos, "Ra9") == MalformedSan);
+    assert(SanError(pos, "Nxx4") == MalformedSan);
+    assert(SanError(pos, "e4") == IllegalSanMove);
+    assert(SanError(pos, "Bd3") == IllegalSanMove);
+    assert(!SanError(pos, "Nce4"));
+    std::cerr << "TestSanErrors OK\n";
+}
+
+auto TestSanRoundTrip() -> void {
+    auto pos = Position{};
+    for (const auto fen : kFens) {
+        assert(!pos.SetFromFen(fen));
+        CheckSanRoundTrip(pos, 2);
+    }
+    std::cerr << "TestSanRoundTrip OK\n";
+}
+
+// Once a position exists, none of the notation code allocates
+auto TestNoAllocations() -> void {
+    auto pos = Position{};
+    auto fen = std::array<char, kMaxFenLength>{};
+    auto san = std::array<char, kMaxSanLength>{};
+    const auto before = gNumAllocations;
+    for (const auto text : kFens) {
+        assert(!pos.SetFromFen(text));
+        pos.WriteFen(fen.data(), fen.data() + fen.size());
+        auto list = MoveList{};
+        GenerateLegal(pos, list);
+        for (const auto m : list) {
+            const auto [end, ec] = WriteSan(san.data(), san.data() + san.size(), pos, m);
+            assert(ec == std::errc{});
+            assert(std::holds_alternative<Move>(ParseSan(pos, std::string_view(san.data(), end))));
+        }
+    }
+    assert(pos.SetFromFen("8/8/8/8/8/8/8/8 w - - 0 1"));
+    assert(std::holds_alternative<NotationError>(ParseSan(pos, "Qxz9")));
+    assert(gNumAllocations == before);
+    std::cerr << "TestNoAllocations OK\n";
+}
+} // namespace NTests
+
+
+auto main() -> int {
+    using namespace NTests;
+    TestFenRoundTrip();
+    TestFenErrors();
+    TestWriteSan();
+    TestSanErrors();
+    TestSanRoundTrip();
+    TestNoAllocations();
+    std::cerr << "All tests passed.\n";
+}
@@ -0,0 +1,88 @@
+#include "../movegen.hpp"
+#include "../position.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <string_view>
+
+
+namespace {
+using namespace NChess;
+
+struct PerftCase {
+    std::string_view Fen;
+    int Depth;
+    uint64_t ExpectedNodes;
+};
+
+// Reference numbers from the Chess Programming Wiki "Perft Results" page
+static constexpr auto kPerftCases = std::array<PerftCase, 6>{{
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 4, 197281},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 3, 97862},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 3, 62379},
+    {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 3, 89890},
+}};
+
+// Walks the move tree checking that incrementally updated keys match
+// freshly computed ones and that every generated move is pseudo-legal
+auto CheckConsistency(Position& pos, int depth) -> void {
+    if (depth == 0) return;
+    auto list = MoveList{};
+    GeneratePseudoLegal<EGenType::All>(pos, list);
+    for (const auto m : list) {
+        assert(pos.IsPseudoLegal(m));
+        if (!pos.IsLegal(m)) continue;
+        const auto keyBefore = pos.Key();
+        pos.MakeMove(m);
+        CheckConsistency(pos, depth - 1);
+        pos.UnmakeMove(m);
+        assert(pos.Key() == keyBefore);
+    }
+}
+} // anonymous namespace
+
+
+namespace NTests {
+auto TestPerft() -> void {
+    for (const auto& testCase : kPerftCases) {
+        auto pos = Position{};
+        assert(!pos.SetFromFen(testCase.Fen));
+        const auto nodes = Perft(pos, testCase.Depth);
+        if (nodes != testCase.ExpectedNodes) {
+            std::cerr << "Perft(" << testCase.Depth << ") of \"" << testCase.Fen << "\": expected "
+                      << testCase.ExpectedNodes << ", got " << nodes << "\n";
+        }
+        assert(nodes == testCase.ExpectedNodes);
+    }
+    std::cerr << "TestPerft OK\n";
+}
+
+auto TestIncrementalConsistency() -> void {
+    for (const auto& testCase : kPerftCases) {
+        auto pos = Position{};
+        assert(!pos.SetFromFen(testCase.Fen));
+        CheckConsistency(pos, 2);
+    }
+    std::cerr << "TestIncrementalConsistency OK\n";
+}
+
+auto TestRejectsMalformedFen() -> void {
+    auto pos = Position{};
+    assert(pos.SetFromFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq - 0 1"));
+    assert(pos.SetFromFen("rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"));
+    assert(pos.SetFromFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1"));
+    assert(pos.SetFromFen("8/8/8/8/8/8/8/8 w - - 0 1"));
+    std::cerr << "TestRejectsMalformedFen OK\n";
+}
+} // namespace NTests
+
+
+auto main() -> int {
+    using namespace NTests;
+    TestPerft();
+    TestIncrementalConsistency();
+    TestRejectsMalformedFen();
+    std::cerr << "All tests passed.\n";
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+
+#include "types.hpp"
+
+
+namespace NChess::NZobrist {
+    namespace NImpl {
+        constexpr auto SplitMix64(uint64_t& state) noexcept -> uint64_t {
+            auto z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+
+        struct Keys {
+            std::array<std::array<uint64_t, kNumSquares>, kNumPieceSlots> PieceSquare{};
+            std::array<uint64_t, 16> Castling{};
+            std::array<uint64_t, 8> EnPassantFile{};
+            uint64_t SideToMove = 0;
+        };
+
+        constexpr auto GenerateKeys() noexcept -> Keys {
+            auto state = uint64_t{20240601};
+            auto keys = Keys{};
+            for (auto& bySquare : keys.PieceSquare) {
+                for (auto& key : bySquare) key = SplitMix64(state);
+            }
+            // Castling keys are XOR-combinations of four independent keys,
+            // so that updating the rights with a mask stays a single XOR
+            auto single = std::array<uint64_t, 4>{};
+            for (auto& key : single) key = SplitMix64(state);
+            for (auto rights = 0; rights < 16; ++rights) {
+                for (auto bit = 0; bit < 4; ++bit) {
+                    if (rights & (1 << bit)) keys.Castling[rights] ^= single[bit];
+                }
+            }
+            for (auto& key : keys.EnPassantFile) key = SplitMix64(state);
+            keys.SideToMove = SplitMix64(state);
+            return keys;
+        }
+    } // namespace NImpl
+
+    // Generated at compile time from a fixed seed, so
+    // that keys are stable across runs and processes
+    inline constexpr auto kKeys = NImpl::GenerateKeys();
+
+    constexpr auto PieceSquare(Piece p, Square s) noexcept -> uint64_t {
+        return kKeys.PieceSquare[p][s];
+    }
+    constexpr auto Castling(uint8_t rights) noexcept -> uint64_t {
+        return kKeys.Castling[rights];
+    }
+    constexpr auto EnPassantFile(int file) noexcept -> uint64_t {
+        return kKeys.EnPassantFile[file];
+    }
+    constexpr auto SideToMove() noexcept -> uint64_t {
+        return kKeys.SideToMove;
+    }
+} // namespace NChess::NZobrist
@@ -0,0 +1,165 @@
+#include "happy_eyeballs.hpp"
+
+#include "../utils/overloaded.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+
+
+namespace {
+    using namespace NHappyEyeballs;
+
+    /* The state of one `AsyncConnectToAny()`, shared by the callbacks of
+     * its attempts, as those of the losers are still called once the
+     * race is decided
+     */
+    struct Race {
+        EventLoop& Loop;
+        std::vector<sockaddr_storage> Candidates;
+        // The sockets of the attempts in progress, by candidate
+        std::vector<std::optional<TcpClient>> Attempts;
+        size_t NumStarted = 0;
+        size_t NumInProgress = 0;
+        std::chrono::milliseconds Timeout;
+        EventLoop::Clock::time_point Start;
+        EventLoop::Clock::time_point Deadline;
+        std::chrono::milliseconds AttemptDelay;
+        std::optional<EventLoop::TimerId> NextAttemptTimer;
+        // Reset once the race is decided
+        OnConnected OnDone;
+        Result LastFailure = SystemError{
+            .Value = std::errc::invalid_argument,
+            .ContextMessage = "no address to connect to (" SOURCE_LOCATION ")",
+        };
+    };
+
+    auto CalcRemainingTimeout(const Race& race) noexcept -> std::chrono::milliseconds {
+        return std::max(
+            std::chrono::ceil<std::chrono::milliseconds>(race.Deadline - EventLoop::Clock::now()),
+            std::chrono::milliseconds{0}
+        );
+    }
+
+    auto Drop(Race& race, const size_t i) noexcept -> void {
+        if (!race.Attempts[i]) return;
+        // Removing the socket cancels its `connect()`, which reports to a callback that ignores it
+        static_cast<void>(race.Loop.Remove(race.Attempts[i]->GetFd()));
+        race.Attempts[i].reset();
+    }
+
+    auto Finish(Race& race, Result result) -> void {
+        if (race.NextAttemptTimer) race.Loop.CancelTimer(*std::exchange(race.NextAttemptTimer, std::nullopt));
+        for (auto i = size_t{0}; i != race.Attempts.size(); ++i) Drop(race, i);
+        std::exchange(race.OnDone, nullptr)(std::move(result));
+    }
+
+    auto StartNextAttempt(const std::shared_ptr<Race>& race) -> void;
+
+    auto OnAttemptFailed(const std::shared_ptr<Race>& race, const size_t i, Result failure) -> void {
+        Drop(*race, i);
+        --race->NumInProgress;
+        race->LastFailure = std::move(failure);
+        if (race->NumStarted != race->Candidates.size() && CalcRemainingTimeout(*race).count() > 0) {
+            // The next one doesn't wait for the delay of a failed one
+            if (race->NextAttemptTimer) race->Loop.CancelTimer(*std::exchange(race->NextAttemptTimer, std::nullopt));
+            StartNextAttempt(race);
+        } else if (race->NumInProgress == 0) {
+            Finish(*race, std::move(race->LastFailure));
+        }
+    }
+
+    auto StartNextAttempt(const std::shared_ptr<Race>& race) -> void {
+        const auto i = race->NumStarted++;
+        const auto& candidate = race->Candidates[i];
+        ++race->NumInProgress;
+        // E.g. `EAFNOSUPPORT` on a host without IPv6
+        auto clientOrErr = candidate.ss_family == AF_INET6 ? TcpClient::CreateNew<IP::v6>()
+                                                           : TcpClient::CreateNew<IP::v4>();
+        if (auto* err = std::get_if<SystemError>(&clientOrErr)) {
+            OnAttemptFailed(race, i, std::move(*err));
+            return;
+        }
+        auto& attempt = race->Attempts[i].emplace(std::move(std::get<TcpClient>(clientOrErr)));
+        if (auto err = race->Loop.Add(attempt.GetFd())) {
+            race->Attempts[i].reset();
+            OnAttemptFailed(race, i, std::move(*err));
+            return;
+        }
+        attempt.AsyncConnect(race->Loop, candidate, CalcRemainingTimeout(*race), [race, i](TcpClient::ConnectResult result) {
+            if (!race->OnDone) return;
+            std::visit(overloaded{
+                [&](TcpClient::Ok) {
+                    auto winner = std::move(*race->Attempts[i]);
+                    race->Attempts[i].reset();
+                    --race->NumInProgress;
+                    Finish(*race, std::move(winner));
+                },
+                // The attempts share the deadline of the race, so they time out in its terms
+                [&](TcpClient::Timeout) {
+                    OnAttemptFailed(race, i, TcpClient::Timeout{
+                        .Duration = race->Timeout,
+                        .WallTimeElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            EventLoop::Clock::now() - race->Start
+                        ),
+                    });
+                },
+                // Redundant, but is needed for the code to compile
+                [&](IpAddrParsingError) {},
+                [&](SystemError& failure) {
+                    OnAttemptFailed(race, i, std::move(failure));
+                },
+            }, result);
+        });
+        if (race->NumStarted != race->Candidates.size()) {
+            race->NextAttemptTimer = race->Loop.ScheduleAfter(race->AttemptDelay, [race]() {
+                race->NextAttemptTimer.reset();
+                if (race->OnDone && CalcRemainingTimeout(*race).count() > 0) StartNextAttempt(race);
+            });
+        }
+    }
+}
+
+
+auto NHappyEyeballs::InterleaveAddressFamilies(std::vector<sockaddr_storage> candidates)
+  -> std::vector<sockaddr_storage> {
+    const auto firstIpV4 = std::stable_partition(candidates.begin(), candidates.end(), [](const sockaddr_storage& addr) {
+        return addr.ss_family == AF_INET6;
+    });
+    auto interleaved = std::vector<sockaddr_storage>{};
+    interleaved.reserve(candidates.size());
+    for (auto ipV6 = candidates.begin(), ipV4 = firstIpV4; ipV6 != firstIpV4 || ipV4 != candidates.end();) {
+        if (ipV6 != firstIpV4) interleaved.push_back(*ipV6++);
+        if (ipV4 != candidates.end()) interleaved.push_back(*ipV4++);
+    }
+    return interleaved;
+}
+
+auto NHappyEyeballs::AsyncConnectToAny(
+    EventLoop& loop,
+    std::vector<sockaddr_storage> candidates,
+    const std::chrono::milliseconds timeout,
+    OnConnected onConnected,
+    const std::chrono::milliseconds attemptDelay
+) noexcept -> void {
+    const auto numCandidates = candidates.size();
+    const auto start = EventLoop::Clock::now();
+    auto race = std::make_shared<Race>(Race{
+        .Loop = loop,
+        .Candidates = InterleaveAddressFamilies(std::move(candidates)),
+        .Attempts = std::vector<std::optional<TcpClient>>(numCandidates),
+        .Timeout = timeout,
+        .Start = start,
+        .Deadline = start + timeout,
+        .AttemptDelay = attemptDelay,
+        .OnDone = std::move(onConnected),
+    });
+    // Even the failures found at once are reported from the loop, as for the other async operations
+    loop.Post([race]() {
+        if (race->Candidates.empty()) {
+            Finish(*race, std::move(race->LastFailure));
+        } else {
+            StartNextAttempt(race);
+        }
+    });
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+
+#include "tcp_client.hpp"
+
+#include "../utils/coroutine/task.hpp"
+#include "../utils/event_loop/event_loop.hpp"
+
+#include <chrono>
+#include <functional>
+#include <sys/socket.h>
+#include <variant>
+#include <vector>
+
+
+namespace NHappyEyeballs {
+    // How long an attempt has the lead before the next one starts beside it, as recommended by RFC 8305
+    constexpr auto kConnectionAttemptDelay = std::chrono::milliseconds{250};
+
+    using Result = std::variant<TcpClient, SystemError, TcpClient::Timeout>;
+    using OnConnected = std::function<void(Result)>;
+
+    // IPv6 and IPv4 addresses in turns, IPv6 first, each family in the given order
+    [[nodiscard]] auto InterleaveAddressFamilies(std::vector<sockaddr_storage> candidates)
+      -> std::vector<sockaddr_storage>;
+
+    /* Connects to whichever of `candidates` answers first, the way of
+     * Happy Eyeballs (RFC 8305): a server that is reachable over one
+     * family only, or a host whose route of one family is a black hole,
+     * costs `attemptDelay` instead of the whole `timeout`.
+     *
+     * The attempts start one by one in the order of
+     * `InterleaveAddressFamilies()`, each as soon as the previous one
+     * fails or `attemptDelay` after it started, and are all given until
+     * `timeout` passes. The first connection made wins and is added to
+     * `loop`; the attempts still in progress are then removed from it and
+     * their sockets closed. If all of them fail, `onConnected` gets the
+     * error of the last one to fail.
+     */
+    auto AsyncConnectToAny(
+        EventLoop& loop,
+        std::vector<sockaddr_storage> candidates,
+        std::chrono::milliseconds timeout,
+        OnConnected onConnected,
+        std::chrono::milliseconds attemptDelay = kConnectionAttemptDelay
+    ) noexcept -> void;
+
+    // The awaitable version of the above, for the coroutines run by `loop`
+    [[nodiscard]] inline auto AsyncConnectToAny(
+        EventLoop& loop,
+        std::vector<sockaddr_storage> candidates,
+        std::chrono::milliseconds timeout
+    ) noexcept {
+        return AwaitCallback<Result>([&loop, candidates = std::move(candidates), timeout](OnConnected onConnected) mutable {
+            AsyncConnectToAny(loop, std::move(candidates), timeout, std::move(onConnected));
+        });
+    }
+} // namespace NHappyEyeballs
@@ -0,0 +1,156 @@
+#include "tcp_client.hpp"
+
+#include "../api/create_new_game.hpp"
+#include "../utils/bench_helpers.hpp"
+#include "../utils/cli_args.hpp"
+#include "../utils/coroutine/task.hpp"
+#include "../utils/event_loop/event_loop.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <netinet/in.h>
+#include <string_view>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+
+namespace {
+    using namespace std::chrono;
+    using namespace NApi;
+
+    constexpr auto kTimeout = milliseconds{10'000};
+
+    struct Stats {
+        std::vector<nanoseconds> Latencies;
+        int NumFailed = 0;
+        int NumDone = 0;
+    };
+
+    // One connection of the central server: answers each "create new game" request
+    auto ServeConnection(EventLoop& loop, const int fd) -> Task<void> {
+        auto request = Buf<MessageType::CreateNewGameRequest>{};
+        for (auto gameId = uint64_t{1};; ++gameId) {
+            const auto read = co_await AwaitCallback<RobustSyncReadResult>([&](EventLoop::OnReadDone onDone) {
+                loop.AsyncRead(fd, request, kTimeout, std::move(onDone));
+            });
+            if (!std::holds_alternative<NRobustSyncRead::OnSuccess>(read)) break;
+            const auto response = Serialize(CreateNewGameResponse{GameId{gameId}});
+            const auto written = co_await AwaitCallback<RobustSyncWriteResult>([&](EventLoop::OnWriteDone onDone) {
+                loop.AsyncWrite(fd, response, kTimeout, std::move(onDone));
+            });
+            if (!std::holds_alternative<NRobustSyncWrite::OnSuccess>(written)) break;
+        }
+        static_cast<void>(loop.Remove(fd));
+        close(fd);
+    }
+
+    // The central server: one coroutine per connection, on the same loop as the clients
+    auto Serve(EventLoop& loop, TaskScope& connections, const int listener) -> Task<void> {
+        for (;;) {
+            const auto fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                const auto ready = co_await AwaitCallback<AsyncWaitResult>([&](EventLoop::OnWaitDone onDone) {
+                    loop.WaitReadable(listener, milliseconds{-1}, std::move(onDone));
+                });
+                if (!std::holds_alternative<NAsyncWait::OnReady>(ready)) co_return;
+                continue;
+            }
+            if (fd == -1 && (errno == EINTR || errno == ECONNABORTED)) continue;
+            Check(fd != -1, "accept4()");
+            if (auto err = loop.Add(fd)) LogErrorAndExit(*err);
+            connections.Spawn(ServeConnection(loop, fd));
+        }
+    }
+
+    /* A player that connects to the central server and creates
+     * `numRequests` games in a row, as the client's state handlers do
+     */
+    auto SimulateClient(
+        EventLoop& loop,
+        const sockaddr_storage server,
+        const int numRequests,
+        Stats& stats
+    ) -> Task<void> {
+        auto clientOrErr = TcpClient::CreateNew<IP::v4>();
+        if (auto* err = std::get_if<SystemError>(&clientOrErr)) LogErrorAndExit(*err);
+        const auto client = std::move(std::get<TcpClient>(clientOrErr));
+        if (auto err = loop.Add(client.GetFd())) LogErrorAndExit(*err);
+        auto ok = std::holds_alternative<TcpClient::Ok>(co_await client.AsyncConnect(loop, server, kTimeout));
+        const auto request = Serialize(CreateNewGameRequest{});
+        auto response = Buf<MessageType::CreateNewGameResponse>{};
+        for (auto i = 0; ok && i != numRequests; ++i) {
+            const auto sent = MonotonicClock::now();
+            ok = std::holds_alternative<TcpClient::Ok>(co_await client.AsyncSend(loop, request, kTimeout))
+              && std::holds_alternative<TcpClient::Ok>(co_await client.AsyncReceive(loop, response, kTimeout))
+              && std::holds_alternative<CreateNewGameResponse>(Deserialize<MessageType::CreateNewGameResponse>(response));
+            if (ok) stats.Latencies.push_back(MonotonicClock::now() - sent);
+        }
+        static_cast<void>(loop.Remove(client.GetFd()));
+        stats.NumFailed += !ok;
+        ++stats.NumDone;
+    }
+} // anonymous namespace
+
+
+/* Usage: load_test [clients = 2000] [requests per client = 20]
+ *
+ * Runs a central server and thousands of simulated clients in one
+ * process, on one `EventLoop`: each client is a coroutine that connects
+ * and creates games in a row, awaiting the `TcpClient` operations, and
+ * the server answers with a coroutine per connection. Reports the
+ * requests/second, the p50/p99 request latency in microseconds, and the
+ * memory taken by the coroutine frames.
+ */
+auto main(int argc, char** argv) -> int {
+    const auto numClients = std::max(argc > 1 ? ParseIntArg(argv[1], 2000) : 2000, 1);
+    const auto numRequests = std::max(argc > 2 ? ParseIntArg(argv[2], 20) : 20, 1);
+
+    // Two sockets per client, in one process
+    auto limit = rlimit{};
+    Check(getrlimit(RLIMIT_NOFILE, &limit) == 0, "getrlimit()");
+    limit.rlim_cur = limit.rlim_max;
+    Check(setrlimit(RLIMIT_NOFILE, &limit) == 0, "setrlimit()");
+
+    auto loopOrErr = EventLoop::CreateNew();
+    if (auto* err = std::get_if<SystemError>(&loopOrErr)) LogErrorAndExit(*err);
+    auto& loop = std::get<EventLoop>(loopOrErr);
+
+    const auto listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    Check(listener != -1, "socket()");
+    auto addr = ConstructSockAddr(in_addr{.s_addr = htonl(INADDR_LOOPBACK)}, 0);
+    auto addrLen = socklen_t{sizeof(addr)};
+    Check(bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0, "bind()");
+    Check(listen(listener, SOMAXCONN) == 0, "listen()");
+    Check(getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &addrLen) == 0, "getsockname()");
+    if (auto err = loop.Add(listener)) LogErrorAndExit(*err);
+
+    auto stats = Stats{};
+    stats.Latencies.reserve(size_t(numClients) * size_t(numRequests));
+    const auto start = MonotonicClock::now();
+    {
+        // Destroyed before the loop, with the server's coroutines still waiting for it
+        auto server = TaskScope{};
+        auto clients = TaskScope{};
+        server.Spawn(Serve(loop, server, listener));
+        for (auto i = 0; i != numClients; ++i) {
+            clients.Spawn(SimulateClient(loop, ToSockAddrStorage(addr), numRequests, stats));
+        }
+        while (stats.NumDone != numClients) {
+            if (auto err = loop.RunOnce()) LogErrorAndExit(*err);
+        }
+    }
+    const auto seconds = duration<double>(MonotonicClock::now() - start).count();
+    close(listener);
+
+    std::cout << "clients: " << numClients << ", failed: " << stats.NumFailed
+              << ", requests: " << stats.Latencies.size() << " in " << std::fixed << std::setprecision(3) << seconds << "s\n"
+              << "requests/s: " << int64_t(double(stats.Latencies.size()) / seconds)
+              << ", p50 us: " << Percentile(stats.Latencies, 0.5) / 1000
+              << ", p99 us: " << Percentile(stats.Latencies, 0.99) / 1000 << "\n"
+              << "coroutine frames: " << FramePool::ForThisThread().NumChunks() << " chunks of 256 KiB\n";
+    return stats.NumFailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,170 @@
+#include "runtime.hpp"
+
+#include "state_handlers/all.hpp"
+
+#include "../utils/overloaded.hpp"
+
+#include <array>
+#include <cerrno>
+#include <fcntl.h>
+#include <functional>
+#include <iostream>
+#include <unistd.h>
+
+
+namespace {
+    using namespace std::chrono_literals;
+
+    // The UI is called at least this often, whatever the network does
+    constexpr auto kFrameInterval = 16ms;
+
+    // Resumes the coroutine from the next `RunOnce()` of `loop`
+    auto Yield(EventLoop& loop) noexcept {
+        return AwaitCallback<std::monostate>([&loop](std::function<void(std::monostate)> resume) {
+            loop.Post([resume = std::move(resume)]() { resume({}); });
+        });
+    }
+
+    auto EnterWhenDone(EventLoop& loop, Task<NState::State> handler, const NState::Transition transition) noexcept
+      -> Task<void> {
+        auto next = co_await std::move(handler);
+        // A handler that fails before it awaits anything is done within `Enter()`
+        co_await Yield(loop);
+        transition(std::move(next));
+    }
+}
+
+NState::Transition::Transition(ClientRuntime& runtime, const uint64_t generation) noexcept
+    : Runtime_(&runtime)
+    , Generation_(generation)
+{
+}
+
+auto NState::Transition::operator()(State next) const noexcept -> void {
+    if (Runtime_->Generation_ == Generation_) Runtime_->Enter(std::move(next));
+}
+
+ClientRuntime::ClientRuntime(NState::Context ctx) noexcept
+    : Ctx_(std::move(ctx))
+{
+}
+
+auto ClientRuntime::CreateNew(std::vector<Endpoint> centralServerEndpoints, IUserClient& userClient) noexcept
+  -> std::variant<ClientRuntime, SystemError> {
+    auto loopOrErr = EventLoop::CreateNew();
+    if (auto* err = std::get_if<SystemError>(&loopOrErr)) return std::move(*err);
+    return ClientRuntime{NState::Context{
+        .Loop = std::move(std::get<EventLoop>(loopOrErr)),
+        .CentralServerEndpoints = std::move(centralServerEndpoints),
+        .UserClient = userClient,
+    }};
+}
+
+auto ClientRuntime::Run() noexcept -> int {
+    const auto stdinFlags = fcntl(STDIN_FILENO, F_GETFL);
+    if (stdinFlags == -1 || fcntl(STDIN_FILENO, F_SETFL, stdinFlags | O_NONBLOCK) == -1) {
+        std::cerr << SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "fcntl() syscall failed (" SOURCE_LOCATION ")",
+        } << "\n";
+        return EXIT_FAILURE;
+    }
+    // A regular file can't be added to epoll, and never blocks either
+    auto err = Ctx_.Loop.Add(STDIN_FILENO);
+    if (err && err->Value == std::errc::operation_not_permitted) err = std::nullopt;
+    if (!err) {
+        Ctx_.Loop.Post([this]() { ReadInput(); });
+        Enter(NState::NeedToConnectToCentralServer{});
+        ScheduleFrame();
+        err = Ctx_.Loop.Run();
+    }
+    if (err) {
+        std::cerr << *err << "\n";
+        ExitCode_ = EXIT_FAILURE;
+    }
+    fcntl(STDIN_FILENO, F_SETFL, stdinFlags);
+    return ExitCode_;
+}
+
+auto ClientRuntime::Enter(NState::State next) noexcept -> void {
+    using namespace NState;
+    State_ = std::move(next);
+    ++Generation_;
+    EnteredStateAt_ = EventLoop::Clock::now();
+    Ctx_.UserClient.Show(State_);
+    const auto transition = Transition{*this, Generation_};
+    std::visit(overloaded{
+        [this](std::derived_from<ErrorState> auto&) {
+            ExitCode_ = EXIT_FAILURE;
+            Ctx_.Loop.Stop();
+        },
+        [this](NeedToExit) {
+            Ctx_.Loop.Stop();
+        },
+        // Waits for the user to create or join a game
+        [](ConnectedToCentralServer) {},
+        // Entered from the loop, as `State_` is being visited
+        [this, transition](EstablishedConnectionWithPeer& state) {
+            Ctx_.Loop.Post([transition, next = HandleState(state, Ctx_)]() { transition(next); });
+        },
+        [this, transition](const auto& state) {
+            Handlers_.Spawn(EnterWhenDone(Ctx_.Loop, HandleState(state, Ctx_), transition));
+        },
+    }, State_);
+}
+
+auto ClientRuntime::ReadInput() noexcept -> void {
+    auto buf = std::array<char, 1024>{};
+    for (;;) {
+        const auto n = read(STDIN_FILENO, buf.data(), buf.size());
+        if (n > 0) {
+            Input_.append(buf.data(), size_t(n));
+            for (auto end = Input_.find('\n'); end != std::string::npos; end = Input_.find('\n')) {
+                const auto line = Input_.substr(0, end);
+                Input_.erase(0, end + 1);
+                if (auto action = Ctx_.UserClient.ParseAction(State_, line)) OnUserAction(std::move(*action));
+            }
+        } else if (n == 0) {
+            // The user closed the input, e.g. with Ctrl-D
+            OnUserAction(NUserAction::Quit{});
+            return;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            Ctx_.Loop.WaitReadable(STDIN_FILENO, std::chrono::milliseconds{-1}, [this](AsyncWaitResult result) {
+                if (std::holds_alternative<NAsyncWait::OnReady>(result)) ReadInput();
+            });
+            return;
+        } else if (errno != EINTR) {
+            std::cerr << SystemError{
+                .Value = std::errc{errno},
+                .ContextMessage = "read() syscall failed (" SOURCE_LOCATION ")",
+                .Fd = STDIN_FILENO,
+            } << "\n";
+            ExitCode_ = EXIT_FAILURE;
+            Ctx_.Loop.Stop();
+            return;
+        }
+    }
+}
+
+auto ClientRuntime::OnUserAction(UserAction action) noexcept -> void {
+    std::visit(overloaded{
+        [this](NUserAction::Quit) {
+            Enter(NState::NeedToExit{});
+        },
+        [this](NUserAction::CreateNewGame) {
+            Enter(NState::NeedToCreateNewGame{});
+        },
+        [this](NUserAction::JoinGame& game) {
+            Enter(NState::NeedToJoinGame{.Id = std::move(game.Id)});
+        },
+        // Not parsed by `IUserClient`s, as the game is not played with the peer yet
+        [](auto&) {},
+    }, action);
+}
+
+auto ClientRuntime::ScheduleFrame() noexcept -> void {
+    Ctx_.Loop.ScheduleAfter(kFrameInterval, [this]() {
+        Ctx_.UserClient.OnFrame(State_, EventLoop::Clock::now() - EnteredStateAt_);
+        ScheduleFrame();
+    });
+}
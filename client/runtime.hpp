@@ -0,0 +1,89 @@
+#pragma once
+
+
+#include "state.hpp"
+#include "tcp_client.hpp"
+#include "user_client/user_client_interface.hpp"
+
+#include "../utils/coroutine/task.hpp"
+#include "../utils/event_loop/event_loop.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+
+class ClientRuntime;
+
+namespace NState {
+    // What the handlers of the states share, owned by the `ClientRuntime`
+    struct Context {
+        EventLoop Loop;
+        // Set once connected, to the first of the endpoints to answer
+        std::optional<TcpClient> CentralServer;
+        std::vector<Endpoint> CentralServerEndpoints;
+        IUserClient& UserClient;
+        // TODO: read this value from config
+        // How long the players try to connect to each other, once each knows the address of the other
+        std::chrono::milliseconds TimeoutToConnectToPeer = std::chrono::seconds{60};
+    };
+
+    /* Enters the next state, from the loop, once the handler of the
+     * state that made it is done, unless that state was left in the
+     * meantime, e.g. because the user quit while it waited for the network.
+     */
+    class Transition {
+    private:
+        ClientRuntime* Runtime_;
+        uint64_t Generation_;
+    public:
+        Transition(ClientRuntime& runtime, uint64_t generation) noexcept;
+        auto operator()(State next) const noexcept -> void;
+    };
+} // namespace NState
+
+/* The client: runs the state machine of `NState` on one `EventLoop`, so
+ * that the user's input, the central server and the peer are serviced
+ * at once, and the UI is never stuck behind the network.
+ *
+ * Entering a state shows it and spawns its handler, a coroutine that
+ * awaits the operations it runs on the loop and returns the next state.
+ * The lines typed by the user are read by the loop as well,
+ * and turned into actions by the `IUserClient`, which is also called
+ * once per frame. Must not be moved once running.
+ */
+class ClientRuntime {
+    friend class NState::Transition;
+private:
+    NState::Context Ctx_;
+    // The handlers still waiting for the loop; after `Ctx_`, so they are destroyed before it
+    TaskScope Handlers_;
+    NState::State State_ = NState::NeedToConnectToCentralServer{};
+    // Bumped by each transition, to drop the ones of the states left since
+    uint64_t Generation_ = 0;
+    EventLoop::Clock::time_point EnteredStateAt_;
+    // The last line typed, until it is complete
+    std::string Input_;
+    int ExitCode_ = EXIT_SUCCESS;
+private:
+    explicit ClientRuntime(NState::Context ctx) noexcept;
+public:
+    ClientRuntime(const ClientRuntime& other) = delete;
+    ClientRuntime(ClientRuntime&& other) noexcept = default;
+
+    // The central server is reached at any of `centralServerEndpoints`, e.g. over IPv6 and IPv4
+    [[nodiscard]] static auto CreateNew(std::vector<Endpoint> centralServerEndpoints, IUserClient& userClient) noexcept
+      -> std::variant<ClientRuntime, SystemError>;
+
+    // Runs until the user quits or an error occurs, and returns the exit code
+    [[nodiscard]] auto Run() noexcept -> int;
+private:
+    auto Enter(NState::State next) noexcept -> void;
+    auto ReadInput() noexcept -> void;
+    auto OnUserAction(UserAction action) noexcept -> void;
+    auto ScheduleFrame() noexcept -> void;
+};
@@ -35,13 +35,8 @@ namespace NState {
             : ErrorState(std::move(s)) {}
     };
 
-    struct NeedToAcceptConnectionFromExpectedPeer {
+    struct NeedToEstablishConnectionWithPeer {
         sockaddr_storage PeerAddress;
-        bool AlreadyTriedToConnectToPeer = false;
-    };
-    struct NeedToConnectToPeer {
-        sockaddr_storage PeerAddress;
-        bool AlreadyTriedToAcceptConnectionFromPeer = false;
     };
     struct EstablishedConnectionWithPeer {
         TcpClient Client;
@@ -51,6 +46,12 @@ namespace NState {
             : ErrorState(std::move(s)) {}
     };
 
+    // Playing the game with the peer is not implemented yet
+    struct FailedToPlayWithPeer : public ErrorState {
+        explicit FailedToPlayWithPeer(ErrorState s)
+            : ErrorState(std::move(s)) {}
+    };
+
     struct NeedToExit {};
 
     using State = std::variant<
@@ -63,10 +64,10 @@ namespace NState {
         NeedToJoinGame,
         JoinedGame,
         FailedToJoinGame,
-        NeedToAcceptConnectionFromExpectedPeer,
-        NeedToConnectToPeer,
+        NeedToEstablishConnectionWithPeer,
         EstablishedConnectionWithPeer,
         FailedToEstablishConnectionWithPeer,
+        FailedToPlayWithPeer,
         NeedToExit
     >;
 } // namespace NState
@@ -1,39 +1,66 @@
 #pragma once
 
 
+#include "../runtime.hpp"
 #include "../state.hpp"
-#include "../tcp_client.hpp"
-#include "../user_client/user_client_interface.hpp"
 
+#include "../../utils/coroutine/task.hpp"
+#include "../../utils/to_string_generic.hpp"
+
+#include <chrono>
+#include <concepts>
+#include <string>
+#include <string_view>
+#include <variant>
 
-namespace NState {
-    auto HandleState(NeedToConnectToCentralServer, const TcpClient&, Endpoint) noexcept
-      -> std::variant<ConnectedToCentralServer, FailedToConnectToCentralServer>;
 
-    auto HandleState(FailedToConnectToCentralServer&&, IUserClient&) noexcept
-      -> void;
+/* Each handler is a coroutine that runs the operations of its state on
+ * the loop, and returns the next state: one of those listed. States are
+ * taken by value, as the handler may outlive the state it was called
+ * for, e.g. when the user quits while it waits for the network. The
+ * states that only wait for the user, and the final ones, are handled
+ * by the `ClientRuntime` itself.
+ */
+namespace NState {
+    // -> ConnectedToCentralServer | FailedToConnectToCentralServer
+    auto HandleState(NeedToConnectToCentralServer, Context&) noexcept -> Task<State>;
 
-    auto HandleState(ConnectedToCentralServer, const TcpClient&, IUserClient&) noexcept
-      -> std::variant<NeedToCreateNewGame, NeedToJoinGame>;
+    // -> CreatedNewGame | FailedToCreateNewGame
+    auto HandleState(NeedToCreateNewGame, Context&) noexcept -> Task<State>;
 
-    auto HandleState(NeedToCreateNewGame, const TcpClient&, const IUserClient&) noexcept
-      -> std::variant<CreatedNewGame, FailedToCreateNewGame>; 
+    // -> JoinedGame | FailedToJoinGame
+    auto HandleState(NeedToJoinGame, Context&) noexcept -> Task<State>;
 
-    auto HandleState(const NeedToJoinGame&, const TcpClient&, const IUserClient&) noexcept
-      -> std::variant<JoinedGame, FailedToJoinGame>;
+    // -> NeedToEstablishConnectionWithPeer | FailedToEstablishConnectionWithPeer
+    auto HandleState(CreatedNewGame, Context&) noexcept -> Task<State>;
 
-    auto HandleState(CreatedNewGame&, const TcpClient&, IUserClient&) noexcept
-      -> std::variant<NeedToAcceptConnectionFromExpectedPeer, FailedToEstablishConnectionWithPeer>;
+    // -> NeedToEstablishConnectionWithPeer | FailedToEstablishConnectionWithPeer
+    auto HandleState(JoinedGame, Context&) noexcept -> Task<State>;
 
-    auto HandleState(const NeedToAcceptConnectionFromExpectedPeer&, TcpClient&, IUserClient&) noexcept
-      -> std::variant<EstablishedConnectionWithPeer, NeedToConnectToPeer, FailedToEstablishConnectionWithPeer>;
+    // -> EstablishedConnectionWithPeer | FailedToEstablishConnectionWithPeer
+    auto HandleState(NeedToEstablishConnectionWithPeer, Context&) noexcept -> Task<State>;
 
-    auto HandleState(JoinedGame&, const TcpClient&, IUserClient&) noexcept
-      -> std::variant<NeedToConnectToPeer, FailedToEstablishConnectionWithPeer>;
+    /* Sets up the connection with the peer, which the state owns, and
+     * returns at once. The game itself is not played yet, so the next
+     * state tells the user so
+     */
+    auto HandleState(EstablishedConnectionWithPeer&, Context&) noexcept -> FailedToPlayWithPeer;
 
-    auto HandleState(const NeedToConnectToPeer&, TcpClient&, IUserClient&) noexcept
-      -> std::variant<EstablishedConnectionWithPeer, NeedToAcceptConnectionFromExpectedPeer, FailedToEstablishConnectionWithPeer>;
+    /* Receives the address of the peer, which the central server sends
+     * once both players are in the game, for up to `timeout`
+     */
+    auto ReceivePeerAddress(Context&, std::chrono::milliseconds timeout) noexcept
+      -> Task<std::variant<sockaddr_storage, FailedToEstablishConnectionWithPeer>>;
 
-    auto HandleState(const EstablishedConnectionWithPeer&, const TcpClient&, IUserClient&) noexcept
-      -> std::variant<NeedToConnectToCentralServer, NeedToExit>;
+    // How an operation of a `TcpClient`, e.g. "receiving the peer address", failed
+    template <class Err>
+    inline auto DescribeError(const Err& err, std::string_view operation) -> std::string {
+        if constexpr (std::same_as<Err, TcpClient::Timeout>) {
+            return err.GetErrorMessage(operation);
+        } else if constexpr (std::same_as<Err, TcpClient::ConnectionTerminatedByPeer>) {
+            return err.GetErrorMessage();
+        } else {
+            return std::string{operation} + " failed: " + ToStringGeneric(err);
+        }
+    }
 } // namespace NState
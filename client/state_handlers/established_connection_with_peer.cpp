@@ -0,0 +1,16 @@
+#include "all.hpp"
+
+#include <chrono>
+
+
+auto NState::HandleState(
+    EstablishedConnectionWithPeer& state,
+    Context&
+) noexcept -> FailedToPlayWithPeer {
+    // Moves are small and waited for: they shouldn't sit in Nagle's buffer or wait
+    // for delayed ACKs. Not worth failing over, the game works without it
+    static_cast<void>(state.Client.EnableLowLatencyMode(std::chrono::nanoseconds{0}));
+    return FailedToPlayWithPeer{{
+        .ErrorDescription = "playing the game with the other player is not implemented yet",
+    }};
+}
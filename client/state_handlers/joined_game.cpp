@@ -0,0 +1,25 @@
+#include "all.hpp"
+
+#include <chrono>
+
+
+namespace {
+    // TODO: read this timeout value from config
+    using namespace std::chrono_literals;
+    // The central server sends it as soon as we joined
+    static constexpr auto kTimeoutToGetPeerAddress = 10s;
+}
+
+
+auto NState::HandleState(
+    JoinedGame,
+    Context& ctx
+) noexcept -> Task<State> {
+    auto peerAddressOrErr = co_await ReceivePeerAddress(ctx, kTimeoutToGetPeerAddress);
+    if (auto* failed = std::get_if<FailedToEstablishConnectionWithPeer>(&peerAddressOrErr)) {
+        co_return std::move(*failed);
+    }
+    co_return NeedToEstablishConnectionWithPeer{
+        .PeerAddress = std::get<sockaddr_storage>(peerAddressOrErr),
+    };
+}
@@ -1,31 +1,55 @@
 #include "all.hpp"
 
+#include "../happy_eyeballs.hpp"
+
+#include "../../networking/sock_addr.hpp"
 #include "../../utils/overloaded.hpp"
 #include "../../utils/to_string_generic.hpp"
 
+#include <chrono>
+#include <vector>
+
 
 namespace {
     using namespace NState;
-    using PossibleNextState =
-        std::variant<ConnectedToCentralServer, FailedToConnectToCentralServer>;
+    // TODO: read this timeout value from config
+    using namespace std::chrono_literals;
+    constexpr auto kTimeoutToConnect = 10s;
 }
 
 
 auto NState::HandleState(
     NeedToConnectToCentralServer,
-    const TcpClient& tcpClient,
-    Endpoint centralServerEndpoint
-) noexcept -> PossibleNextState {
-    const auto connOrErr = tcpClient.Connect(centralServerEndpoint);
-    return std::visit(overloaded{
-        [](const auto& err) -> PossibleNextState {
+    Context& ctx
+) noexcept -> Task<State> {
+    auto candidates = std::vector<sockaddr_storage>{};
+    for (const auto& endpoint : ctx.CentralServerEndpoints) {
+        auto addressOrErr = ToSockAddrStorage(endpoint);
+        if (auto* err = std::get_if<IpAddrParsingError>(&addressOrErr)) {
+            co_return FailedToConnectToCentralServer{{
+                .ErrorDescription = ToStringGeneric(*err),
+                .RecommendationHowToFix = "check the address of the central server in the app settings",
+            }};
+        }
+        candidates.push_back(std::get<sockaddr_storage>(addressOrErr));
+    }
+    auto connOrErr = co_await NHappyEyeballs::AsyncConnectToAny(ctx.Loop, std::move(candidates), kTimeoutToConnect);
+    co_return std::visit(overloaded{
+        [](const TcpClient::Timeout& timeout) -> State {
+            return FailedToConnectToCentralServer{{
+                .ErrorDescription = timeout.GetErrorMessage("connecting to the central server"),
+                .RecommendationHowToFix = "check your network connection and try again",
+            }};
+        },
+        [](const SystemError& err) -> State {
             return FailedToConnectToCentralServer{{
                 .ErrorDescription = ToStringGeneric(err),
                 // TODO: write recommendation how to fix
                 .RecommendationHowToFix = std::nullopt,
             }};
         },
-        [](TcpClient::Ok) -> PossibleNextState {
+        [&ctx](TcpClient& centralServer) -> State {
+            ctx.CentralServer = std::move(centralServer);
             return ConnectedToCentralServer{};
         },
     }, connOrErr);
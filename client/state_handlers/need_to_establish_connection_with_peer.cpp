@@ -0,0 +1,166 @@
+#include "all.hpp"
+
+#include "../tcp_acceptor.hpp"
+
+#include "../../networking/socket_options.hpp"
+#include "../../utils/overloaded.hpp"
+#include "../../utils/to_string_generic.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+
+
+namespace {
+    using namespace NState;
+    // TODO: read this value from config
+    using namespace std::chrono_literals;
+    // The peer's host refuses the connection until the peer listens or connects too
+    constexpr auto kRetryInterval = 50ms;
+
+    /* Connecting to the peer and accepting its connection at once, from
+     * the port that the central server told the peer: the first to
+     * succeed wins and ends the other. If both peers connect at the same
+     * moment, their SYNs cross and TCP simultaneous open makes one
+     * connection of the two attempts. Shared by the callbacks of both,
+     * as the loser's is still called once the race is decided.
+     */
+    struct Race {
+        EventLoop& Loop;
+        TcpAcceptor Acceptor;
+        TcpClient Connector;
+        sockaddr_storage PeerAddress;
+        std::chrono::milliseconds Timeout;
+        EventLoop::Clock::time_point Deadline;
+        std::optional<EventLoop::TimerId> RetryTimer;
+        // Reset once the race is decided
+        std::function<void(State)> OnDone;
+        std::string Errors;
+        int NumFailed = 0;
+    };
+
+    auto CalcRemainingTimeout(const Race& race) noexcept -> std::chrono::milliseconds {
+        return std::max(
+            std::chrono::ceil<std::chrono::milliseconds>(race.Deadline - EventLoop::Clock::now()),
+            std::chrono::milliseconds{0}
+        );
+    }
+
+    auto Finish(Race& race, State result) -> void {
+        // Removing the sockets cancels what they still wait for
+        static_cast<void>(race.Loop.Remove(race.Acceptor.GetFd()));
+        if (race.Connector.GetFd() != -1) static_cast<void>(race.Loop.Remove(race.Connector.GetFd()));
+        if (race.RetryTimer) race.Loop.CancelTimer(*race.RetryTimer);
+        std::exchange(race.OnDone, nullptr)(std::move(result));
+    }
+
+    auto Fail(Race& race, const std::string& errorDescription) -> void {
+        race.Errors += (race.Errors.empty() ? "" : "; ") + errorDescription;
+        if (++race.NumFailed == 2) {
+            Finish(race, FailedToEstablishConnectionWithPeer{{
+                .ErrorDescription = race.Errors,
+            }});
+        }
+    }
+
+    auto Connect(const std::shared_ptr<Race>& race) -> void {
+        const auto timeout = CalcRemainingTimeout(*race);
+        race->Connector.AsyncConnect(race->Loop, race->PeerAddress, timeout, [race](TcpClient::ConnectResult result) {
+            if (!race->OnDone) return;
+            std::visit(overloaded{
+                [&](TcpClient::Ok) {
+                    Finish(*race, EstablishedConnectionWithPeer{.Client = std::move(race->Connector)});
+                },
+                [&](const SystemError& err) {
+                    const auto refused = err.Value == std::errc::connection_refused
+                                      || err.Value == std::errc::connection_reset;
+                    if (refused && CalcRemainingTimeout(*race) > kRetryInterval) {
+                        race->RetryTimer = race->Loop.ScheduleAfter(kRetryInterval, [race]() {
+                            race->RetryTimer.reset();
+                            Connect(race);
+                        });
+                    } else {
+                        // E.g. `EADDRNOTAVAIL`: the peer's connection came first, and waits to be accepted
+                        Fail(*race, DescribeError(err, "connecting to the peer"));
+                    }
+                },
+                [&](const auto& err) {
+                    Fail(*race, DescribeError(err, "connecting to the peer"));
+                },
+            }, result);
+        });
+    }
+
+    auto Accept(const std::shared_ptr<Race>& race) -> void {
+        const auto timeout = CalcRemainingTimeout(*race);
+        race->Acceptor.AsyncAcceptExpectedPeer(race->Loop, race->PeerAddress, timeout, [race](TcpAcceptor::AcceptResult result) {
+            if (!race->OnDone) return;
+            std::visit(overloaded{
+                [&](TcpClient& peer) {
+                    if (auto err = race->Loop.Add(peer.GetFd())) {
+                        Fail(*race, ToStringGeneric(*err));
+                    } else {
+                        Finish(*race, EstablishedConnectionWithPeer{.Client = std::move(peer)});
+                    }
+                },
+                [&](TcpAcceptor::Timeout) {
+                    Fail(*race, "the peer didn't connect in " + std::to_string(race->Timeout.count()) + "ms");
+                },
+                // Someone else found the port: the peer may still come
+                [&](TcpAcceptor::PeerAddressMismatchError) {
+                    Accept(race);
+                },
+                [&](const SystemError& err) {
+                    Fail(*race, ToStringGeneric(err));
+                },
+            }, result);
+        });
+    }
+}
+
+
+auto NState::HandleState(
+    const NeedToEstablishConnectionWithPeer state,
+    Context& ctx
+) noexcept -> Task<State> {
+    auto fail = [](const SystemError& err) -> State {
+        return FailedToEstablishConnectionWithPeer{{
+            .ErrorDescription = ToStringGeneric(err),
+        }};
+    };
+    auto localAddressOrErr = ctx.CentralServer->GetLocalAddress();
+    if (auto* err = std::get_if<SystemError>(&localAddressOrErr)) co_return fail(*err);
+    const auto localAddress = std::get<sockaddr_storage>(localAddressOrErr);
+    // Before it is bound again, next to the connecting socket
+    if (auto err = EnablePortReuse(ctx.CentralServer->GetFd())) co_return fail(*err);
+
+    // The socket stays in the loop, as a listening one
+    auto acceptorOrErr = TcpAcceptor::FromTcpClient(std::move(*ctx.CentralServer));
+    ctx.CentralServer.reset();
+    if (auto* err = std::get_if<SystemError>(&acceptorOrErr)) co_return fail(*err);
+
+    auto connectorOrErr = localAddress.ss_family == AF_INET6 ? TcpClient::CreateNew<IP::v6>()
+                                                             : TcpClient::CreateNew<IP::v4>();
+    if (auto* err = std::get_if<SystemError>(&connectorOrErr)) co_return fail(*err);
+    auto& connector = std::get<TcpClient>(connectorOrErr);
+    if (auto err = EnablePortReuse(connector.GetFd())) co_return fail(*err);
+    if (auto err = connector.Bind(localAddress)) co_return fail(*err);
+    if (auto err = ctx.Loop.Add(connector.GetFd())) co_return fail(*err);
+
+    auto race = std::make_shared<Race>(Race{
+        .Loop = ctx.Loop,
+        .Acceptor = std::move(std::get<TcpAcceptor>(acceptorOrErr)),
+        .Connector = std::move(connector),
+        .PeerAddress = state.PeerAddress,
+        .Timeout = ctx.TimeoutToConnectToPeer,
+        .Deadline = EventLoop::Clock::now() + ctx.TimeoutToConnectToPeer,
+    });
+    // By reference, see `AwaitCallback()`
+    co_return co_await AwaitCallback<State>([&race](std::function<void(State)> onDone) {
+        race->OnDone = std::move(onDone);
+        Accept(race);
+        Connect(race);
+    });
+}
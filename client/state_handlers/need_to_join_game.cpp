@@ -4,72 +4,89 @@
 #include "../../utils/overloaded.hpp"
 #include "../../utils/to_string_generic.hpp"
 
+#include <chrono>
+
 
 namespace {
     using namespace NState;
-    using PossibleNextState =
-        std::variant<JoinedGame, FailedToJoinGame>;
+    using namespace NApi;
+
+    auto OnResponse(const JoinGameResponse& resp, const GameId& gameId) -> State {
+        using enum NApi::AddPlayerToGameOp::Result;
+        switch (resp.Result) {
+            // TODO: write proper recommendations how to fix
+            case Success:
+                return JoinedGame{.Id = gameId};
+            case GameIdDoesNotExist:
+                return FailedToJoinGame{{
+                    .ErrorDescription = "Game id [" + gameId.ToString() + "] does not exist on the server",
+                    .RecommendationHowToFix = std::nullopt,
+                }};
+            case GameAlreadyHasTwoPlayers:
+                return FailedToJoinGame{{
+                    .ErrorDescription = "Game id [" + gameId.ToString() + "] already has two players",
+                    .RecommendationHowToFix = std::nullopt,
+                }};
+            default:
+                return FailedToJoinGame{{
+                    .ErrorDescription = "Unknown error ("
+                            + std::to_string(ToUnderlying(resp.Result))
+                            + ") occurred when trying to join game id [" + gameId.ToString() + "], ",
+                    .RecommendationHowToFix = std::nullopt,
+                }};
+        }
+    }
 }
 
 auto NState::HandleState(
-    const NState::NeedToJoinGame& game,
-    const TcpClient& tcpClient,
-    const IUserClient&
-) noexcept -> PossibleNextState {
-    using namespace NApi;
-    const auto sndBuf = NApi::Serialize(NApi::JoinGameRequest{game.Id});
-    const auto sndResult = tcpClient.Send(sndBuf, std::chrono::seconds{10});
-    if (!std::get_if<TcpClient::Ok>(&sndResult)) {
-        return FailedToJoinGame{{
+    const NeedToJoinGame game,
+    Context& ctx
+) noexcept -> Task<State> {
+    const auto& tcpClient = *ctx.CentralServer;
+    const auto sndBuf = Serialize(JoinGameRequest{game.Id});
+    const auto sndResult = co_await tcpClient.AsyncSend(ctx.Loop, sndBuf, std::chrono::seconds{10});
+    if (!std::holds_alternative<TcpClient::Ok>(sndResult)) {
+        co_return FailedToJoinGame{{
             .ErrorDescription = std::visit(overloaded{
-                [](const SystemError& err) {
-                    return ToStringGeneric(err);
-                },
-                [](const TcpClient::Timeout& timeout) {
-                    return timeout.GetErrorMessage("sending a \"join game request\" message to central server");
-                },
-                [](const TcpClient::ConnectionTerminatedByPeer& terminated) {
-                    return terminated.GetErrorMessage();
+                [](const auto& err) {
+                    return DescribeError(err, "sending a \"join game request\" message to central server");
                 },
                 // Redundant, but is needed for the code to compile
                 [](TcpClient::Ok) { return std::string{}; },
             }, sndResult),
         }};
     }
-    Buf<MessageType::JoinGameResponse> rcvBuf;
-    const auto rcvResult = tcpClient.Receive(rcvBuf, std::chrono::seconds{10});
-    return std::visit(overloaded{
-        [&game](const NApi::JoinGameResponse& resp) -> PossibleNextState {
-            using enum NApi::AddPlayerToGameOp::Result;
-            switch (resp.Result) {
-                // TODO: write proper recommendations how to fix
-                case Success:
-                    return JoinedGame{.Id = std::move(game.Id)};
-                case GameIdDoesNotExist:
-                    return FailedToJoinGame{{
-                        .ErrorDescription = "Game id [" + game.Id.ToString() + "] does not exist on the server",
-                        .RecommendationHowToFix = std::nullopt,
-                    }};
-                case GameAlreadyHasTwoPlayers:
-                    return FailedToJoinGame{{
-                        .ErrorDescription = "Game id [" + game.Id.ToString() + "] already has two players",
-                        .RecommendationHowToFix = std::nullopt,
-                    }};
-                default:
-                    return FailedToJoinGame{{
-                        .ErrorDescription = "Unknown error ("
-                                + std::to_string(ToUnderlying(resp.Result))
-                                + ") occurred when trying to join game id [" + game.Id.ToString() + "], ",
-                        .RecommendationHowToFix = std::nullopt,
-                    }};
-            }
+
+    auto rcvBuf = Buf<MessageType::JoinGameResponse>{};
+    const auto rcvResult = co_await tcpClient.AsyncReceive(ctx.Loop, rcvBuf, std::chrono::seconds{10});
+    if (!std::holds_alternative<TcpClient::Ok>(rcvResult)) {
+        co_return FailedToJoinGame{{
+            .ErrorDescription = std::visit(overloaded{
+                [](const auto& err) {
+                    return DescribeError(err, "receiving the \"join game\" response from central server");
+                },
+                [](TcpClient::Ok) { return std::string{}; },
+            }, rcvResult),
+            // TODO: write proper recommendation how to fix
+            .RecommendationHowToFix = std::nullopt,
+        }};
+    }
+    co_return std::visit(overloaded{
+        [&game](const JoinGameResponse& resp) -> State {
+            return OnResponse(resp, game.Id);
         },
-        [](const auto& err) -> PossibleNextState {
-            return FailedToJoinGame{ErrorState{
-                .ErrorDescription = ToStringGeneric(err),
-                // TODO: write proper recommendation how to fix
+        [](JoinGameResponse::UnknownResultError err) -> State {
+            return FailedToJoinGame{{
+                .ErrorDescription = "Got bad response from central server: unknown result "
+                                    + std::to_string(err.Value),
                 .RecommendationHowToFix = std::nullopt,
             }};
-        }
-    }, rcvResult);
+        },
+        [](const auto& err) -> State {
+            return FailedToJoinGame{{
+                .ErrorDescription = "Got bad response from central server: " + ToStringGeneric(err),
+                .RecommendationHowToFix = std::nullopt,
+            }};
+        },
+    }, Deserialize<MessageType::JoinGameResponse>(rcvBuf));
 }
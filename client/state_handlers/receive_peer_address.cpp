@@ -0,0 +1,48 @@
+#include "all.hpp"
+
+#include "../../api/socket_address.hpp"
+#include "../../utils/overloaded.hpp"
+#include "../../utils/to_string_generic.hpp"
+
+
+auto NState::ReceivePeerAddress(
+    Context& ctx,
+    const std::chrono::milliseconds timeout
+) noexcept -> Task<std::variant<sockaddr_storage, FailedToEstablishConnectionWithPeer>> {
+    using namespace NApi;
+    using R = std::variant<sockaddr_storage, FailedToEstablishConnectionWithPeer>;
+    auto rcvBuf = Buf<MessageType::SocketAddress>{};
+    const auto rcvResult = co_await ctx.CentralServer->AsyncReceive(ctx.Loop, rcvBuf, timeout);
+    if (!std::holds_alternative<TcpClient::Ok>(rcvResult)) {
+        co_return FailedToEstablishConnectionWithPeer{{
+            .ErrorDescription = std::visit(overloaded{
+                [](const auto& err) {
+                    return DescribeError(
+                        err,
+                        "waiting for the peer to join the game and for the central server to send the peer address"
+                    );
+                },
+                // Redundant, but is needed for the code to compile
+                [](TcpClient::Ok) { return std::string{}; },
+            }, rcvResult),
+        }};
+    }
+    co_return std::visit(overloaded{
+        [](const SocketAddressMsg& peerAddress) -> R {
+            return std::visit([](const auto& addr) {
+                return ToSockAddrStorage(addr);
+            }, peerAddress);
+        },
+        [](SocketAddressMsg::UnknownAddressFamily err) -> R {
+            return FailedToEstablishConnectionWithPeer{{
+                .ErrorDescription = "Got a peer address of unknown address family "
+                                    + std::to_string(err.Value) + " from central server",
+            }};
+        },
+        [](const auto& err) -> R {
+            return FailedToEstablishConnectionWithPeer{{
+                .ErrorDescription = "Got bad peer address from central server: " + ToStringGeneric(err),
+            }};
+        },
+    }, Deserialize<MessageType::SocketAddress>(rcvBuf));
+}
@@ -1,17 +1,37 @@
 #include "tcp_acceptor.hpp"
 
 #include "tcp_client.hpp"
+#include "../utils/overloaded.hpp"
 #include "../utils/timer/timer.hpp"
 
+#include <cstring>
 #include <sys/poll.h>
 #include <unistd.h>
+#include <utility>
 
 
 TcpAcceptor::TcpAcceptor(int sockFd) noexcept : SockFd_(sockFd) {}
 
+TcpAcceptor::TcpAcceptor(TcpAcceptor&& other) noexcept
+    : SockFd_(std::exchange(other.SockFd_, -1))
+{
+}
+
+TcpAcceptor::~TcpAcceptor() noexcept {
+    if (SockFd_ != -1) {
+        close(SockFd_);
+    }
+}
+
 auto TcpAcceptor::FromTcpClient(TcpClient &&tcpClient) noexcept
   -> std::variant<TcpAcceptor, SystemError> {
-    if (auto err = tcpClient.Disconnect()) {
+    // The peer is told the address that the server saw, so the socket listens on it again
+    auto localAddressOrErr = tcpClient.GetLocalAddress();
+    if (auto* err = std::get_if<SystemError>(&localAddressOrErr)) {
+        return std::move(*err);
+    } else if (auto err = tcpClient.Disconnect()) {
+        return *err;
+    } else if (auto err = tcpClient.Bind(std::get<sockaddr_storage>(localAddressOrErr))) {
         return *err;
     } else if (listen(tcpClient.SockFd_, /* backlog */ 128) == 0) {
         auto acceptor = TcpAcceptor(tcpClient.SockFd_);
@@ -40,10 +60,9 @@ auto TcpAcceptor::AcceptExpectedPeer(
         .revents = 0,
     };
     auto pollResult = -1;
-    auto remainingTime = timeout;
     const auto timer = Timer(timeout);
-    for (; pollResult != 0; remainingTime = timer.CalcRemainingTime()) {
-        pollResult = poll(&pollFd, 1, remainingTime.count());
+    while (pollResult != 0) {
+        pollResult = poll(&pollFd, 1, timer.CalcRemainingPollTimeout());
         if (pollResult == -1) {
             if (errno == EINTR) continue;
             else return SystemError{
@@ -83,3 +102,65 @@ auto TcpAcceptor::AcceptExpectedPeer(
     }
     return Timeout{};
 }
+
+auto TcpAcceptor::AsyncAcceptExpectedPeer(
+    EventLoop& loop,
+    const sockaddr_storage& expectedPeerAddress,
+    const std::chrono::milliseconds timeout,
+    OnAccepted onAccepted
+) const noexcept -> void {
+    const auto deadline = EventLoop::Clock::now() + timeout;
+    AcceptWhenReadable(loop, SockFd_, expectedPeerAddress, deadline, std::move(onAccepted));
+}
+
+auto TcpAcceptor::AcceptWhenReadable(
+    EventLoop& loop,
+    const int sockFd,
+    const sockaddr_storage& expectedPeerAddress,
+    const EventLoop::Clock::time_point deadline,
+    OnAccepted onAccepted
+) noexcept -> void {
+    const auto remaining = std::max(
+        std::chrono::ceil<std::chrono::milliseconds>(deadline - EventLoop::Clock::now()),
+        std::chrono::milliseconds{0}
+    );
+    loop.WaitReadable(sockFd, remaining, [=, &loop, onAccepted = std::move(onAccepted)](AsyncWaitResult result) mutable {
+        using namespace NAsyncWait;
+        std::visit(overloaded{
+            [&](OnReady) {
+                auto peerAddress = sockaddr_storage{};
+                auto peerAddressSize = socklen_t{sizeof(peerAddress)};
+                const auto peerSockFd = accept4(sockFd, (sockaddr*) &peerAddress, &peerAddressSize, SOCK_NONBLOCK);
+                if (peerSockFd == -1) {
+                    if (errno == EINTR || errno == EWOULDBLOCK || errno == EAGAIN) {
+                        AcceptWhenReadable(loop, sockFd, expectedPeerAddress, deadline, std::move(onAccepted));
+                    } else {
+                        onAccepted(SystemError{
+                            .Value = std::errc{errno},
+                            .ContextMessage = "accept4() syscall failed (" SOURCE_LOCATION ")",
+                            .Fd = sockFd,
+                        });
+                    }
+                } else if (std::memcmp(&peerAddress, &expectedPeerAddress, peerAddressSize) != 0) {
+                    close(peerSockFd);
+                    onAccepted(PeerAddressMismatchError{});
+                } else {
+                    onAccepted(TcpClient{peerSockFd});
+                }
+            },
+            [&](OnCancellation) {
+                onAccepted(SystemError{
+                    .Value = std::errc::operation_canceled,
+                    .ContextMessage = "accept4() was cancelled (" SOURCE_LOCATION ")",
+                    .Fd = sockFd,
+                });
+            },
+            [&](OnTimeout) {
+                onAccepted(Timeout{});
+            },
+            [&](OnSystemError& onErr) {
+                onAccepted(std::move(onErr.Err));
+            },
+        }, result);
+    });
+}
@@ -9,6 +9,10 @@ private:
     int SockFd_;
     explicit TcpAcceptor(int sockFd) noexcept;
 public:
+    TcpAcceptor(const TcpAcceptor& other) = delete;
+    TcpAcceptor(TcpAcceptor&& other) noexcept;
+    ~TcpAcceptor() noexcept;
+
     static auto FromTcpClient(TcpClient&& tcpClient) noexcept
       -> std::variant<TcpAcceptor, SystemError>;
     struct Timeout {};
@@ -18,4 +22,38 @@ public:
         const std::chrono::milliseconds timeout
     ) const noexcept
       -> std::variant<TcpClient, Timeout, SystemError, PeerAddressMismatchError>;
+
+    // What `AcceptExpectedPeer()` returns
+    using AcceptResult = std::variant<TcpClient, Timeout, SystemError, PeerAddressMismatchError>;
+    using OnAccepted = std::function<void(AcceptResult)>;
+    /* The non-blocking `AcceptExpectedPeer()`, run by `loop`, to which
+     * the listening socket has to be added first
+     */
+    auto AsyncAcceptExpectedPeer(
+        EventLoop& loop,
+        const sockaddr_storage& expectedPeerAddress,
+        std::chrono::milliseconds timeout,
+        OnAccepted onAccepted
+    ) const noexcept -> void;
+
+    // The awaitable version of the above, for the coroutines run by `loop`
+    [[nodiscard]] auto AsyncAcceptExpectedPeer(
+        EventLoop& loop,
+        const sockaddr_storage& expectedPeerAddress,
+        std::chrono::milliseconds timeout
+    ) const noexcept {
+        return AwaitCallback<AcceptResult>([this, &loop, expectedPeerAddress, timeout](OnAccepted onAccepted) {
+            AsyncAcceptExpectedPeer(loop, expectedPeerAddress, timeout, std::move(onAccepted));
+        });
+    }
+
+    [[nodiscard]] auto GetFd() const noexcept -> int { return SockFd_; }
+private:
+    static auto AcceptWhenReadable(
+        EventLoop& loop,
+        int sockFd,
+        const sockaddr_storage& expectedPeerAddress,
+        EventLoop::Clock::time_point deadline,
+        OnAccepted onAccepted
+    ) noexcept -> void;
 };
\ No newline at end of file
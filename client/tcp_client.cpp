@@ -1,10 +1,14 @@
 #include "tcp_client.hpp"
 
 #include "../networking/sock_addr.hpp"
+#include "../networking/socket_options.hpp"
 #include "../utils/overloaded.hpp"
 #include "../utils/robust_read_write/robust_read_write.hpp"
+#include "../utils/timer/timer.hpp"
 
+#include <cerrno>
 #include <concepts>
+#include <sys/poll.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
@@ -20,6 +24,118 @@ namespace NTcpClientActionResult {
     }
 }
 
+namespace {
+    using Result = std::variant<
+        TcpClient::Ok,
+        SystemError,
+        TcpClient::Timeout,
+        TcpClient::ConnectionTerminatedByPeer
+    >;
+
+    auto ToSendResult(const RobustSyncWriteResult& result, const std::chrono::milliseconds timeout) noexcept -> Result {
+        // TODO: add proper logging
+        using namespace NRobustSyncWrite;
+        return std::visit(overloaded{
+            [](OnSuccess) -> Result {
+                return TcpClient::Ok{};
+            },
+            [](const OnSystemError& onErr) -> Result {
+                return onErr.Err;
+            },
+            [timeout](const OnTimeout& onTimeout) -> Result {
+                return TcpClient::Timeout{
+                    .Duration = timeout,
+                    .WallTimeElapsed = onTimeout.Timeout,
+                };
+            },
+            [](const OnPollerrOrPollhup&) -> Result {
+                return TcpClient::ConnectionTerminatedByPeer{};
+            },
+            // No cancellation fd is passed, as in `Receive()`,
+            // and the async operations are only cancelled by their
+            // owner, which then ignores the result
+            [](const OnCancellation&) -> Result {
+                return TcpClient::ConnectionTerminatedByPeer{};
+            },
+        }, result);
+    }
+
+    // How the `connect()` that was in progress on the socket ended, once it is writable
+    auto TakeConnectError(const int sockFd) noexcept -> std::optional<SystemError> {
+        auto err = 0;
+        auto errLen = socklen_t{sizeof(err)};
+        if (getsockopt(sockFd, SOL_SOCKET, SO_ERROR, &err, &errLen) == -1) {
+            err = errno;
+        }
+        if (err == 0) return std::nullopt;
+        return SystemError{
+            .Value = std::errc{err},
+            .ContextMessage = "connect() syscall failed asynchronously (" SOURCE_LOCATION ")",
+            .Fd = sockFd,
+        };
+    }
+
+    auto ConnectWithTimeout(
+        const int sockFd,
+        const sockaddr_storage& serverAddress,
+        const std::chrono::milliseconds timeout
+    ) noexcept -> TcpClient::ConnectResult {
+        const auto addrLen = socklen_t(serverAddress.ss_family == AF_INET6 ? sizeof(sockaddr_in6) : sizeof(sockaddr_in));
+        if (connect(sockFd, (const sockaddr*) &serverAddress, addrLen) == 0) return TcpClient::Ok{};
+        // The socket is non-blocking, so the connection is only being made yet
+        if (errno != EINPROGRESS) {
+            return SystemError{
+                .Value = std::errc{errno},
+                .ContextMessage = "connect() syscall failed (" SOURCE_LOCATION ")",
+                .Fd = sockFd,
+            };
+        }
+        const auto timer = Timer{timeout};
+        auto pollFd = pollfd{.fd = sockFd, .events = POLLOUT, .revents = 0};
+        for (;;) {
+            const auto pollResult = poll(&pollFd, 1, timer.CalcRemainingPollTimeout());
+            if (pollResult == -1) {
+                if (errno == EINTR) continue;
+                return SystemError{
+                    .Value = std::errc{errno},
+                    .ContextMessage = "poll() syscall failed (" SOURCE_LOCATION ")",
+                    .Fd = sockFd,
+                };
+            } else if (pollResult == 0) {
+                return TcpClient::Timeout{
+                    .Duration = timeout,
+                    .WallTimeElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(timer.CalcElapsedTime()),
+                };
+            }
+            // `POLLERR` and `POLLHUP` tell that it failed, and `SO_ERROR` tells why
+            if (auto err = TakeConnectError(sockFd)) return std::move(*err);
+            return TcpClient::Ok{};
+        }
+    }
+
+    auto ToReceiveResult(const RobustSyncReadResult& result, const std::chrono::milliseconds timeout) noexcept -> Result {
+        // TODO: add proper logging
+        using namespace NRobustSyncRead;
+        return std::visit(overloaded{
+            [](OnSuccess) -> Result {
+                return TcpClient::Ok{};
+            },
+            [](const OnSystemError& onErr) -> Result {
+                return onErr.Err;
+            },
+            [timeout](const OnTimeout& onTimeout) -> Result {
+                return TcpClient::Timeout{
+                    .Duration = timeout,
+                    .WallTimeElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(onTimeout.WallTimeElapsed),
+                };
+            },
+            [](const auto&) -> Result {
+                return TcpClient::ConnectionTerminatedByPeer{};
+            },
+        }, result);
+    }
+}
+
 
 TcpClient::TcpClient(int sockFd) noexcept
     : SockFd_(sockFd)
@@ -28,6 +144,7 @@ TcpClient::TcpClient(int sockFd) noexcept
 
 TcpClient::TcpClient(TcpClient&& other) noexcept
     : SockFd_(other.SockFd_)
+    , BusyPollBudget_(other.BusyPollBudget_)
 {
     // The value `-1` indicates that an instance
     // of `TcpClient` is in a moved-from state
@@ -36,6 +153,7 @@ TcpClient::TcpClient(TcpClient&& other) noexcept
 
 TcpClient& TcpClient::operator=(TcpClient&& other) noexcept {
     std::swap(SockFd_, other.SockFd_);
+    std::swap(BusyPollBudget_, other.BusyPollBudget_);
     return *this;
 }
 
@@ -65,50 +183,28 @@ auto TcpClient::CreateNew() noexcept -> std::variant<TcpClient, SystemError> {
 template auto TcpClient::CreateNew<IP::v4>() noexcept -> std::variant<TcpClient, SystemError>;
 template auto TcpClient::CreateNew<IP::v6>() noexcept -> std::variant<TcpClient, SystemError>;
 
-auto TcpClient::CreateNew(const Endpoint clientEndpoint) noexcept
-  -> std::variant<TcpClient, SystemError, IpAddrParsingError> {
-    using R = std::variant<TcpClient, SystemError, IpAddrParsingError>;
-    auto ipAddrStorageOrErr = ConstructIpAddrStorage(clientEndpoint.IpAddr);
+auto TcpClient::CreateNew(const Endpoint serverEndpoint, const std::chrono::milliseconds timeout) noexcept
+  -> std::variant<TcpClient, SystemError, Timeout, IpAddrParsingError> {
+    using R = std::variant<TcpClient, SystemError, Timeout, IpAddrParsingError>;
+    const auto serverAddressOrErr = ToSockAddrStorage(serverEndpoint);
+    if (const auto* err = std::get_if<IpAddrParsingError>(&serverAddressOrErr)) return *err;
+    const auto& serverAddress = std::get<sockaddr_storage>(serverAddressOrErr);
+    auto clientOrErr = serverAddress.ss_family == AF_INET6 ? TcpClient::CreateNew<IP::v6>()
+                                                           : TcpClient::CreateNew<IP::v4>();
+    if (auto* err = std::get_if<SystemError>(&clientOrErr)) return std::move(*err);
+    auto& client = std::get<TcpClient>(clientOrErr);
+    auto connectResult = ConnectWithTimeout(client.SockFd_, serverAddress, timeout);
     return std::visit(overloaded{
-        [](IpAddrParsingError& err) -> R { return std::move(err); },
-        [port = clientEndpoint.Port](auto& addr) -> R {
-            auto clientOrErr = TcpClient::CreateNew<
-                ip_addr_type_t<std::remove_reference_t<decltype(addr)>>
-            >();
-            return std::visit(overloaded{
-                [&addr, port](TcpClient& client) -> R {
-                    const auto serverSockAddr = ConstructSockAddr(addr, port);
-                    if (connect(client.SockFd_, (sockaddr*) &serverSockAddr, sizeof(serverSockAddr)) == -1) {
-                        return SystemError{
-                            .Value = std::errc{errno},
-                            .ContextMessage = "connect() syscall failed (" SOURCE_LOCATION ")",
-                        };
-                    }
-                    return std::move(client);
-                },
-                [](auto& err) -> R { return std::move(err); },
-            }, clientOrErr);
-        },
-    }, ipAddrStorageOrErr); 
-}
-
-auto TcpClient::Connect(const Endpoint serverEndpoint) const noexcept
-  -> std::variant<Ok, SystemError, IpAddrParsingError> {
-    using R = std::variant<Ok, SystemError, IpAddrParsingError>;
-    auto ipAddrStorageOrErr = ConstructIpAddrStorage(serverEndpoint.IpAddr);
-    return std::visit(overloaded{
-        [](IpAddrParsingError& err) -> R { return std::move(err); },
-        [port = serverEndpoint.Port, this](auto& addr) -> R {
-            const auto serverSockAddr = ConstructSockAddr(addr, port);
-            if (connect(SockFd_, (sockaddr*) &serverSockAddr, sizeof(serverSockAddr)) == -1) {
-                return SystemError{
-                    .Value = std::errc{errno},
-                    .ContextMessage = "connect() syscall failed (" SOURCE_LOCATION ")",
-                };
-            }
-            return Ok{};
-        },
-    }, ipAddrStorageOrErr);
+        [&client](Ok) -> R { return std::move(client); },
+        [](auto& err) -> R { return std::move(err); },
+    }, connectResult);
+}
+
+auto TcpClient::Connect(const Endpoint serverEndpoint, const std::chrono::milliseconds timeout) const noexcept
+  -> ConnectResult {
+    const auto serverAddressOrErr = ToSockAddrStorage(serverEndpoint);
+    if (const auto* err = std::get_if<IpAddrParsingError>(&serverAddressOrErr)) return *err;
+    return ConnectWithTimeout(SockFd_, std::get<sockaddr_storage>(serverAddressOrErr), timeout);
 }
 
 auto TcpClient::Disconnect() const noexcept -> std::optional<SystemError> {
@@ -123,31 +219,48 @@ auto TcpClient::Disconnect() const noexcept -> std::optional<SystemError> {
     }
 }
 
+auto TcpClient::Bind(const sockaddr_storage& localAddress) const noexcept -> std::optional<SystemError> {
+    const auto addrLen = socklen_t(localAddress.ss_family == AF_INET6 ? sizeof(sockaddr_in6) : sizeof(sockaddr_in));
+    if (bind(SockFd_, (const sockaddr*) &localAddress, addrLen) == -1) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "bind() syscall failed (" SOURCE_LOCATION ")",
+            .Fd = SockFd_,
+        };
+    }
+    return std::nullopt;
+}
+
+auto TcpClient::GetLocalAddress() const noexcept -> std::variant<sockaddr_storage, SystemError> {
+    auto localAddress = sockaddr_storage{};
+    auto addrLen = socklen_t{sizeof(localAddress)};
+    if (getsockname(SockFd_, (sockaddr*) &localAddress, &addrLen) == -1) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "getsockname() syscall failed (" SOURCE_LOCATION ")",
+            .Fd = SockFd_,
+        };
+    }
+    return localAddress;
+}
+
+auto TcpClient::EnableLowLatencyMode(const std::chrono::nanoseconds busyPollBudget) noexcept
+  -> std::variant<Ok, SystemError, BusyPollUnavailable> {
+    if (auto err = SetLowLatencyOptions(SockFd_)) return std::move(*err);
+    BusyPollBudget_ = busyPollBudget;
+    if (busyPollBudget.count() > 0) {
+        const auto busyPoll = std::chrono::duration_cast<std::chrono::microseconds>(busyPollBudget);
+        if (auto err = SetBusyPollOptions(SockFd_, busyPoll)) return BusyPollUnavailable{std::move(*err)};
+    }
+    return Ok{};
+}
+
 auto TcpClient::Send(
     std::span<const std::byte> msg,
     std::chrono::milliseconds timeout
 ) const noexcept
   -> std::variant<Ok, SystemError, Timeout, ConnectionTerminatedByPeer> {
-    using R = std::variant<Ok, SystemError, Timeout, ConnectionTerminatedByPeer>;
-    const auto result = RobustSyncWrite(SockFd_, msg, timeout);
-    // TODO: add proper logging
-    using namespace NRobustSyncWrite;
-    return std::visit(overloaded{
-        [](OnSuccess) -> R {
-            return Ok{};
-        },
-        [](const OnSystemError& onErr) -> R {
-            return onErr.Err;
-        },
-        [](const OnTimeout& onTimeout) -> R {
-            return Timeout{
-                .WallTimeElapsed = onTimeout.Timeout,
-            };
-        },
-        [](const OnPollerrOrPollhup& onPollerrOrPollhup) -> R {
-            return ConnectionTerminatedByPeer{};
-        },
-    }, result);
+    return ToSendResult(RobustSyncWrite(SockFd_, msg, timeout), timeout);
 }
 
 auto TcpClient::Receive(
@@ -155,24 +268,98 @@ auto TcpClient::Receive(
     const std::chrono::milliseconds timeout
 ) const noexcept
   -> std::variant<Ok, SystemError, Timeout, ConnectionTerminatedByPeer> {
-    using R = std::variant<Ok, SystemError, Timeout, ConnectionTerminatedByPeer>;
-    const auto result = RobustSyncRead(SockFd_, msg, timeout);
-    // TODO: add proper logging
-    using namespace NRobustSyncRead;
-    return std::visit(overloaded{
-        [](OnSuccess) -> R {
-            return Ok{};
-        },
-        [](const OnSystemError& onErr) -> R {
-            return onErr.Err;
-        },
-        [](const OnTimeout& onTimeout) -> R {
-            return Timeout{
-                .WallTimeElapsed = onTimeout.WallTimeElapsed,
-            };
-        },
-        [](const auto& otherResult) -> R {
-            return ConnectionTerminatedByPeer{};
-        },
-    }, result);
+    const auto result = RobustSyncRead(SockFd_, msg, timeout, std::nullopt, BusyPollBudget_);
+    if (BusyPollBudget_.count() > 0) {
+        // Not worth failing a read over, the next one rearms it again
+        static_cast<void>(RearmQuickAck(SockFd_));
+    }
+    return ToReceiveResult(result, timeout);
+}
+
+auto TcpClient::AsyncSend(
+    EventLoop& loop,
+    const std::span<const std::byte> msg,
+    const std::chrono::milliseconds timeout,
+    OnDone onDone
+) const noexcept -> void {
+    loop.AsyncWrite(SockFd_, msg, timeout, [timeout, onDone = std::move(onDone)](const RobustSyncWriteResult& result) {
+        onDone(ToSendResult(result, timeout));
+    });
+}
+
+auto TcpClient::AsyncReceive(
+    EventLoop& loop,
+    const std::span<std::byte> msg,
+    const std::chrono::milliseconds timeout,
+    OnDone onDone
+) const noexcept -> void {
+    const auto rearmQuickAck = BusyPollBudget_.count() > 0;
+    loop.AsyncRead(SockFd_, msg, timeout, [=, sockFd = SockFd_, onDone = std::move(onDone)](const RobustSyncReadResult& result) {
+        if (rearmQuickAck) static_cast<void>(RearmQuickAck(sockFd));
+        onDone(ToReceiveResult(result, timeout));
+    });
+}
+
+auto TcpClient::AsyncConnect(
+    EventLoop& loop,
+    const Endpoint serverEndpoint,
+    const std::chrono::milliseconds timeout,
+    OnConnected onConnected
+) const noexcept -> void {
+    const auto serverAddressOrErr = ToSockAddrStorage(serverEndpoint);
+    if (const auto* err = std::get_if<IpAddrParsingError>(&serverAddressOrErr)) {
+        loop.Post([err = *err, onConnected = std::move(onConnected)]() { onConnected(err); });
+        return;
+    }
+    AsyncConnect(loop, std::get<sockaddr_storage>(serverAddressOrErr), timeout, std::move(onConnected));
+}
+
+auto TcpClient::AsyncConnect(
+    EventLoop& loop,
+    const sockaddr_storage& serverAddress,
+    const std::chrono::milliseconds timeout,
+    OnConnected onConnected
+) const noexcept -> void {
+    const auto addrLen = socklen_t(serverAddress.ss_family == AF_INET6 ? sizeof(sockaddr_in6) : sizeof(sockaddr_in));
+    if (connect(SockFd_, (const sockaddr*) &serverAddress, addrLen) == 0) {
+        loop.Post([onConnected = std::move(onConnected)]() { onConnected(Ok{}); });
+        return;
+    }
+    if (errno != EINPROGRESS) {
+        auto err = SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "connect() syscall failed (" SOURCE_LOCATION ")",
+            .Fd = SockFd_,
+        };
+        loop.Post([err = std::move(err), onConnected = std::move(onConnected)]() { onConnected(err); });
+        return;
+    }
+    loop.WaitWritable(SockFd_, timeout, [=, sockFd = SockFd_, onConnected = std::move(onConnected)](AsyncWaitResult result) {
+        using namespace NAsyncWait;
+        std::visit(overloaded{
+            [&](OnReady) {
+                if (auto err = TakeConnectError(sockFd)) {
+                    onConnected(std::move(*err));
+                } else {
+                    onConnected(Ok{});
+                }
+            },
+            [&](OnSystemError& onErr) {
+                onConnected(std::move(onErr.Err));
+            },
+            [&](OnCancellation) {
+                onConnected(SystemError{
+                    .Value = std::errc::operation_canceled,
+                    .ContextMessage = "connect() was cancelled (" SOURCE_LOCATION ")",
+                    .Fd = sockFd,
+                });
+            },
+            [&](OnTimeout) {
+                onConnected(Timeout{
+                    .Duration = timeout,
+                    .WallTimeElapsed = timeout,
+                });
+            },
+        }, result);
+    });
 }
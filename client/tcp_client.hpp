@@ -3,11 +3,15 @@
 
 #include "../networking/ip_addr.hpp"
 #include "../networking/sock_addr.hpp"
+#include "../utils/coroutine/task.hpp"
 #include "../utils/error.hpp"
+#include "../utils/event_loop/event_loop.hpp"
 
 #include <chrono>
+#include <functional>
 #include <optional>
 #include <span>
+#include <sys/socket.h>
 
 
 namespace NTcpClientActionResult {
@@ -26,12 +30,23 @@ class TcpClient {
     friend class TcpAcceptor;
 private:
     int SockFd_;
+    // Zero unless `EnableLowLatencyMode()` was called
+    std::chrono::nanoseconds BusyPollBudget_{0};
 private:
     explicit TcpClient(int sockFd) noexcept;
 public:
     using Ok = NTcpClientActionResult::Ok;
     using ConnectionTerminatedByPeer = NTcpClientActionResult::ConnectionTerminatedByPeer;
     using Timeout = NTcpClientActionResult::Timeout;
+    // What `Send()` or `Receive()` return
+    using IoResult = std::variant<Ok, SystemError, Timeout, ConnectionTerminatedByPeer>;
+    using ConnectResult = std::variant<Ok, SystemError, Timeout, IpAddrParsingError>;
+    using OnDone = std::function<void(IoResult)>;
+    using OnConnected = std::function<void(ConnectResult)>;
+    // The low latency mode is on, but without the busy-polling of the kernel
+    struct BusyPollUnavailable {
+        SystemError Err;
+    };
 public:
     TcpClient(const TcpClient& other) = delete;
     TcpClient(TcpClient&& other) noexcept;
@@ -44,16 +59,40 @@ public:
     [[nodiscard]] static auto CreateNew() noexcept
       -> std::variant<TcpClient, SystemError>;
 
-    // IP address type is auto-detected
-    [[nodiscard]] static auto CreateNew(Endpoint) noexcept
-      -> std::variant<TcpClient, SystemError, IpAddrParsingError>;
+    // IP address type is auto-detected, and the client is connected to the endpoint
+    [[nodiscard]] static auto CreateNew(Endpoint, std::chrono::milliseconds timeout) noexcept
+      -> std::variant<TcpClient, SystemError, Timeout, IpAddrParsingError>;
 
-    [[nodiscard]] auto Connect(Endpoint) const noexcept
-      -> std::variant<Ok, SystemError, IpAddrParsingError>;
+    /* Blocks until the `connect()` of the non-blocking socket is done,
+     * in `poll()`, or until `timeout` passes, as `AsyncConnect()` does
+     * from the loop
+     */
+    [[nodiscard]] auto Connect(Endpoint, std::chrono::milliseconds timeout) const noexcept
+      -> ConnectResult;
 
     [[nodiscard]] auto Disconnect() const noexcept
       -> std::optional<SystemError>;
 
+    // Binds the socket before it connects, e.g. to the port of a listening socket
+    [[nodiscard]] auto Bind(const sockaddr_storage& localAddress) const noexcept
+      -> std::optional<SystemError>;
+
+    // The address and port that the socket is bound to, which the server sees
+    [[nodiscard]] auto GetLocalAddress() const noexcept
+      -> std::variant<sockaddr_storage, SystemError>;
+
+    /* Opt-in mode for latency-critical connections, such as the one over
+     * which the moves of a game are exchanged with the peer: sets the
+     * options of `SetLowLatencyOptions()`, and makes `Receive()` spin on
+     * the socket for up to `busyPollBudget` before it sleeps in `poll()`.
+     * This costs a core while spinning, so it is meant for the short
+     * waits of fast time controls, not for idle connections. With a
+     * non-zero budget the kernel is asked to busy-poll as well, see
+     * `SetBusyPollOptions()`, which may not be allowed.
+     */
+    [[nodiscard]] auto EnableLowLatencyMode(std::chrono::nanoseconds busyPollBudget) noexcept
+      -> std::variant<Ok, SystemError, BusyPollUnavailable>;
+
     [[nodiscard]] auto Send(
         std::span<const std::byte> msg,
         std::chrono::milliseconds timeout
@@ -65,4 +104,89 @@ public:
         std::chrono::milliseconds timeout
     ) const noexcept
       -> std::variant<Ok, SystemError, Timeout, ConnectionTerminatedByPeer>;
+
+    /* The non-blocking counterparts of `Send()` and `Receive()`, run by
+     * `loop`, to which the socket has to be added first. `msg` has to
+     * stay valid until `onDone` is called. Busy-polling doesn't apply:
+     * the loop's thread never spins on one socket.
+     */
+    auto AsyncSend(
+        EventLoop& loop,
+        std::span<const std::byte> msg,
+        std::chrono::milliseconds timeout,
+        OnDone onDone
+    ) const noexcept -> void;
+
+    auto AsyncReceive(
+        EventLoop& loop,
+        std::span<std::byte> msg,
+        std::chrono::milliseconds timeout,
+        OnDone onDone
+    ) const noexcept -> void;
+
+    /* Connects without blocking: the `connect()` of the non-blocking
+     * socket is in progress until the socket becomes writable, and
+     * `SO_ERROR` then tells how it ended. The socket has to be added
+     * to `loop` first. A timed out connection attempt is not aborted,
+     * so the socket should be closed then.
+     */
+    auto AsyncConnect(
+        EventLoop& loop,
+        Endpoint serverEndpoint,
+        std::chrono::milliseconds timeout,
+        OnConnected onConnected
+    ) const noexcept -> void;
+
+    auto AsyncConnect(
+        EventLoop& loop,
+        const sockaddr_storage& serverAddress,
+        std::chrono::milliseconds timeout,
+        OnConnected onConnected
+    ) const noexcept -> void;
+
+    /* The awaitable versions of the above, for the coroutines run by
+     * `loop`, e.g. `co_await client.AsyncSend(loop, msg, timeout)`. The
+     * client, and the buffer, have to stay valid until it resumes.
+     */
+    [[nodiscard]] auto AsyncSend(
+        EventLoop& loop,
+        std::span<const std::byte> msg,
+        std::chrono::milliseconds timeout
+    ) const noexcept {
+        return AwaitCallback<IoResult>([this, &loop, msg, timeout](OnDone onDone) {
+            AsyncSend(loop, msg, timeout, std::move(onDone));
+        });
+    }
+
+    [[nodiscard]] auto AsyncReceive(
+        EventLoop& loop,
+        std::span<std::byte> msg,
+        std::chrono::milliseconds timeout
+    ) const noexcept {
+        return AwaitCallback<IoResult>([this, &loop, msg, timeout](OnDone onDone) {
+            AsyncReceive(loop, msg, timeout, std::move(onDone));
+        });
+    }
+
+    [[nodiscard]] auto AsyncConnect(
+        EventLoop& loop,
+        Endpoint serverEndpoint,
+        std::chrono::milliseconds timeout
+    ) const noexcept {
+        return AwaitCallback<ConnectResult>([this, &loop, serverEndpoint, timeout](OnConnected onConnected) {
+            AsyncConnect(loop, serverEndpoint, timeout, std::move(onConnected));
+        });
+    }
+
+    [[nodiscard]] auto AsyncConnect(
+        EventLoop& loop,
+        const sockaddr_storage& serverAddress,
+        std::chrono::milliseconds timeout
+    ) const noexcept {
+        return AwaitCallback<ConnectResult>([this, &loop, serverAddress, timeout](OnConnected onConnected) {
+            AsyncConnect(loop, serverAddress, timeout, std::move(onConnected));
+        });
+    }
+
+    [[nodiscard]] auto GetFd() const noexcept -> int { return SockFd_; }
 };
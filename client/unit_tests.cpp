@@ -0,0 +1,380 @@
+#include "happy_eyeballs.hpp"
+#include "state_handlers/all.hpp"
+#include "tcp_acceptor.hpp"
+
+#include "../networking/sock_addr.hpp"
+#include "../networking/socket_options.hpp"
+
+#include <cassert>
+#include <cerrno>
+#include <fcntl.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <optional>
+#include <poll.h>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+
+namespace {
+using namespace std::chrono;
+
+auto CreateLoop() -> EventLoop {
+    auto loopOrError = EventLoop::CreateNew();
+    assert(std::holds_alternative<EventLoop>(loopOrError));
+    return std::move(std::get<EventLoop>(loopOrError));
+}
+
+auto V4(in_port_t port) -> sockaddr_storage {
+    return ToSockAddrStorage(ConstructSockAddr(in_addr{.s_addr = htonl(INADDR_LOOPBACK)}, port));
+}
+
+auto V6(in_port_t port) -> sockaddr_storage {
+    return ToSockAddrStorage(ConstructSockAddr(in6addr_loopback, port));
+}
+
+auto GetPort(const sockaddr_storage& addr) -> in_port_t {
+    return ntohs(addr.ss_family == AF_INET6 ? reinterpret_cast<const sockaddr_in6&>(addr).sin6_port
+                                            : reinterpret_cast<const sockaddr_in&>(addr).sin_port);
+}
+
+// A RAII wrapper over a socket listening on an IPv4 loopback port chosen by the kernel
+struct Listener {
+    int Fd = -1;
+    in_port_t Port = 0;
+
+    explicit Listener(int backlog = 16) {
+        Fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        auto addr = ConstructSockAddr(in_addr{.s_addr = htonl(INADDR_LOOPBACK)}, 0);
+        auto addrSize = socklen_t{sizeof(addr)};
+        assert(bind(Fd, (sockaddr*) &addr, sizeof(addr)) == 0 && listen(Fd, backlog) == 0);
+        assert(getsockname(Fd, (sockaddr*) &addr, &addrSize) == 0);
+        Port = ntohs(addr.sin_port);
+    }
+    ~Listener() {
+        close(Fd);
+    }
+};
+
+/* A listener whose accept queue is full, so that the kernel drops the
+ * SYNs sent to it: a connection to it hangs, as to a black hole route
+ */
+struct FullListener : Listener {
+    std::vector<int> Fillers;
+
+    FullListener() : Listener(/* backlog */ 0) {
+        for (auto i = 0; i != 4; ++i) {
+            const auto addr = V4(Port);
+            Fillers.push_back(socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+            connect(Fillers.back(), (const sockaddr*) &addr, sizeof(sockaddr_in));
+        }
+        // Until the handshakes of those that fit are done
+        usleep(100'000);
+    }
+    ~FullListener() {
+        for (const auto fd : Fillers) close(fd);
+    }
+};
+
+// The port of a listener that is closed since, so the connections to it are refused
+auto FindClosedPort() -> in_port_t {
+    return Listener{}.Port;
+}
+
+// The fd that the next socket gets, the lowest one not open
+auto FindNextFd() -> int {
+    const auto fd = dup(STDERR_FILENO);
+    assert(fd != -1);
+    close(fd);
+    return fd;
+}
+
+auto IsOpen(int fd) -> bool {
+    return fcntl(fd, F_GETFD) != -1 || errno != EBADF;
+}
+
+struct RaceOutcome {
+    NHappyEyeballs::Result Result;
+    milliseconds Elapsed;
+};
+
+auto RunRace(
+    EventLoop& loop,
+    std::vector<sockaddr_storage> candidates,
+    milliseconds timeout
+) -> RaceOutcome {
+    auto result = std::optional<NHappyEyeballs::Result>{};
+    const auto start = EventLoop::Clock::now();
+    NHappyEyeballs::AsyncConnectToAny(loop, std::move(candidates), timeout, [&](NHappyEyeballs::Result r) {
+        assert(!result);
+        result = std::move(r);
+    });
+    // Never called from the call that starts the race
+    assert(!result);
+    while (!result) assert(!loop.RunOnce());
+    return RaceOutcome{
+        .Result = std::move(*result),
+        .Elapsed = duration_cast<milliseconds>(EventLoop::Clock::now() - start),
+    };
+}
+
+auto GetPeerAddress(int sockFd) -> sockaddr_storage {
+    auto addr = sockaddr_storage{};
+    auto addrSize = socklen_t{sizeof(addr)};
+    assert(getpeername(sockFd, (sockaddr*) &addr, &addrSize) == 0);
+    return addr;
+}
+
+auto IsSameAddress(const sockaddr_storage& lhs, const sockaddr_storage& rhs) -> bool {
+    return lhs.ss_family == AF_INET && rhs.ss_family == AF_INET
+        && reinterpret_cast<const sockaddr_in&>(lhs) == reinterpret_cast<const sockaddr_in&>(rhs);
+}
+
+// Shows nothing, as the handlers run here don't wait for the user
+class SilentUserClient : public IUserClient {
+public:
+    auto Show(const NState::State&) noexcept -> void override {}
+    auto OnFrame(const NState::State&, std::chrono::nanoseconds) noexcept -> void override {}
+    auto ParseAction(const NState::State&, std::string_view) noexcept -> std::optional<UserAction> override {
+        return std::nullopt;
+    }
+};
+
+/* A player whom the central server told the address of the other one,
+ * which is the local address of the connection to the server, each
+ * with a loop of its own
+ */
+struct Peer {
+    NState::Context Ctx;
+    // After `Ctx`, so that the handler is destroyed before the loop
+    TaskScope Handler;
+    sockaddr_storage LocalAddress = {};
+    std::optional<NState::State> Result;
+    EventLoop::Clock::time_point Start;
+    milliseconds Elapsed{0};
+
+    Peer(IUserClient& userClient, const Listener& centralServer, milliseconds timeout)
+        : Ctx{.Loop = CreateLoop(), .UserClient = userClient, .TimeoutToConnectToPeer = timeout}
+    {
+        auto [result, elapsed] = RunRace(Ctx.Loop, {V4(centralServer.Port)}, milliseconds{2000});
+        Ctx.CentralServer = std::move(std::get<TcpClient>(result));
+        LocalAddress = std::get<sockaddr_storage>(Ctx.CentralServer->GetLocalAddress());
+    }
+
+    auto StartConnecting(const Peer& other) -> void {
+        Start = EventLoop::Clock::now();
+        Handler.Spawn([](Peer& self, const sockaddr_storage peerAddress) -> Task<void> {
+            self.Result = co_await NState::HandleState(NState::NeedToEstablishConnectionWithPeer{
+                .PeerAddress = peerAddress,
+            }, self.Ctx);
+            self.Elapsed = duration_cast<milliseconds>(EventLoop::Clock::now() - self.Start);
+        }(*this, other.LocalAddress));
+    }
+};
+
+// Runs the loops of both until both are done, `late` starting `offset` after `early`
+auto ConnectPeers(Peer& early, Peer& late, milliseconds offset) -> void {
+    early.StartConnecting(late);
+    const auto lateStart = early.Start + offset;
+    auto lateStarted = false;
+    while (!early.Result || !late.Result) {
+        if (!lateStarted && EventLoop::Clock::now() >= lateStart) {
+            late.StartConnecting(early);
+            lateStarted = true;
+        }
+        assert(!early.Ctx.Loop.RunOnce(milliseconds{1}));
+        if (lateStarted) assert(!late.Ctx.Loop.RunOnce(milliseconds{1}));
+    }
+}
+
+// Both ends of one connection, from one peer to the other
+auto CheckConnected(const Peer& lhs, const Peer& rhs) -> void {
+    const auto* lhsState = std::get_if<NState::EstablishedConnectionWithPeer>(&*lhs.Result);
+    const auto* rhsState = std::get_if<NState::EstablishedConnectionWithPeer>(&*rhs.Result);
+    assert(lhsState && rhsState);
+    const auto lhsFd = lhsState->Client.GetFd();
+    const auto rhsFd = rhsState->Client.GetFd();
+    assert(IsSameAddress(GetPeerAddress(lhsFd), rhs.LocalAddress));
+    assert(IsSameAddress(GetPeerAddress(rhsFd), lhs.LocalAddress));
+    assert(write(lhsFd, "x", 1) == 1);
+    auto pollFd = pollfd{.fd = rhsFd, .events = POLLIN, .revents = 0};
+    auto byte = char{};
+    assert(poll(&pollFd, 1, 1000) == 1 && read(rhsFd, &byte, 1) == 1 && byte == 'x');
+}
+} // anonymous namespace
+
+
+namespace NTests {
+// IPv6 first, then the families take turns, each in the given order
+auto TestInterleaveAddressFamilies() -> void {
+    const auto interleaved = NHappyEyeballs::InterleaveAddressFamilies({V4(1), V4(2), V6(3), V4(4), V6(5), V6(6)});
+    const auto expected = std::vector<std::pair<sa_family_t, in_port_t>>{
+        {AF_INET6, 3}, {AF_INET, 1}, {AF_INET6, 5}, {AF_INET, 2}, {AF_INET6, 6}, {AF_INET, 4},
+    };
+    assert(interleaved.size() == expected.size());
+    for (auto i = size_t{0}; i != expected.size(); ++i) {
+        assert(interleaved[i].ss_family == expected[i].first && GetPort(interleaved[i]) == expected[i].second);
+    }
+    assert(NHappyEyeballs::InterleaveAddressFamilies({V4(1), V4(2)}).size() == 2);
+    assert(NHappyEyeballs::InterleaveAddressFamilies({}).empty());
+    std::cerr << "TestInterleaveAddressFamilies OK\n";
+}
+
+// Only IPv4 listens: the refused IPv6 attempt starts the IPv4 one at once, without the delay
+auto TestRefusedIpV6ThenGoodIpV4() -> void {
+    auto loop = CreateLoop();
+    const auto listener = Listener{};
+    auto [result, elapsed] = RunRace(loop, {V4(listener.Port), V6(listener.Port)}, milliseconds{2000});
+    assert(std::holds_alternative<TcpClient>(result));
+    assert(elapsed < NHappyEyeballs::kConnectionAttemptDelay);
+    assert(!loop.HasWork() && !loop.Remove(std::get<TcpClient>(result).GetFd()));
+    std::cerr << "TestRefusedIpV6ThenGoodIpV4 OK\n";
+}
+
+// The error of the last attempt to fail is reported once all of them failed
+auto TestRefusedOnly() -> void {
+    auto loop = CreateLoop();
+    const auto port = FindClosedPort();
+    auto [result, elapsed] = RunRace(loop, {V4(port), V6(port)}, milliseconds{2000});
+    const auto* err = std::get_if<SystemError>(&result);
+    assert(err && err->Value == std::errc::connection_refused);
+    assert(elapsed < NHappyEyeballs::kConnectionAttemptDelay);
+    assert(!loop.HasWork());
+    std::cerr << "TestRefusedOnly OK\n";
+}
+
+auto TestEmptyCandidates() -> void {
+    auto loop = CreateLoop();
+    auto [result, elapsed] = RunRace(loop, {}, milliseconds{2000});
+    const auto* err = std::get_if<SystemError>(&result);
+    assert(err && err->Value == std::errc::invalid_argument);
+    assert(!loop.HasWork());
+    std::cerr << "TestEmptyCandidates OK\n";
+}
+
+/* The hanging attempt has the lead for the delay, then the next one
+ * wins, and the loser is removed from the loop and closed
+ */
+auto TestHoleThenGoodListener() -> void {
+    auto loop = CreateLoop();
+    const auto hole = FullListener{};
+    const auto listener = Listener{};
+    const auto holeAttemptFd = FindNextFd();
+    auto [result, elapsed] = RunRace(loop, {V4(hole.Port), V4(listener.Port)}, milliseconds{5000});
+    assert(std::holds_alternative<TcpClient>(result));
+    const auto& winner = std::get<TcpClient>(result);
+    assert(elapsed >= NHappyEyeballs::kConnectionAttemptDelay);
+    assert(elapsed < NHappyEyeballs::kConnectionAttemptDelay + milliseconds{500});
+    // The attempts got the sockets in the order they started
+    assert(winner.GetFd() == holeAttemptFd + 1 && !IsOpen(holeAttemptFd));
+    // The cancelled `connect()` of the loser ends with a call to its callback, and leaves nothing behind
+    assert(!loop.RunOnce(milliseconds{0}) && !loop.HasWork());
+    assert(!loop.Remove(winner.GetFd()));
+    std::cerr << "TestHoleThenGoodListener OK\n";
+}
+
+/* The attempts share the deadline of the race: the one that started
+ * after the delay times out with the first, not a delay later
+ */
+auto TestHoleOnlyTimeout() -> void {
+    auto loop = CreateLoop();
+    const auto hole = FullListener{};
+    const auto otherHole = FullListener{};
+    const auto timeout = milliseconds{400};
+    const auto firstAttemptFd = FindNextFd();
+    auto [result, elapsed] = RunRace(loop, {V4(hole.Port), V4(otherHole.Port)}, timeout);
+    const auto* err = std::get_if<TcpClient::Timeout>(&result);
+    assert(err && err->Duration == timeout);
+    assert(err->WallTimeElapsed >= timeout && err->WallTimeElapsed <= elapsed);
+    assert(elapsed >= timeout && elapsed < timeout + NHappyEyeballs::kConnectionAttemptDelay);
+    assert(!IsOpen(firstAttemptFd) && !IsOpen(firstAttemptFd + 1));
+    assert(!loop.RunOnce(milliseconds{0}) && !loop.HasWork());
+    std::cerr << "TestHoleOnlyTimeout OK\n";
+}
+
+// The socket connected to the central server listens at the same address instead
+auto TestAcceptorFromTcpClient() -> void {
+    auto loop = CreateLoop();
+    const auto centralServer = Listener{};
+    auto [result, elapsed] = RunRace(loop, {V4(centralServer.Port)}, milliseconds{2000});
+    auto& client = std::get<TcpClient>(result);
+    const auto localAddress = std::get<sockaddr_storage>(client.GetLocalAddress());
+    assert(!loop.Remove(client.GetFd()) && !EnablePortReuse(client.GetFd()));
+    auto acceptorOrErr = TcpAcceptor::FromTcpClient(std::move(client));
+    assert(std::holds_alternative<TcpAcceptor>(acceptorOrErr) && client.GetFd() == -1);
+    const auto& acceptor = std::get<TcpAcceptor>(acceptorOrErr);
+
+    const auto connect = [&]() -> TcpClient {
+        auto peerOrErr = TcpClient::CreateNew(Endpoint{.IpAddr = IP::v4::loopback{}, .Port = GetPort(localAddress)}, milliseconds{1000});
+        assert(std::holds_alternative<TcpClient>(peerOrErr));
+        return std::move(std::get<TcpClient>(peerOrErr));
+    };
+    const auto peer = connect();
+    const auto peerAddress = std::get<sockaddr_storage>(peer.GetLocalAddress());
+    auto accepted = acceptor.AcceptExpectedPeer(peerAddress, milliseconds{1000});
+    assert(std::holds_alternative<TcpClient>(accepted));
+    assert(IsSameAddress(GetPeerAddress(std::get<TcpClient>(accepted).GetFd()), peerAddress));
+
+    // Anyone else who finds the port is turned away
+    const auto stranger = connect();
+    accepted = acceptor.AcceptExpectedPeer(peerAddress, milliseconds{1000});
+    assert(std::holds_alternative<TcpAcceptor::PeerAddressMismatchError>(accepted));
+    accepted = acceptor.AcceptExpectedPeer(peerAddress, milliseconds{100});
+    assert(std::holds_alternative<TcpAcceptor::Timeout>(accepted));
+    std::cerr << "TestAcceptorFromTcpClient OK\n";
+}
+
+/* Each peer connects to the other and accepts it at once, from the same
+ * port: whichever starts first, and even when their SYNs cross, they
+ * end up at both ends of one connection. The one that starts late is
+ * refused until then, which the other retries.
+ */
+auto TestConnectPeers() -> void {
+    auto userClient = SilentUserClient{};
+    const auto centralServer = Listener{};
+    for (const auto offset : {milliseconds{0}, milliseconds{5}, milliseconds{200}, milliseconds{1000}}) {
+        auto early = Peer(userClient, centralServer, milliseconds{5000});
+        auto late = Peer(userClient, centralServer, milliseconds{5000});
+        ConnectPeers(early, late, offset);
+        CheckConnected(early, late);
+        CheckConnected(late, early);
+        // By a retry, an interval after the other started at most
+        assert(early.Elapsed >= offset && early.Elapsed < offset + milliseconds{500});
+        assert(late.Elapsed < milliseconds{500});
+    }
+    std::cerr << "TestConnectPeers OK\n";
+}
+
+// The connection is refused until the deadline, when the peer didn't connect either
+auto TestPeerNeverShowsUp() -> void {
+    auto userClient = SilentUserClient{};
+    const auto centralServer = Listener{};
+    const auto timeout = milliseconds{300};
+    auto peer = Peer(userClient, centralServer, timeout);
+    auto absent = Peer(userClient, centralServer, timeout);
+    peer.StartConnecting(absent);
+    while (!peer.Result) assert(!peer.Ctx.Loop.RunOnce());
+    const auto* failed = std::get_if<NState::FailedToEstablishConnectionWithPeer>(&*peer.Result);
+    assert(failed && failed->ErrorDescription.find("the peer didn't connect in 300ms") != std::string::npos);
+    assert(peer.Elapsed >= timeout && peer.Elapsed < timeout + milliseconds{200});
+    assert(!peer.Ctx.Loop.RunOnce(milliseconds{0}) && !peer.Ctx.Loop.HasWork());
+    std::cerr << "TestPeerNeverShowsUp OK\n";
+}
+} // namespace NTests
+
+
+auto main() -> int {
+    using namespace NTests;
+    TestInterleaveAddressFamilies();
+    TestRefusedIpV6ThenGoodIpV4();
+    TestRefusedOnly();
+    TestEmptyCandidates();
+    TestHoleThenGoodListener();
+    TestHoleOnlyTimeout();
+    TestAcceptorFromTcpClient();
+    TestConnectPeers();
+    TestPeerNeverShowsUp();
+    std::cerr << "All tests passed.\n";
+}
@@ -13,13 +13,15 @@ namespace NUserAction {
     struct MakeMove {};
     struct OfferDraw {};
     struct Resign {};
+    struct Quit {};
 
     using UserAction = std::variant<
         CreateNewGame,
         JoinGame,
         MakeMove,
         OfferDraw,
-        Resign
+        Resign,
+        Quit
     >;
 } // namespace NActions
 
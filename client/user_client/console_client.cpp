@@ -1,54 +1,104 @@
 #include "console_client.hpp"
 
 #include "../../utils/error.hpp"
+#include "../../utils/overloaded.hpp"
 
 #include <iostream>
 #include <string_view>
 
 
-auto ConsoleClient::ActOn(NState::ConnectedToCentralServer) noexcept
-  -> std::variant<NUserAction::CreateNewGame, NUserAction::JoinGame> {
-    static constexpr auto prompt = std::string_view{
-        "Connection to the central server established successfully.\n"
-        "Type \"new game\" to create a new game or "
-        "\"join game <game_id>\" to join an existing game.\n"
-        ">>> "
-    };
+namespace {
+    constexpr auto kPrompt = std::string_view{">>> "};
+
+    auto Trim(std::string_view s) noexcept -> std::string_view {
+        constexpr auto kSpaces = std::string_view{" \t\r"};
+        const auto begin = s.find_first_not_of(kSpaces);
+        if (begin == std::string_view::npos) return {};
+        return s.substr(begin, s.find_last_not_of(kSpaces) - begin + 1);
+    }
+}
+
+auto ConsoleClient::Show(const NState::State& state) noexcept -> void {
+    using namespace NState;
+    std::visit(overloaded{
+        [](NeedToConnectToCentralServer) {
+            std::cout << "Connecting to the central server...\n";
+        },
+        [](ConnectedToCentralServer) {
+            std::cout << "Connection to the central server established successfully.\n"
+                         "Type \"new game\" to create a new game or "
+                         "\"join game <game_id>\" to join an existing game.\n"
+                      << kPrompt << std::flush;
+        },
+        [](NeedToCreateNewGame) {
+            std::cout << "Creating a new game...\n";
+        },
+        [](const CreatedNewGame& game) {
+            std::cout << "Successfully created new game with id "
+                      << game.Id
+                      << ".\n"
+                         "Tell this game id to the other player and ask them "
+                         "to make a \"join game\" request with this game id.\n"
+                         "Waiting for the other player to join the game "
+                         "(type \"quit\" to give up)...\n";
+        },
+        [](const NeedToJoinGame& game) {
+            std::cout << "Joining the game with id " << game.Id << "...\n";
+        },
+        [](const JoinedGame& game) {
+            std::cout << "Joined the game with id " << game.Id
+                      << ", waiting for the address of the other player...\n";
+        },
+        [](const NeedToEstablishConnectionWithPeer&) {
+            std::cout << "Connecting to the other player...\n";
+        },
+        [](const EstablishedConnectionWithPeer&) {
+            std::cout << "Connected to the other player.\n";
+        },
+        [](const std::derived_from<ErrorState> auto& errorState) {
+            std::cout << "Error: " << errorState.ErrorDescription << "\n";
+            if (errorState.RecommendationHowToFix) {
+                std::cout << "How to fix: " << *errorState.RecommendationHowToFix << "\n";
+            }
+        },
+        [](NeedToExit) {
+            std::cout << "Bye.\n";
+        },
+    }, state);
+}
+
+auto ConsoleClient::OnFrame(const NState::State&, std::chrono::nanoseconds) noexcept -> void {
+    // The console is only written to by `Show()` and `ParseAction()`, line by line
+}
+
+auto ConsoleClient::ParseAction(const NState::State& state, const std::string_view line) noexcept
+  -> std::optional<UserAction> {
     static constexpr auto newGameCmd = std::string_view{"new game"};
     static constexpr auto joinGameCmd = std::string_view{"join game "};
-    std::cout << prompt;
-    auto userAction = std::string{};
-    for (;;) {
-        std::cin >> userAction;
-        if (userAction == newGameCmd) {
-            return NUserAction::CreateNewGame{};
-        } else if (userAction.starts_with(joinGameCmd)) {
-            const auto gameIdStr = std::string_view{userAction}.substr(joinGameCmd.size());
-            const auto gameIdOrErr = GameId::FromString(gameIdStr);
-            // TODO: change impl to `std::visit`
-            if (auto* gameIdPtr = std::get_if<GameId>(&gameIdOrErr); gameIdPtr) {
-                return NUserAction::JoinGame{.Id = *gameIdPtr};
-            } else {
-                std::cout << "Couldn't parse game_id from the string \"" << gameIdStr << "\", got the following error: "
-                          << std::get<SystemError>(gameIdOrErr);
-            }
-        } else {
-            std::cout << "Couldn't interpret action \"" << userAction << "\".\n";
+    static constexpr auto quitCmd = std::string_view{"quit"};
+    const auto userAction = Trim(line);
+    if (userAction == quitCmd) {
+        return NUserAction::Quit{};
+    } else if (!std::holds_alternative<NState::ConnectedToCentralServer>(state)) {
+        // Only "quit" is available while the client waits for the network
+        if (!userAction.empty()) {
+            std::cout << "Couldn't interpret action \"" << userAction << "\" now.\n";
         }
-        std::cout << prompt;
+        return std::nullopt;
+    } else if (userAction == newGameCmd) {
+        return NUserAction::CreateNewGame{};
+    } else if (userAction.starts_with(joinGameCmd)) {
+        const auto gameIdStr = Trim(userAction.substr(joinGameCmd.size()));
+        const auto gameIdOrErr = GameId::FromString(gameIdStr);
+        // TODO: change impl to `std::visit`
+        if (auto* gameIdPtr = std::get_if<GameId>(&gameIdOrErr); gameIdPtr) {
+            return NUserAction::JoinGame{.Id = *gameIdPtr};
+        }
+        std::cout << "Couldn't parse game_id from the string \"" << gameIdStr << "\", got the following error: "
+                  << std::get<SystemError>(gameIdOrErr) << "\n";
+    } else if (!userAction.empty()) {
+        std::cout << "Couldn't interpret action \"" << userAction << "\".\n";
     }
-}
-
-auto ConsoleClient::ActOn(
-    const NState::CreatedNewGame& game,
-    const uint8_t timeoutInSecondsForPeerToJoin
-) noexcept -> void {
-    std::cout << "Successfully created new game with id "
-              << game.Id
-              << ".\n"
-                 "Tell this game id to the other player and ask them "
-                 "to make a \"join game\" request with this game id.\n"
-                 "Waiting for the other player to join the game for "
-              << timeoutInSecondsForPeerToJoin
-              << " seconds...";
+    std::cout << kPrompt << std::flush;
+    return std::nullopt;
 }
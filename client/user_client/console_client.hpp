@@ -6,12 +6,8 @@
 
 class ConsoleClient : public IUserClient {
 public:
-    auto ActOn(NState::FailedToConnectToCentralServer&&) noexcept
-      -> void override;
-    auto ActOn(NState::ConnectedToCentralServer) noexcept
-      -> std::variant<NUserAction::CreateNewGame, NUserAction::JoinGame> override;
-    auto ActOn(const NState::CreatedNewGame&, std::chrono::seconds timeoutForPeerToJoin) noexcept
-      -> void override;
-    auto ActOn(const NState::FailedToJoinGame&) noexcept
-      -> void override;
+    auto Show(const NState::State&) noexcept -> void override;
+    auto OnFrame(const NState::State&, std::chrono::nanoseconds timeInState) noexcept -> void override;
+    auto ParseAction(const NState::State&, std::string_view line) noexcept
+      -> std::optional<UserAction> override;
 };
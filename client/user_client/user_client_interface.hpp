@@ -4,14 +4,23 @@
 #include "../state.hpp"
 #include "../user_actions.hpp"
 
+#include <chrono>
+#include <optional>
+#include <string_view>
 
+
+/* The user's side of the client, driven by the `ClientRuntime` from its
+ * event loop, so none of these may block: the network and the user's
+ * input are serviced by the same thread.
+ */
 class IUserClient {
 public:
     virtual ~IUserClient() = default;
-    virtual auto ActOn(NState::FailedToConnectToCentralServer&&) noexcept -> void = 0;
-    virtual auto ActOn(NState::ConnectedToCentralServer) noexcept
-      -> std::variant<NUserAction::CreateNewGame, NUserAction::JoinGame> = 0;
-    virtual auto ActOn(const NState::CreatedNewGame&, std::chrono::seconds timeoutForPeerToJoin) noexcept
-      -> void = 0;
-    virtual auto ActOn(const NState::FailedToJoinGame&) noexcept -> void = 0;
+    // Called on entering each state, to show it: a prompt, progress or an error
+    virtual auto Show(const NState::State&) noexcept -> void = 0;
+    // Called once per frame, e.g. to animate a countdown without waiting for an event
+    virtual auto OnFrame(const NState::State&, std::chrono::nanoseconds timeInState) noexcept -> void = 0;
+    // The action that a line typed by the user asks for in the state, if any
+    virtual auto ParseAction(const NState::State&, std::string_view line) noexcept
+      -> std::optional<UserAction> = 0;
 };
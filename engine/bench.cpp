@@ -0,0 +1,159 @@
+#include "nnue.hpp"
+#include "search.hpp"
+#include "smp_search.hpp"
+
+#include "../chess/position.hpp"
+#include "../utils/cli_args.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+
+namespace {
+    // A fixed, varied set of positions: openings, middlegames with
+    // tactics, and endgames, so that the node rate is comparable
+    // between runs and between versions of the engine
+    static constexpr auto kBenchPositions = std::array<std::string_view, 12>{
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R2QKB1R w KQ - 0 8",
+        "2r3k1/pp3ppp/4p3/3pP3/3P1P2/1P3K2/P5PP/2R5 b - - 0 25",
+        "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "8/8/4k3/8/2K5/8/3P4/8 w - - 0 1",
+        "r2q1rk1/ppp2ppp/2n1bn2/2bpp3/4P3/2PP1N2/PP1NBPPP/R1BQ1RK1 w - - 0 8",
+        "3r2k1/p4ppp/1p6/2p5/2P5/1P3N2/P4PPP/3R2K1 w - - 0 30",
+    };
+
+    // Evaluations per second of every SIMD path the CPU supports,
+    // on already computed accumulators of the bench positions
+    auto BenchEvaluation() -> void {
+        using namespace NEngine::NNnue;
+        using Clock = std::chrono::steady_clock;
+        static constexpr auto kRounds = 20000;
+
+        const auto& net = Network::Default();
+        auto positions = std::vector<NChess::Position>(kBenchPositions.size());
+        auto accumulators = std::vector<Accumulator>(kBenchPositions.size());
+        for (auto i = size_t{0}; i < kBenchPositions.size(); ++i) {
+            // Validity was checked by the search bench
+            (void)positions[i].SetFromFen(kBenchPositions[i]);
+            Refresh(net, positions[i], accumulators[i]);
+        }
+        for (const auto simd : SupportedSimd()) {
+            auto checksum = NEngine::Score{0};
+            const auto start = Clock::now();
+            for (auto round = 0; round < kRounds; ++round) {
+                for (auto i = size_t{0}; i < positions.size(); ++i) {
+                    checksum += Evaluate(net, accumulators[i], positions[i], simd);
+                }
+            }
+            const auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            std::cout << std::setw(8) << simd << ": "
+                      << uint64_t(kRounds * positions.size() / elapsed) << " evals/second"
+                      << " (checksum " << checksum << ")\n";
+        }
+    }
+
+    struct BenchTotals {
+        uint64_t Nodes = 0;
+        std::chrono::milliseconds Time{0};
+        int Depth = 0;
+    };
+
+    auto RunBench(
+        NEngine::TranspositionTable& tt,
+        ThreadPool& pool,
+        int threads,
+        const NEngine::SearchLimits& limits,
+        bool verbose
+    ) -> BenchTotals {
+        auto searcher = NEngine::SmpSearcher{tt, pool, threads};
+        auto totals = BenchTotals{};
+        for (const auto fen : kBenchPositions) {
+            auto pos = NChess::Position{};
+            if (const auto err = pos.SetFromFen(fen)) {
+                std::cerr << "Bad bench position \"" << fen << "\": ";
+                LogErrorAndExit(*err);
+            }
+            searcher.Clear();
+            tt.Clear();
+            const auto result = searcher.Search(pos, limits);
+            totals.Nodes += result.Nodes;
+            totals.Time += result.WallTimeElapsed;
+            totals.Depth += result.Depth;
+            if (!verbose) continue;
+            std::cout << "depth " << result.Depth
+                      << " score " << result.BestScore
+                      << " nodes " << result.Nodes
+                      << " time " << result.WallTimeElapsed.count() << "ms"
+                      << " hashfull " << tt.Hashfull()
+                      << " bestmove " << result.BestMove
+                      << " fen " << fen << "\n";
+        }
+        return totals;
+    }
+} // anonymous namespace
+
+
+/* Usage: bench [time budget per position in ms = 100] [max depth = unlimited]
+ *              [hash MB = 64] [threads = 1]
+ *
+ * Searches every position of a fixed set and reports the reached depth
+ * and the node rate, then the evaluation speed of every SIMD path. With
+ * more than one thread the set is searched again for 1, 2, 4, ... threads
+ * up to the given count, and the speedup over one thread is reported;
+ * with a max depth the speedup is the time-to-depth one, which is the
+ * meaningful measure for Lazy SMP.
+ */
+auto main(int argc, char** argv) -> int {
+    using namespace NEngine;
+    const auto timeBudget = std::chrono::milliseconds{argc > 1 ? ParseIntArg(argv[1], 100) : 100};
+    const auto maxDepth = argc > 2 ? ParseIntArg(argv[2], NChess::kMaxPly - 1) : NChess::kMaxPly - 1;
+    const auto hashMegabytes = argc > 3 ? ParseIntArg(argv[3], 64) : 64;
+    const auto maxThreads = std::clamp(argc > 4 ? ParseIntArg(argv[4], 1) : 1, 1, SmpSearcher::kMaxThreads);
+
+    auto ttOrError = TranspositionTable::CreateNew(size_t(std::max(hashMegabytes, 1)));
+    if (std::holds_alternative<SystemError>(ttOrError)) {
+        LogErrorAndExit(std::get<SystemError>(ttOrError));
+    }
+    auto& tt = std::get<TranspositionTable>(ttOrError);
+    std::cout << "Hash: " << tt.GetSizeInBytes() / (1 << 20) << "MB backed by " << tt.GetBacking() << "\n";
+
+    const auto limits = SearchLimits{
+        .TimeBudget = timeBudget,
+        .MaxDepth = maxDepth,
+    };
+    // The calling thread searches too
+    auto pool = ThreadPool{maxThreads - 1};
+    const auto total = RunBench(tt, pool, 1, limits, true);
+    const auto ms = std::max<int64_t>(total.Time.count(), 1);
+    std::cout << "===========================\n"
+              << "Total nodes:   " << total.Nodes << "\n"
+              << "Total time:    " << total.Time.count() << "ms\n"
+              << "Nodes/second:  " << total.Nodes * 1000 / ms << "\n"
+              << "Average depth: " << double(total.Depth) / kBenchPositions.size() << "\n"
+              << "===========================\n";
+    BenchEvaluation();
+
+    if (maxThreads == 1) return 0;
+    std::cout << "===========================\n"
+              << "threads   nodes/second   time   avg depth   speedup\n";
+    for (auto threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+        const auto run = threads == 1 ? total : RunBench(tt, pool, threads, limits, false);
+        const auto runMs = std::max<int64_t>(run.Time.count(), 1);
+        std::cout << std::setw(7) << threads
+                  << std::setw(15) << run.Nodes * 1000 / runMs
+                  << std::setw(5) << run.Time.count() << "ms"
+                  << std::setw(12) << double(run.Depth) / kBenchPositions.size()
+                  << std::setw(9) << std::fixed << std::setprecision(2) << double(ms) / runMs << "x\n";
+        std::cout.unsetf(std::ios::floatfield);
+        if (threads == maxThreads) break;
+    }
+}
@@ -0,0 +1,41 @@
+#include "evaluate.hpp"
+#include "psqt.hpp"
+
+#include <algorithm>
+
+
+namespace {
+    using namespace NChess;
+    using NEngine::Score;
+    using namespace NEngine::NPsqt;
+} // anonymous namespace
+
+
+namespace NEngine {
+    auto Evaluate(const Position& pos) noexcept -> Score {
+        auto mg = std::array<Score, 2>{};
+        auto eg = std::array<Score, 2>{};
+        auto phase = 0;
+        for (const auto c : {White, Black}) {
+            for (auto pt = int{Pawn}; pt <= King; ++pt) {
+                auto pieces = pos.Pieces(c, PieceType(pt));
+                phase += kPhaseWeight[pt] * PopCount(pieces);
+                while (pieces) {
+                    const auto s = PopLsb(pieces);
+                    const auto rs = c == White ? s : FlipRank(s);
+                    mg[c] += kMaterialValue[pt] + MgValue(PieceType(pt), rs);
+                    eg[c] += kMaterialValue[pt] + EgValue(PieceType(pt), rs);
+                }
+            }
+            if (MoreThanOne(pos.Pieces(c, Bishop))) {
+                mg[c] += kBishopPair;
+                eg[c] += kBishopPair;
+            }
+        }
+        phase = std::min(phase, kMaxPhase);
+        const auto us = pos.SideToMove(), them = ~us;
+        const auto mgScore = mg[us] - mg[them];
+        const auto egScore = eg[us] - eg[them];
+        return (mgScore * phase + egScore * (kMaxPhase - phase)) / kMaxPhase + kTempo;
+    }
+} // namespace NEngine
@@ -0,0 +1,22 @@
+#pragma once
+
+
+#include "../chess/position.hpp"
+
+
+namespace NEngine {
+    // Centipawns from the point of view of the side to move
+    using Score = int;
+
+    static constexpr auto kInfinite = Score{32000};
+    static constexpr auto kMate = Score{31000};
+    // Scores above this value are "mate in N plies"
+    static constexpr auto kMateInMaxPly = kMate - NChess::kMaxPly;
+
+    static constexpr auto kMaterialValue = std::array<Score, NChess::kNumPieceTypes>{
+        100, 320, 330, 500, 950, 0,
+    };
+
+    // Hand-crafted evaluation: tapered material and piece-square tables
+    [[nodiscard]] auto Evaluate(const NChess::Position& pos) noexcept -> Score;
+} // namespace NEngine
@@ -0,0 +1,391 @@
+#include "nnue.hpp"
+#include "nnue_default_net.hpp"
+
+#include "../utils/integer_serialization.hpp"
+
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NNUE_X86
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define NNUE_NEON
+#endif
+
+
+namespace {
+    using namespace NChess;
+    using namespace NEngine;
+    using namespace NEngine::NNnue;
+
+    using TransformedFeatures = std::array<uint8_t, kL1Inputs>;
+    using HiddenActivations = std::array<uint8_t, kL1Outputs>;
+
+    /* Every path computes the same integers in the same way:
+     *   Transform: out = clamp(acc, 0, 127), own perspective first
+     *   Propagate: hidden = clamp((b1 + W1 * in) >> kL1Shift, 0, 127), out = b2 + W2 * hidden
+     * Products of an activation (at most 127) and an int8 weight summed in
+     * pairs fit in int16 without saturation, so `maddubs`-style
+     * instructions are exact and the order of the int32 sums doesn't matter.
+     */
+    auto ClipHidden(int32_t sum) noexcept -> uint8_t {
+        return uint8_t(std::clamp(sum >> kL1Shift, 0, kActivationMax));
+    }
+
+    auto TransformScalar(const Accumulator& acc, Color stm, uint8_t* out) noexcept -> void {
+        for (const auto& [half, perspective] : {std::pair{0, stm}, std::pair{1, ~stm}}) {
+            for (auto i = 0; i < kHalfDimensions; ++i) {
+                out[half * kHalfDimensions + i] = uint8_t(std::clamp<int>(acc.Values[perspective][i], 0, kActivationMax));
+            }
+        }
+    }
+
+    auto PropagateScalar(const Network& net, const uint8_t* in) noexcept -> int32_t {
+        alignas(64) HiddenActivations hidden;
+        for (auto o = 0; o < kL1Outputs; ++o) {
+            auto sum = net.L1Bias[o];
+            for (auto i = 0; i < kL1Inputs; ++i) {
+                sum += int32_t(in[i]) * net.L1Weights[o][i];
+            }
+            hidden[o] = ClipHidden(sum);
+        }
+        auto out = net.L2Bias;
+        for (auto i = 0; i < kL1Outputs; ++i) {
+            out += int32_t(hidden[i]) * net.L2Weights[i];
+        }
+        return out;
+    }
+
+#ifdef NNUE_X86
+    __attribute__((target("ssse3")))
+    auto TransformSse(const Accumulator& acc, Color stm, uint8_t* out) noexcept -> void {
+        const auto max = _mm_set1_epi16(kActivationMax);
+        for (const auto& [half, perspective] : {std::pair{0, stm}, std::pair{1, ~stm}}) {
+            const auto* values = acc.Values[perspective].data();
+            for (auto i = 0; i < kHalfDimensions; i += 16) {
+                const auto a = _mm_min_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(values + i)), max);
+                const auto b = _mm_min_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(values + i + 8)), max);
+                // Unsigned saturation clips negative values to 0
+                _mm_store_si128(reinterpret_cast<__m128i*>(out + half * kHalfDimensions + i), _mm_packus_epi16(a, b));
+            }
+        }
+    }
+
+    __attribute__((target("ssse3")))
+    auto DotSse(const uint8_t* in, const int8_t* weights, int size) noexcept -> int32_t {
+        const auto ones = _mm_set1_epi16(1);
+        auto sum = _mm_setzero_si128();
+        for (auto i = 0; i < size; i += 16) {
+            const auto x = _mm_load_si128(reinterpret_cast<const __m128i*>(in + i));
+            const auto w = _mm_load_si128(reinterpret_cast<const __m128i*>(weights + i));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(x, w), ones));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        return _mm_cvtsi128_si32(sum);
+    }
+
+    __attribute__((target("ssse3")))
+    auto PropagateSse(const Network& net, const uint8_t* in) noexcept -> int32_t {
+        alignas(64) HiddenActivations hidden;
+        for (auto o = 0; o < kL1Outputs; ++o) {
+            hidden[o] = ClipHidden(net.L1Bias[o] + DotSse(in, net.L1Weights[o].data(), kL1Inputs));
+        }
+        return net.L2Bias + DotSse(hidden.data(), net.L2Weights.data(), kL1Outputs);
+    }
+
+    __attribute__((target("avx2")))
+    auto TransformAvx2(const Accumulator& acc, Color stm, uint8_t* out) noexcept -> void {
+        const auto max = _mm256_set1_epi16(kActivationMax);
+        for (const auto& [half, perspective] : {std::pair{0, stm}, std::pair{1, ~stm}}) {
+            const auto* values = acc.Values[perspective].data();
+            for (auto i = 0; i < kHalfDimensions; i += 32) {
+                const auto a = _mm256_min_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(values + i)), max);
+                const auto b = _mm256_min_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(values + i + 16)), max);
+                // `packus` works within 128-bit lanes, the permutation
+                // restores the order of the scalar path
+                const auto packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(out + half * kHalfDimensions + i), packed);
+            }
+        }
+    }
+
+    __attribute__((target("avx2")))
+    auto DotAvx2(const uint8_t* in, const int8_t* weights, int size) noexcept -> int32_t {
+        const auto ones = _mm256_set1_epi16(1);
+        auto sum = _mm256_setzero_si256();
+        for (auto i = 0; i < size; i += 32) {
+            const auto x = _mm256_load_si256(reinterpret_cast<const __m256i*>(in + i));
+            const auto w = _mm256_load_si256(reinterpret_cast<const __m256i*>(weights + i));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+        }
+        auto half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+        return _mm_cvtsi128_si32(half);
+    }
+
+    __attribute__((target("avx2")))
+    auto PropagateAvx2(const Network& net, const uint8_t* in) noexcept -> int32_t {
+        alignas(64) HiddenActivations hidden;
+        for (auto o = 0; o < kL1Outputs; ++o) {
+            hidden[o] = ClipHidden(net.L1Bias[o] + DotAvx2(in, net.L1Weights[o].data(), kL1Inputs));
+        }
+        return net.L2Bias + DotAvx2(hidden.data(), net.L2Weights.data(), kL1Outputs);
+    }
+#endif
+
+#ifdef NNUE_NEON
+    auto TransformNeon(const Accumulator& acc, Color stm, uint8_t* out) noexcept -> void {
+        const auto max = vdupq_n_s16(kActivationMax);
+        for (const auto& [half, perspective] : {std::pair{0, stm}, std::pair{1, ~stm}}) {
+            const auto* values = acc.Values[perspective].data();
+            for (auto i = 0; i < kHalfDimensions; i += 8) {
+                // Unsigned saturating narrowing clips negative values to 0
+                const auto clipped = vqmovun_s16(vminq_s16(vld1q_s16(values + i), max));
+                vst1_u8(out + half * kHalfDimensions + i, clipped);
+            }
+        }
+    }
+
+    auto DotNeon(const uint8_t* in, const int8_t* weights, int size) noexcept -> int32_t {
+        auto sum = vdupq_n_s32(0);
+        for (auto i = 0; i < size; i += 16) {
+            // Activations are at most 127, so they are valid int8 values
+            const auto x = vreinterpretq_s8_u8(vld1q_u8(in + i));
+            const auto w = vld1q_s8(weights + i);
+            auto products = vmull_s8(vget_low_s8(x), vget_low_s8(w));
+            sum = vpadalq_s16(sum, products);
+            products = vmull_s8(vget_high_s8(x), vget_high_s8(w));
+            sum = vpadalq_s16(sum, products);
+        }
+        return vaddvq_s32(sum);
+    }
+
+    auto PropagateNeon(const Network& net, const uint8_t* in) noexcept -> int32_t {
+        alignas(64) HiddenActivations hidden;
+        for (auto o = 0; o < kL1Outputs; ++o) {
+            hidden[o] = ClipHidden(net.L1Bias[o] + DotNeon(in, net.L1Weights[o].data(), kL1Inputs));
+        }
+        return net.L2Bias + DotNeon(hidden.data(), net.L2Weights.data(), kL1Outputs);
+    }
+#endif
+
+    auto DetectSimd() noexcept -> std::vector<ESimd> {
+        auto supported = std::vector<ESimd>{ESimd::Scalar};
+#ifdef NNUE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("ssse3")) supported.push_back(ESimd::Sse);
+        if (__builtin_cpu_supports("avx2")) supported.push_back(ESimd::Avx2);
+#endif
+#ifdef NNUE_NEON
+        supported.push_back(ESimd::Neon);
+#endif
+        return supported;
+    }
+
+    static const auto kSupportedSimd = DetectSimd();
+
+    auto Phase(const Position& pos) noexcept -> int {
+        auto phase = 0;
+        for (auto pt = int{Knight}; pt <= Queen; ++pt) {
+            phase += NPsqt::kPhaseWeight[pt] * PopCount(pos.Pieces(PieceType(pt)));
+        }
+        return phase;
+    }
+
+    struct FeatureChange {
+        Piece P;
+        Square S;
+    };
+
+    // At most: a moving piece, a captured piece and a castling rook
+    struct FeatureDelta {
+        std::array<FeatureChange, 2> Added;
+        std::array<FeatureChange, 2> Removed;
+        int NumAdded = 0;
+        int NumRemoved = 0;
+
+        auto Add(Piece p, Square s) noexcept -> void { Added[NumAdded++] = {p, s}; }
+        auto Remove(Piece p, Square s) noexcept -> void { Removed[NumRemoved++] = {p, s}; }
+    };
+
+    auto DeltaOfMove(const Position& pos, Move m) noexcept -> FeatureDelta {
+        const auto us = ~pos.SideToMove();
+        const auto from = m.From(), to = m.To();
+        auto delta = FeatureDelta{};
+        switch (m.Kind()) {
+            case Move::Castling: {
+                const auto king = MakePiece(us, King);
+                const auto rook = MakePiece(us, Rook);
+                const auto kingSide = FileOf(to) > FileOf(from);
+                const auto rookFrom = MakeSquare(kingSide ? 7 : 0, RankOf(from));
+                const auto rookTo = MakeSquare(kingSide ? 5 : 3, RankOf(from));
+                delta.Remove(king, from);
+                delta.Add(king, to);
+                delta.Remove(rook, rookFrom);
+                delta.Add(rook, rookTo);
+                break;
+            }
+            case Move::EnPassant: {
+                const auto pawn = MakePiece(us, Pawn);
+                delta.Remove(pawn, from);
+                delta.Add(pawn, to);
+                delta.Remove(MakePiece(~us, Pawn), MakeSquare(FileOf(to), RankOf(from)));
+                break;
+            }
+            case Move::Promotion:
+                delta.Remove(MakePiece(us, Pawn), from);
+                delta.Add(pos.PieceOn(to), to);
+                if (pos.CapturedPiece() != NoPiece) delta.Remove(pos.CapturedPiece(), to);
+                break;
+            case Move::Normal:
+                delta.Remove(pos.PieceOn(to), from);
+                delta.Add(pos.PieceOn(to), to);
+                if (pos.CapturedPiece() != NoPiece) delta.Remove(pos.CapturedPiece(), to);
+                break;
+        }
+        return delta;
+    }
+} // anonymous namespace
+
+
+namespace NEngine::NNnue {
+    auto SupportedSimd() noexcept -> std::span<const ESimd> {
+        return kSupportedSimd;
+    }
+
+    auto BestSimd() noexcept -> ESimd {
+        return kSupportedSimd.back();
+    }
+
+    auto Network::Load(std::span<const std::byte> file) -> std::variant<std::unique_ptr<Network>, GenericError> {
+        if (file.size() != NDefaultNet::kFileSize) {
+            return GenericError{
+                .Value = "expected " + std::to_string(NDefaultNet::kFileSize)
+                    + " bytes, got " + std::to_string(file.size()),
+                .ContextMessage = "Bad NNUE network file",
+            };
+        }
+        auto pos = size_t{0};
+        const auto read = [&]<std::integral I>(I& x) {
+            x = IntFromBytes<I>(file.subspan(pos).template first<sizeof(I)>());
+            pos += sizeof(I);
+        };
+        auto magic = uint32_t{}, version = uint32_t{}, architecture = uint32_t{};
+        read(magic);
+        read(version);
+        read(architecture);
+        if (magic != kMagic || version != kVersion || architecture != kArchitectureHash) {
+            return GenericError{
+                .Value = "unknown magic, version or architecture",
+                .ContextMessage = "Bad NNUE network file",
+            };
+        }
+
+        auto net = std::make_unique<Network>();
+        for (auto& b : net->FtBias) read(b);
+        for (auto& column : net->FtWeights) {
+            for (auto& w : column) read(w);
+        }
+        for (auto& column : net->PsqtWeights) {
+            for (auto& w : column) read(w);
+        }
+        for (auto& b : net->L1Bias) read(b);
+        for (auto& row : net->L1Weights) {
+            for (auto& w : row) read(w);
+        }
+        read(net->L2Bias);
+        for (auto& w : net->L2Weights) read(w);
+        return net;
+    }
+
+    auto Network::Default() -> const Network& {
+        static const auto net = []() {
+            auto netOrError = Load(NDefaultNet::kFile);
+            if (std::holds_alternative<GenericError>(netOrError)) {
+                LogErrorAndExit(std::get<GenericError>(netOrError));
+            }
+            return std::move(std::get<std::unique_ptr<Network>>(netOrError));
+        }();
+        return *net;
+    }
+
+    auto Refresh(const Network& net, const Position& pos, Accumulator& acc) noexcept -> void {
+        for (const auto perspective : {White, Black}) {
+            auto& values = acc.Values[perspective];
+            auto& psqt = acc.Psqt[perspective];
+            values = net.FtBias;
+            psqt = {};
+            auto pieces = pos.Pieces();
+            while (pieces) {
+                const auto s = PopLsb(pieces);
+                const auto f = FeatureIndex(perspective, pos.PieceOn(s), s);
+                for (auto i = 0; i < kHalfDimensions; ++i) values[i] += net.FtWeights[f][i];
+                for (auto b = 0; b < kNumBuckets; ++b) psqt[b] += net.PsqtWeights[f][b];
+            }
+        }
+    }
+
+    auto AccumulatorStack::Reset(const Position& pos) noexcept -> void {
+        Refresh(Net_, pos, Stack_[0]);
+        Size_ = 1;
+    }
+
+    auto AccumulatorStack::Push(const Position& pos, Move m) noexcept -> void {
+        const auto delta = DeltaOfMove(pos, m);
+        const auto& prev = Stack_[Size_ - 1];
+        auto& next = Stack_[Size_];
+        ++Size_;
+        for (const auto perspective : {White, Black}) {
+            auto values = prev.Values[perspective];
+            auto psqt = prev.Psqt[perspective];
+            for (auto k = 0; k < delta.NumRemoved; ++k) {
+                const auto f = FeatureIndex(perspective, delta.Removed[k].P, delta.Removed[k].S);
+                for (auto i = 0; i < kHalfDimensions; ++i) values[i] -= Net_.FtWeights[f][i];
+                for (auto b = 0; b < kNumBuckets; ++b) psqt[b] -= Net_.PsqtWeights[f][b];
+            }
+            for (auto k = 0; k < delta.NumAdded; ++k) {
+                const auto f = FeatureIndex(perspective, delta.Added[k].P, delta.Added[k].S);
+                for (auto i = 0; i < kHalfDimensions; ++i) values[i] += Net_.FtWeights[f][i];
+                for (auto b = 0; b < kNumBuckets; ++b) psqt[b] += Net_.PsqtWeights[f][b];
+            }
+            next.Values[perspective] = values;
+            next.Psqt[perspective] = psqt;
+        }
+    }
+
+    auto Evaluate(const Network& net, const Accumulator& acc, const Position& pos, const ESimd simd) noexcept
+      -> Score {
+        const auto stm = pos.SideToMove();
+        alignas(64) TransformedFeatures transformed;
+        auto positional = int32_t{0};
+        switch (simd) {
+#ifdef NNUE_X86
+            case ESimd::Avx2:
+                TransformAvx2(acc, stm, transformed.data());
+                positional = PropagateAvx2(net, transformed.data());
+                break;
+            case ESimd::Sse:
+                TransformSse(acc, stm, transformed.data());
+                positional = PropagateSse(net, transformed.data());
+                break;
+#endif
+#ifdef NNUE_NEON
+            case ESimd::Neon:
+                TransformNeon(acc, stm, transformed.data());
+                positional = PropagateNeon(net, transformed.data());
+                break;
+#endif
+            default:
+                TransformScalar(acc, stm, transformed.data());
+                positional = PropagateScalar(net, transformed.data());
+                break;
+        }
+        const auto bucket = BucketOfPhase(Phase(pos));
+        const auto psqt = acc.Psqt[stm][bucket] - acc.Psqt[~stm][bucket];
+        // Keeps an arbitrary network from producing mate scores
+        return std::clamp((psqt + positional) / kOutputDivisor, -kMateInMaxPly + 1, kMateInMaxPly - 1);
+    }
+} // namespace NEngine::NNnue
@@ -0,0 +1,159 @@
+#pragma once
+
+
+#include "evaluate.hpp"
+#include "psqt.hpp"
+
+#include "../chess/position.hpp"
+#include "../chess/types.hpp"
+#include "../utils/error.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <variant>
+
+
+/* An efficiently updatable neural network evaluation.
+ *
+ * Architecture, per perspective (white and black):
+ *   768 piece-square features -> 128 int16 accumulator + 8 int32 PSQT sums
+ * then, from the side to move's point of view:
+ *   [own 128, their 128] -> clipped ReLU (0..127) -> int8 256x32 -> clipped ReLU -> int8 32x1
+ * and the result is the layer stack output plus the PSQT difference
+ * of the bucket selected by the game phase.
+ *
+ * All arithmetic is integer, so every instruction set path
+ * computes exactly the same value.
+ */
+namespace NEngine::NNnue {
+    static constexpr auto kNumFeatures = 2 * NChess::kNumPieceTypes * NChess::kNumSquares;
+    static constexpr auto kHalfDimensions = 128;
+    static constexpr auto kL1Inputs = 2 * kHalfDimensions;
+    static constexpr auto kL1Outputs = 32;
+    static constexpr auto kNumBuckets = 8;
+    static constexpr auto kActivationMax = 127;
+    // The hidden layer output is scaled down by 2^kL1Shift before clipping
+    static constexpr auto kL1Shift = 6;
+    // The final layer output is in 1/kOutputDivisor centipawns
+    static constexpr auto kOutputDivisor = 16;
+
+    static constexpr auto kMagic = uint32_t{'N'} | uint32_t{'N'} << 8 | uint32_t{'U'} << 16 | uint32_t{'E'} << 24;
+    static constexpr auto kVersion = uint32_t{1};
+    // Changes whenever the layer sizes do, so that a network file
+    // for another architecture is rejected instead of misread
+    static constexpr auto kArchitectureHash = uint32_t(
+        kNumFeatures * 0x9E3779B1u ^ kHalfDimensions * 0x85EBCA77u ^ kL1Outputs * 0xC2B2AE3Du ^ kNumBuckets
+    );
+
+    // Output bucket of a position with the given game phase (see `NPsqt::kPhaseWeight`)
+    constexpr auto BucketOfPhase(int phase) noexcept -> int {
+        return std::min(phase, NPsqt::kMaxPhase) * kNumBuckets / (NPsqt::kMaxPhase + 1);
+    }
+
+    // Index of the feature of piece `p` on square `s` as seen by `perspective`:
+    // own pieces first, squares flipped for black so both sides look "up"
+    constexpr auto FeatureIndex(NChess::Color perspective, NChess::Piece p, NChess::Square s) noexcept -> int {
+        const auto relative = perspective == NChess::White ? s : NChess::FlipRank(s);
+        const auto theirs = NChess::ColorOf(p) != perspective;
+        return (theirs * NChess::kNumPieceTypes + NChess::TypeOf(p)) * NChess::kNumSquares + relative;
+    }
+
+    enum class ESimd {
+        Scalar,
+        Sse,
+        Avx2,
+        Neon,
+    };
+
+    // The paths this CPU can run, from the slowest (scalar) to the fastest
+    [[nodiscard]] auto SupportedSimd() noexcept -> std::span<const ESimd>;
+    [[nodiscard]] auto BestSimd() noexcept -> ESimd;
+
+    struct alignas(64) Network {
+        // Indexed by [feature][neuron]: a feature's column is contiguous,
+        // which is what the accumulator updates add and subtract
+        std::array<int16_t, kHalfDimensions> FtBias;
+        std::array<std::array<int16_t, kHalfDimensions>, kNumFeatures> FtWeights;
+        std::array<std::array<int32_t, kNumBuckets>, kNumFeatures> PsqtWeights;
+        std::array<int32_t, kL1Outputs> L1Bias;
+        // Indexed by [output][input]
+        alignas(64) std::array<std::array<int8_t, kL1Inputs>, kL1Outputs> L1Weights;
+        int32_t L2Bias;
+        alignas(64) std::array<int8_t, kL1Outputs> L2Weights;
+
+        /* File format, all integers little-endian:
+         *   "NNUE" magic, uint32 version, uint32 architecture hash,
+         *   then every array above in declaration order.
+         */
+        [[nodiscard]] static auto Load(std::span<const std::byte> file)
+          -> std::variant<std::unique_ptr<Network>, GenericError>;
+        // The network embedded in the binary, parsed on first use
+        [[nodiscard]] static auto Default() -> const Network&;
+    };
+
+    struct alignas(64) Accumulator {
+        // Indexed by perspective
+        std::array<std::array<int16_t, kHalfDimensions>, 2> Values;
+        std::array<std::array<int32_t, kNumBuckets>, 2> Psqt;
+    };
+
+    /* Accumulators of the positions along the current search path. The
+     * owner calls `Push` after every `Position::MakeMove` and `Pop` after
+     * every `UnmakeMove`: a move changes at most four features per
+     * perspective, so a push costs a few vector additions instead of a
+     * full refresh.
+     */
+    class AccumulatorStack {
+    private:
+        const Network& Net_;
+        std::array<Accumulator, NChess::kMaxPly + 1> Stack_;
+        int Size_ = 0;
+    public:
+        explicit AccumulatorStack(const Network& net) noexcept
+            : Net_(net)
+        {
+        }
+
+        // Computes the accumulator of `pos` from scratch as the only element
+        auto Reset(const NChess::Position& pos) noexcept -> void;
+        // `pos` is the position right after `m` was made
+        auto Push(const NChess::Position& pos, NChess::Move m) noexcept -> void;
+        auto PushNull() noexcept -> void { Stack_[Size_] = Stack_[Size_ - 1]; ++Size_; }
+        auto Pop() noexcept -> void { --Size_; }
+        [[nodiscard]] auto Top() const noexcept -> const Accumulator& { return Stack_[Size_ - 1]; }
+        [[nodiscard]] auto GetNetwork() const noexcept -> const Network& { return Net_; }
+    };
+
+    // Computes the accumulator of `pos` from scratch
+    auto Refresh(const Network& net, const NChess::Position& pos, Accumulator& acc) noexcept -> void;
+
+    [[nodiscard]] auto Evaluate(
+        const Network& net,
+        const Accumulator& acc,
+        const NChess::Position& pos,
+        ESimd simd = BestSimd()
+    ) noexcept -> Score;
+
+    template <class OStream>
+    inline auto operator<<(OStream&& out, ESimd simd) -> OStream&& {
+        switch (simd) {
+            case ESimd::Scalar:
+                out << "scalar";
+                break;
+            case ESimd::Sse:
+                out << "SSSE3";
+                break;
+            case ESimd::Avx2:
+                out << "AVX2";
+                break;
+            case ESimd::Neon:
+                out << "NEON";
+                break;
+        }
+        return std::forward<OStream>(out);
+    }
+} // namespace NEngine::NNnue
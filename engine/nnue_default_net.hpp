@@ -0,0 +1,104 @@
+#pragma once
+
+
+#include "nnue.hpp"
+#include "psqt.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+
+/* The network embedded in the binary, in the same file format that
+ * `Network::Load()` reads, generated at compile time.
+ *
+ * It is not trained: its PSQT weights reproduce the piece-square tables of
+ * the hand-crafted evaluation, tapered at the midpoint of each phase bucket,
+ * and its layer stack encodes the bishop pair bonus and the tempo, so it
+ * plays like `Evaluate()` while exercising the whole inference path.
+ * A trained network in the same format replaces it through `Network::Load()`.
+ */
+namespace NEngine::NNnue::NDefaultNet {
+    static constexpr auto kFileSize = size_t{12}
+        + sizeof(Network::FtBias)
+        + sizeof(Network::FtWeights)
+        + sizeof(Network::PsqtWeights)
+        + sizeof(Network::L1Bias)
+        + sizeof(Network::L1Weights)
+        + sizeof(Network::L2Bias)
+        + sizeof(Network::L2Weights);
+
+    // Value of the bishop pair neuron when the pair is present
+    static constexpr auto kPairActivation = 120;
+    static constexpr auto kPairL1Weight = 64;
+
+    constexpr auto MakeFile() -> std::array<std::byte, kFileSize> {
+        using namespace NChess;
+        using namespace NPsqt;
+
+        auto file = std::array<std::byte, kFileSize>{};
+        auto pos = size_t{0};
+        const auto put = [&](uint64_t value, size_t size) {
+            for (auto i = size_t{0}; i < size; ++i) {
+                file[pos++] = std::byte(value >> (8 * i));
+            }
+        };
+
+        put(kMagic, 4);
+        put(kVersion, 4);
+        put(kArchitectureHash, 4);
+
+        // Feature transformer: only neuron 0 is used, as "own bishop pair"
+        for (auto n = 0; n < kHalfDimensions; ++n) {
+            put(uint16_t(n == 0 ? -kPairActivation : 0), 2);
+        }
+        for (auto f = 0; f < kNumFeatures; ++f) {
+            const auto ownBishop = f / kNumSquares == Bishop;
+            for (auto n = 0; n < kHalfDimensions; ++n) {
+                put(uint16_t(n == 0 && ownBishop ? kPairActivation : 0), 2);
+            }
+        }
+
+        // PSQT weights of own pieces, in 1/kOutputDivisor centipawns;
+        // the pieces of the other side are counted by the other perspective
+        for (auto f = 0; f < kNumFeatures; ++f) {
+            const auto theirs = f >= kNumFeatures / 2;
+            const auto pt = PieceType(f / kNumSquares % kNumPieceTypes);
+            const auto s = Square(f % kNumSquares);
+            for (auto b = 0; b < kNumBuckets; ++b) {
+                auto lo = 0;
+                while (BucketOfPhase(lo) != b) ++lo;
+                auto hi = lo;
+                while (hi < kMaxPhase && BucketOfPhase(hi + 1) == b) ++hi;
+                // Tapered at phase (lo + hi) / 2
+                const auto mg = kMaterialValue[pt] + MgValue(pt, s);
+                const auto eg = kMaterialValue[pt] + EgValue(pt, s);
+                const auto twicePhase = lo + hi;
+                const auto value = (mg * twicePhase + eg * (2 * kMaxPhase - twicePhase)) * kOutputDivisor;
+                const auto rounded = (value + (value >= 0 ? kMaxPhase : -kMaxPhase)) / (2 * kMaxPhase);
+                put(uint32_t(theirs ? 0 : rounded), 4);
+            }
+        }
+
+        // Hidden layer: neuron 0 passes our bishop pair, neuron 1 theirs
+        for (auto o = 0; o < kL1Outputs; ++o) {
+            put(0, 4);
+        }
+        for (auto o = 0; o < kL1Outputs; ++o) {
+            for (auto i = 0; i < kL1Inputs; ++i) {
+                const auto used = (o == 0 && i == 0) || (o == 1 && i == kHalfDimensions);
+                put(uint8_t(used ? kPairL1Weight : 0), 1);
+            }
+        }
+
+        // Output: tempo, plus our bishop pair minus theirs
+        put(uint32_t(kTempo * kOutputDivisor), 4);
+        const auto pairWeight = kBishopPair * kOutputDivisor / kPairActivation;
+        for (auto o = 0; o < kL1Outputs; ++o) {
+            put(uint8_t(o == 0 ? pairWeight : o == 1 ? -pairWeight : 0), 1);
+        }
+        return file;
+    }
+
+    inline constexpr auto kFile = MakeFile();
+} // namespace NEngine::NNnue::NDefaultNet
@@ -0,0 +1,144 @@
+#include "polyglot_book.hpp"
+#include "polyglot_randoms.hpp"
+
+#include "../chess/movegen.hpp"
+
+#include <array>
+
+
+namespace {
+    using namespace NChess;
+    using namespace NEngine;
+
+    static constexpr auto kCastlingOffset = 768;
+    static constexpr auto kEnPassantOffset = 772;
+    static constexpr auto kTurnOffset = 780;
+    static constexpr auto kCastlingOrder = std::array<CastlingRights, 4>{
+        WhiteKingSide, WhiteQueenSide, BlackKingSide, BlackQueenSide,
+    };
+
+    auto ReadBigEndian64(const std::byte* p) noexcept -> uint64_t {
+        auto x = uint64_t{0};
+        for (auto i = 0; i < 8; ++i) x = x << 8 | uint64_t(p[i]);
+        return x;
+    }
+
+    auto ReadBigEndian16(const std::byte* p) noexcept -> uint16_t {
+        return uint16_t(uint16_t(p[0]) << 8 | uint16_t(p[1]));
+    }
+
+    auto ReadBigEndian32(const std::byte* p) noexcept -> uint32_t {
+        return uint32_t(ReadBigEndian16(p)) << 16 | ReadBigEndian16(p + 2);
+    }
+} // anonymous namespace
+
+
+namespace NEngine {
+    auto PolyglotKey(const Position& pos) noexcept -> uint64_t {
+        auto key = uint64_t{0};
+        auto pieces = pos.Pieces();
+        while (pieces) {
+            const auto s = PopLsb(pieces);
+            const auto p = pos.PieceOn(s);
+            const auto kind = 2 * TypeOf(p) + (ColorOf(p) == White);
+            key ^= kPolyglotRandoms[64 * kind + s];
+        }
+        const auto castling = pos.Castling();
+        for (auto i = 0; i < int(kCastlingOrder.size()); ++i) {
+            if (castling & kCastlingOrder[i]) key ^= kPolyglotRandoms[kCastlingOffset + i];
+        }
+        // `Position` keeps the en passant square only if a pawn
+        // can capture on it, which is the Polyglot condition too
+        if (pos.EnPassantSquare() != NoSquare) {
+            key ^= kPolyglotRandoms[kEnPassantOffset + FileOf(pos.EnPassantSquare())];
+        }
+        if (pos.SideToMove() == White) key ^= kPolyglotRandoms[kTurnOffset];
+        return key;
+    }
+
+    auto MoveFromPolyglot(const Position& pos, const uint16_t rawMove) noexcept -> std::optional<Move> {
+        const auto to = MakeSquare(rawMove & 7, (rawMove >> 3) & 7);
+        const auto from = MakeSquare((rawMove >> 6) & 7, (rawMove >> 9) & 7);
+        const auto promotion = (rawMove >> 12) & 7;
+
+        auto list = MoveList{};
+        GenerateLegal(pos, list);
+        for (const auto m : list) {
+            if (m.From() != from) continue;
+            if (m.Kind() == Move::Castling) {
+                // Our castling moves are king moves by two squares
+                const auto rookFile = FileOf(m.To()) > FileOf(from) ? 7 : 0;
+                if (to == MakeSquare(rookFile, RankOf(from))) return m;
+            } else if (m.To() == to) {
+                const auto isPromotion = m.Kind() == Move::Promotion;
+                if (!isPromotion && promotion == 0) return m;
+                if (isPromotion && promotion != 0 && m.PromotionType() == PieceType(Pawn + promotion)) return m;
+            }
+        }
+        return std::nullopt;
+    }
+
+    auto PolyglotBook::EntryRange::operator[](const size_t i) const noexcept -> Entry {
+        const auto* p = Bytes_.data() + i * kEntrySize;
+        return Entry{
+            .Key = ReadBigEndian64(p),
+            .RawMove = ReadBigEndian16(p + 8),
+            .Weight = ReadBigEndian16(p + 10),
+            .Learn = ReadBigEndian32(p + 12),
+        };
+    }
+
+    PolyglotBook::PolyglotBook(MappedFile file) noexcept
+        : File_(std::move(file))
+    {
+    }
+
+    auto PolyglotBook::Open(const std::string& path) noexcept
+      -> std::variant<PolyglotBook, SystemError, GenericError> {
+        // Lookups jump around the file, so read-ahead would be wasted
+        auto fileOrError = MappedFile::OpenReadOnly(path, MappedFile::EAccessPattern::Random);
+        if (std::holds_alternative<SystemError>(fileOrError)) {
+            return std::get<SystemError>(std::move(fileOrError));
+        }
+        auto& file = std::get<MappedFile>(fileOrError);
+        if (file.GetData().size() % kEntrySize != 0) {
+            return GenericError{
+                .Value = "size " + std::to_string(file.GetData().size()) + " is not a multiple of 16",
+                .ContextMessage = "Bad Polyglot book \"" + path + "\"",
+            };
+        }
+        return PolyglotBook{std::move(file)};
+    }
+
+    auto PolyglotBook::Find(const uint64_t key) const noexcept -> EntryRange {
+        const auto* data = File_.GetData().data();
+        const auto keyAt = [data](size_t i) { return ReadBigEndian64(data + i * kEntrySize); };
+        // Lower and upper bound of `key`
+        auto lo = size_t{0}, hi = GetNumEntries();
+        while (lo < hi) {
+            const auto mid = lo + (hi - lo) / 2;
+            if (keyAt(mid) < key) lo = mid + 1;
+            else hi = mid;
+        }
+        auto end = lo;
+        while (end < GetNumEntries() && keyAt(end) == key) ++end;
+        return EntryRange{File_.GetData().subspan(lo * kEntrySize, (end - lo) * kEntrySize)};
+    }
+
+    auto PolyglotBook::PickWeighted(const Position& pos, const uint64_t key, const uint64_t random) const noexcept
+      -> std::optional<Move> {
+        const auto entries = Find(key);
+        auto totalWeight = uint64_t{0};
+        for (auto i = size_t{0}; i < entries.Size(); ++i) {
+            totalWeight += entries[i].Weight;
+        }
+        if (totalWeight == 0) return std::nullopt;
+        auto r = random % totalWeight;
+        for (auto i = size_t{0}; i < entries.Size(); ++i) {
+            const auto entry = entries[i];
+            if (r < entry.Weight) return MoveFromPolyglot(pos, entry.RawMove);
+            r -= entry.Weight;
+        }
+        return std::nullopt;
+    }
+} // namespace NEngine
@@ -0,0 +1,79 @@
+#pragma once
+
+
+#include "../chess/position.hpp"
+#include "../chess/types.hpp"
+#include "../utils/error.hpp"
+#include "../utils/mapped_file/mapped_file.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <variant>
+
+
+namespace NEngine {
+    // Polyglot hash of `pos`, by which the books made by other tools are keyed
+    [[nodiscard]] auto PolyglotKey(const NChess::Position& pos) noexcept -> uint64_t;
+
+    /* A Polyglot `.bin` opening book: 16-byte big-endian records
+     * `(key u64, move u16, weight u16, learn u32)` sorted by key.
+     *
+     * The file is memory-mapped and never parsed: opening is O(1), a lookup
+     * is a binary search touching O(log n) pages, and processes using the
+     * same book share its pages through the page cache.
+     */
+    class PolyglotBook {
+    public:
+        static constexpr auto kEntrySize = size_t{16};
+
+        struct Entry {
+            uint64_t Key;
+            // Polyglot encoding: to file, to rank, from file, from rank,
+            // promotion piece (0 none, 1 knight ... 4 queen), 3 bits each
+            uint16_t RawMove;
+            uint16_t Weight;
+            uint32_t Learn;
+        };
+
+        // The entries of one key, decoded on access
+        class EntryRange {
+        private:
+            std::span<const std::byte> Bytes_;
+        public:
+            explicit EntryRange(std::span<const std::byte> bytes) noexcept
+                : Bytes_(bytes)
+            {
+            }
+            [[nodiscard]] auto Size() const noexcept -> size_t { return Bytes_.size() / kEntrySize; }
+            [[nodiscard]] auto Empty() const noexcept -> bool { return Bytes_.empty(); }
+            [[nodiscard]] auto operator[](size_t i) const noexcept -> Entry;
+        };
+    private:
+        MappedFile File_;
+    private:
+        explicit PolyglotBook(MappedFile file) noexcept;
+    public:
+        [[nodiscard]] static auto Open(const std::string& path) noexcept
+          -> std::variant<PolyglotBook, SystemError, GenericError>;
+
+        [[nodiscard]] auto GetNumEntries() const noexcept -> size_t {
+            return File_.GetData().size() / kEntrySize;
+        }
+        [[nodiscard]] auto Find(uint64_t key) const noexcept -> EntryRange;
+
+        /* Picks one of the book moves of `pos` with probability proportional
+         * to its weight, `random` being a uniformly distributed number.
+         * Returns nothing if `pos` is not in the book or no book move is
+         * legal in it (which means the key collided).
+         */
+        [[nodiscard]] auto PickWeighted(const NChess::Position& pos, uint64_t key, uint64_t random) const noexcept
+          -> std::optional<NChess::Move>;
+    };
+
+    // Converts a Polyglot move to the legal move of `pos` it denotes, if any.
+    // Polyglot writes castling as "king takes own rook", e.g. e1h1
+    [[nodiscard]] auto MoveFromPolyglot(const NChess::Position& pos, uint16_t rawMove) noexcept
+      -> std::optional<NChess::Move>;
+} // namespace NEngine
@@ -0,0 +1,117 @@
+#pragma once
+
+
+#include "../chess/types.hpp"
+
+#include <array>
+
+
+// The tables of the hand-crafted evaluation. Shared with the generator
+// of the default NNUE network, which reproduces them in its PSQT weights
+namespace NEngine::NPsqt {
+    using namespace NChess;
+    using Table = std::array<int, kNumSquares>;
+
+    // Piece-square tables from white's point of view, laid out the
+    // way a board is printed: the first row is the eighth rank
+    inline constexpr auto kPawnMg = Table{
+          0,   0,   0,   0,   0,   0,   0,   0,
+         50,  50,  50,  50,  50,  50,  50,  50,
+         10,  10,  20,  30,  30,  20,  10,  10,
+          5,   5,  10,  25,  25,  10,   5,   5,
+          0,   0,   0,  20,  20,   0,   0,   0,
+          5,  -5, -10,   0,   0, -10,  -5,   5,
+          5,  10,  10, -20, -20,  10,  10,   5,
+          0,   0,   0,   0,   0,   0,   0,   0,
+    };
+    inline constexpr auto kPawnEg = Table{
+          0,   0,   0,   0,   0,   0,   0,   0,
+         90,  90,  85,  80,  80,  85,  90,  90,
+         55,  55,  50,  45,  45,  50,  55,  55,
+         30,  30,  25,  20,  20,  25,  30,  30,
+         15,  15,  10,  10,  10,  10,  15,  15,
+          5,   5,   5,   5,   5,   5,   5,   5,
+          0,   0,   0,   0,   0,   0,   0,   0,
+          0,   0,   0,   0,   0,   0,   0,   0,
+    };
+    inline constexpr auto kKnight = Table{
+        -50, -40, -30, -30, -30, -30, -40, -50,
+        -40, -20,   0,   0,   0,   0, -20, -40,
+        -30,   0,  10,  15,  15,  10,   0, -30,
+        -30,   5,  15,  20,  20,  15,   5, -30,
+        -30,   0,  15,  20,  20,  15,   0, -30,
+        -30,   5,  10,  15,  15,  10,   5, -30,
+        -40, -20,   0,   5,   5,   0, -20, -40,
+        -50, -40, -30, -30, -30, -30, -40, -50,
+    };
+    inline constexpr auto kBishop = Table{
+        -20, -10, -10, -10, -10, -10, -10, -20,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -10,   0,   5,  10,  10,   5,   0, -10,
+        -10,   5,   5,  10,  10,   5,   5, -10,
+        -10,   0,  10,  10,  10,  10,   0, -10,
+        -10,  10,  10,  10,  10,  10,  10, -10,
+        -10,   5,   0,   0,   0,   0,   5, -10,
+        -20, -10, -10, -10, -10, -10, -10, -20,
+    };
+    inline constexpr auto kRook = Table{
+          0,   0,   0,   0,   0,   0,   0,   0,
+          5,  10,  10,  10,  10,  10,  10,   5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+          0,   0,   0,   5,   5,   0,   0,   0,
+    };
+    inline constexpr auto kQueen = Table{
+        -20, -10, -10,  -5,  -5, -10, -10, -20,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -10,   0,   5,   5,   5,   5,   0, -10,
+         -5,   0,   5,   5,   5,   5,   0,  -5,
+          0,   0,   5,   5,   5,   5,   0,  -5,
+        -10,   5,   5,   5,   5,   5,   0, -10,
+        -10,   0,   5,   0,   0,   0,   0, -10,
+        -20, -10, -10,  -5,  -5, -10, -10, -20,
+    };
+    inline constexpr auto kKingMg = Table{
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -20, -30, -30, -40, -40, -30, -30, -20,
+        -10, -20, -20, -20, -20, -20, -20, -10,
+         20,  20,   0,   0,   0,   0,  20,  20,
+         20,  30,  10,   0,   0,  10,  30,  20,
+    };
+    inline constexpr auto kKingEg = Table{
+        -50, -40, -30, -20, -20, -30, -40, -50,
+        -30, -20, -10,   0,   0, -10, -20, -30,
+        -30, -10,  20,  30,  30,  20, -10, -30,
+        -30, -10,  30,  40,  40,  30, -10, -30,
+        -30, -10,  30,  40,  40,  30, -10, -30,
+        -30, -10,  20,  30,  30,  20, -10, -30,
+        -30, -30,   0,   0,   0,   0, -30, -30,
+        -50, -30, -30, -30, -30, -30, -30, -50,
+    };
+
+    inline constexpr auto kMgTables = std::array<const Table*, kNumPieceTypes>{
+        &kPawnMg, &kKnight, &kBishop, &kRook, &kQueen, &kKingMg,
+    };
+    inline constexpr auto kEgTables = std::array<const Table*, kNumPieceTypes>{
+        &kPawnEg, &kKnight, &kBishop, &kRook, &kQueen, &kKingEg,
+    };
+    inline constexpr auto kPhaseWeight = std::array<int, kNumPieceTypes>{0, 1, 1, 2, 4, 0};
+    inline constexpr auto kMaxPhase = 24;
+    inline constexpr auto kTempo = 10;
+    inline constexpr auto kBishopPair = 30;
+
+    // Tables are written from white's point of view with the eighth rank
+    // first, so `relativeSquare` is the square from the owner's side
+    constexpr auto MgValue(PieceType pt, Square relativeSquare) noexcept -> int {
+        return (*kMgTables[pt])[FlipRank(relativeSquare)];
+    }
+    constexpr auto EgValue(PieceType pt, Square relativeSquare) noexcept -> int {
+        return (*kEgTables[pt])[FlipRank(relativeSquare)];
+    }
+} // namespace NEngine::NPsqt
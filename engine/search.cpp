@@ -0,0 +1,430 @@
+#include "search.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+    using namespace NChess;
+    using namespace NEngine;
+    using Clock = std::chrono::steady_clock;
+
+    // Reductions[depth][moveNumber] for late-move reductions
+    static const auto kReductions = []() {
+        auto table = std::array<std::array<int8_t, kMaxMoves>, kMaxPly>{};
+        for (auto d = 1; d < kMaxPly; ++d) {
+            for (auto m = 1; m < kMaxMoves; ++m) {
+                table[d][m] = int8_t(0.75 + std::log(d) * std::log(m) / 2.25);
+            }
+        }
+        return table;
+    }();
+
+    static constexpr auto kHistoryMax = 16384;
+    static constexpr auto kCheckLimitsEveryNodes = 2047;
+
+    // Ordering buckets, highest first
+    static constexpr auto kHashMoveScore = 1 << 30;
+    static constexpr auto kGoodNoisyScore = 1 << 28;
+    static constexpr auto kFirstKillerScore = 1 << 27;
+    static constexpr auto kSecondKillerScore = kFirstKillerScore - 1;
+
+    // Most valuable victim, least valuable attacker
+    auto MvvLva(const Position& pos, Move m) noexcept -> int {
+        const auto victim = m.Kind() == Move::EnPassant ? Pawn : TypeOf(pos.PieceOn(m.To()));
+        const auto attacker = TypeOf(pos.PieceOn(m.From()));
+        auto score = (victim == NoPieceType ? 0 : 16 * kMaterialValue[victim]) - attacker;
+        if (m.Kind() == Move::Promotion) score += 16 * kMaterialValue[m.PromotionType()];
+        return score;
+    }
+
+    // Picks the best remaining move (selection sort step): moves
+    // after a beta cutoff are never sorted, which is the common case
+    auto PickNext(MoveList& list, std::span<int> scores, int from) noexcept -> Move {
+        auto best = from;
+        for (auto i = from + 1; i < list.Size; ++i) {
+            if (scores[i] > scores[best]) best = i;
+        }
+        std::swap(list.Moves[from], list.Moves[best]);
+        std::swap(scores[from], scores[best]);
+        return list.Moves[from];
+    }
+
+    // Lazy SMP helper threads skip some iterations so that at any moment
+    // the group works on several different depths: the threads then
+    // diverge, and the shallower ones fill the transposition table with
+    // results the deeper ones reuse. The pattern repeats every 20 threads
+    static constexpr auto kSkipSize = std::array<int, 20>{1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+    static constexpr auto kSkipPhase = std::array<int, 20>{0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+    auto SkipDepth(int threadIndex, int depth) noexcept -> bool {
+        if (threadIndex == 0) return false;
+        const auto i = (threadIndex - 1) % int(kSkipSize.size());
+        return (depth + kSkipPhase[i]) / kSkipSize[i] % 2 == 1;
+    }
+
+    // Whether a stored score proves that the node fails high or fails low
+    auto BoundAllowsCutoff(const TTHit& tt, Score value, Score beta) noexcept -> bool {
+        return tt.Bound == EBound::Exact
+            || (tt.Bound == EBound::Lower && value >= beta)
+            || (tt.Bound == EBound::Upper && value < beta);
+    }
+
+    auto UpdateHistory(int& entry, int bonus) noexcept -> void {
+        // "Gravity": keeps the entry within [-kHistoryMax, kHistoryMax]
+        entry += bonus - entry * std::abs(bonus) / kHistoryMax;
+    }
+} // anonymous namespace
+
+
+namespace NEngine {
+    auto Searcher::Clear() noexcept -> void {
+        Killers_ = {};
+        History_ = {};
+    }
+
+    auto Searcher::MakeMove(Position& pos, Move m) noexcept -> void {
+        pos.MakeMove(m);
+        // Started first, so that the memory access overlaps the accumulator update
+        TT_.Prefetch(pos.Key());
+        Accumulators_.Push(pos, m);
+    }
+
+    auto Searcher::UnmakeMove(Position& pos, Move m) noexcept -> void {
+        pos.UnmakeMove(m);
+        Accumulators_.Pop();
+    }
+
+    auto Searcher::MakeNullMove(Position& pos) noexcept -> void {
+        pos.MakeNullMove();
+        TT_.Prefetch(pos.Key());
+        Accumulators_.PushNull();
+    }
+
+    auto Searcher::UnmakeNullMove(Position& pos) noexcept -> void {
+        pos.UnmakeNullMove();
+        Accumulators_.Pop();
+    }
+
+    auto Searcher::Evaluate(const Position& pos) const noexcept -> Score {
+        return NNnue::Evaluate(Accumulators_.GetNetwork(), Accumulators_.Top(), pos);
+    }
+
+    auto Searcher::CheckLimits() noexcept -> void {
+        if ((MaxNodes_ && Nodes_ >= MaxNodes_) || Clock::now() >= Deadline_) {
+            Stopped_ = true;
+        }
+        if (StopSignal_ && StopSignal_->load(std::memory_order_relaxed)) {
+            Stopped_ = true;
+        }
+    }
+
+    auto Searcher::ScoreMoves(
+        const Position& pos,
+        const MoveList& list,
+        std::span<int> scores,
+        Move hashMove,
+        int ply
+    ) const noexcept -> void {
+        const auto us = pos.SideToMove();
+        for (auto i = 0; i < list.Size; ++i) {
+            const auto m = list.Moves[i];
+            if (m == hashMove) {
+                scores[i] = kHashMoveScore;
+            } else if (pos.IsCapture(m) || m.Kind() == Move::Promotion) {
+                scores[i] = kGoodNoisyScore + MvvLva(pos, m);
+            } else if (m == Killers_[ply][0]) {
+                scores[i] = kFirstKillerScore;
+            } else if (m == Killers_[ply][1]) {
+                scores[i] = kSecondKillerScore;
+            } else {
+                scores[i] = History_[us][m.From()][m.To()];
+            }
+        }
+    }
+
+    auto Searcher::UpdateQuietStats(
+        const Position& pos,
+        Move best,
+        std::span<const Move> triedQuiets,
+        int depth,
+        int ply
+    ) noexcept -> void {
+        if (Killers_[ply][0] != best) {
+            Killers_[ply][1] = Killers_[ply][0];
+            Killers_[ply][0] = best;
+        }
+        const auto us = pos.SideToMove();
+        const auto bonus = std::min(depth * depth, 400);
+        UpdateHistory(History_[us][best.From()][best.To()], 32 * bonus);
+        for (const auto m : triedQuiets) {
+            if (m != best) UpdateHistory(History_[us][m.From()][m.To()], -32 * bonus);
+        }
+    }
+
+    auto Searcher::QSearch(Position& pos, Score alpha, Score beta, int ply) -> Score {
+        if ((++Nodes_ & kCheckLimitsEveryNodes) == 0) CheckLimits();
+        if (Stopped_) return 0;
+        if (pos.IsDraw()) return 0;
+
+        const auto inCheck = pos.InCheck();
+        if (ply >= kMaxPly - 1) return inCheck ? 0 : Evaluate(pos);
+
+        const auto pvNode = beta - alpha > 1;
+        const auto originalAlpha = alpha;
+        const auto tt = TT_.Probe(pos.Key());
+        if (tt && !pvNode && BoundAllowsCutoff(*tt, ScoreFromTT(tt->Value, ply), beta)) {
+            return ScoreFromTT(tt->Value, ply);
+        }
+        const auto ttMove = tt && pos.IsPseudoLegal(tt->BestMove) ? tt->BestMove : Move::None();
+
+        auto best = -kInfinite;
+        auto staticEval = -kInfinite;
+        if (!inCheck) {
+            // Stand pat: the side to move can usually do at least as well as
+            // the static evaluation by playing some quiet move
+            staticEval = tt ? tt->StaticEval : Evaluate(pos);
+            best = staticEval;
+            if (best >= beta) return best;
+            alpha = std::max(alpha, best);
+        }
+
+        auto list = MoveList{};
+        // In check all evasions have to be searched to detect mates
+        if (inCheck) GeneratePseudoLegal<EGenType::All>(pos, list);
+        else GeneratePseudoLegal<EGenType::Noisy>(pos, list);
+        std::array<int, kMaxMoves> scores;
+        ScoreMoves(pos, list, scores, ttMove, ply);
+
+        auto legalMoves = 0;
+        auto bestMove = Move::None();
+        for (auto i = 0; i < list.Size; ++i) {
+            const auto m = PickNext(list, scores, i);
+            if (!pos.IsLegal(m)) continue;
+            ++legalMoves;
+            MakeMove(pos, m);
+            const auto score = -QSearch(pos, -beta, -alpha, ply + 1);
+            UnmakeMove(pos, m);
+            if (Stopped_) return 0;
+            if (score > best) {
+                best = score;
+                if (score > alpha) {
+                    alpha = score;
+                    bestMove = m;
+                    if (alpha >= beta) break;
+                }
+            }
+        }
+        if (inCheck && legalMoves == 0) return -kMate + ply;
+
+        const auto bound = best >= beta ? EBound::Lower : best > originalAlpha ? EBound::Exact : EBound::Upper;
+        TT_.Store(pos.Key(), bestMove, ScoreToTT(best, ply), staticEval, 0, bound);
+        return best;
+    }
+
+    auto Searcher::Negamax(
+        Position& pos,
+        Score alpha,
+        Score beta,
+        int depth,
+        const int ply,
+        const bool nullAllowed
+    ) -> Score {
+        Pv_[ply].Length = 0;
+        const auto inCheck = pos.InCheck();
+        if (depth <= 0 && !inCheck) return QSearch(pos, alpha, beta, ply);
+        depth = std::max(depth, 1);
+
+        if ((++Nodes_ & kCheckLimitsEveryNodes) == 0) CheckLimits();
+        if (Stopped_) return 0;
+
+        const auto pvNode = beta - alpha > 1;
+        const auto rootNode = ply == 0;
+        if (!rootNode) {
+            if (pos.IsDraw()) return 0;
+            if (ply >= kMaxPly - 1) return inCheck ? 0 : Evaluate(pos);
+            // Mate distance pruning: no score can be better than
+            // mating right now or worse than being mated right now
+            alpha = std::max(alpha, -kMate + ply);
+            beta = std::min(beta, kMate - ply - 1);
+            if (alpha >= beta) return alpha;
+        }
+
+        const auto originalAlpha = alpha;
+        const auto tt = TT_.Probe(pos.Key());
+        if (tt && !pvNode && tt->Depth >= depth && BoundAllowsCutoff(*tt, ScoreFromTT(tt->Value, ply), beta)) {
+            return ScoreFromTT(tt->Value, ply);
+        }
+        // The move may come from a position with a colliding key
+        const auto ttMove = tt && pos.IsPseudoLegal(tt->BestMove) ? tt->BestMove : Move::None();
+
+        const auto staticEval = inCheck ? -kInfinite : tt ? tt->StaticEval : Evaluate(pos);
+        const auto us = pos.SideToMove();
+
+        if (!pvNode && !inCheck) {
+            // Reverse futility pruning
+            if (depth <= 6 && staticEval - 80 * depth >= beta && std::abs(beta) < kMateInMaxPly) {
+                return staticEval;
+            }
+            // Null-move pruning: if passing still fails high, a real move
+            // will almost certainly fail high too. Disabled without
+            // non-pawn material because of zugzwang
+            if (nullAllowed && depth >= 3 && staticEval >= beta && pos.HasNonPawnMaterial(us)) {
+                const auto r = 3 + depth / 4 + std::min((staticEval - beta) / 200, 3);
+                MakeNullMove(pos);
+                auto score = -Negamax(pos, -beta, -beta + 1, depth - 1 - r, ply + 1, false);
+                UnmakeNullMove(pos);
+                if (Stopped_) return 0;
+                if (score >= beta) return score >= kMateInMaxPly ? beta : score;
+            }
+        }
+
+        auto list = MoveList{};
+        GeneratePseudoLegal<EGenType::All>(pos, list);
+        std::array<int, kMaxMoves> scores;
+        ScoreMoves(pos, list, scores, rootNode && RootBestMove_ ? RootBestMove_ : ttMove, ply);
+
+        auto best = -kInfinite;
+        auto bestMove = Move::None();
+        auto legalMoves = 0;
+        std::array<Move, kMaxMoves> triedQuiets;
+        auto numTriedQuiets = 0;
+
+        for (auto i = 0; i < list.Size; ++i) {
+            const auto m = PickNext(list, scores, i);
+            if (!pos.IsLegal(m)) continue;
+            ++legalMoves;
+            const auto quiet = !pos.IsCapture(m) && m.Kind() != Move::Promotion;
+
+            // Late-move pruning of quiet moves close to the horizon
+            if (!pvNode && !inCheck && quiet && best > -kMateInMaxPly
+                && depth <= 3 && legalMoves > 3 + depth * depth) {
+                continue;
+            }
+
+            MakeMove(pos, m);
+            const auto givesCheck = pos.InCheck();
+            // Check extension
+            const auto newDepth = depth - 1 + (givesCheck ? 1 : 0);
+
+            auto score = Score{0};
+            if (legalMoves == 1) {
+                score = -Negamax(pos, -beta, -alpha, newDepth, ply + 1, true);
+            } else {
+                // Late-move reductions for quiet moves that are ordered late
+                auto r = 0;
+                if (depth >= 3 && quiet && !inCheck && !givesCheck) {
+                    r = kReductions[std::min(depth, kMaxPly - 1)][std::min(legalMoves, kMaxMoves - 1)];
+                    r += !pvNode;
+                    r -= History_[us][m.From()][m.To()] / 8192;
+                    r = std::clamp(r, 0, newDepth - 1);
+                }
+                score = -Negamax(pos, -alpha - 1, -alpha, newDepth - r, ply + 1, true);
+                if (score > alpha && r > 0) {
+                    score = -Negamax(pos, -alpha - 1, -alpha, newDepth, ply + 1, true);
+                }
+                if (score > alpha && score < beta) {
+                    score = -Negamax(pos, -beta, -alpha, newDepth, ply + 1, true);
+                }
+            }
+            UnmakeMove(pos, m);
+            if (Stopped_) return 0;
+
+            if (score > best) {
+                best = score;
+                bestMove = m;
+                if (score > alpha) {
+                    alpha = score;
+                    auto& line = Pv_[ply];
+                    const auto& childLine = Pv_[ply + 1];
+                    line.Moves[0] = m;
+                    std::copy_n(childLine.Moves.begin(), childLine.Length, line.Moves.begin() + 1);
+                    line.Length = childLine.Length + 1;
+                    if (alpha >= beta) {
+                        if (quiet) {
+                            UpdateQuietStats(pos, m, {triedQuiets.data(), size_t(numTriedQuiets)}, depth, ply);
+                        }
+                        break;
+                    }
+                }
+            }
+            if (quiet) triedQuiets[numTriedQuiets++] = m;
+        }
+
+        if (legalMoves == 0) return inCheck ? -kMate + ply : 0;
+
+        const auto bound = best >= beta ? EBound::Lower : best > originalAlpha ? EBound::Exact : EBound::Upper;
+        TT_.Store(pos.Key(), bound == EBound::Upper ? Move::None() : bestMove,
+                  ScoreToTT(best, ply), staticEval, depth, bound);
+        return best;
+    }
+
+    auto Searcher::Search(Position pos, const SearchLimits limits) -> SearchResult {
+        const auto startTime = Clock::now();
+        Deadline_ = startTime + limits.TimeBudget;
+        MaxNodes_ = limits.MaxNodes;
+        Nodes_ = 0;
+        Stopped_ = false;
+        RootBestMove_ = Move::None();
+        // The searchers of a group share one generation, advanced by the group
+        if (!StopSignal_) TT_.NewSearch();
+        Accumulators_.Reset(pos);
+        // Old killers are for different plies of a different tree
+        Killers_ = {};
+
+        auto result = SearchResult{};
+        {
+            // Always have some legal move to return, even
+            // if not a single iteration completes in time
+            auto list = MoveList{};
+            GenerateLegal(pos, list);
+            if (list.Size == 0) return result;
+            result.BestMove = list.Moves[0];
+        }
+
+        auto score = Score{0};
+        for (auto depth = 1; depth <= std::min(limits.MaxDepth, kMaxPly - 1); ++depth) {
+            if (SkipDepth(ThreadIndex_, depth)) continue;
+            // Aspiration windows: search a narrow window around the previous
+            // score first and widen it on every fail low or fail high
+            auto delta = Score{25};
+            auto alpha = -kInfinite, beta = kInfinite;
+            if (depth >= 5) {
+                alpha = std::max(score - delta, -kInfinite);
+                beta = std::min(score + delta, kInfinite);
+            }
+            for (;;) {
+                const auto iterScore = Negamax(pos, alpha, beta, depth, 0, false);
+                if (Stopped_) break;
+                if (iterScore <= alpha) {
+                    beta = (alpha + beta) / 2;
+                    alpha = std::max(iterScore - delta, -kInfinite);
+                } else if (iterScore >= beta) {
+                    beta = std::min(iterScore + delta, kInfinite);
+                } else {
+                    score = iterScore;
+                    break;
+                }
+                delta += delta / 2;
+            }
+            if (Stopped_) break;
+
+            const auto& pv = Pv_[0];
+            RootBestMove_ = pv.Moves[0];
+            result.BestMove = pv.Moves[0];
+            result.BestScore = score;
+            result.Depth = depth;
+            result.PvLength = pv.Length;
+            std::copy_n(pv.Moves.begin(), pv.Length, result.Pv.begin());
+
+            // Don't start an iteration that most likely won't finish. Helper
+            // threads keep going until the main thread stops them
+            if (ThreadIndex_ == 0 && Clock::now() - startTime > limits.TimeBudget / 2) break;
+            if (std::abs(score) >= kMateInMaxPly && depth > kMate - std::abs(score)) break;
+        }
+
+        result.Nodes = Nodes_;
+        result.WallTimeElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - startTime);
+        return result;
+    }
+} // namespace NEngine
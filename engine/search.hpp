@@ -0,0 +1,106 @@
+#pragma once
+
+
+#include "evaluate.hpp"
+#include "nnue.hpp"
+#include "transposition_table.hpp"
+
+#include "../chess/movegen.hpp"
+#include "../chess/position.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <span>
+
+
+namespace NEngine {
+    struct SearchLimits {
+        // Hard wall-time budget for the whole search
+        std::chrono::milliseconds TimeBudget = std::chrono::milliseconds{100};
+        int MaxDepth = NChess::kMaxPly - 1;
+        // 0 means unlimited
+        uint64_t MaxNodes = 0;
+    };
+
+    struct SearchResult {
+        NChess::Move BestMove;
+        Score BestScore = 0;
+        // Depth of the last completed iteration
+        int Depth = 0;
+        uint64_t Nodes = 0;
+        std::chrono::milliseconds WallTimeElapsed{0};
+        std::array<NChess::Move, NChess::kMaxPly> Pv = {};
+        int PvLength = 0;
+    };
+
+    /* A single-threaded PVS searcher with iterative deepening, aspiration
+     * windows, null-move pruning, late-move reductions and killer/history
+     * move ordering.
+     *
+     * An instance keeps its move ordering tables between searches, so
+     * a bot that reuses one `Searcher` for a whole game orders moves
+     * better from the first iteration on. The transposition table is
+     * not owned and may be shared with other searchers.
+     *
+     * Aligned to a cache line since the searchers of a Lazy SMP group
+     * update their counters and tables concurrently.
+     */
+    class alignas(64) Searcher {
+    private:
+        TranspositionTable& TT_;
+        // 0 for a standalone searcher and for the main thread of a group
+        int ThreadIndex_ = 0;
+        // Raised by the main thread of a group when the search is over
+        const std::atomic<bool>* StopSignal_ = nullptr;
+        struct PvLine {
+            std::array<NChess::Move, NChess::kMaxPly> Moves;
+            int Length = 0;
+        };
+        std::array<std::array<NChess::Move, 2>, NChess::kMaxPly> Killers_ = {};
+        // Indexed by [side to move][from][to]
+        std::array<std::array<std::array<int, NChess::kNumSquares>, NChess::kNumSquares>, 2> History_ = {};
+        std::array<PvLine, NChess::kMaxPly + 1> Pv_ = {};
+        uint64_t Nodes_ = 0;
+        uint64_t MaxNodes_ = 0;
+        std::chrono::steady_clock::time_point Deadline_;
+        bool Stopped_ = false;
+        // Best move of the previous iteration, searched first at the root
+        NChess::Move RootBestMove_;
+        NNnue::AccumulatorStack Accumulators_;
+    public:
+        explicit Searcher(
+            TranspositionTable& tt,
+            int threadIndex = 0,
+            const std::atomic<bool>* stopSignal = nullptr,
+            const NNnue::Network& net = NNnue::Network::Default()
+        ) noexcept
+            : TT_(tt)
+            , ThreadIndex_(threadIndex)
+            , StopSignal_(stopSignal)
+            , Accumulators_(net)
+        {
+        }
+
+        [[nodiscard]] auto Search(NChess::Position pos, SearchLimits limits) -> SearchResult;
+        // Forgets move ordering statistics, e.g. before a new game
+        auto Clear() noexcept -> void;
+    private:
+        auto Negamax(NChess::Position& pos, Score alpha, Score beta, int depth, int ply, bool nullAllowed)
+          -> Score;
+        auto QSearch(NChess::Position& pos, Score alpha, Score beta, int ply) -> Score;
+        // Keep the position, the transposition table prefetch and the
+        // evaluation accumulators in step
+        auto MakeMove(NChess::Position& pos, NChess::Move m) noexcept -> void;
+        auto UnmakeMove(NChess::Position& pos, NChess::Move m) noexcept -> void;
+        auto MakeNullMove(NChess::Position& pos) noexcept -> void;
+        auto UnmakeNullMove(NChess::Position& pos) noexcept -> void;
+        auto Evaluate(const NChess::Position& pos) const noexcept -> Score;
+        auto CheckLimits() noexcept -> void;
+        auto ScoreMoves(const NChess::Position& pos, const NChess::MoveList& list,
+                        std::span<int> scores, NChess::Move ttMove, int ply) const noexcept -> void;
+        auto UpdateQuietStats(const NChess::Position& pos, NChess::Move best,
+                              std::span<const NChess::Move> triedQuiets, int depth, int ply) noexcept -> void;
+    };
+} // namespace NEngine
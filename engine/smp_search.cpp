@@ -0,0 +1,51 @@
+#include "smp_search.hpp"
+
+#include <algorithm>
+
+
+namespace NEngine {
+    SmpSearcher::SmpSearcher(TranspositionTable& tt, ThreadPool& pool, int numThreads)
+        : TT_(tt)
+        , Pool_(pool)
+    {
+        numThreads = std::clamp(numThreads, 1, kMaxThreads);
+        Searchers_.reserve(numThreads);
+        // The main searcher gets the stop signal too: it makes it a member
+        // of a group, whose table generation is advanced in `Search()`
+        for (auto i = 0; i < numThreads; ++i) {
+            Searchers_.push_back(std::make_unique<Searcher>(TT_, i, &Stop_));
+        }
+    }
+
+    auto SmpSearcher::Clear() noexcept -> void {
+        for (auto& searcher : Searchers_) {
+            searcher->Clear();
+        }
+    }
+
+    auto SmpSearcher::Search(const NChess::Position& pos, const SearchLimits limits) -> SearchResult {
+        Stop_.store(false, std::memory_order_relaxed);
+        TT_.NewSearch();
+
+        auto results = std::vector<SearchResult>(Searchers_.size());
+        Pool_.ForkJoin(GetNumThreads(), [this, &pos, &results, limits](int i) {
+            results[i] = Searchers_[i]->Search(pos, limits);
+            // The helpers notice the signal within a couple of thousand
+            // nodes and are joined. One that only starts now, because
+            // the pool was busy, stops after its first iteration.
+            if (i == 0) Stop_.store(true, std::memory_order_relaxed);
+        });
+
+        // A helper may have completed a deeper iteration than the main
+        // thread: its move is then based on more information
+        auto best = results[0];
+        auto totalNodes = uint64_t{0};
+        for (const auto& result : results) {
+            totalNodes += result.Nodes;
+            if (result.Depth > best.Depth && result.BestMove) best = result;
+        }
+        best.Nodes = totalNodes;
+        best.WallTimeElapsed = results[0].WallTimeElapsed;
+        return best;
+    }
+} // namespace NEngine
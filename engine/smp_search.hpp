@@ -0,0 +1,45 @@
+#pragma once
+
+
+#include "search.hpp"
+#include "transposition_table.hpp"
+
+#include "../chess/position.hpp"
+#include "../utils/thread_pool/thread_pool.hpp"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+
+namespace NEngine {
+    /* Lazy SMP: all threads search the same root position independently,
+     * helpers at staggered depths, and cooperate only through the shared
+     * transposition table. Each thread owns its `Searcher` with its own
+     * history and killer tables.
+     *
+     * The thread count is fixed per instance, so that the owner (e.g. a
+     * server running many games at once) decides how many cores each
+     * game may use. The helpers are tasks of a pool shared by all the
+     * games, so several searches don't oversubscribe the cores. The
+     * calling thread is the main search thread, so a group of one thread
+     * uses no other thread.
+     */
+    class SmpSearcher {
+    public:
+        static constexpr auto kMaxThreads = 256;
+    private:
+        TranspositionTable& TT_;
+        ThreadPool& Pool_;
+        // Searchers_[0] runs on the calling thread
+        std::vector<std::unique_ptr<Searcher>> Searchers_;
+        std::atomic<bool> Stop_ = false;
+    public:
+        // `numThreads` is clamped to [1, kMaxThreads]
+        SmpSearcher(TranspositionTable& tt, ThreadPool& pool, int numThreads);
+
+        [[nodiscard]] auto Search(const NChess::Position& pos, SearchLimits limits) -> SearchResult;
+        auto Clear() noexcept -> void;
+        [[nodiscard]] auto GetNumThreads() const noexcept -> int { return int(Searchers_.size()); }
+    };
+} // namespace NEngine
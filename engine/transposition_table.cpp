@@ -0,0 +1,233 @@
+#include "transposition_table.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <utility>
+
+
+namespace {
+    using namespace NEngine;
+
+    static constexpr auto kHugePageSize = size_t{2} << 20;
+    static constexpr auto kGenerationMask = uint8_t{0x3F};
+
+    /* Entry data packed into 64 bits:
+     *   bits  0-15: best move
+     *   bits 16-31: value
+     *   bits 32-47: static evaluation
+     *   bits 48-55: depth
+     *   bits 56-57: bound
+     *   bits 58-63: generation
+     */
+    struct Unpacked {
+        NChess::Move BestMove;
+        int16_t Value;
+        int16_t StaticEval;
+        uint8_t Depth;
+        EBound Bound;
+        uint8_t Generation;
+    };
+
+    constexpr auto Pack(const Unpacked& u) noexcept -> uint64_t {
+        return uint64_t(u.BestMove.GetRaw())
+             | uint64_t(uint16_t(u.Value)) << 16
+             | uint64_t(uint16_t(u.StaticEval)) << 32
+             | uint64_t(u.Depth) << 48
+             | uint64_t(u.Bound) << 56
+             | uint64_t(u.Generation & kGenerationMask) << 58;
+    }
+
+    constexpr auto Unpack(uint64_t data) noexcept -> Unpacked {
+        return Unpacked{
+            .BestMove = NChess::Move{uint16_t(data)},
+            .Value = int16_t(uint16_t(data >> 16)),
+            .StaticEval = int16_t(uint16_t(data >> 32)),
+            .Depth = uint8_t(data >> 48),
+            .Bound = EBound((data >> 56) & 3),
+            .Generation = uint8_t(data >> 58),
+        };
+    }
+
+    // How many searches ago the entry was written
+    constexpr auto Age(uint8_t currentGeneration, uint8_t entryGeneration) noexcept -> int {
+        return (currentGeneration - entryGeneration) & kGenerationMask;
+    }
+} // anonymous namespace
+
+
+namespace NEngine {
+    TranspositionTable::TranspositionTable(
+        Bucket* buckets,
+        size_t numBuckets,
+        size_t mappedSize,
+        EBacking backing
+    ) noexcept
+        : Buckets_(buckets)
+        , NumBuckets_(numBuckets)
+        , MappedSize_(mappedSize)
+        , Backing_(backing)
+    {
+    }
+
+    TranspositionTable::TranspositionTable(TranspositionTable&& other) noexcept
+        : Buckets_(std::exchange(other.Buckets_, nullptr))
+        , NumBuckets_(std::exchange(other.NumBuckets_, 0))
+        , MappedSize_(std::exchange(other.MappedSize_, 0))
+        , Backing_(other.Backing_)
+        , Generation_(other.Generation_)
+    {
+    }
+
+    TranspositionTable& TranspositionTable::operator=(TranspositionTable&& other) noexcept {
+        std::swap(Buckets_, other.Buckets_);
+        std::swap(NumBuckets_, other.NumBuckets_);
+        std::swap(MappedSize_, other.MappedSize_);
+        std::swap(Backing_, other.Backing_);
+        std::swap(Generation_, other.Generation_);
+        return *this;
+    }
+
+    TranspositionTable::~TranspositionTable() noexcept {
+        // `Buckets_ == nullptr` means a moved-from state
+        if (Buckets_) {
+            // TODO: log the error if `munmap()` returns `-1`
+            munmap(Buckets_, MappedSize_);
+        }
+    }
+
+    auto TranspositionTable::CreateNew(const size_t sizeInMegabytes) noexcept
+      -> std::variant<TranspositionTable, SystemError> {
+        const auto requested = std::max<size_t>(sizeInMegabytes, 1) << 20;
+        // Rounding up to whole huge pages makes the explicit huge page
+        // mapping possible and costs at most 2MB over the requested size
+        const auto mappedSize = (requested + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+        const auto numBuckets = requested / sizeof(Bucket);
+
+        // Explicit huge pages only work if the administrator reserved
+        // them (`vm.nr_hugepages`), so failure here is expected
+        auto* memory = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        auto backing = EBacking::ExplicitHugePages;
+        if (memory == MAP_FAILED) {
+            memory = mmap(nullptr, mappedSize + kHugePageSize, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+                return SystemError{
+                    .Value = std::errc{errno},
+                    .ContextMessage = "mmap() syscall failed (" SOURCE_LOCATION ")",
+                };
+            }
+            // Transparent huge pages can only back 2MB-aligned ranges,
+            // so trim the over-allocated mapping to an aligned one
+            const auto addr = reinterpret_cast<uintptr_t>(memory);
+            const auto aligned = (addr + kHugePageSize - 1) & ~(kHugePageSize - 1);
+            if (aligned != addr) munmap(memory, aligned - addr);
+            munmap(reinterpret_cast<void*>(aligned + mappedSize), addr + kHugePageSize - aligned);
+            memory = reinterpret_cast<void*>(aligned);
+            backing = madvise(memory, mappedSize, MADV_HUGEPAGE) == 0
+                ? EBacking::TransparentHugePages
+                : EBacking::RegularPages;
+        }
+        // Anonymous mappings are zero-filled, which is an
+        // empty table: a zero entry never matches a real key
+        // because its data word has `EBound::None`
+        return TranspositionTable{static_cast<Bucket*>(memory), numBuckets, mappedSize, backing};
+    }
+
+    auto TranspositionTable::Probe(const uint64_t key) const noexcept -> std::optional<TTHit> {
+        auto& bucket = BucketFor(key);
+        for (auto& entry : bucket.Entries) {
+            const auto data = entry.Data.load(std::memory_order_relaxed);
+            const auto keyXorData = entry.KeyXorData.load(std::memory_order_relaxed);
+            if ((keyXorData ^ data) != key) continue;
+            const auto u = Unpack(data);
+            if (u.Bound == EBound::None) continue;
+            return TTHit{
+                .BestMove = u.BestMove,
+                .Value = u.Value,
+                .StaticEval = u.StaticEval,
+                .Depth = u.Depth,
+                .Bound = u.Bound,
+            };
+        }
+        return std::nullopt;
+    }
+
+    auto TranspositionTable::Store(
+        const uint64_t key,
+        NChess::Move bestMove,
+        const Score value,
+        const Score staticEval,
+        const int depth,
+        const EBound bound
+    ) noexcept -> void {
+        auto& bucket = BucketFor(key);
+        const auto generation = uint8_t(Generation_ & kGenerationMask);
+
+        // Replace the entry of the same position if there is one, otherwise
+        // the entry whose information is the least valuable: shallow
+        // entries left over from old searches go first
+        auto* victim = &bucket.Entries[0];
+        auto victimWorth = INT32_MAX;
+        auto victimData = uint64_t{0};
+        auto sameKey = false;
+        for (auto& entry : bucket.Entries) {
+            const auto data = entry.Data.load(std::memory_order_relaxed);
+            const auto keyXorData = entry.KeyXorData.load(std::memory_order_relaxed);
+            if ((keyXorData ^ data) == key) {
+                victim = &entry;
+                victimData = data;
+                sameKey = true;
+                break;
+            }
+            const auto u = Unpack(data);
+            const auto worth = u.Bound == EBound::None ? INT32_MIN : u.Depth - 8 * Age(generation, u.Generation);
+            if (worth < victimWorth) {
+                victim = &entry;
+                victimWorth = worth;
+                victimData = data;
+            }
+        }
+
+        if (sameKey) {
+            const auto old = Unpack(victimData);
+            // Keep the old best move rather than forgetting it
+            if (!bestMove) bestMove = old.BestMove;
+            // Don't let a shallow bound overwrite a deeper
+            // result of the same search
+            if (bound != EBound::Exact && old.Generation == generation && depth + 3 < old.Depth) {
+                return;
+            }
+        }
+
+        const auto data = Pack(Unpacked{
+            .BestMove = bestMove,
+            .Value = int16_t(value),
+            .StaticEval = int16_t(staticEval),
+            .Depth = uint8_t(std::clamp(depth, 0, 255)),
+            .Bound = bound,
+            .Generation = generation,
+        });
+        victim->KeyXorData.store(key ^ data, std::memory_order_relaxed);
+        victim->Data.store(data, std::memory_order_relaxed);
+    }
+
+    auto TranspositionTable::Clear() noexcept -> void {
+        std::memset(static_cast<void*>(Buckets_), 0, NumBuckets_ * sizeof(Bucket));
+        Generation_ = 0;
+    }
+
+    auto TranspositionTable::Hashfull() const noexcept -> int {
+        const auto sample = std::min<size_t>(NumBuckets_, 250);
+        auto used = 0;
+        for (auto i = size_t{0}; i < sample; ++i) {
+            for (const auto& entry : Buckets_[i].Entries) {
+                const auto u = Unpack(entry.Data.load(std::memory_order_relaxed));
+                used += u.Bound != EBound::None && u.Generation == (Generation_ & kGenerationMask);
+            }
+        }
+        return int(used * 1000 / (sample * kEntriesPerBucket));
+    }
+} // namespace NEngine
@@ -0,0 +1,139 @@
+#pragma once
+
+
+#include "evaluate.hpp"
+
+#include "../chess/types.hpp"
+#include "../utils/error.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <variant>
+
+
+namespace NEngine {
+    enum class EBound : uint8_t {
+        None = 0,
+        // The score is an upper bound (the search failed low)
+        Upper = 1,
+        // The score is a lower bound (the search failed high)
+        Lower = 2,
+        Exact = Upper | Lower,
+    };
+
+    struct TTHit {
+        NChess::Move BestMove;
+        Score Value;
+        Score StaticEval;
+        int Depth;
+        EBound Bound;
+    };
+
+    /* A transposition table shared by any number of search threads without locks.
+     *
+     * The table is an array of cache-line sized buckets, each holding four
+     * 16-byte entries. An entry is a pair of 64-bit words `(key ^ data, data)`
+     * written and read with relaxed atomics: a torn entry (the two words
+     * coming from two different concurrent stores) fails the `key ^ data`
+     * check on probe and is treated as a miss, which is the "lockless hashing"
+     * scheme of Hyatt and Mann.
+     *
+     * The memory is taken from explicit huge pages (`MAP_HUGETLB`) when the
+     * system has them reserved, otherwise from regular pages with a
+     * transparent huge pages hint (`MADV_HUGEPAGE`), to reduce TLB misses on
+     * the essentially random accesses of the search.
+     */
+    class TranspositionTable {
+    public:
+        enum class EBacking {
+            ExplicitHugePages,
+            TransparentHugePages,
+            RegularPages,
+        };
+    private:
+        struct Entry {
+            std::atomic<uint64_t> KeyXorData;
+            std::atomic<uint64_t> Data;
+        };
+        static constexpr auto kEntriesPerBucket = 4;
+        struct alignas(64) Bucket {
+            Entry Entries[kEntriesPerBucket];
+        };
+        static_assert(sizeof(Bucket) == 64);
+
+        Bucket* Buckets_ = nullptr;
+        size_t NumBuckets_ = 0;
+        size_t MappedSize_ = 0;
+        EBacking Backing_ = EBacking::RegularPages;
+        // Only the lower 6 bits are stored in entries
+        uint8_t Generation_ = 0;
+    private:
+        TranspositionTable(Bucket* buckets, size_t numBuckets, size_t mappedSize, EBacking backing) noexcept;
+        auto BucketFor(uint64_t key) const noexcept -> Bucket& {
+            // Maps the key to [0, NumBuckets_) with a multiplication
+            // instead of a modulo, so any bucket count works
+            return Buckets_[(unsigned __int128)(key) * NumBuckets_ >> 64];
+        }
+    public:
+        TranspositionTable(const TranspositionTable&) = delete;
+        TranspositionTable(TranspositionTable&& other) noexcept;
+        TranspositionTable& operator=(TranspositionTable&& other) noexcept;
+        ~TranspositionTable() noexcept;
+
+        [[nodiscard]] static auto CreateNew(size_t sizeInMegabytes) noexcept
+          -> std::variant<TranspositionTable, SystemError>;
+
+        [[nodiscard]] auto Probe(uint64_t key) const noexcept -> std::optional<TTHit>;
+        auto Store(
+            uint64_t key,
+            NChess::Move bestMove,
+            Score value,
+            Score staticEval,
+            int depth,
+            EBound bound
+        ) noexcept -> void;
+
+        // Hints the CPU to start loading the bucket of `key`. Meant to be
+        // called right after making a move, so that the memory access
+        // overlaps with the rest of the work done before the probe
+        auto Prefetch(uint64_t key) const noexcept -> void {
+            __builtin_prefetch(&BucketFor(key));
+        }
+
+        // Marks all existing entries as one search older,
+        // which makes them preferred for replacement
+        auto NewSearch() noexcept -> void { ++Generation_; }
+        auto Clear() noexcept -> void;
+        // Approximate occupancy by entries of the current search, in permille
+        [[nodiscard]] auto Hashfull() const noexcept -> int;
+        [[nodiscard]] auto GetBacking() const noexcept -> EBacking { return Backing_; }
+        [[nodiscard]] auto GetSizeInBytes() const noexcept -> size_t { return NumBuckets_ * sizeof(Bucket); }
+    };
+
+    // Mate scores are stored relative to the node rather than to the
+    // root, so that an entry stays valid when reached at another ply
+    constexpr auto ScoreToTT(Score s, int ply) noexcept -> Score {
+        return s >= kMateInMaxPly ? s + ply : s <= -kMateInMaxPly ? s - ply : s;
+    }
+    constexpr auto ScoreFromTT(Score s, int ply) noexcept -> Score {
+        return s >= kMateInMaxPly ? s - ply : s <= -kMateInMaxPly ? s + ply : s;
+    }
+
+    template <class OStream>
+    inline auto operator<<(OStream&& out, TranspositionTable::EBacking backing) -> OStream&& {
+        switch (backing) {
+            case TranspositionTable::EBacking::ExplicitHugePages:
+                out << "explicit huge pages";
+                break;
+            case TranspositionTable::EBacking::TransparentHugePages:
+                out << "transparent huge pages";
+                break;
+            case TranspositionTable::EBacking::RegularPages:
+                out << "regular pages";
+                break;
+        }
+        return std::forward<OStream>(out);
+    }
+} // namespace NEngine
@@ -0,0 +1,141 @@
+#include "../evaluate.hpp"
+#include "../nnue.hpp"
+#include "../nnue_default_net.hpp"
+
+#include "../../chess/movegen.hpp"
+#include "../../chess/position.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string_view>
+#include <vector>
+
+
+namespace {
+using namespace NChess;
+using namespace NEngine;
+using namespace NEngine::NNnue;
+
+static constexpr auto kFens = std::array<std::string_view, 5>{
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+};
+
+// A network file with random weights, large enough to
+// exercise clipping on both ends of every layer
+auto MakeRandomNetwork(uint32_t seed) -> std::unique_ptr<Network> {
+    auto rng = std::mt19937{seed};
+    auto file = std::vector<std::byte>(NDefaultNet::kFile.begin(), NDefaultNet::kFile.end());
+    auto offset = size_t{12};
+    // Fills the next `size` bytes with integers of type I in [-range, range)
+    const auto fill = [&]<class I>(I, size_t size, int range) {
+        for (auto end = offset + size; offset < end; offset += sizeof(I)) {
+            const auto x = I(int(rng() % (2 * range)) - range);
+            std::memcpy(&file[offset], &x, sizeof(I));
+        }
+    };
+    // Feature transformer weights are small enough for accumulators
+    // not to overflow int16, and sums not to overflow int32
+    fill(int16_t{}, sizeof(Network::FtBias), 64);
+    fill(int16_t{}, sizeof(Network::FtWeights), 64);
+    fill(int32_t{}, sizeof(Network::PsqtWeights), 1 << 16);
+    fill(int32_t{}, sizeof(Network::L1Bias), 1 << 16);
+    fill(int8_t{}, sizeof(Network::L1Weights), 128);
+    fill(int32_t{}, sizeof(Network::L2Bias), 1 << 16);
+    fill(int8_t{}, sizeof(Network::L2Weights), 128);
+    assert(offset == file.size());
+
+    auto netOrError = Network::Load(file);
+    assert(std::holds_alternative<std::unique_ptr<Network>>(netOrError));
+    return std::move(std::get<std::unique_ptr<Network>>(netOrError));
+}
+
+// Plays random legal moves, checking the incremental accumulator
+// against a refresh and all SIMD paths against the scalar one
+auto RandomWalk(const Network& net, Position pos, std::mt19937& rng, int plies) -> void {
+    auto stack = AccumulatorStack{net};
+    stack.Reset(pos);
+    auto played = std::vector<Move>{};
+    for (auto ply = 0; ply < plies; ++ply) {
+        auto list = MoveList{};
+        GenerateLegal(pos, list);
+        if (list.Size == 0) break;
+        const auto m = list.Moves[rng() % list.Size];
+        pos.MakeMove(m);
+        stack.Push(pos, m);
+        played.push_back(m);
+
+        auto fresh = Accumulator{};
+        Refresh(net, pos, fresh);
+        assert(fresh.Values == stack.Top().Values);
+        assert(fresh.Psqt == stack.Top().Psqt);
+
+        const auto expected = Evaluate(net, stack.Top(), pos, ESimd::Scalar);
+        for (const auto simd : SupportedSimd()) {
+            assert(Evaluate(net, stack.Top(), pos, simd) == expected);
+        }
+    }
+    for (auto it = played.rbegin(); it != played.rend(); ++it) {
+        pos.UnmakeMove(*it);
+        stack.Pop();
+    }
+    auto fresh = Accumulator{};
+    Refresh(net, pos, fresh);
+    assert(fresh.Values == stack.Top().Values);
+}
+} // anonymous namespace
+
+
+namespace NTests {
+auto TestIncrementalUpdatesAndSimdPaths() -> void {
+    auto rng = std::mt19937{42};
+    const auto randomNet = MakeRandomNetwork(7);
+    for (const auto* net : std::array<const Network*, 2>{&Network::Default(), randomNet.get()}) {
+        for (const auto fen : kFens) {
+            auto pos = Position{};
+            assert(!pos.SetFromFen(fen));
+            for (auto walk = 0; walk < 20; ++walk) {
+                RandomWalk(*net, pos, rng, 60);
+            }
+        }
+    }
+    std::cerr << "TestIncrementalUpdatesAndSimdPaths OK\n";
+}
+
+auto TestDefaultNetworkMatchesHandCraftedEvaluation() -> void {
+    for (const auto fen : kFens) {
+        auto pos = Position{};
+        assert(!pos.SetFromFen(fen));
+        auto acc = Accumulator{};
+        Refresh(Network::Default(), pos, acc);
+        // Only the tapering differs: it is done at the middle of a phase bucket
+        const auto diff = Evaluate(Network::Default(), acc, pos) - NEngine::Evaluate(pos);
+        assert(std::abs(diff) <= 15);
+    }
+    std::cerr << "TestDefaultNetworkMatchesHandCraftedEvaluation OK\n";
+}
+
+auto TestRejectsBadFiles() -> void {
+    auto file = std::vector<std::byte>(NDefaultNet::kFile.begin(), NDefaultNet::kFile.end());
+    assert(std::holds_alternative<std::unique_ptr<Network>>(Network::Load(file)));
+    file[8] ^= std::byte{1};
+    assert(std::holds_alternative<GenericError>(Network::Load(file)));
+    file.pop_back();
+    assert(std::holds_alternative<GenericError>(Network::Load(file)));
+    std::cerr << "TestRejectsBadFiles OK\n";
+}
+} // namespace NTests
+
+
+auto main() -> int {
+    using namespace NTests;
+    TestIncrementalUpdatesAndSimdPaths();
+    TestDefaultNetworkMatchesHandCraftedEvaluation();
+    TestRejectsBadFiles();
+    std::cerr << "All tests passed.\n";
+}
@@ -0,0 +1,181 @@
+#include "../polyglot_book.hpp"
+#include "../polyglot_randoms.hpp"
+
+#include "../../chess/position.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace {
+using namespace NChess;
+using namespace NEngine;
+
+auto EncodeMove(Square from, Square to, int promotion = 0) -> uint16_t {
+    return uint16_t(FileOf(to) | RankOf(to) << 3 | FileOf(from) << 6 | RankOf(from) << 9 | promotion << 12);
+}
+
+auto WriteBook(const std::string& path, std::vector<PolyglotBook::Entry> entries) -> void {
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.Key < b.Key; });
+    auto out = std::ofstream{path, std::ios::binary};
+    const auto put = [&out](uint64_t x, int size) {
+        for (auto i = size - 1; i >= 0; --i) out.put(char(x >> (8 * i)));
+    };
+    for (const auto& e : entries) {
+        put(e.Key, 8);
+        put(e.RawMove, 2);
+        put(e.Weight, 2);
+        put(e.Learn, 4);
+    }
+}
+
+auto OpenBook(const std::string& path) -> PolyglotBook {
+    auto bookOrError = PolyglotBook::Open(path);
+    assert(std::holds_alternative<PolyglotBook>(bookOrError));
+    return std::move(std::get<PolyglotBook>(bookOrError));
+}
+} // anonymous namespace
+
+
+namespace NTests {
+auto TestFindAndPickWeighted() -> void {
+    const auto start = Position::StartPosition();
+    const auto startKey = PolyglotKey(start);
+    const auto path = std::string{"/tmp/polyglot_book_ut.bin"};
+    WriteBook(path, {
+        {.Key = startKey, .RawMove = EncodeMove(E2, E4), .Weight = 1, .Learn = 0},
+        {.Key = startKey, .RawMove = EncodeMove(D2, D4), .Weight = 3, .Learn = 0},
+        {.Key = startKey - 1, .RawMove = EncodeMove(G1, F3), .Weight = 5, .Learn = 0},
+        {.Key = startKey + 1, .RawMove = EncodeMove(C2, C4), .Weight = 5, .Learn = 0},
+    });
+    const auto book = OpenBook(path);
+    assert(book.GetNumEntries() == 4);
+
+    const auto entries = book.Find(startKey);
+    assert(entries.Size() == 2);
+    assert(entries[0].Key == startKey && entries[1].Key == startKey);
+    assert(book.Find(startKey + 2).Empty());
+
+    // r = random % (1 + 3): 0 picks e2e4, 1..3 pick d2d4
+    const auto e2e4 = book.PickWeighted(start, startKey, 4);
+    const auto d2d4 = book.PickWeighted(start, startKey, 7);
+    assert(e2e4 && e2e4->From() == E2 && e2e4->To() == E4);
+    assert(d2d4 && d2d4->From() == D2 && d2d4->To() == D4);
+    assert(!book.PickWeighted(start, startKey + 2, 0));
+    std::remove(path.c_str());
+    std::cerr << "TestFindAndPickWeighted OK\n";
+}
+
+// The keys given in the Polyglot format description
+auto TestReferenceKeys() -> void {
+    const auto cases = std::vector<std::pair<std::string, uint64_t>>{
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 0x463b96181691fc9cull},
+        // e2e4
+        {"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", 0x823c9b50fd114196ull},
+        // e2e4 d7d5
+        {"rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2", 0x0756b94461c50fb0ull},
+        // e2e4 d7d5 e4e5
+        {"rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2", 0x662fafb965db29d4ull},
+        // e2e4 d7d5 e4e5 f7f5, where e5 can capture en passant
+        {"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", 0x22a48b5a8e47ff78ull},
+        // e2e4 d7d5 e4e5 f7f5 e1e2
+        {"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR b kq - 0 3", 0x652a607ca3f242c1ull},
+        // e2e4 d7d5 e4e5 f7f5 e1e2 e8f7
+        {"rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4", 0x00fdd303c946bdd9ull},
+        // a2a4 b7b5 h2h4 b5b4 c2c4, where b4 can capture en passant
+        {"rnbqkbnr/p1pppppp/8/8/PpP4P/8/1P1PPPP1/RNBQKBNR b KQkq c3 0 3", 0x3c8123ea7b067637ull},
+        // a2a4 b7b5 h2h4 b5b4 c2c4 b4c3 a1a3
+        {"rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4", 0x5c3f9b829b279560ull},
+    };
+    auto pos = Position{};
+    for (const auto& [fen, key] : cases) {
+        assert(!pos.SetFromFen(fen));
+        assert(PolyglotKey(pos) == key);
+    }
+    std::cerr << "TestReferenceKeys OK\n";
+}
+
+// A book keyed the way other tools key them, not with `PolyglotKey()`
+auto TestLookupInReferenceBook() -> void {
+    const auto path = std::string{"/tmp/polyglot_book_ut_reference.bin"};
+    WriteBook(path, {
+        {.Key = 0x463b96181691fc9cull, .RawMove = EncodeMove(E2, E4), .Weight = 10, .Learn = 0},
+        {.Key = 0x823c9b50fd114196ull, .RawMove = EncodeMove(D7, D5), .Weight = 2, .Learn = 0},
+        {.Key = 0x0756b94461c50fb0ull, .RawMove = EncodeMove(E4, E5), .Weight = 1, .Learn = 0},
+        {.Key = 0x662fafb965db29d4ull, .RawMove = EncodeMove(F7, F5), .Weight = 1, .Learn = 0},
+        {.Key = 0x22a48b5a8e47ff78ull, .RawMove = EncodeMove(E5, F6), .Weight = 1, .Learn = 0},
+    });
+    const auto book = OpenBook(path);
+    // Plays the line out of the book, down to the en passant capture
+    auto pos = Position::StartPosition();
+    for (auto ply = 0; ply < 5; ++ply) {
+        const auto key = PolyglotKey(pos);
+        assert(book.Find(key).Size() == 1);
+        const auto move = book.PickWeighted(pos, key, 0);
+        assert(move);
+        pos.MakeMove(*move);
+    }
+    assert(pos.PieceOn(F6) == MakePiece(White, Pawn) && pos.PieceOn(F5) == NoPiece);
+    assert(book.Find(PolyglotKey(pos)).Empty());
+    std::remove(path.c_str());
+    std::cerr << "TestLookupInReferenceBook OK\n";
+}
+
+auto TestPolyglotKeyComponents() -> void {
+    auto pos = Position{};
+    assert(!pos.SetFromFen("4k3/8/8/8/8/8/8/4K3 b - - 0 1"));
+    // Black king: kind 10, white king: kind 11; black to move adds nothing
+    assert(PolyglotKey(pos) == (kPolyglotRandoms[64 * 10 + E8] ^ kPolyglotRandoms[64 * 11 + E1]));
+    assert(!pos.SetFromFen("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1"));
+    const auto withEp = PolyglotKey(pos);
+    assert(!pos.SetFromFen("4k3/8/8/3pP3/8/8/8/4K3 w - - 0 1"));
+    assert((withEp ^ PolyglotKey(pos)) == kPolyglotRandoms[772 + 3]);
+    // No pawn next to d5 to capture it
+    assert(!pos.SetFromFen("4k3/8/8/3p4/8/8/8/4K3 w - d6 0 1"));
+    const auto withoutCapturer = PolyglotKey(pos);
+    assert(!pos.SetFromFen("4k3/8/8/3p4/8/8/8/4K3 w - - 0 1"));
+    assert(withoutCapturer == PolyglotKey(pos));
+    std::cerr << "TestPolyglotKeyComponents OK\n";
+}
+
+auto TestMoveConversion() -> void {
+    auto pos = Position{};
+    assert(!pos.SetFromFen("r3k2r/1P6/8/8/8/8/8/R3K2R w KQkq - 0 1"));
+    const auto castle = MoveFromPolyglot(pos, EncodeMove(E1, H1));
+    assert(castle && castle->Kind() == Move::Castling && castle->To() == G1);
+    const auto castleLong = MoveFromPolyglot(pos, EncodeMove(E1, A1));
+    assert(castleLong && castleLong->Kind() == Move::Castling && castleLong->To() == C1);
+    const auto promotion = MoveFromPolyglot(pos, EncodeMove(B7, B8, 1));
+    assert(promotion && promotion->Kind() == Move::Promotion && promotion->PromotionType() == Knight);
+    assert(!MoveFromPolyglot(pos, EncodeMove(B7, B8)));
+    assert(!MoveFromPolyglot(pos, EncodeMove(E1, E3)));
+    std::cerr << "TestMoveConversion OK\n";
+}
+
+auto TestRejectsBadFiles() -> void {
+    assert(std::holds_alternative<SystemError>(PolyglotBook::Open("/nonexistent/book.bin")));
+    const auto path = std::string{"/tmp/polyglot_book_ut_bad.bin"};
+    std::ofstream{path, std::ios::binary} << "not a book";
+    assert(std::holds_alternative<GenericError>(PolyglotBook::Open(path)));
+    std::remove(path.c_str());
+    std::cerr << "TestRejectsBadFiles OK\n";
+}
+} // namespace NTests
+
+
+auto main() -> int {
+    using namespace NTests;
+    TestFindAndPickWeighted();
+    TestReferenceKeys();
+    TestLookupInReferenceBook();
+    TestPolyglotKeyComponents();
+    TestMoveConversion();
+    TestRejectsBadFiles();
+    std::cerr << "All tests passed.\n";
+}
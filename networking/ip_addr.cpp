@@ -23,7 +23,7 @@ auto ConstructIpAddrStorage(IpAddr ipAddr)
         },
         [](IP::v4::any) -> R { return in_addr{.s_addr = INADDR_ANY}; },
         [](IP::v6::any) -> R { return in6addr_any; },
-        [](IP::v4::loopback) -> R { return in_addr{.s_addr = INADDR_LOOPBACK}; },
+        [](IP::v4::loopback) -> R { return in_addr{.s_addr = htonl(INADDR_LOOPBACK)}; },
         [](IP::v6::loopback) -> R { return in6addr_loopback; },
     }, ipAddr);
 }
@@ -0,0 +1,141 @@
+#include "socket_options.hpp"
+
+#include "../utils/bench_helpers.hpp"
+#include "../utils/cli_args.hpp"
+#include "../utils/robust_read_write/robust_read_write.hpp"
+#include "../utils/timer/clock.hpp"
+
+#include <algorithm>
+#include <array>
+#include <arpa/inet.h>
+#include <chrono>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <netinet/in.h>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+
+namespace {
+    using namespace std::chrono;
+
+    constexpr auto kTimeout = milliseconds{5000};
+
+    // Both ends of a non-blocking TCP connection over loopback
+    struct Connection {
+        int Client = -1;
+        int Server = -1;
+
+        Connection() {
+            const auto listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            Check(listener != -1, "socket()");
+            auto addr = sockaddr_in{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            auto addrLen = socklen_t{sizeof(addr)};
+            Check(bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0, "bind()");
+            Check(listen(listener, 1) == 0, "listen()");
+            Check(getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &addrLen) == 0, "getsockname()");
+            Client = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            Check(Client != -1, "socket()");
+            Check(connect(Client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0, "connect()");
+            Server = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            Check(Server != -1, "accept4()");
+            Check(fcntl(Client, F_SETFL, O_NONBLOCK) == 0, "fcntl()");
+            close(listener);
+        }
+        ~Connection() {
+            close(Client);
+            close(Server);
+        }
+    };
+
+    struct Mode {
+        std::string_view Name;
+        bool LowLatencyOptions;
+        nanoseconds BusyPollBudget;
+    };
+
+    /* Sends a message of `size` bytes and waits for it to be echoed,
+     * `roundTrips` times: the exchange of a move between two peers. Both
+     * ends use the same mode.
+     */
+    auto Run(const Mode& mode, int roundTrips, size_t size) -> void {
+        const auto conn = Connection{};
+        if (mode.LowLatencyOptions) {
+            const auto busyPoll = duration_cast<microseconds>(mode.BusyPollBudget);
+            for (const auto fd : {conn.Client, conn.Server}) {
+                if (auto err = SetLowLatencyOptions(fd)) LogErrorAndExit(*err);
+                if (busyPoll.count() == 0) continue;
+                // Only the spinning of the reader is measured then
+                if (auto err = SetBusyPollOptions(fd, busyPoll)) {
+                    std::cerr << "No busy-polling by the kernel: " << *err << "\n";
+                }
+            }
+        }
+        // Delayed ACKs are only avoided if `TCP_QUICKACK` is set again after reads
+        auto afterRead = [&](int fd) {
+            if (!mode.LowLatencyOptions) return;
+            if (auto err = RearmQuickAck(fd)) LogErrorAndExit(*err);
+        };
+        auto echo = std::jthread{[&]() {
+            auto buf = std::vector<std::byte>(size);
+            for (auto i = 0; i != roundTrips; ++i) {
+                const auto read = RobustSyncRead(conn.Server, buf, kTimeout, std::nullopt, mode.BusyPollBudget);
+                if (auto* err = std::get_if<NRobustSyncRead::OnSystemError>(&read)) LogErrorAndExit(err->Err);
+                if (!std::holds_alternative<NRobustSyncRead::OnSuccess>(read)) LogErrorAndExit("echo: read failed");
+                afterRead(conn.Server);
+                const auto write = RobustSyncWrite(conn.Server, buf, kTimeout);
+                if (!std::holds_alternative<NRobustSyncWrite::OnSuccess>(write)) LogErrorAndExit("echo: write failed");
+            }
+        }};
+        auto buf = std::vector<std::byte>(size);
+        auto rtts = std::vector<nanoseconds>{};
+        rtts.reserve(size_t(roundTrips));
+        const auto start = MonotonicClock::now();
+        for (auto i = 0; i != roundTrips; ++i) {
+            const auto sent = MonotonicClock::now();
+            const auto write = RobustSyncWrite(conn.Client, buf, kTimeout);
+            if (!std::holds_alternative<NRobustSyncWrite::OnSuccess>(write)) LogErrorAndExit("write failed");
+            const auto read = RobustSyncRead(conn.Client, buf, kTimeout, std::nullopt, mode.BusyPollBudget);
+            if (!std::holds_alternative<NRobustSyncRead::OnSuccess>(read)) LogErrorAndExit("read failed");
+            afterRead(conn.Client);
+            rtts.push_back(MonotonicClock::now() - sent);
+        }
+        const auto seconds = duration<double>(MonotonicClock::now() - start).count();
+        std::cout << std::setw(16) << mode.Name
+                  << std::setw(15) << int64_t(double(roundTrips) / seconds)
+                  << std::setw(10) << Percentile(rtts, 0.5)
+                  << std::setw(10) << Percentile(rtts, 0.99) << "\n";
+    }
+} // anonymous namespace
+
+
+/* Usage: ping_pong_bench [round trips = 20000] [message bytes = 64]
+ *
+ * Reports round trips/second and the p50/p99 round-trip time in
+ * nanoseconds of a ping-pong over a loopback TCP connection: with the
+ * default socket options, with `SetLowLatencyOptions()`, and with those
+ * plus busy-polling reads for a few budgets. Busy-polling needs a core
+ * per spinning thread to pay off: with fewer cores than the two ends,
+ * the spinning reader delays the peer it waits for.
+ */
+auto main(int argc, char** argv) -> int {
+    const auto roundTrips = std::max(argc > 1 ? ParseIntArg(argv[1], 20'000) : 20'000, 1);
+    const auto size = size_t(std::clamp(argc > 2 ? ParseIntArg(argv[2], 64) : 64, 1, 1 << 20));
+
+    const auto modes = std::array{
+        Mode{"default", false, {}},
+        Mode{"nodelay+quickack", true, {}},
+        Mode{"busy-poll 10us", true, microseconds{10}},
+        Mode{"busy-poll 50us", true, microseconds{50}},
+        Mode{"busy-poll 200us", true, microseconds{200}},
+    };
+    std::cout << "            mode  round trips/s    p50 ns    p99 ns\n";
+    for (const auto& mode : modes) Run(mode, roundTrips, size);
+}
@@ -1,5 +1,7 @@
 #include "sock_addr.hpp"
 
+#include "../utils/overloaded.hpp"
+
 #include <cstring>
 #include <netinet/in.h>
 
@@ -26,6 +28,28 @@ auto ConstructSockAddr(
     };
 }
 
+auto ToSockAddrStorage(const sockaddr_in& addr) -> sockaddr_storage {
+    auto storage = sockaddr_storage{};
+    std::memcpy(&storage, &addr, sizeof(addr));
+    return storage;
+}
+
+auto ToSockAddrStorage(const sockaddr_in6& addr) -> sockaddr_storage {
+    auto storage = sockaddr_storage{};
+    std::memcpy(&storage, &addr, sizeof(addr));
+    return storage;
+}
+
+auto ToSockAddrStorage(const Endpoint endpoint) -> std::variant<sockaddr_storage, IpAddrParsingError> {
+    using R = std::variant<sockaddr_storage, IpAddrParsingError>;
+    return std::visit(overloaded{
+        [](IpAddrParsingError err) -> R { return err; },
+        [port = endpoint.Port](const auto& addr) -> R {
+            return ToSockAddrStorage(ConstructSockAddr(addr, port));
+        },
+    }, ConstructIpAddrStorage(endpoint.IpAddr));
+}
+
 auto operator==(const sockaddr_in& lhs, const sockaddr_in& rhs) -> bool {
     return lhs.sin_port == rhs.sin_port
         && lhs.sin_addr.s_addr == rhs.sin_addr.s_addr;
@@ -4,6 +4,7 @@
 #include "ip_addr.hpp"
 
 #include <netinet/in.h>
+#include <sys/socket.h>
 
 
 struct Endpoint {
@@ -33,5 +34,13 @@ auto ConstructSockAddr(
 ) -> sockaddr_in6;
 
 
+// For the syscalls that take an address of either
+// family, e.g. `connect()` and `accept4()`
+auto ToSockAddrStorage(const sockaddr_in& addr) -> sockaddr_storage;
+auto ToSockAddrStorage(const sockaddr_in6& addr) -> sockaddr_storage;
+// Of the family of the parsed IP address
+auto ToSockAddrStorage(Endpoint endpoint) -> std::variant<sockaddr_storage, IpAddrParsingError>;
+
+
 auto operator==(const sockaddr_in& lhs, const sockaddr_in& rhs) -> bool;
 auto operator==(const sockaddr_in6& lhs, const sockaddr_in6& rhs) -> bool;
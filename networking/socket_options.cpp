@@ -0,0 +1,75 @@
+#include "socket_options.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+
+namespace {
+    auto SetIntOption(const int sockFd, const int level, const int name, const int value) noexcept -> int {
+        return setsockopt(sockFd, level, name, &value, sizeof(value));
+    }
+}
+
+auto SetLowLatencyOptions(const int sockFd) noexcept -> std::optional<SystemError> {
+    if (SetIntOption(sockFd, IPPROTO_TCP, TCP_NODELAY, 1) == -1) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "setsockopt() syscall failed for TCP_NODELAY (" SOURCE_LOCATION ")",
+        };
+    }
+    return RearmQuickAck(sockFd);
+}
+
+auto SetBusyPollOptions(const int sockFd, const std::chrono::microseconds busyPoll) noexcept
+  -> std::optional<SystemError> {
+    const auto value = int(std::min<std::chrono::microseconds::rep>(busyPoll.count(), INT_MAX));
+    if (SetIntOption(sockFd, SOL_SOCKET, SO_BUSY_POLL, value) == -1) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "setsockopt() syscall failed for SO_BUSY_POLL (" SOURCE_LOCATION ")",
+            .Fd = sockFd,
+        };
+    }
+#ifdef SO_PREFER_BUSY_POLL
+    if (SetIntOption(sockFd, SOL_SOCKET, SO_PREFER_BUSY_POLL, 1) == -1) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "setsockopt() syscall failed for SO_PREFER_BUSY_POLL (" SOURCE_LOCATION ")",
+            .Fd = sockFd,
+        };
+    }
+#endif
+    return std::nullopt;
+}
+
+auto RearmQuickAck(const int sockFd) noexcept -> std::optional<SystemError> {
+    if (SetIntOption(sockFd, IPPROTO_TCP, TCP_QUICKACK, 1) == -1) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "setsockopt() syscall failed for TCP_QUICKACK (" SOURCE_LOCATION ")",
+        };
+    }
+    return std::nullopt;
+}
+
+auto EnablePortReuse(const int sockFd) noexcept -> std::optional<SystemError> {
+    if (SetIntOption(sockFd, SOL_SOCKET, SO_REUSEADDR, 1) == -1) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "setsockopt() syscall failed for SO_REUSEADDR (" SOURCE_LOCATION ")",
+            .Fd = sockFd,
+        };
+    }
+    if (SetIntOption(sockFd, SOL_SOCKET, SO_REUSEPORT, 1) == -1) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "setsockopt() syscall failed for SO_REUSEPORT (" SOURCE_LOCATION ")",
+            .Fd = sockFd,
+        };
+    }
+    return std::nullopt;
+}
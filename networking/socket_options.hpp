@@ -0,0 +1,35 @@
+#pragma once
+
+
+#include "../utils/error.hpp"
+
+#include <chrono>
+#include <optional>
+
+
+/* Tunes a connected TCP socket for latency rather than throughput, e.g.
+ * for the moves of blitz and bullet games: disables Nagle's algorithm
+ * (`TCP_NODELAY`) and delayed ACKs (`TCP_QUICKACK`).
+ */
+[[nodiscard]] auto SetLowLatencyOptions(int sockFd) noexcept -> std::optional<SystemError>;
+
+/* Asks the kernel to busy-poll the device queue for `busyPoll` on
+ * blocking reads and `poll()` of the socket (`SO_BUSY_POLL`,
+ * `SO_PREFER_BUSY_POLL`). These need `CAP_NET_ADMIN` above
+ * `net.core.busy_read` and a recent kernel, so the socket works without
+ * them; the error is for the caller to tell why latency stays as it is.
+ */
+[[nodiscard]] auto SetBusyPollOptions(int sockFd, std::chrono::microseconds busyPoll) noexcept
+  -> std::optional<SystemError>;
+
+/* `TCP_QUICKACK` is not permanent: the kernel may go back to delayed
+ * ACKs after any receive, so it is set again after each one.
+ */
+[[nodiscard]] auto RearmQuickAck(int sockFd) noexcept -> std::optional<SystemError>;
+
+/* Lets other sockets bind the address and port that this one is bound to
+ * (`SO_REUSEADDR`, `SO_REUSEPORT`), e.g. a connecting socket next to a
+ * listening one, for TCP simultaneous open. Has to be set on each of
+ * them before it is bound, explicitly or by `connect()`.
+ */
+[[nodiscard]] auto EnablePortReuse(int sockFd) noexcept -> std::optional<SystemError>;
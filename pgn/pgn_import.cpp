@@ -0,0 +1,38 @@
+#include "pgn_importer.hpp"
+
+#include "../utils/cli_args.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <string_view>
+#include <thread>
+
+
+// Usage: pgn_import <file.pgn> [threads = all cores]
+// Parses the whole file and reports the throughput
+auto main(int argc, char** argv) -> int {
+    using namespace NPgn;
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <file.pgn> [threads = all cores]\n";
+        return EXIT_FAILURE;
+    }
+    const auto defaultThreads = int(std::max(std::thread::hardware_concurrency(), 1u));
+    const auto numThreads = std::max(argc > 2 ? ParseIntArg(argv[2], defaultThreads) : defaultThreads, 1);
+
+    // This thread works too
+    auto pool = ThreadPool{numThreads - 1};
+    auto statsOrError = ImportFile(argv[1], pool, [](const Game&) {});
+    if (std::holds_alternative<SystemError>(statsOrError)) {
+        LogErrorAndExit(std::get<SystemError>(statsOrError));
+    }
+    const auto& stats = std::get<ImportStats>(statsOrError);
+    const auto ms = std::max<int64_t>(stats.Time.count(), 1);
+    std::cout << "Games:      " << stats.Games << "\n"
+              << "Bad games:  " << stats.BadGames << "\n"
+              << "Plies:      " << stats.Plies << "\n"
+              << "Size:       " << stats.Bytes / (1 << 20) << "MB\n"
+              << "Time:       " << ms << "ms on " << numThreads << " threads\n"
+              << "Throughput: " << stats.Bytes * 1000 / ms / (1 << 20) << "MB/s, "
+              << stats.Games * 1000 / ms << " games/s, "
+              << stats.Plies * 1000 / ms << " plies/s\n";
+}
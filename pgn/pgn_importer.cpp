@@ -0,0 +1,269 @@
+#include "pgn_importer.hpp"
+#include "scanner.hpp"
+
+#include "../chess/san.hpp"
+#include "../utils/mapped_file/mapped_file.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+
+namespace {
+    using namespace NPgn;
+    using namespace NPgn::NScan;
+
+    static constexpr auto kStartFen =
+        std::string_view{"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"};
+
+    constexpr auto IsDigit(char c) noexcept -> bool { return c >= '0' && c <= '9'; }
+
+    auto ResultFromToken(std::string_view token) noexcept -> std::optional<EResult> {
+        if (token == "1-0") return EResult::WhiteWins;
+        if (token == "0-1") return EResult::BlackWins;
+        if (token == "1/2-1/2") return EResult::Draw;
+        if (token == "*") return EResult::Unknown;
+        return std::nullopt;
+    }
+
+    // Past the closing quote of a tag value starting at `p`
+    auto FindClosingQuote(const char* p, const char* end) noexcept -> const char* {
+        for (;;) {
+            const auto* quote = FindByte(p, end, '"');
+            if (quote == end) return end;
+            auto backslashes = 0;
+            while (quote - backslashes > p && quote[-backslashes - 1] == '\\') ++backslashes;
+            if (backslashes % 2 == 0) return quote;
+            p = quote + 1;
+        }
+    }
+
+    // Past the end of a variation starting at the '(' at `p`,
+    // or nothing if it is not closed
+    auto SkipVariation(const char* p, const char* end) noexcept -> const char* {
+        auto depth = 0;
+        while (p != end) {
+            switch (*p) {
+                case '(': ++depth; break;
+                case ')': if (--depth == 0) return p + 1; break;
+                case '{': p = FindByte(p, end, '}'); if (p == end) return nullptr; break;
+                case ';': p = FindByte(p, end, '\n'); if (p == end) return nullptr; break;
+                default: break;
+            }
+            ++p;
+        }
+        return nullptr;
+    }
+
+    auto PreviousLineIsTag(std::string_view text, size_t lineStart) noexcept -> bool {
+        auto last = lineStart;
+        while (last > 0 && NImpl::IsWhitespace(text[last - 1])) --last;
+        if (last == 0) return false;
+        const auto newline = text.rfind('\n', last - 1);
+        auto first = newline == std::string_view::npos ? 0 : newline + 1;
+        while (NImpl::IsWhitespace(text[first])) ++first;
+        return text[first] == '[';
+    }
+} // anonymous namespace
+
+
+namespace NPgn {
+    auto Game::FindTag(std::string_view name) const noexcept -> std::optional<std::string_view> {
+        for (const auto& tag : Tags) {
+            if (tag.Name == name) return tag.Value;
+        }
+        return std::nullopt;
+    }
+
+    auto ImportStats::operator+=(const ImportStats& other) noexcept -> ImportStats& {
+        Games += other.Games;
+        BadGames += other.BadGames;
+        Plies += other.Plies;
+        Bytes += other.Bytes;
+        return *this;
+    }
+
+    auto GameParser::ParseTags(const char*& p, const char* end) -> bool {
+        Tags_.clear();
+        while (p != end && *p == '[') {
+            const auto* name = SkipWhitespace(p + 1, end);
+            const auto* nameEnd = name;
+            while (nameEnd != end && !NImpl::IsWhitespace(*nameEnd) && *nameEnd != '"') ++nameEnd;
+            const auto* quote = FindByte(nameEnd, end, '"');
+            if (quote == end) return false;
+            const auto* closingQuote = FindClosingQuote(quote + 1, end);
+            if (closingQuote == end) return false;
+            const auto* bracket = FindByte(closingQuote + 1, end, ']');
+            if (bracket == end) return false;
+            Tags_.push_back(Tag{
+                .Name = std::string_view{name, size_t(nameEnd - name)},
+                .Value = std::string_view{quote + 1, size_t(closingQuote - quote - 1)},
+            });
+            p = SkipWhitespace(bracket + 1, end);
+        }
+        return true;
+    }
+
+    auto GameParser::ParseMovetext(const char*& p, const char* end, EResult& result) -> bool {
+        Moves_.clear();
+        for (;;) {
+            p = SkipWhitespace(p, end);
+            if (p == end) return true;
+            switch (*p) {
+                case '[':
+                    // The next game, this one has no result token
+                    return true;
+                case '{': {
+                    const auto* close = FindByte(p + 1, end, '}');
+                    p = close == end ? end : close + 1;
+                    continue;
+                }
+                case ';':
+                case '%':
+                    p = FindByte(p + 1, end, '\n');
+                    continue;
+                case '(':
+                    p = SkipVariation(p, end);
+                    if (!p) return false;
+                    continue;
+                case '$':
+                    p = FindTokenEnd(p + 1, end);
+                    continue;
+                default:
+                    break;
+            }
+
+            if (IsDigit(*p)) {
+                // A move number ("12." or "12..."), a result, or "0-0"
+                const auto* digitsEnd = p;
+                while (digitsEnd != end && IsDigit(*digitsEnd)) ++digitsEnd;
+                if (digitsEnd == end || *digitsEnd == '.' || NImpl::IsWhitespace(*digitsEnd)) {
+                    while (digitsEnd != end && *digitsEnd == '.') ++digitsEnd;
+                    p = digitsEnd;
+                    continue;
+                }
+            }
+            const auto* tokenEnd = FindTokenEnd(p, end);
+            const auto token = std::string_view{p, size_t(tokenEnd - p)};
+            p = tokenEnd;
+            if (const auto tokenResult = ResultFromToken(token)) {
+                result = *tokenResult;
+                return true;
+            }
+            const auto moveOrError = NChess::ParseSan(Pos_, token);
+            const auto* move = std::get_if<NChess::Move>(&moveOrError);
+            if (!move) return false;
+            Pos_.MakeMove(*move);
+            Moves_.push_back(*move);
+        }
+    }
+
+    auto GameParser::ParseAll(
+        std::string_view text, const uint64_t baseOffset, const size_t chunk, const GameCallback& onGame
+    ) -> ImportStats {
+        auto stats = ImportStats{.Bytes = text.size()};
+        const auto* begin = text.data();
+        const auto* end = begin + text.size();
+        const auto* p = begin;
+        for (;;) {
+            p = SkipWhitespace(p, end);
+            if (p == end) break;
+            const auto* gameBegin = p;
+
+            auto ok = ParseTags(p, end);
+            auto fen = std::string_view{};
+            auto result = EResult::Unknown;
+            for (const auto& tag : Tags_) {
+                if (tag.Name == "FEN") fen = tag.Value;
+                if (tag.Name == "Result") result = ResultFromToken(tag.Value).value_or(EResult::Unknown);
+            }
+            ok = ok && !Pos_.SetFromFen(fen.empty() ? kStartFen : fen);
+            ok = ok && ParseMovetext(p, end, result);
+            if (!ok) {
+                ++stats.BadGames;
+                const auto from = size_t(std::max(p, gameBegin + 1) - begin);
+                p = begin + FindGameStart(text, std::min(from, text.size()));
+                continue;
+            }
+            ++stats.Games;
+            stats.Plies += Moves_.size();
+            onGame(Game{
+                .Offset = baseOffset + uint64_t(gameBegin - begin),
+                .Chunk = chunk,
+                .Tags = Tags_,
+                .Fen = fen,
+                .Moves = Moves_,
+                .Result = result,
+            });
+        }
+        return stats;
+    }
+
+    auto FindGameStart(std::string_view text, size_t from) noexcept -> size_t {
+        const auto* begin = text.data();
+        const auto* end = begin + text.size();
+        if (from < text.size() && (from == 0 || text[from - 1] == '\n')
+            && text[from] == '[' && !PreviousLineIsTag(text, from)) {
+            return from;
+        }
+        for (auto p = begin + from; p < end;) {
+            const auto* newline = FindByte(p, end, '\n');
+            if (newline == end) break;
+            const auto lineStart = size_t(newline + 1 - begin);
+            if (lineStart < text.size() && text[lineStart] == '[' && !PreviousLineIsTag(text, lineStart)) {
+                return lineStart;
+            }
+            p = newline + 1;
+        }
+        return text.size();
+    }
+
+    auto ImportText(std::string_view text, const GameCallback& onGame) -> ImportStats {
+        const auto start = std::chrono::steady_clock::now();
+        auto parser = GameParser{};
+        auto stats = parser.ParseAll(text, 0, 0, onGame);
+        stats.Time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        return stats;
+    }
+
+    auto ImportFile(const std::string& path, ThreadPool& pool, const GameCallback& onGame, const size_t chunkSize)
+      -> std::variant<ImportStats, SystemError> {
+        const auto start = std::chrono::steady_clock::now();
+        auto fileOrError = MappedFile::OpenReadOnly(path, MappedFile::EAccessPattern::Sequential);
+        if (std::holds_alternative<SystemError>(fileOrError)) {
+            return std::get<SystemError>(std::move(fileOrError));
+        }
+        const auto& file = std::get<MappedFile>(fileOrError);
+        const auto text = std::string_view{reinterpret_cast<const char*>(file.GetData().data()), file.GetData().size()};
+
+        // Chunk `i` is `[starts[i], starts[i + 1])`, each
+        // boundary being the start of a game
+        auto starts = std::vector<size_t>{0};
+        for (auto pos = std::max<size_t>(chunkSize, 1); pos < text.size();) {
+            const auto boundary = FindGameStart(text, pos);
+            if (boundary >= text.size()) break;
+            if (boundary > starts.back()) starts.push_back(boundary);
+            pos = boundary + std::max<size_t>(chunkSize, 1);
+        }
+        starts.push_back(text.size());
+
+        auto total = ImportStats{};
+        auto totalMutex = std::mutex{};
+        auto nextChunk = std::atomic<size_t>{0};
+        // One parser per task, each taking chunks in turn
+        pool.ForkJoin(pool.GetConcurrency(), [&](int) {
+            auto parser = GameParser{};
+            auto stats = ImportStats{};
+            for (;;) {
+                const auto chunk = nextChunk.fetch_add(1, std::memory_order_relaxed);
+                if (chunk + 1 >= starts.size()) break;
+                const auto chunkText = text.substr(starts[chunk], starts[chunk + 1] - starts[chunk]);
+                stats += parser.ParseAll(chunkText, starts[chunk], chunk, onGame);
+            }
+            const auto lock = std::scoped_lock{totalMutex};
+            total += stats;
+        });
+        total.Time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        return total;
+    }
+} // namespace NPgn
@@ -0,0 +1,110 @@
+#pragma once
+
+
+#include "../chess/position.hpp"
+#include "../chess/types.hpp"
+#include "../utils/error.hpp"
+#include "../utils/thread_pool/thread_pool.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+
+namespace NPgn {
+    enum class EResult : uint8_t {
+        WhiteWins,
+        BlackWins,
+        Draw,
+        Unknown,
+    };
+
+    struct Tag {
+        std::string_view Name;
+        // Raw: the `\"` and `\\` escapes are left as they are
+        std::string_view Value;
+    };
+
+    /* A parsed game. It only lives during the callback it is passed to:
+     * the tags point into the input text and the moves into the buffer
+     * of the parser, both reused for the next game.
+     */
+    struct Game {
+        // Byte offset of the game's first tag in the input
+        uint64_t Offset;
+        // Index of the chunk of the input the game was parsed from;
+        // ordering by it and by `Offset` restores the input order
+        size_t Chunk;
+        std::span<const Tag> Tags;
+        // Empty for the standard starting position
+        std::string_view Fen;
+        std::span<const NChess::Move> Moves;
+        EResult Result;
+
+        [[nodiscard]] auto FindTag(std::string_view name) const noexcept -> std::optional<std::string_view>;
+    };
+
+    struct ImportStats {
+        uint64_t Games = 0;
+        // Games skipped because of a bad tag, an illegal or unparsable
+        // move, or a bad FEN
+        uint64_t BadGames = 0;
+        uint64_t Plies = 0;
+        uint64_t Bytes = 0;
+        std::chrono::milliseconds Time{0};
+
+        auto operator+=(const ImportStats& other) noexcept -> ImportStats&;
+    };
+
+    // Called for every game, concurrently from the worker threads
+    using GameCallback = std::function<void(const Game&)>;
+
+    /* Parses PGN text game by game, resolving every SAN move against the
+     * position. Comments, variations and NAGs are skipped; a game with a
+     * move that can't be resolved is counted as bad and parsing resumes
+     * at the next game. One parser is reused for many games, so no memory
+     * is allocated per game once its buffers have grown.
+     */
+    class GameParser {
+    private:
+        NChess::Position Pos_;
+        std::vector<NChess::Move> Moves_;
+        std::vector<Tag> Tags_;
+    private:
+        // Both advance `p` and return false if the game is malformed
+        auto ParseTags(const char*& p, const char* end) -> bool;
+        auto ParseMovetext(const char*& p, const char* end, EResult& result) -> bool;
+    public:
+        // `baseOffset` and `chunk` are copied to the games' `Offset` and `Chunk`
+        auto ParseAll(std::string_view text, uint64_t baseOffset, size_t chunk, const GameCallback& onGame)
+          -> ImportStats;
+    };
+
+    /* The start of the first game at or after `from`: a line that begins
+     * with '[' and does not follow another tag line. Returns `text.size()`
+     * if there is none.
+     */
+    [[nodiscard]] auto FindGameStart(std::string_view text, size_t from) noexcept -> size_t;
+
+    // Parses `text` on the calling thread
+    [[nodiscard]] auto ImportText(std::string_view text, const GameCallback& onGame) -> ImportStats;
+
+    /* Memory-maps the file and parses it on the threads of `pool`. The
+     * file is cut into chunks of about `chunkSize` bytes at game
+     * boundaries, and the threads take chunks in file order, so the
+     * pages read are sequential and only the parser buffers are
+     * allocated, whatever the file size.
+     */
+    [[nodiscard]] auto ImportFile(
+        const std::string& path,
+        ThreadPool& pool,
+        const GameCallback& onGame,
+        size_t chunkSize = size_t{4} << 20
+    ) -> std::variant<ImportStats, SystemError>;
+} // namespace NPgn
@@ -0,0 +1,128 @@
+#pragma once
+
+
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+
+/* Vectorized byte classification for the PGN tokenizer.
+ *
+ * Each function returns the first position in `[p, end)` whose byte
+ * belongs to a class, or `end`. Whole vectors are compared at once (32
+ * bytes with AVX2, 16 with SSE2 or NEON, chosen at compile time since
+ * one of them is always part of the target's baseline) and the tail is
+ * finished byte by byte, so nothing is read past `end`.
+ */
+namespace NPgn::NScan {
+    namespace NImpl {
+        // Whitespace in the PGN sense: any control character or space.
+        // Bytes >= 0x80 (UTF-8 in names and comments) are not
+        constexpr auto IsWhitespace(char c) noexcept -> bool {
+            return uint8_t(c) <= uint8_t(' ');
+        }
+        constexpr auto IsTokenEnd(char c) noexcept -> bool {
+            return IsWhitespace(c) || c == '(' || c == ')' || c == '{' || c == '}' || c == ';';
+        }
+
+#if defined(__AVX2__)
+        static constexpr auto kWidth = 32;
+        using Vector = __m256i;
+        inline auto Load(const char* p) noexcept -> Vector {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        }
+        inline auto Splat(char c) noexcept -> Vector { return _mm256_set1_epi8(c); }
+        inline auto Eq(Vector a, Vector b) noexcept -> Vector { return _mm256_cmpeq_epi8(a, b); }
+        inline auto Or(Vector a, Vector b) noexcept -> Vector { return _mm256_or_si256(a, b); }
+        inline auto LessOrEqualUnsigned(Vector a, Vector b) noexcept -> Vector {
+            return _mm256_cmpeq_epi8(_mm256_min_epu8(a, b), a);
+        }
+        // Bit `i` (or bits `[k * i, k * (i + 1))`) set for matching byte `i`
+        inline auto Mask(Vector v) noexcept -> uint64_t { return uint32_t(_mm256_movemask_epi8(v)); }
+        static constexpr auto kBitsPerByte = 1;
+#elif defined(__SSE2__)
+        static constexpr auto kWidth = 16;
+        using Vector = __m128i;
+        inline auto Load(const char* p) noexcept -> Vector {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        }
+        inline auto Splat(char c) noexcept -> Vector { return _mm_set1_epi8(c); }
+        inline auto Eq(Vector a, Vector b) noexcept -> Vector { return _mm_cmpeq_epi8(a, b); }
+        inline auto Or(Vector a, Vector b) noexcept -> Vector { return _mm_or_si128(a, b); }
+        inline auto LessOrEqualUnsigned(Vector a, Vector b) noexcept -> Vector {
+            return _mm_cmpeq_epi8(_mm_min_epu8(a, b), a);
+        }
+        inline auto Mask(Vector v) noexcept -> uint64_t { return uint32_t(_mm_movemask_epi8(v)); }
+        static constexpr auto kBitsPerByte = 1;
+#elif defined(__ARM_NEON)
+        static constexpr auto kWidth = 16;
+        using Vector = uint8x16_t;
+        inline auto Load(const char* p) noexcept -> Vector { return vld1q_u8(reinterpret_cast<const uint8_t*>(p)); }
+        inline auto Splat(char c) noexcept -> Vector { return vdupq_n_u8(uint8_t(c)); }
+        inline auto Eq(Vector a, Vector b) noexcept -> Vector { return vceqq_u8(a, b); }
+        inline auto Or(Vector a, Vector b) noexcept -> Vector { return vorrq_u8(a, b); }
+        inline auto LessOrEqualUnsigned(Vector a, Vector b) noexcept -> Vector { return vcleq_u8(a, b); }
+        // NEON has no movemask: narrowing by 4 bits leaves a nibble per byte
+        inline auto Mask(Vector v) noexcept -> uint64_t {
+            return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0);
+        }
+        static constexpr auto kBitsPerByte = 4;
+#else
+        // No vector unit: everything goes through the scalar tail
+        static constexpr auto kWidth = 0;
+        using Vector = int;
+        inline auto Load(const char*) noexcept -> Vector { return 0; }
+        inline auto Splat(char) noexcept -> Vector { return 0; }
+        inline auto Eq(Vector, Vector) noexcept -> Vector { return 0; }
+        inline auto Or(Vector, Vector) noexcept -> Vector { return 0; }
+        inline auto LessOrEqualUnsigned(Vector, Vector) noexcept -> Vector { return 0; }
+        inline auto Mask(Vector) noexcept -> uint64_t { return 0; }
+        static constexpr auto kBitsPerByte = 1;
+#endif
+
+        template <class VectorMatch, class ScalarMatch>
+        inline auto Find(const char* p, const char* end, VectorMatch&& vectorMatch, ScalarMatch&& scalarMatch) noexcept
+          -> const char* {
+            if constexpr (kWidth > 0) {
+                for (; end - p >= kWidth; p += kWidth) {
+                    if (const auto mask = Mask(vectorMatch(Load(p)))) {
+                        return p + __builtin_ctzll(mask) / kBitsPerByte;
+                    }
+                }
+            }
+            while (p != end && !scalarMatch(*p)) ++p;
+            return p;
+        }
+    } // namespace NImpl
+
+    inline auto FindByte(const char* p, const char* end, char c) noexcept -> const char* {
+        using namespace NImpl;
+        return Find(p, end,
+            [c](auto v) { return Eq(v, Splat(c)); },
+            [c](char x) { return x == c; });
+    }
+
+    inline auto SkipWhitespace(const char* p, const char* end) noexcept -> const char* {
+        using namespace NImpl;
+        return Find(p, end,
+            [](auto v) { return Eq(LessOrEqualUnsigned(v, Splat(' ')), Splat(0)); },
+            [](char x) { return !IsWhitespace(x); });
+    }
+
+    // The end of a move token such as "Nbd7+!?"
+    inline auto FindTokenEnd(const char* p, const char* end) noexcept -> const char* {
+        using namespace NImpl;
+        return Find(p, end,
+            [](auto v) {
+                return Or(Or(LessOrEqualUnsigned(v, Splat(' ')), Or(Eq(v, Splat('(')), Eq(v, Splat(')')))),
+                          Or(Or(Eq(v, Splat('{')), Eq(v, Splat('}'))), Eq(v, Splat(';'))));
+            },
+            [](char x) { return IsTokenEnd(x); });
+    }
+} // namespace NPgn::NScan
@@ -0,0 +1,174 @@
+#include "../pgn_importer.hpp"
+#include "../scanner.hpp"
+
+#include "../../chess/san.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+
+namespace {
+using namespace NChess;
+using namespace NPgn;
+
+// Comments, a nested variation, NAGs, a "%" escape line, move numbers
+// glued to moves, castling, en passant and an underpromotion
+static constexpr auto kGames = std::string_view{R"([Event "Test \"1\""]
+[White "A"]
+[Black "B"]
+[Result "1-0"]
+
+1.e4 {best by test} e5 2. Nf3 (2. f4 exf4 (2... d5) 3. Nf3) 2... Nc6 $1
+3. Bb5 a6!? 4. Ba4 Nf6 5. O-O Be7 1-0
+
+[Event "Bad"]
+[Result "*"]
+
+1. e4 e5 2. Ke3 *
+
+[Event "Position"]
+[SetUp "1"]
+[FEN "4k3/1P6/8/3pP3/8/8/8/4K3 w - d6 0 1"]
+[Result "1/2-1/2"]
+
+%escaped line
+1. exd6 Kd7 2. b8=N+ Kxd6 ; rest of line
+1/2-1/2
+[Event "No result token"]
+
+1. d4 d5
+)"};
+
+auto Collect(std::string_view text) -> std::pair<std::vector<std::string>, ImportStats> {
+    auto games = std::vector<std::string>{};
+    const auto stats = ImportText(text, [&games](const Game& game) {
+        auto out = std::ostringstream{};
+        out << game.FindTag("Event").value_or("?") << ":" << int(game.Result);
+        for (const auto m : game.Moves) out << " " << m;
+        games.push_back(out.str());
+    });
+    return {games, stats};
+}
+} // anonymous namespace
+
+
+namespace NTests {
+auto TestScanner() -> void {
+    using namespace NScan;
+    const auto text = std::string{"    \t\n  abc   e8=Q+!?  {x} Nf3(  ..."};
+    for (auto offset = size_t{0}; offset < text.size(); ++offset) {
+        const auto* begin = text.data() + offset;
+        const auto* end = text.data() + text.size();
+        auto expected = begin;
+        while (expected != end && uint8_t(*expected) <= ' ') ++expected;
+        assert(SkipWhitespace(begin, end) == expected);
+        expected = begin;
+        while (expected != end && *expected != '{') ++expected;
+        assert(FindByte(begin, end, '{') == expected);
+    }
+    const auto* token = text.data() + text.find('e');
+    assert(std::string_view(token, FindTokenEnd(token, text.data() + text.size())) == "e8=Q+!?");
+    const auto* knight = text.data() + text.find('N');
+    assert(std::string_view(knight, FindTokenEnd(knight, text.data() + text.size())) == "Nf3");
+    std::cerr << "TestScanner OK\n";
+}
+
+auto TestSan() -> void {
+    auto pos = Position{};
+    assert(!pos.SetFromFen("r3k2r/8/8/8/8/2N3N1/8/R3K2R w KQkq - 0 1"));
+    const auto san = [&pos](std::string_view s) {
+        const auto moveOrError = ParseSan(pos, s);
+        auto out = std::ostringstream{};
+        if (const auto* m = std::get_if<Move>(&moveOrError)) out << *m;
+        return out.str();
+    };
+    // Both knights reach e4 and e2
+    assert(san("Ne4").empty());
+    assert(san("Nce4") == "c3e4");
+    assert(san("Nge2+") == "g3e2");
+    assert(san("N3e4").empty());
+    assert(san("O-O") == "e1g1");
+    assert(san("O-O-O") == "e1c1");
+    assert(san("Rxa8+") == "a1a8");
+    assert(san("Ra9").empty());
+    assert(san("e4").empty());
+
+    assert(!pos.SetFromFen("4k3/8/8/8/8/8/3N4/4K1N1 w - - 0 1"));
+    assert(san("Nf3").empty());
+    assert(san("Ndf3") == "d2f3");
+    // The knight on d2 is pinned, so Nf3 is not ambiguous
+    assert(!pos.SetFromFen("4k3/8/8/b7/8/8/3N4/4K1N1 w - - 0 1"));
+    assert(san("Nf3") == "g1f3");
+    assert(san("Nb3").empty());
+    std::cerr << "TestSan OK\n";
+}
+
+auto TestImportText() -> void {
+    const auto [games, stats] = Collect(kGames);
+    assert(stats.Games == 3 && stats.BadGames == 1);
+    assert(games.size() == 3);
+    assert(games[0] == R"(Test \"1\":0 e2e4 e7e5 g1f3 b8c6 f1b5 a7a6 b5a4 g8f6 e1g1 f8e7)");
+    assert(games[1] == "Position:2 e5d6 e8d7 b7b8n d7d6");
+    assert(games[2] == "No result token:3 d2d4 d7d5");
+    assert(stats.Plies == 16);
+    std::cerr << "TestImportText OK\n";
+}
+
+auto TestFindGameStart() -> void {
+    const auto second = kGames.find("[Event \"Bad\"]");
+    assert(FindGameStart(kGames, 0) == 0);
+    assert(FindGameStart(kGames, 1) == second);
+    // Not in the middle of a tag section
+    assert(FindGameStart(kGames, kGames.find("[White")) == second);
+    assert(FindGameStart(kGames, second) == second);
+    assert(FindGameStart(kGames, kGames.size() - 3) == kGames.size());
+    std::cerr << "TestFindGameStart OK\n";
+}
+
+// Chunks of any size and any number of threads see the same games
+auto TestImportFileInChunks() -> void {
+    const auto path = std::string{"/tmp/pgn_ut.pgn"};
+    {
+        auto out = std::ofstream{path, std::ios::binary};
+        for (auto i = 0; i < 500; ++i) out << kGames << "\n";
+    }
+    for (const auto& [threads, chunkSize] : {std::pair{1, size_t{1} << 20}, std::pair{3, size_t{1000}}, std::pair{4, size_t{1}}}) {
+        auto mutex = std::mutex{};
+        auto plies = uint64_t{0};
+        auto offsets = std::vector<uint64_t>{};
+        auto pool = ThreadPool{threads - 1};
+        const auto statsOrError = ImportFile(path, pool, [&](const Game& game) {
+            const auto lock = std::scoped_lock{mutex};
+            plies += game.Moves.size();
+            offsets.push_back(game.Offset);
+        }, chunkSize);
+        assert(std::holds_alternative<ImportStats>(statsOrError));
+        const auto& stats = std::get<ImportStats>(statsOrError);
+        assert(stats.Games == 1500 && stats.BadGames == 500);
+        assert(stats.Plies == plies && plies == 500 * 16);
+        std::sort(offsets.begin(), offsets.end());
+        assert(std::adjacent_find(offsets.begin(), offsets.end()) == offsets.end());
+    }
+    auto pool = ThreadPool{0};
+    assert(std::holds_alternative<SystemError>(ImportFile("/nonexistent.pgn", pool, [](const Game&) {})));
+    std::remove(path.c_str());
+    std::cerr << "TestImportFileInChunks OK\n";
+}
+} // namespace NTests
+
+
+auto main() -> int {
+    using namespace NTests;
+    TestScanner();
+    TestSan();
+    TestImportText();
+    TestFindGameStart();
+    TestImportFileInChunks();
+    std::cerr << "All tests passed.\n";
+}
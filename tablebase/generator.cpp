@@ -0,0 +1,461 @@
+#include "generator.hpp"
+
+#include "../chess/bitboard.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <fcntl.h>
+#include <tuple>
+#include <unistd.h>
+
+
+namespace {
+    using namespace NTablebase;
+
+    // Values during generation: plies to mate (odd for a win of the side
+    // to move, even for a loss) or one of these
+    static constexpr auto kUnknown = uint16_t{0xFFFF};
+    static constexpr auto kIllegal = uint16_t{0xFFFE};
+    static constexpr auto kDraw = uint16_t{0xFFFD};
+
+    constexpr auto IsWin(uint16_t v) noexcept -> bool { return v < kDraw && v % 2 == 1; }
+
+    // How good a value is for the side to move, to pick the best conversion
+    constexpr auto Preference(uint16_t v) noexcept -> int {
+        if (v == kUnknown) return -1'000'000;
+        if (v == kDraw) return 0;
+        return IsWin(v) ? 100'000 - v : -100'000 + v;
+    }
+
+    // Positions per task of a pass over a table
+    static constexpr auto kChunkSize = uint64_t{1} << 14;
+
+    auto Occupancy(const PiecePlacement& p) noexcept -> Bitboard {
+        auto occ = Bitboard{0};
+        for (auto i = 0; i < p.NumPieces; ++i) occ |= SquareBb(p.Squares[i]);
+        return occ;
+    }
+
+    auto Occupancy(const PiecePlacement& p, Color c) noexcept -> Bitboard {
+        auto occ = Bitboard{0};
+        for (auto i = 0; i < p.NumPieces; ++i) {
+            if (ColorOf(p.Pieces[i]) == c) occ |= SquareBb(p.Squares[i]);
+        }
+        return occ;
+    }
+
+    auto KingSquareOf(const PiecePlacement& p, Color c) noexcept -> Square {
+        for (auto i = 0; i < p.NumPieces; ++i) {
+            if (p.Pieces[i] == MakePiece(c, King)) return p.Squares[i];
+        }
+        return NoSquare;
+    }
+
+    auto IsAttacked(const PiecePlacement& p, Square target, Color by, Bitboard occ) noexcept -> bool {
+        for (auto i = 0; i < p.NumPieces; ++i) {
+            const auto piece = p.Pieces[i];
+            if (ColorOf(piece) != by) continue;
+            const auto attacks = TypeOf(piece) == Pawn
+                ? PawnAttacks(by, p.Squares[i])
+                : Attacks(TypeOf(piece), p.Squares[i], occ);
+            if (attacks & SquareBb(target)) return true;
+        }
+        return false;
+    }
+
+    // No overlapping pieces, no pawns on the back ranks,
+    // and the side not to move is not in check
+    auto IsLegal(const PiecePlacement& p) noexcept -> bool {
+        const auto occ = Occupancy(p);
+        if (PopCount(occ) != p.NumPieces) return false;
+        for (auto i = 0; i < p.NumPieces; ++i) {
+            const auto rank = RankOf(p.Squares[i]);
+            if (TypeOf(p.Pieces[i]) == Pawn && (rank == 0 || rank == 7)) return false;
+        }
+        return !IsAttacked(p, KingSquareOf(p, ~p.SideToMove), p.SideToMove, occ);
+    }
+
+    auto InCheck(const PiecePlacement& p) noexcept -> bool {
+        return IsAttacked(p, KingSquareOf(p, p.SideToMove), ~p.SideToMove, Occupancy(p));
+    }
+
+    // Calls `f(child, isConversion)` for every legal move of `p`
+    template <class F>
+    auto ForEachChild(const PiecePlacement& p, F&& f) -> void {
+        const auto us = p.SideToMove;
+        const auto occ = Occupancy(p);
+        const auto own = Occupancy(p, us);
+        const auto enemy = occ & ~own;
+        for (auto i = 0; i < p.NumPieces; ++i) {
+            const auto piece = p.Pieces[i];
+            if (ColorOf(piece) != us) continue;
+            const auto from = p.Squares[i];
+            auto targets = Bitboard{0};
+            if (TypeOf(piece) == Pawn) {
+                const auto push = Square(from + PawnPush(us));
+                if (!(occ & SquareBb(push))) {
+                    targets |= SquareBb(push);
+                    const auto doublePush = Square(push + PawnPush(us));
+                    if (RelativeRank(us, RankOf(from)) == 1 && !(occ & SquareBb(doublePush))) {
+                        targets |= SquareBb(doublePush);
+                    }
+                }
+                targets |= PawnAttacks(us, from) & enemy;
+            } else {
+                targets = Attacks(TypeOf(piece), from, occ) & ~own;
+            }
+            while (targets) {
+                const auto to = PopLsb(targets);
+                auto child = PiecePlacement{};
+                child.SideToMove = ~us;
+                auto captured = NoPiece;
+                for (auto j = 0; j < p.NumPieces; ++j) {
+                    if (p.Squares[j] == to) {
+                        captured = p.Pieces[j];
+                    } else {
+                        child.Add(p.Pieces[j], j == i ? to : p.Squares[j]);
+                    }
+                }
+                // Can't happen in a legal position
+                if (captured != NoPiece && TypeOf(captured) == King) continue;
+                const auto childOcc = (occ & ~SquareBb(from)) | SquareBb(to);
+                if (IsAttacked(child, KingSquareOf(child, us), ~us, childOcc)) continue;
+                const auto promotes = TypeOf(piece) == Pawn && RelativeRank(us, RankOf(to)) == 7;
+                if (!promotes) {
+                    f(child, captured != NoPiece);
+                    continue;
+                }
+                const auto moved = std::find(child.Squares.begin(), child.Squares.end(), to) - child.Squares.begin();
+                for (const auto pt : {Queen, Rook, Bishop, Knight}) {
+                    child.Pieces[moved] = MakePiece(us, pt);
+                    f(child, true);
+                }
+            }
+        }
+    }
+
+    // Calls `f(parent)` for every position from which a non-capturing,
+    // non-promoting move of the side not to move leads to `p`
+    template <class F>
+    auto ForEachParent(const PiecePlacement& p, F&& f) -> void {
+        const auto them = ~p.SideToMove;
+        const auto occ = Occupancy(p);
+        for (auto i = 0; i < p.NumPieces; ++i) {
+            const auto piece = p.Pieces[i];
+            if (ColorOf(piece) != them) continue;
+            const auto to = p.Squares[i];
+            auto sources = Bitboard{0};
+            if (TypeOf(piece) == Pawn) {
+                const auto rank = RelativeRank(them, RankOf(to));
+                const auto from = Square(to - PawnPush(them));
+                if (rank >= 2 && !(occ & SquareBb(from))) {
+                    sources |= SquareBb(from);
+                    const auto doubleFrom = Square(from - PawnPush(them));
+                    if (rank == 3 && !(occ & SquareBb(doubleFrom))) sources |= SquareBb(doubleFrom);
+                }
+            } else {
+                sources = Attacks(TypeOf(piece), to, occ) & ~occ;
+            }
+            while (sources) {
+                auto parent = p;
+                parent.Squares[i] = PopLsb(sources);
+                parent.SideToMove = them;
+                f(parent);
+            }
+        }
+    }
+
+    // A conversion's value for the side making it
+    auto ConversionValue(const ProbeResult& child) noexcept -> uint16_t {
+        // A win of the opponent in d plies is a loss in d + 1, and vice versa
+        return child.Wdl == EWdl::Draw ? kDraw : uint16_t(child.Dtm + 1);
+    }
+
+    auto SortedUnique(uint64_t* begin, uint64_t* end) noexcept -> uint64_t* {
+        std::sort(begin, end);
+        return std::unique(begin, end);
+    }
+
+    auto Canonical(const Material& m) noexcept -> Material {
+        return m.IsCanonical() ? m : m.Flipped();
+    }
+
+    // The tables `material` converts into, except the always drawn KvK
+    auto Subtables(const Material& material) -> std::vector<Material> {
+        auto result = std::vector<Material>{};
+        for (const auto c : {White, Black}) {
+            for (auto pt = 0; pt < King; ++pt) {
+                if (material.Count[c][pt] == 0) continue;
+                auto captured = material;
+                --captured.Count[c][pt];
+                if (captured.NumPieces() > 2) result.push_back(Canonical(captured));
+                if (pt != Pawn) continue;
+                for (const auto promotion : {Knight, Bishop, Rook, Queen}) {
+                    auto promoted = captured;
+                    ++promoted.Count[c][promotion];
+                    result.push_back(Canonical(promoted));
+                }
+            }
+        }
+        return result;
+    }
+
+    auto AtomicMax(std::atomic<int>& x, int value) noexcept -> void {
+        auto current = x.load(std::memory_order_relaxed);
+        while (current < value && !x.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+} // anonymous namespace
+
+
+namespace NTablebase {
+    auto AllMaterials(const int maxPieces) -> std::vector<Material> {
+        // Non-king pieces of one side, as multisets of piece types
+        auto sides = std::vector<std::array<uint8_t, kNumPieceTypes>>{{}};
+        for (auto size = 1; size <= maxPieces - 2; ++size) {
+            const auto previous = sides;
+            for (const auto& side : previous) {
+                auto count = 0;
+                auto highest = 0;
+                for (auto pt = 0; pt < King; ++pt) {
+                    count += side[pt];
+                    if (side[pt]) highest = pt;
+                }
+                if (count != size - 1) continue;
+                // Adding types in non-decreasing order makes each multiset once
+                for (auto pt = highest; pt < King; ++pt) {
+                    auto bigger = side;
+                    ++bigger[pt];
+                    sides.push_back(bigger);
+                }
+            }
+        }
+
+        auto materials = std::vector<Material>{};
+        for (const auto& white : sides) {
+            for (const auto& black : sides) {
+                const auto material = Material{.Count = {white, black}};
+                if (material.NumPieces() < 3 || material.NumPieces() > maxPieces || !material.IsCanonical()) continue;
+                materials.push_back(material);
+            }
+        }
+        const auto order = [](const Material& m) {
+            return std::tuple{m.NumPieces(), m.Count[White][Pawn] + m.Count[Black][Pawn], m.Name()};
+        };
+        std::sort(materials.begin(), materials.end(), [&order](const auto& a, const auto& b) {
+            return order(a) < order(b);
+        });
+        return materials;
+    }
+
+    auto GenerateTable(const Material& material, const Tablebases& subtables, ThreadPool& pool)
+      -> std::variant<GeneratedTable, GenericError> {
+        for (const auto& sub : Subtables(material)) {
+            if (!subtables.HasTable(sub)) {
+                return GenericError{
+                    .Value = "table " + sub.Name() + " is missing",
+                    .ContextMessage = "Can't generate " + material.Name(),
+                };
+            }
+        }
+        const auto start = std::chrono::steady_clock::now();
+        const auto layout = TableLayout{material};
+        const auto size = layout.GetNumPositions();
+        auto values = std::vector<uint16_t>(size);
+        // The best capture or promotion of each position
+        auto conversions = std::vector<uint16_t>(size);
+        // Distinct moves to positions of this table yet to be refuted
+        auto counters = std::vector<uint8_t>(size);
+        auto maxPly = std::atomic<int>{0};
+
+        pool.ParallelFor(0, size, kChunkSize, [&](uint64_t begin, uint64_t end) {
+            auto children = std::array<uint64_t, 256>{};
+            for (auto index = begin; index < end; ++index) {
+                const auto p = layout.Decode(index);
+                if (!IsLegal(p) || layout.CanonicalIndex(p) != index) {
+                    values[index] = kIllegal;
+                    continue;
+                }
+                auto numChildren = 0;
+                auto conversion = kUnknown;
+                ForEachChild(p, [&](const PiecePlacement& child, bool isConversion) {
+                    if (!isConversion) {
+                        children[numChildren++] = layout.CanonicalIndex(child);
+                        return;
+                    }
+                    // Present, as checked above
+                    const auto value = ConversionValue(*subtables.Probe(child));
+                    if (Preference(value) > Preference(conversion)) conversion = value;
+                });
+                const auto numDistinct = SortedUnique(children.data(), children.data() + numChildren) - children.data();
+                counters[index] = uint8_t(numDistinct);
+                conversions[index] = conversion;
+                auto value = kUnknown;
+                if (numDistinct == 0 && conversion == kUnknown) {
+                    value = InCheck(p) ? uint16_t{0} : kDraw;
+                } else if (numDistinct == 0 || IsWin(conversion)) {
+                    value = conversion;
+                }
+                values[index] = value;
+                if (value < kDraw) AtomicMax(maxPly, value);
+            }
+        });
+
+        for (auto ply = 0; ply <= maxPly.load(); ++ply) {
+            pool.ParallelFor(0, size, kChunkSize, [&](uint64_t begin, uint64_t end) {
+                auto parents = std::array<uint64_t, 256>{};
+                for (auto index = begin; index < end; ++index) {
+                    if (std::atomic_ref{values[index]}.load(std::memory_order_relaxed) != ply) continue;
+                    auto numParents = 0;
+                    ForEachParent(layout.Decode(index), [&](const PiecePlacement& parent) {
+                        parents[numParents++] = layout.CanonicalIndex(parent);
+                    });
+                    const auto* parentsEnd = SortedUnique(parents.data(), parents.data() + numParents);
+                    for (const auto* it = parents.data(); it != parentsEnd; ++it) {
+                        auto parentValue = std::atomic_ref{values[*it]};
+                        auto current = parentValue.load(std::memory_order_relaxed);
+                        if (current == kIllegal) continue;
+                        const auto next = uint16_t(ply + 1);
+                        if (ply % 2 == 0) {
+                            // A move into a loss wins
+                            while (current == kUnknown || (IsWin(current) && current > next)) {
+                                if (parentValue.compare_exchange_weak(current, next, std::memory_order_relaxed)) {
+                                    AtomicMax(maxPly, next);
+                                    break;
+                                }
+                            }
+                        } else if (std::atomic_ref{counters[*it]}.fetch_sub(1, std::memory_order_relaxed) == 1) {
+                            // Every move within the table loses; a drawing
+                            // conversion leaves it undecided, that is drawn
+                            const auto conversion = conversions[*it];
+                            if (conversion == kDraw) continue;
+                            const auto loss = conversion == kUnknown ? next : std::max(next, conversion);
+                            current = kUnknown;
+                            if (parentValue.compare_exchange_strong(current, loss, std::memory_order_relaxed)) {
+                                AtomicMax(maxPly, loss);
+                            }
+                        }
+                    }
+                }
+            });
+        }
+
+        auto table = GeneratedTable{.Signature = material, .Codes = std::vector<uint16_t>(size)};
+        for (auto index = uint64_t{0}; index < size; ++index) {
+            const auto value = values[index];
+            if (value == kIllegal) {
+                table.Codes[index] = uint16_t(NFormat::kDtmUnused);
+                continue;
+            }
+            ++table.NumUsed;
+            if (value == kUnknown || value == kDraw) {
+                table.Codes[index] = uint16_t(NFormat::kDtmDraw);
+                ++table.NumDraws;
+                continue;
+            }
+            table.Codes[index] = uint16_t(value + NFormat::kDtmOffset);
+            ++(IsWin(value) ? table.NumWins : table.NumLosses);
+            table.MaxDtm = std::max(table.MaxDtm, int(value));
+        }
+        table.Time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        return table;
+    }
+
+    auto WriteTable(const std::string& directory, const GeneratedTable& table) noexcept
+      -> std::variant<uint64_t, SystemError> {
+        const auto numPositions = uint64_t(table.Codes.size());
+        auto maxCode = uint32_t{NFormat::kDtmUnused};
+        for (const auto code : table.Codes) maxCode = std::max(maxCode, uint32_t(code));
+        const auto dtmBits = int(std::bit_width(maxCode));
+
+        auto header = NFormat::FileHeader{};
+        std::memcpy(header.Magic, NFormat::kMagic.data(), sizeof(header.Magic));
+        header.Version = NFormat::kVersion;
+        const auto name = table.Signature.Name();
+        std::memcpy(header.Name, name.data(), std::min(name.size(), sizeof(header.Name)));
+        header.NumPositions = numPositions;
+        header.DtmBits = uint32_t(dtmBits);
+
+        const auto wdlSize = NFormat::SectionSize(numPositions, NFormat::kWdlBits);
+        const auto dtmSize = NFormat::SectionSize(numPositions, dtmBits);
+        auto bytes = std::vector<uint8_t>(sizeof(header) + wdlSize + dtmSize);
+        std::memcpy(bytes.data(), &header, sizeof(header));
+        auto* wdl = bytes.data() + sizeof(header);
+        auto* dtm = wdl + wdlSize;
+        const auto put = [](uint8_t* section, uint64_t bit, int width, uint32_t value) {
+            for (auto b = 0; b < width; ++b, ++bit) {
+                if (value >> b & 1) section[bit / 8] |= uint8_t(1 << (bit % 8));
+            }
+        };
+        for (auto index = uint64_t{0}; index < numPositions; ++index) {
+            const auto code = table.Codes[index];
+            const auto wdlCode = code == NFormat::kDtmUnused ? NFormat::kWdlUnused
+                : code == NFormat::kDtmDraw ? uint8_t(EWdl::Draw)
+                : (code - NFormat::kDtmOffset) % 2 == 1 ? uint8_t(EWdl::Win)
+                : uint8_t(EWdl::Loss);
+            put(wdl, index * NFormat::kWdlBits, NFormat::kWdlBits, wdlCode);
+            put(dtm, index * dtmBits, dtmBits, code);
+        }
+
+        // Written next to the final file and renamed, so that a
+        // reader never maps a partially written table
+        const auto path = directory + "/" + NFormat::FileName(table.Signature);
+        const auto tmpPath = path + ".tmp";
+        const auto fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd == -1) {
+            return SystemError{
+                .Value = std::errc{errno},
+                .ContextMessage = "open() syscall failed for \"" + tmpPath + "\" (" SOURCE_LOCATION ")",
+            };
+        }
+        for (auto written = size_t{0}; written < bytes.size();) {
+            const auto n = write(fd, bytes.data() + written, bytes.size() - written);
+            if (n == -1) {
+                if (errno == EINTR) continue;
+                const auto err = errno;
+                close(fd);
+                return SystemError{
+                    .Value = std::errc{err},
+                    .ContextMessage = "write() syscall failed (" SOURCE_LOCATION ")",
+                };
+            }
+            written += size_t(n);
+        }
+        close(fd);
+        if (rename(tmpPath.c_str(), path.c_str()) == -1) {
+            return SystemError{
+                .Value = std::errc{errno},
+                .ContextMessage = "rename() syscall failed for \"" + path + "\" (" SOURCE_LOCATION ")",
+            };
+        }
+        return uint64_t(bytes.size());
+    }
+
+    auto GenerateAll(
+        const std::string& directory,
+        const int maxPieces,
+        ThreadPool& pool,
+        const std::function<void(const GeneratedTable& table, uint64_t fileSize)>& onTable
+    ) -> std::optional<std::variant<SystemError, GenericError>> {
+        auto tablebases = Tablebases{};
+        for (const auto& material : AllMaterials(maxPieces)) {
+            auto tableOrError = GenerateTable(material, tablebases, pool);
+            if (std::holds_alternative<GenericError>(tableOrError)) {
+                return std::get<GenericError>(std::move(tableOrError));
+            }
+            const auto& table = std::get<GeneratedTable>(tableOrError);
+            auto sizeOrError = WriteTable(directory, table);
+            if (std::holds_alternative<SystemError>(sizeOrError)) {
+                return std::get<SystemError>(std::move(sizeOrError));
+            }
+            // Later tables convert into this one
+            if (auto error = tablebases.AddTable(directory + "/" + NFormat::FileName(material))) {
+                return std::move(*error);
+            }
+            onTable(table, std::get<uint64_t>(sizeOrError));
+        }
+        return std::nullopt;
+    }
+} // namespace NTablebase
@@ -0,0 +1,66 @@
+#pragma once
+
+
+#include "indexing.hpp"
+#include "tablebases.hpp"
+
+#include "../utils/error.hpp"
+#include "../utils/thread_pool/thread_pool.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+
+namespace NTablebase {
+    struct GeneratedTable {
+        Material Signature;
+        // DTM codes of the file format, by index
+        std::vector<uint16_t> Codes;
+
+        uint64_t NumUsed = 0;
+        uint64_t NumWins = 0;
+        uint64_t NumDraws = 0;
+        uint64_t NumLosses = 0;
+        int MaxDtm = 0;
+        std::chrono::milliseconds Time{0};
+    };
+
+    // Every canonical material of 3 to `maxPieces` pieces, in an order
+    // where the tables a table converts into (by a capture or a
+    // promotion) come before it
+    [[nodiscard]] auto AllMaterials(int maxPieces) -> std::vector<Material>;
+
+    /* Generates a table by retrograde analysis, in parallel on `pool`.
+     *
+     * Every position is first solved as far as its own moves tell: mates,
+     * stalemates and the best capture or promotion (probed in `subtables`,
+     * which must contain every table it converts into). Then, ply by ply,
+     * the positions decided at the previous ply are unmoved: the
+     * predecessors of a loss are wins, and a predecessor all of whose
+     * moves lead to wins is a loss. What remains undecided is a draw.
+     *
+     * En passant and castling are not generated (the prober refuses such
+     * positions), and the 50-move rule is ignored.
+     */
+    [[nodiscard]] auto GenerateTable(const Material& material, const Tablebases& subtables, ThreadPool& pool)
+      -> std::variant<GeneratedTable, GenericError>;
+
+    // Writes `directory/<name>.ctb`, returning its size
+    [[nodiscard]] auto WriteTable(const std::string& directory, const GeneratedTable& table) noexcept
+      -> std::variant<uint64_t, SystemError>;
+
+    /* Generates and writes every table up to `maxPieces` pieces into
+     * `directory`, calling `onTable` after each one
+     */
+    [[nodiscard]] auto GenerateAll(
+        const std::string& directory,
+        int maxPieces,
+        ThreadPool& pool,
+        const std::function<void(const GeneratedTable& table, uint64_t fileSize)>& onTable
+    ) -> std::optional<std::variant<SystemError, GenericError>>;
+} // namespace NTablebase
@@ -0,0 +1,191 @@
+#include "indexing.hpp"
+
+#include <algorithm>
+
+
+namespace {
+    using namespace NTablebase;
+
+    // Piece letters by piece type
+    static constexpr auto kPieceLetters = std::string_view{"PNBRQK"};
+    // Strongest first, the order of pieces in names and layouts
+    static constexpr auto kStrengthOrder = std::array<PieceType, 5>{Queen, Rook, Bishop, Knight, Pawn};
+
+    static constexpr auto kNumPawnlessKingSlots = 10;
+    static constexpr auto kNumPawnKingSlots = 32;
+
+    // The a1-d1-d4 triangle, indexed by square
+    static constexpr auto kTriangleSlot = []() {
+        auto slots = std::array<int8_t, kNumSquares>{};
+        auto next = int8_t{0};
+        for (auto s = 0; s < kNumSquares; ++s) {
+            const auto file = s % 8, rank = s / 8;
+            slots[s] = file <= 3 && rank <= file ? next++ : int8_t(-1);
+        }
+        return slots;
+    }();
+    static constexpr auto kTriangleSquare = []() {
+        auto squares = std::array<Square, kNumPawnlessKingSlots>{};
+        for (auto s = 0; s < kNumSquares; ++s) {
+            if (kTriangleSlot[s] >= 0) squares[kTriangleSlot[s]] = Square(s);
+        }
+        return squares;
+    }();
+
+    constexpr auto MirrorFile(Square s) noexcept -> Square { return Square(s ^ 7); }
+    constexpr auto Transpose(Square s) noexcept -> Square { return Square((s >> 3) | ((s & 7) << 3)); }
+
+    // Symmetry `t` of the board: bit 0 mirrors files,
+    // bit 1 mirrors ranks, bit 2 transposes (after the mirrors)
+    constexpr auto ApplySymmetry(int t, Square s) noexcept -> Square {
+        if (t & 1) s = MirrorFile(s);
+        if (t & 2) s = FlipRank(s);
+        if (t & 4) s = Transpose(s);
+        return s;
+    }
+
+    auto StrengthKey(const std::array<uint8_t, kNumPieceTypes>& count) noexcept -> uint32_t {
+        // More pieces first, then stronger pieces first
+        auto key = uint32_t(count[Pawn] + count[Knight] + count[Bishop] + count[Rook] + count[Queen]);
+        for (const auto pt : kStrengthOrder) key = key * 4 + count[pt];
+        return key;
+    }
+} // anonymous namespace
+
+
+namespace NTablebase {
+    auto Material::NumPieces() const noexcept -> int {
+        auto n = 2;
+        for (const auto& side : Count) {
+            for (const auto c : side) n += c;
+        }
+        return n;
+    }
+
+    auto Material::IsCanonical() const noexcept -> bool {
+        return StrengthKey(Count[White]) >= StrengthKey(Count[Black]);
+    }
+
+    auto Material::Flipped() const noexcept -> Material {
+        return Material{.Count = {Count[Black], Count[White]}};
+    }
+
+    auto Material::Key() const noexcept -> uint32_t {
+        return StrengthKey(Count[White]) << 16 | StrengthKey(Count[Black]);
+    }
+
+    auto Material::Name() const -> std::string {
+        auto name = std::string{};
+        for (const auto c : {White, Black}) {
+            if (c == Black) name += 'v';
+            name += 'K';
+            for (const auto pt : kStrengthOrder) {
+                name.append(Count[c][pt], kPieceLetters[pt]);
+            }
+        }
+        return name;
+    }
+
+    auto Material::FromName(std::string_view name) noexcept -> std::optional<Material> {
+        auto material = Material{};
+        const auto v = name.find('v');
+        if (v == std::string_view::npos) return std::nullopt;
+        for (const auto& [c, side] : {std::pair{White, name.substr(0, v)}, std::pair{Black, name.substr(v + 1)}}) {
+            if (side.empty() || side[0] != 'K') return std::nullopt;
+            for (const auto letter : side.substr(1)) {
+                const auto pt = kPieceLetters.find(letter);
+                if (pt == std::string_view::npos || pt == King) return std::nullopt;
+                ++material.Count[c][pt];
+            }
+        }
+        if (material.NumPieces() > kMaxPieces) return std::nullopt;
+        return material;
+    }
+
+    auto PiecePlacement::GetMaterial() const noexcept -> Material {
+        auto material = Material{};
+        for (auto i = 0; i < NumPieces; ++i) {
+            if (TypeOf(Pieces[i]) != King) ++material.Count[ColorOf(Pieces[i])][TypeOf(Pieces[i])];
+        }
+        return material;
+    }
+
+    TableLayout::TableLayout(const Material& material) noexcept
+        : Material_(material)
+        , HasPawns_(material.HasPawns())
+    {
+        Pieces_[NumPieces_++] = MakePiece(White, King);
+        Pieces_[NumPieces_++] = MakePiece(Black, King);
+        for (const auto c : {White, Black}) {
+            for (const auto pt : kStrengthOrder) {
+                for (auto i = 0; i < material.Count[c][pt]; ++i) Pieces_[NumPieces_++] = MakePiece(c, pt);
+            }
+        }
+        NumPositions_ = uint64_t(HasPawns_ ? kNumPawnKingSlots : kNumPawnlessKingSlots) * 2;
+        for (auto i = 1; i < NumPieces_; ++i) NumPositions_ *= kNumSquares;
+    }
+
+    auto TableLayout::Decode(uint64_t index) const noexcept -> PiecePlacement {
+        auto placement = PiecePlacement{};
+        placement.NumPieces = NumPieces_;
+        placement.Pieces = Pieces_;
+        placement.SideToMove = Color(index & 1);
+        index >>= 1;
+        for (auto i = NumPieces_ - 1; i >= 1; --i) {
+            placement.Squares[i] = Square(index % kNumSquares);
+            index /= kNumSquares;
+        }
+        // Pawn tables: slot = rank * 4 + file
+        placement.Squares[0] = HasPawns_ ? MakeSquare(int(index % 4), int(index / 4)) : kTriangleSquare[index];
+        return placement;
+    }
+
+    auto TableLayout::CanonicalIndex(const PiecePlacement& placement) const noexcept -> uint64_t {
+        auto best = UINT64_MAX;
+        const auto numSymmetries = HasPawns_ ? 2 : 8;
+        for (auto t = 0; t < numSymmetries; ++t) {
+            auto squares = placement.Squares;
+            for (auto i = 0; i < NumPieces_; ++i) squares[i] = ApplySymmetry(t, squares[i]);
+            const auto king = squares[0];
+            auto slot = 0;
+            if (HasPawns_) {
+                if (FileOf(king) > 3) continue;
+                slot = RankOf(king) * 4 + FileOf(king);
+            } else {
+                if (kTriangleSlot[king] < 0) continue;
+                slot = kTriangleSlot[king];
+            }
+            // Identical pieces are interchangeable: the lower square goes first
+            if (NumPieces_ == 4 && Pieces_[2] == Pieces_[3] && squares[2] > squares[3]) {
+                std::swap(squares[2], squares[3]);
+            }
+            auto index = uint64_t(slot);
+            for (auto i = 1; i < NumPieces_; ++i) index = index * kNumSquares + squares[i];
+            best = std::min(best, index * 2 + placement.SideToMove);
+        }
+        return best;
+    }
+
+    auto Canonicalize(const PiecePlacement& placement) noexcept -> PiecePlacement {
+        const auto flip = !placement.GetMaterial().IsCanonical();
+        auto canonical = PiecePlacement{};
+        canonical.SideToMove = flip ? ~placement.SideToMove : placement.SideToMove;
+        const auto addAll = [&](Color c, PieceType pt) {
+            for (auto i = 0; i < placement.NumPieces; ++i) {
+                const auto p = placement.Pieces[i];
+                const auto s = placement.Squares[i];
+                const auto color = flip ? ~ColorOf(p) : ColorOf(p);
+                if (color == c && TypeOf(p) == pt) {
+                    canonical.Add(MakePiece(color, pt), flip ? FlipRank(s) : s);
+                }
+            }
+        };
+        // The layout order: kings, then the pieces of each side strongest first
+        addAll(White, King);
+        addAll(Black, King);
+        for (const auto c : {White, Black}) {
+            for (const auto pt : kStrengthOrder) addAll(c, pt);
+        }
+        return canonical;
+    }
+} // namespace NTablebase
@@ -0,0 +1,97 @@
+#pragma once
+
+
+#include "../chess/types.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+
+/* Position indexing shared by the tablebase generator and prober.
+ *
+ * A table covers one material signature with up to 4 pieces, kings
+ * included. Its pieces are laid out as: white king, black king, then the
+ * other white pieces and the other black pieces, strongest first.
+ *
+ * The index of a position is
+ *   (((king slot * 64 + black king) * 64 + piece 3) * 64 + piece 4) * 2 + side to move
+ * where the king slot restricts the white king by symmetry: to the
+ * a1-d1-d4 triangle (10 squares) without pawns, to files a-d (32 squares)
+ * with pawns. Every position has exactly one canonical index; the other
+ * indices of the same position (symmetric or with identical pieces
+ * swapped) are marked unused by the generator.
+ */
+namespace NTablebase {
+    using namespace NChess;
+
+    static constexpr auto kMaxPieces = 4;
+
+    // Non-king piece counts of both sides
+    struct Material {
+        std::array<std::array<uint8_t, kNumPieceTypes>, 2> Count = {};
+
+        [[nodiscard]] auto NumPieces() const noexcept -> int;
+        [[nodiscard]] auto HasPawns() const noexcept -> bool {
+            return Count[White][Pawn] + Count[Black][Pawn] > 0;
+        }
+        // Tables are stored with the stronger side as white
+        [[nodiscard]] auto IsCanonical() const noexcept -> bool;
+        [[nodiscard]] auto Flipped() const noexcept -> Material;
+        // A small integer unique to the material, for table lookup
+        [[nodiscard]] auto Key() const noexcept -> uint32_t;
+        // E.g. "KQRvK"
+        [[nodiscard]] auto Name() const -> std::string;
+        [[nodiscard]] static auto FromName(std::string_view name) noexcept -> std::optional<Material>;
+
+        auto operator==(const Material&) const noexcept -> bool = default;
+    };
+
+    // A position of a table: pieces in any order and side to move
+    struct PiecePlacement {
+        std::array<Piece, kMaxPieces> Pieces = {};
+        std::array<Square, kMaxPieces> Squares = {};
+        int NumPieces = 0;
+        Color SideToMove = White;
+
+        auto Add(Piece p, Square s) noexcept -> void {
+            Pieces[NumPieces] = p;
+            Squares[NumPieces] = s;
+            ++NumPieces;
+        }
+        [[nodiscard]] auto GetMaterial() const noexcept -> Material;
+    };
+
+    class TableLayout {
+    private:
+        Material Material_;
+        // In index order, kings first
+        std::array<Piece, kMaxPieces> Pieces_ = {};
+        int NumPieces_ = 0;
+        bool HasPawns_ = false;
+        uint64_t NumPositions_ = 0;
+    public:
+        // `material` has to be canonical
+        explicit TableLayout(const Material& material) noexcept;
+
+        [[nodiscard]] auto GetMaterial() const noexcept -> const Material& { return Material_; }
+        [[nodiscard]] auto GetPiece(int i) const noexcept -> Piece { return Pieces_[i]; }
+        [[nodiscard]] auto GetNumPieces() const noexcept -> int { return NumPieces_; }
+        [[nodiscard]] auto GetNumPositions() const noexcept -> uint64_t { return NumPositions_; }
+
+        // The position an index denotes, which may be non-canonical or illegal.
+        // The pieces are in layout order
+        [[nodiscard]] auto Decode(uint64_t index) const noexcept -> PiecePlacement;
+        // The canonical index of a placement of this table's pieces in layout order
+        [[nodiscard]] auto CanonicalIndex(const PiecePlacement& placement) const noexcept -> uint64_t;
+    };
+
+    /* Brings a placement of any material with at most 4 pieces to the
+     * canonical table: swaps colors (mirroring ranks and flipping the side to
+     * move) if the weaker side is white, and orders the pieces as in the
+     * table layout.
+     */
+    [[nodiscard]] auto Canonicalize(const PiecePlacement& placement) noexcept -> PiecePlacement;
+} // namespace NTablebase
@@ -0,0 +1,139 @@
+#include "tablebases.hpp"
+
+#include <cstring>
+#include <filesystem>
+
+
+namespace {
+    using namespace NTablebase;
+
+    // Bits `[bit, bit + width)` of a padded section, `width` <= 56.
+    // The tables are little-endian, as is every supported target
+    auto ReadBits(const std::byte* section, uint64_t bit, int width) noexcept -> uint32_t {
+        auto word = uint64_t{0};
+        std::memcpy(&word, section + bit / 8, sizeof(word));
+        return uint32_t((word >> (bit % 8)) & ((uint64_t{1} << width) - 1));
+    }
+
+    auto PlacementOf(const Position& pos) noexcept -> std::optional<PiecePlacement> {
+        if (pos.Castling() != NoCastling || pos.EnPassantSquare() != NoSquare) return std::nullopt;
+        if (PopCount(pos.Pieces()) > kMaxPieces) return std::nullopt;
+        auto placement = PiecePlacement{};
+        placement.SideToMove = pos.SideToMove();
+        auto pieces = pos.Pieces();
+        while (pieces) {
+            const auto s = PopLsb(pieces);
+            placement.Add(pos.PieceOn(s), s);
+        }
+        return placement;
+    }
+} // anonymous namespace
+
+
+namespace NTablebase {
+    auto Tablebases::OpenDirectory(const std::string& directory) noexcept
+      -> std::variant<Tablebases, SystemError, GenericError> {
+        auto tablebases = Tablebases{};
+        auto ec = std::error_code{};
+        auto it = std::filesystem::directory_iterator{directory, ec};
+        if (ec) {
+            return SystemError{
+                .Value = std::errc{ec.value()},
+                .ContextMessage = "Can't list tablebase directory \"" + directory + "\"",
+            };
+        }
+        for (const auto& entry : it) {
+            if (entry.path().extension() != ".ctb") continue;
+            if (auto error = tablebases.AddTable(entry.path().string())) {
+                return std::visit([](auto&& err) -> std::variant<Tablebases, SystemError, GenericError> {
+                    return std::move(err);
+                }, std::move(*error));
+            }
+        }
+        return tablebases;
+    }
+
+    auto Tablebases::AddTable(const std::string& path) noexcept
+      -> std::optional<std::variant<SystemError, GenericError>> {
+        auto fileOrError = MappedFile::OpenReadOnly(path, MappedFile::EAccessPattern::Random);
+        if (std::holds_alternative<SystemError>(fileOrError)) {
+            return std::get<SystemError>(std::move(fileOrError));
+        }
+        auto& file = std::get<MappedFile>(fileOrError);
+        const auto data = file.GetData();
+        const auto bad = [&path](std::string what) {
+            return GenericError{
+                .Value = std::move(what),
+                .ContextMessage = "Bad tablebase file \"" + path + "\"",
+            };
+        };
+
+        auto header = NFormat::FileHeader{};
+        if (data.size() < sizeof(header)) return bad("file is too short");
+        std::memcpy(&header, data.data(), sizeof(header));
+        if (std::string_view{header.Magic, 4} != NFormat::kMagic) return bad("wrong magic");
+        if (header.Version != NFormat::kVersion) {
+            return bad("unsupported version " + std::to_string(header.Version));
+        }
+        const auto material = Material::FromName(std::string_view{header.Name, strnlen(header.Name, sizeof(header.Name))});
+        if (!material || !material->IsCanonical()) return bad("bad material name");
+        auto layout = TableLayout{*material};
+        if (header.NumPositions != layout.GetNumPositions()) return bad("wrong number of positions");
+        if (header.DtmBits < 1 || header.DtmBits > 32) return bad("bad DTM width");
+        const auto wdlSize = NFormat::SectionSize(header.NumPositions, NFormat::kWdlBits);
+        const auto dtmSize = NFormat::SectionSize(header.NumPositions, int(header.DtmBits));
+        if (data.size() != sizeof(header) + wdlSize + dtmSize) return bad("wrong file size");
+
+        const auto* wdl = data.data() + sizeof(header);
+        const auto* dtm = wdl + wdlSize;
+        MaxPieces_ = std::max(MaxPieces_, material->NumPieces());
+        Tables_.insert_or_assign(material->Key(), Table{
+            .Layout = layout,
+            .File = std::move(file),
+            .DtmBits = int(header.DtmBits),
+            .Wdl = wdl,
+            .Dtm = dtm,
+        });
+        return std::nullopt;
+    }
+
+    auto Tablebases::HasTable(const Material& material) const noexcept -> bool {
+        return Tables_.contains(material.Key());
+    }
+
+    auto Tablebases::Probe(const PiecePlacement& placement) const noexcept -> std::optional<ProbeResult> {
+        if (placement.NumPieces == 2) return ProbeResult{.Wdl = EWdl::Draw, .Dtm = 0};
+        const auto canonical = Canonicalize(placement);
+        const auto it = Tables_.find(canonical.GetMaterial().Key());
+        if (it == Tables_.end()) return std::nullopt;
+        const auto& table = it->second;
+        const auto index = table.Layout.CanonicalIndex(canonical);
+        const auto code = ReadBits(table.Dtm, index * table.DtmBits, table.DtmBits);
+        if (code == NFormat::kDtmDraw) return ProbeResult{.Wdl = EWdl::Draw, .Dtm = 0};
+        // Unused indices are positions the side to move could never
+        // be in, e.g. the other king in check
+        if (code == NFormat::kDtmUnused) return std::nullopt;
+        const auto plies = int(code - NFormat::kDtmOffset);
+        return ProbeResult{.Wdl = plies % 2 == 1 ? EWdl::Win : EWdl::Loss, .Dtm = plies};
+    }
+
+    auto Tablebases::Probe(const Position& pos) const noexcept -> std::optional<ProbeResult> {
+        const auto placement = PlacementOf(pos);
+        if (!placement) return std::nullopt;
+        return Probe(*placement);
+    }
+
+    auto Tablebases::ProbeWdl(const Position& pos) const noexcept -> std::optional<EWdl> {
+        const auto placement = PlacementOf(pos);
+        if (!placement) return std::nullopt;
+        if (placement->NumPieces == 2) return EWdl::Draw;
+        const auto canonical = Canonicalize(*placement);
+        const auto it = Tables_.find(canonical.GetMaterial().Key());
+        if (it == Tables_.end()) return std::nullopt;
+        const auto& table = it->second;
+        const auto index = table.Layout.CanonicalIndex(canonical);
+        const auto code = uint8_t(ReadBits(table.Wdl, index * NFormat::kWdlBits, NFormat::kWdlBits));
+        if (code == NFormat::kWdlUnused) return std::nullopt;
+        return EWdl(code);
+    }
+} // namespace NTablebase
@@ -0,0 +1,111 @@
+#pragma once
+
+
+#include "indexing.hpp"
+
+#include "../chess/position.hpp"
+#include "../utils/error.hpp"
+#include "../utils/mapped_file/mapped_file.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <variant>
+
+
+namespace NTablebase {
+    enum class EWdl : uint8_t {
+        Draw = 0,
+        Win = 1,
+        Loss = 2,
+    };
+
+    struct ProbeResult {
+        // For the side to move
+        EWdl Wdl;
+        // Plies to mate with best play, 0 for draws (and for being mated)
+        int Dtm;
+    };
+
+    /* The ".ctb" file of a table:
+     *   header (see `FileHeader`), all integers little-endian
+     *   WDL section: 2 bits per index (`EWdl`, or 3 for unused indices)
+     *   DTM section: `DtmBits` bits per index, 0 = draw, 1 = unused, else plies + 2
+     * Both sections are bit-packed from the least significant bit and
+     * padded with 8 bytes, so that any entry can be read with one
+     * unaligned 64-bit load.
+     */
+    namespace NFormat {
+        static constexpr auto kMagic = std::string_view{"CTB1"};
+        static constexpr auto kVersion = uint32_t{1};
+        static constexpr auto kSectionPadding = uint64_t{8};
+        static constexpr auto kWdlBits = 2;
+        static constexpr auto kWdlUnused = uint8_t{3};
+        static constexpr auto kDtmDraw = uint32_t{0};
+        static constexpr auto kDtmUnused = uint32_t{1};
+        static constexpr auto kDtmOffset = uint32_t{2};
+
+        struct FileHeader {
+            char Magic[4];
+            uint32_t Version;
+            // Material name, zero-padded
+            char Name[16];
+            uint64_t NumPositions;
+            uint32_t DtmBits;
+            uint32_t Reserved;
+        };
+        static_assert(sizeof(FileHeader) == 40);
+
+        constexpr auto SectionSize(uint64_t numPositions, int bits) noexcept -> uint64_t {
+            return (numPositions * bits + 7) / 8 + kSectionPadding;
+        }
+
+        inline auto FileName(const Material& material) -> std::string {
+            return material.Name() + ".ctb";
+        }
+    } // namespace NFormat
+
+    /* Memory-mapped endgame tables of up to 4 pieces.
+     *
+     * A probe maps the position to its table and canonical index, then
+     * reads a few bits: no I/O happens until a page is first touched,
+     * and the pages of a table are shared by every process using it.
+     */
+    class Tablebases {
+    private:
+        struct Table {
+            TableLayout Layout;
+            MappedFile File;
+            int DtmBits;
+            const std::byte* Wdl;
+            const std::byte* Dtm;
+        };
+
+        // By `Material::Key()` of canonical materials
+        std::unordered_map<uint32_t, Table> Tables_;
+        int MaxPieces_ = 2;
+    public:
+        // Opens every table of `directory` that exists
+        [[nodiscard]] static auto OpenDirectory(const std::string& directory) noexcept
+          -> std::variant<Tablebases, SystemError, GenericError>;
+
+        [[nodiscard]] auto AddTable(const std::string& path) noexcept
+          -> std::optional<std::variant<SystemError, GenericError>>;
+
+        [[nodiscard]] auto GetNumTables() const noexcept -> size_t { return Tables_.size(); }
+        // The largest number of pieces of a loaded table, 2 if none
+        [[nodiscard]] auto GetMaxPieces() const noexcept -> int { return MaxPieces_; }
+        [[nodiscard]] auto HasTable(const Material& material) const noexcept -> bool;
+
+        /* Nothing is returned for positions the tables do not cover: more
+         * pieces than loaded, castling rights or an en passant square (the
+         * tables assume neither). The 50-move rule is not taken into
+         * account either.
+         */
+        [[nodiscard]] auto Probe(const NChess::Position& pos) const noexcept -> std::optional<ProbeResult>;
+        [[nodiscard]] auto Probe(const PiecePlacement& placement) const noexcept -> std::optional<ProbeResult>;
+        [[nodiscard]] auto ProbeWdl(const NChess::Position& pos) const noexcept -> std::optional<EWdl>;
+    };
+} // namespace NTablebase
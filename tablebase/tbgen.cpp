@@ -0,0 +1,47 @@
+#include "generator.hpp"
+
+#include "../utils/cli_args.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string_view>
+#include <thread>
+
+
+// Usage: tbgen <directory> [max pieces = 4] [threads = all cores]
+auto main(int argc, char** argv) -> int {
+    using namespace NTablebase;
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <directory> [max pieces = 4] [threads = all cores]\n";
+        return EXIT_FAILURE;
+    }
+    const auto directory = std::string{argv[1]};
+    const auto maxPieces = std::clamp(argc > 2 ? ParseIntArg(argv[2], kMaxPieces) : kMaxPieces, 3, kMaxPieces);
+    const auto defaultThreads = int(std::max(std::thread::hardware_concurrency(), 1u));
+    const auto numThreads = std::max(argc > 3 ? ParseIntArg(argv[3], defaultThreads) : defaultThreads, 1);
+    // This thread works too
+    auto pool = ThreadPool{numThreads - 1};
+
+    std::cout << "table       positions        used     wins    draws   losses  max DTM       size      time\n";
+    auto totalSize = uint64_t{0};
+    auto totalTime = std::chrono::milliseconds{0};
+    const auto error = GenerateAll(directory, maxPieces, pool, [&](const GeneratedTable& table, uint64_t fileSize) {
+        std::cout << std::left << std::setw(8) << table.Signature.Name() << std::right
+                  << std::setw(13) << table.Codes.size()
+                  << std::setw(12) << table.NumUsed
+                  << std::setw(9) << table.NumWins
+                  << std::setw(9) << table.NumDraws
+                  << std::setw(9) << table.NumLosses
+                  << std::setw(9) << table.MaxDtm
+                  << std::setw(9) << fileSize / 1024 << "KB"
+                  << std::setw(8) << table.Time.count() << "ms\n";
+        totalSize += fileSize;
+        totalTime += table.Time;
+    });
+    if (error) {
+        std::visit([](const auto& err) { LogErrorAndExit(err); }, *error);
+    }
+    std::cout << "Total: " << totalSize / 1024 << "KB in " << totalTime.count() << "ms on "
+              << numThreads << " threads\n";
+}
@@ -0,0 +1,207 @@
+#include "../generator.hpp"
+#include "../tablebases.hpp"
+
+#include "../../chess/movegen.hpp"
+#include "../../chess/position.hpp"
+
+#include <cassert>
+#include <climits>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <random>
+
+
+namespace {
+using namespace NChess;
+using namespace NTablebase;
+
+static const auto kDirectory = std::string{"/tmp/tablebase_ut"};
+
+auto OpenTablebases() -> Tablebases {
+    auto tablebasesOrError = Tablebases::OpenDirectory(kDirectory);
+    assert(std::holds_alternative<Tablebases>(tablebasesOrError));
+    return std::move(std::get<Tablebases>(tablebasesOrError));
+}
+
+auto ProbeFen(const Tablebases& tablebases, std::string_view fen) -> std::optional<ProbeResult> {
+    auto pos = Position{};
+    assert(!pos.SetFromFen(fen));
+    return tablebases.Probe(pos);
+}
+
+auto FenOf(const PiecePlacement& placement) -> std::string {
+    static constexpr auto kLetters = std::string_view{"PNBRQK"};
+    auto board = std::array<char, kNumSquares>{};
+    board.fill(0);
+    for (auto i = 0; i < placement.NumPieces; ++i) {
+        const auto p = placement.Pieces[i];
+        const auto letter = kLetters[TypeOf(p)];
+        board[placement.Squares[i]] = char(ColorOf(p) == White ? letter : letter - 'A' + 'a');
+    }
+    auto fen = std::string{};
+    for (auto rank = 7; rank >= 0; --rank) {
+        auto empty = 0;
+        for (auto file = 0; file < 8; ++file) {
+            const auto c = board[MakeSquare(file, rank)];
+            if (!c) {
+                ++empty;
+                continue;
+            }
+            if (empty) fen += char('0' + empty);
+            empty = 0;
+            fen += c;
+        }
+        if (empty) fen += char('0' + empty);
+        if (rank) fen += '/';
+    }
+    return fen + (placement.SideToMove == White ? " w - - 0 1" : " b - - 0 1");
+}
+} // anonymous namespace
+
+
+namespace NTests {
+auto TestMaterials() -> void {
+    const auto materials = AllMaterials(4);
+    assert(materials.size() == 35);
+    assert(materials.front().Name() == "KBvK");
+    for (const auto& m : materials) {
+        assert(m.IsCanonical());
+        assert(Material::FromName(m.Name()) == m);
+    }
+    assert(!Material::FromName("KQRRvK"));
+    assert(!Material::FromName("KQK"));
+    std::cerr << "TestMaterials OK\n";
+}
+
+auto TestCanonicalIndex() -> void {
+    auto rng = std::mt19937_64{42};
+    for (const auto name : {"KRvK", "KPvK", "KNNvK", "KRvKP"}) {
+        const auto layout = TableLayout{*Material::FromName(name)};
+        for (auto i = 0; i < 10000; ++i) {
+            const auto index = rng() % layout.GetNumPositions();
+            const auto canonical = layout.CanonicalIndex(layout.Decode(index));
+            assert(canonical <= index);
+            assert(layout.CanonicalIndex(layout.Decode(canonical)) == canonical);
+        }
+    }
+    std::cerr << "TestCanonicalIndex OK\n";
+}
+
+auto TestGenerateThreePieces() -> void {
+    std::filesystem::create_directories(kDirectory);
+    auto maxDtm = std::map<std::string, int>{};
+    auto decisive = std::map<std::string, uint64_t>{};
+    auto pool = ThreadPool{1};
+    const auto error = GenerateAll(kDirectory, 3, pool, [&](const GeneratedTable& table, uint64_t fileSize) {
+        assert(fileSize > sizeof(NFormat::FileHeader));
+        assert(table.NumWins + table.NumDraws + table.NumLosses == table.NumUsed);
+        maxDtm[table.Signature.Name()] = table.MaxDtm;
+        decisive[table.Signature.Name()] = table.NumWins + table.NumLosses;
+    });
+    assert(!error);
+    // Known longest mates: KQK in 10 moves, KRK in 16, KPK in 28,
+    // so the longest losses (the defender to move) take 2 * moves plies
+    assert(maxDtm["KQvK"] == 20);
+    assert(maxDtm["KRvK"] == 32);
+    assert(maxDtm["KPvK"] == 56);
+    assert(decisive["KBvK"] == 0 && decisive["KNvK"] == 0);
+    assert(decisive["KPvK"] > 0);
+    std::cerr << "TestGenerateThreePieces OK\n";
+}
+
+auto TestProbes() -> void {
+    const auto tablebases = OpenTablebases();
+    assert(tablebases.GetNumTables() == 5);
+
+    const auto mateInOne = ProbeFen(tablebases, "k7/8/1K6/8/8/8/8/6Q1 w - - 0 1");
+    assert(mateInOne && mateInOne->Wdl == EWdl::Win && mateInOne->Dtm == 1);
+    const auto mated = ProbeFen(tablebases, "k6Q/8/1K6/8/8/8/8/8 b - - 0 1");
+    assert(mated && mated->Wdl == EWdl::Loss && mated->Dtm == 0);
+
+    // King in front of its pawn on the 6th rank wins whoever moves
+    assert(ProbeFen(tablebases, "4k3/8/4K3/4P3/8/8/8/8 w - - 0 1")->Wdl == EWdl::Win);
+    assert(ProbeFen(tablebases, "4k3/8/4K3/4P3/8/8/8/8 b - - 0 1")->Wdl == EWdl::Loss);
+    // The same with colors swapped is probed through the flipped table
+    assert(ProbeFen(tablebases, "8/8/8/8/4p3/4k3/8/4K3 b - - 0 1")->Wdl == EWdl::Win);
+    assert(ProbeFen(tablebases, "8/8/8/8/4p3/4k3/8/4K3 w - - 0 1")->Wdl == EWdl::Loss);
+    // A rook pawn with the defending king in the corner
+    assert(ProbeFen(tablebases, "k7/8/8/8/8/8/P7/K7 w - - 0 1")->Wdl == EWdl::Draw);
+
+    assert(ProbeFen(tablebases, "4k3/8/8/8/8/8/8/4K3 w - - 0 1")->Wdl == EWdl::Draw);
+    assert(!ProbeFen(tablebases, "4k3/8/8/8/8/8/8/R3K3 w Q - 0 1"));
+    assert(!ProbeFen(tablebases, "4k3/8/8/8/8/8/8/RR2K3 w - - 0 1"));
+    auto pos = Position{};
+    assert(!pos.SetFromFen("4k3/8/4K3/4P3/8/8/8/8 w - - 0 1"));
+    assert(tablebases.ProbeWdl(pos) == EWdl::Win);
+    std::cerr << "TestProbes OK\n";
+}
+
+// Every DTM must follow from the DTMs of the position's moves
+auto TestConsistencyWithMoveGeneration() -> void {
+    const auto tablebases = OpenTablebases();
+    auto rng = std::mt19937_64{7};
+    auto checked = 0;
+    for (const auto name : {"KQvK", "KRvK", "KPvK"}) {
+        const auto layout = TableLayout{*Material::FromName(name)};
+        for (auto i = 0; i < 3000; ++i) {
+            const auto placement = layout.Decode(rng() % layout.GetNumPositions());
+            auto pos = Position{};
+            if (pos.SetFromFen(FenOf(placement))) continue;
+            const auto result = tablebases.Probe(pos);
+            if (!result) continue;
+
+            auto bestWin = INT_MAX, worstLoss = -1;
+            auto hasDraw = false;
+            auto list = MoveList{};
+            GenerateLegal(pos, list);
+            for (const auto m : list) {
+                pos.MakeMove(m);
+                const auto child = tablebases.Probe(pos);
+                pos.UnmakeMove(m);
+                assert(child);
+                if (child->Wdl == EWdl::Loss) bestWin = std::min(bestWin, child->Dtm + 1);
+                if (child->Wdl == EWdl::Draw) hasDraw = true;
+                if (child->Wdl == EWdl::Win) worstLoss = std::max(worstLoss, child->Dtm + 1);
+            }
+            if (result->Wdl == EWdl::Win) {
+                assert(bestWin == result->Dtm);
+            } else if (result->Wdl == EWdl::Draw) {
+                assert(bestWin == INT_MAX && (hasDraw || (list.Size == 0 && !pos.InCheck())));
+            } else if (list.Size == 0) {
+                assert(pos.InCheck() && result->Dtm == 0);
+            } else {
+                assert(bestWin == INT_MAX && !hasDraw && worstLoss == result->Dtm);
+            }
+            ++checked;
+        }
+    }
+    assert(checked > 1000);
+    std::cerr << "TestConsistencyWithMoveGeneration OK\n";
+}
+
+auto TestRejectsBadFiles() -> void {
+    auto tablebases = Tablebases{};
+    assert(tablebases.AddTable("/nonexistent/KQvK.ctb"));
+    const auto path = kDirectory + "/bad.ctb";
+    std::filesystem::copy_file(kDirectory + "/KQvK.ctb", path, std::filesystem::copy_options::overwrite_existing);
+    std::filesystem::resize_file(path, 1000);
+    const auto error = tablebases.AddTable(path);
+    assert(error && std::holds_alternative<GenericError>(*error));
+    std::filesystem::remove(path);
+    std::cerr << "TestRejectsBadFiles OK\n";
+}
+} // namespace NTests
+
+
+auto main() -> int {
+    using namespace NTests;
+    TestMaterials();
+    TestCanonicalIndex();
+    TestGenerateThreePieces();
+    TestProbes();
+    TestConsistencyWithMoveGeneration();
+    TestRejectsBadFiles();
+    std::filesystem::remove_all(kDirectory);
+    std::cerr << "All tests passed.\n";
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+
+#include "error.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Exits with the error of the syscall `what` unless it succeeded
+inline auto Check(bool ok, const char* what) -> void {
+    if (!ok) {
+        LogErrorAndExit(SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = std::string{what} + " failed (" SOURCE_LOCATION ")",
+        });
+    }
+}
+
+// The `p`-th quantile of `samples` in nanoseconds, reordering them, or 0 if there are none
+inline auto Percentile(std::vector<std::chrono::nanoseconds>& samples, double p) -> int64_t {
+    if (samples.empty()) return 0;
+    const auto k = std::min(samples.size() - 1, size_t(p * double(samples.size())));
+    std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+    return samples[k].count();
+}
@@ -0,0 +1,45 @@
+#include "buffered_reader.hpp"
+
+#include <cerrno>
+#include <unistd.h>
+#include <utility>
+
+
+BufferedReader::BufferedReader(const int fd, MagicRingBuffer buffer) noexcept
+    : Fd_(fd)
+    , Buffer_(std::move(buffer))
+{
+}
+
+auto BufferedReader::CreateNew(const int nonBlockingFd, const size_t minCapacity) noexcept
+  -> std::variant<BufferedReader, SystemError> {
+    auto bufferOrError = MagicRingBuffer::CreateNew(minCapacity);
+    if (auto* err = std::get_if<SystemError>(&bufferOrError)) return std::move(*err);
+    return BufferedReader{nonBlockingFd, std::move(std::get<MagicRingBuffer>(bufferOrError))};
+}
+
+auto BufferedReader::Fill() noexcept -> BufferedReadResult {
+    using namespace NBufferedRead;
+    const auto free = Buffer_.GetWritable();
+    if (free.empty()) return OnBufferFull{};
+    for (;;) {
+        const auto x = read(Fd_, free.data(), free.size());
+        if (x > 0) {
+            Buffer_.Commit(size_t(x));
+            return OnData{.NumBytesRead = size_t(x)};
+        } else if (x == 0) {
+            return OnEof{};
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return OnWouldBlock{};
+        } else {
+            return OnSystemError{
+                .Err = SystemError{
+                    .Value = std::errc{errno},
+                    .ContextMessage = "read() syscall failed (" SOURCE_LOCATION ")",
+                },
+            };
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+
+#include "magic_ring_buffer.hpp"
+
+#include "../error.hpp"
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <variant>
+
+
+namespace NBufferedRead {
+    // Indicates that `NumBytesRead` > 0 bytes were appended to the buffer
+    struct OnData {
+        size_t NumBytesRead;
+    };
+    // Indicates that the underlying `read()` syscall returned 0
+    struct OnEof {};
+    // Indicates that there was nothing to read yet
+    struct OnWouldBlock {};
+    // Indicates that there was no free space left, i.e. the frame
+    // at the front of the buffer is longer than the whole buffer
+    struct OnBufferFull {};
+    // Indicates that a system error occurred while
+    // reading from `nonBlockingFd`
+    struct OnSystemError {
+        SystemError Err;
+    };
+    using Result = std::variant<OnData, OnEof, OnWouldBlock, OnBufferFull, OnSystemError>;
+}
+using BufferedReadResult = NBufferedRead::Result;
+
+/* Reads a stream of frames from a non-blocking file descriptor (which
+ * can typically refer to a TCP socket or a pipe) through a
+ * `MagicRingBuffer`.
+ *
+ * Each `Fill()` is one `read()` of as much as the kernel has and fits,
+ * so a peer sending many small frames costs far fewer than one syscall
+ * per frame, and `TryPopFrame()` hands out each complete frame as one
+ * contiguous span, even when it wraps around the buffer. The caller
+ * waits for readability itself, e.g. in an event loop.
+ *
+ * `nonBlockingFd` is not owned.
+ */
+class BufferedReader {
+public:
+    static constexpr auto kDefaultCapacity = size_t{64} * 1024;
+private:
+    int Fd_;
+    MagicRingBuffer Buffer_;
+private:
+    BufferedReader(int fd, MagicRingBuffer buffer) noexcept;
+public:
+    [[nodiscard]] static auto CreateNew(int nonBlockingFd, size_t minCapacity = kDefaultCapacity) noexcept
+      -> std::variant<BufferedReader, SystemError>;
+
+    [[nodiscard]] auto Fill() noexcept -> BufferedReadResult;
+
+    // Bytes read and not consumed yet
+    [[nodiscard]] auto GetBuffered() const noexcept -> std::span<const std::byte> {
+        return Buffer_.GetReadable();
+    }
+    auto Consume(size_t n) noexcept -> void {
+        Buffer_.Consume(n);
+    }
+
+    /* Pops the frame at the front of the buffer if it is complete.
+     * `frameSize(GetBuffered())` returns the size of that frame, or 0 if
+     * it can't tell yet. The span stays valid until the next `Fill()`.
+     */
+    template <class FrameSize>
+    [[nodiscard]] auto TryPopFrame(FrameSize&& frameSize) noexcept -> std::optional<std::span<const std::byte>> {
+        const auto buffered = Buffer_.GetReadable();
+        const auto size = size_t(frameSize(buffered));
+        if (size == 0 || size > buffered.size()) return std::nullopt;
+        Buffer_.Consume(size);
+        return buffered.first(size);
+    }
+
+    [[nodiscard]] auto GetFd() const noexcept -> int { return Fd_; }
+    [[nodiscard]] auto GetCapacity() const noexcept -> size_t { return Buffer_.GetCapacity(); }
+};
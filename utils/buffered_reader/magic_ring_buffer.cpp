@@ -0,0 +1,84 @@
+#include "magic_ring_buffer.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+
+
+MagicRingBuffer::MagicRingBuffer(std::byte* data, const size_t capacity) noexcept
+    : Data_(data)
+    , Capacity_(capacity)
+{
+}
+
+MagicRingBuffer::MagicRingBuffer(MagicRingBuffer&& other) noexcept
+    : Data_(std::exchange(other.Data_, nullptr))
+    , Capacity_(std::exchange(other.Capacity_, 0))
+    , Head_(std::exchange(other.Head_, 0))
+    , Tail_(std::exchange(other.Tail_, 0))
+{
+}
+
+MagicRingBuffer& MagicRingBuffer::operator=(MagicRingBuffer&& other) noexcept {
+    std::swap(Data_, other.Data_);
+    std::swap(Capacity_, other.Capacity_);
+    std::swap(Head_, other.Head_);
+    std::swap(Tail_, other.Tail_);
+    return *this;
+}
+
+MagicRingBuffer::~MagicRingBuffer() noexcept {
+    if (Data_) {
+        // TODO: log the error if `munmap()` returns `-1`
+        munmap(Data_, 2 * Capacity_);
+    }
+}
+
+auto MagicRingBuffer::CreateNew(const size_t minCapacity) noexcept
+  -> std::variant<MagicRingBuffer, SystemError> {
+    const auto pageSize = size_t(sysconf(_SC_PAGESIZE));
+    const auto capacity = std::bit_ceil(std::max(minCapacity, pageSize));
+    const auto fd = memfd_create("magic_ring_buffer", MFD_CLOEXEC);
+    if (fd == -1) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "memfd_create() syscall failed (" SOURCE_LOCATION ")",
+        };
+    }
+    if (ftruncate(fd, off_t(capacity)) == -1) {
+        const auto err = errno;
+        close(fd);
+        return SystemError{
+            .Value = std::errc{err},
+            .ContextMessage = "ftruncate() syscall failed (" SOURCE_LOCATION ")",
+        };
+    }
+    // Reserves the address range for both copies, then maps the file
+    // over each half
+    auto* base = mmap(nullptr, 2 * capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        const auto err = errno;
+        close(fd);
+        return SystemError{
+            .Value = std::errc{err},
+            .ContextMessage = "mmap() syscall failed (" SOURCE_LOCATION ")",
+        };
+    }
+    auto* data = static_cast<std::byte*>(base);
+    for (auto* half : {data, data + capacity}) {
+        if (mmap(half, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            const auto err = errno;
+            munmap(base, 2 * capacity);
+            close(fd);
+            return SystemError{
+                .Value = std::errc{err},
+                .ContextMessage = "mmap() syscall failed (" SOURCE_LOCATION ")",
+            };
+        }
+    }
+    // The mappings stay valid after the descriptor is closed
+    close(fd);
+    return MagicRingBuffer{data, capacity};
+}
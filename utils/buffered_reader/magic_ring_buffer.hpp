@@ -0,0 +1,50 @@
+#pragma once
+
+
+#include "../error.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <variant>
+
+
+/* A byte ring buffer whose memory is mapped twice, back to back: the
+ * byte after the last one is the first one again. So the readable bytes
+ * and the free space are each one contiguous span even when they wrap
+ * around, and a `read()` can fill all the free space at once.
+ *
+ * The capacity is a power of two, at least a page.
+ */
+class MagicRingBuffer {
+private:
+    std::byte* Data_;
+    size_t Capacity_;
+    // Positions in the stream, wrapped by masking
+    uint64_t Head_ = 0;
+    uint64_t Tail_ = 0;
+private:
+    MagicRingBuffer(std::byte* data, size_t capacity) noexcept;
+public:
+    MagicRingBuffer(const MagicRingBuffer& other) = delete;
+    MagicRingBuffer(MagicRingBuffer&& other) noexcept;
+    MagicRingBuffer& operator=(MagicRingBuffer&& other) noexcept;
+    ~MagicRingBuffer() noexcept;
+
+    [[nodiscard]] static auto CreateNew(size_t minCapacity) noexcept
+      -> std::variant<MagicRingBuffer, SystemError>;
+
+    [[nodiscard]] auto GetCapacity() const noexcept -> size_t { return Capacity_; }
+
+    [[nodiscard]] auto GetReadable() const noexcept -> std::span<const std::byte> {
+        return {Data_ + (Head_ & (Capacity_ - 1)), size_t(Tail_ - Head_)};
+    }
+    [[nodiscard]] auto GetWritable() const noexcept -> std::span<std::byte> {
+        return {Data_ + (Tail_ & (Capacity_ - 1)), Capacity_ - size_t(Tail_ - Head_)};
+    }
+
+    // Makes `n` bytes written to `GetWritable()` readable
+    auto Commit(size_t n) noexcept -> void { Tail_ += n; }
+    // Frees the first `n` readable bytes
+    auto Consume(size_t n) noexcept -> void { Head_ += n; }
+};
@@ -0,0 +1,176 @@
+#include "buffered_reader.hpp"
+#include "magic_ring_buffer.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+
+namespace {
+// A frame is a 2-byte little-endian length of the whole frame, then
+// the payload: a running counter
+auto MakeFrame(uint32_t seq) -> std::vector<std::byte> {
+    const auto size = size_t(3 + seq % 200);
+    auto frame = std::vector<std::byte>(size);
+    frame[0] = std::byte(size & 0xFF);
+    frame[1] = std::byte(size >> 8);
+    for (auto i = size_t{2}; i < size; ++i) frame[i] = std::byte(seq + i);
+    return frame;
+}
+
+auto FrameSize(std::span<const std::byte> buffered) -> size_t {
+    if (buffered.size() < 2) return 0;
+    return size_t(buffered[0]) | size_t(buffered[1]) << 8;
+}
+
+auto IsFrame(std::span<const std::byte> frame, uint32_t seq) -> bool {
+    const auto expected = MakeFrame(seq);
+    return frame.size() == expected.size() && std::memcmp(frame.data(), expected.data(), frame.size()) == 0;
+}
+
+auto WriteAll(int fd, std::span<const std::byte> bytes) -> void {
+    while (!bytes.empty()) {
+        const auto x = write(fd, bytes.data(), bytes.size());
+        assert(x > 0);
+        bytes = bytes.subspan(size_t(x));
+    }
+}
+
+struct Pipe {
+    int ReadFd = -1;
+    int WriteFd = -1;
+
+    Pipe() {
+        int fds[2];
+        assert(pipe2(fds, O_CLOEXEC) == 0);
+        ReadFd = fds[0];
+        WriteFd = fds[1];
+        assert(fcntl(ReadFd, F_SETFL, O_NONBLOCK) == 0);
+    }
+    ~Pipe() {
+        close(ReadFd);
+        if (WriteFd != -1) close(WriteFd);
+    }
+};
+} // anonymous namespace
+
+
+namespace NTests {
+auto TestMagicRingBuffer() -> void {
+    auto ringOrError = MagicRingBuffer::CreateNew(100);
+    assert(std::holds_alternative<MagicRingBuffer>(ringOrError));
+    auto ring = std::move(std::get<MagicRingBuffer>(ringOrError));
+    const auto capacity = ring.GetCapacity();
+    assert(capacity >= 4096 && (capacity & (capacity - 1)) == 0);
+    assert(ring.GetReadable().empty() && ring.GetWritable().size() == capacity);
+
+    // Moves the head near the end, then writes across the end
+    ring.Commit(capacity - 10);
+    ring.Consume(capacity - 10);
+    auto writable = ring.GetWritable();
+    assert(writable.size() == capacity);
+    for (auto i = size_t{0}; i < 100; ++i) writable[i] = std::byte(i);
+    ring.Commit(100);
+    const auto readable = ring.GetReadable();
+    assert(readable.size() == 100);
+    for (auto i = size_t{0}; i < 100; ++i) assert(readable[i] == std::byte(i));
+    // The bytes past the end are the first ones of the buffer
+    assert(readable.data()[10] == (readable.data() + 10 - capacity)[0]);
+    assert(ring.GetWritable().size() == capacity - 100);
+    std::cerr << "TestMagicRingBuffer OK\n";
+}
+
+// Many small frames already in the kernel cost one `read()`
+auto TestCoalescing() -> void {
+    static constexpr auto kFrames = uint32_t{400};
+    auto pipe = Pipe{};
+    auto bytes = size_t{0};
+    for (auto seq = uint32_t{0}; seq < kFrames; ++seq) {
+        const auto frame = MakeFrame(seq);
+        WriteAll(pipe.WriteFd, frame);
+        bytes += frame.size();
+    }
+    auto readerOrError = BufferedReader::CreateNew(pipe.ReadFd);
+    assert(std::holds_alternative<BufferedReader>(readerOrError));
+    auto& reader = std::get<BufferedReader>(readerOrError);
+    assert(reader.GetCapacity() >= bytes);
+    const auto result = reader.Fill();
+    assert(std::get<NBufferedRead::OnData>(result).NumBytesRead == bytes);
+    for (auto seq = uint32_t{0}; seq < kFrames; ++seq) {
+        const auto frame = reader.TryPopFrame(FrameSize);
+        assert(frame && IsFrame(*frame, seq));
+    }
+    assert(!reader.TryPopFrame(FrameSize) && reader.GetBuffered().empty());
+    assert(std::holds_alternative<NBufferedRead::OnWouldBlock>(reader.Fill()));
+    close(std::exchange(pipe.WriteFd, -1));
+    assert(std::holds_alternative<NBufferedRead::OnEof>(reader.Fill()));
+    std::cerr << "TestCoalescing OK\n";
+}
+
+// Frames arrive whole and in order from a concurrent writer, through a
+// buffer much smaller than the stream, so that frames wrap around it
+auto TestStream() -> void {
+    static constexpr auto kFrames = uint32_t{100'000};
+    auto pipe = Pipe{};
+    auto writer = std::jthread{[&pipe]() {
+        auto batch = std::vector<std::byte>{};
+        for (auto seq = uint32_t{0}; seq < kFrames; ++seq) {
+            const auto frame = MakeFrame(seq);
+            batch.insert(batch.end(), frame.begin(), frame.end());
+            if (seq % 7 == 6 || seq + 1 == kFrames) {
+                WriteAll(pipe.WriteFd, batch);
+                batch.clear();
+            }
+        }
+        close(std::exchange(pipe.WriteFd, -1));
+    }};
+    auto readerOrError = BufferedReader::CreateNew(pipe.ReadFd, 4096);
+    assert(std::holds_alternative<BufferedReader>(readerOrError));
+    auto& reader = std::get<BufferedReader>(readerOrError);
+    auto seq = uint32_t{0};
+    auto numReads = 0;
+    for (auto eof = false; !eof;) {
+        auto pfd = pollfd{.fd = pipe.ReadFd, .events = POLLIN, .revents = 0};
+        assert(poll(&pfd, 1, 5000) == 1);
+        ++numReads;
+        std::visit([&eof]<class R>(const R&) {
+            eof = std::is_same_v<R, NBufferedRead::OnEof>;
+            assert((std::is_same_v<R, NBufferedRead::OnData> || eof));
+        }, reader.Fill());
+        while (const auto frame = reader.TryPopFrame(FrameSize)) assert(IsFrame(*frame, seq++));
+    }
+    assert(seq == kFrames && reader.GetBuffered().empty());
+    std::cerr << "TestStream OK (" << double(numReads) / kFrames << " reads per frame)\n";
+}
+
+auto TestBufferFull() -> void {
+    auto pipe = Pipe{};
+    auto readerOrError = BufferedReader::CreateNew(pipe.ReadFd, 4096);
+    auto& reader = std::get<BufferedReader>(readerOrError);
+    const auto junk = std::vector<std::byte>(reader.GetCapacity() + 1, std::byte{0xFF});
+    WriteAll(pipe.WriteFd, junk);
+    assert(std::holds_alternative<NBufferedRead::OnData>(reader.Fill()));
+    // A frame longer than the buffer never completes
+    assert(!reader.TryPopFrame(FrameSize));
+    assert(std::holds_alternative<NBufferedRead::OnBufferFull>(reader.Fill()));
+    reader.Consume(10);
+    assert(std::get<NBufferedRead::OnData>(reader.Fill()).NumBytesRead == 1);
+    std::cerr << "TestBufferFull OK\n";
+}
+} // namespace NTests
+
+
+auto main() -> int {
+    using namespace NTests;
+    TestMagicRingBuffer();
+    TestCoalescing();
+    TestStream();
+    TestBufferFull();
+    std::cerr << "All tests passed.\n";
+}
@@ -0,0 +1,65 @@
+#include "cancellation_token.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <utility>
+
+
+CancellationToken::CancellationToken(const int fd) noexcept
+    : Fd_(fd)
+{
+}
+
+CancellationToken::CancellationToken(CancellationToken&& other) noexcept
+    : Fd_(std::exchange(other.Fd_, -1))
+    , Cancelled_(other.Cancelled_.load(std::memory_order_relaxed))
+{
+}
+
+CancellationToken::~CancellationToken() noexcept {
+    if (Fd_ != -1) close(Fd_);
+}
+
+auto CancellationToken::CreateNew() noexcept -> std::variant<CancellationToken, SystemError> {
+    const auto fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd == -1) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "eventfd() syscall failed (" SOURCE_LOCATION ")",
+        };
+    }
+    return CancellationToken{fd};
+}
+
+auto CancellationToken::Cancel() noexcept -> std::optional<SystemError> {
+    if (Cancelled_.exchange(true, std::memory_order_acq_rel)) return std::nullopt;
+    const auto one = uint64_t{1};
+    if (write(Fd_, &one, sizeof(one)) == -1) {
+        // Lets a retry write again
+        Cancelled_.store(false, std::memory_order_relaxed);
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "write() syscall failed for an eventfd (" SOURCE_LOCATION ")",
+        };
+    }
+    return std::nullopt;
+}
+
+auto CancellationToken::IsCancelled() const noexcept -> bool {
+    return Cancelled_.load(std::memory_order_acquire);
+}
+
+auto CancellationToken::Reset() noexcept -> std::optional<SystemError> {
+    auto value = uint64_t{0};
+    // `EAGAIN` if it wasn't cancelled
+    if (read(Fd_, &value, sizeof(value)) == -1 && errno != EAGAIN) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "read() syscall failed for an eventfd (" SOURCE_LOCATION ")",
+        };
+    }
+    Cancelled_.store(false, std::memory_order_release);
+    return std::nullopt;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+
+#include "../error.hpp"
+
+#include <atomic>
+#include <optional>
+#include <variant>
+
+
+/* Cancels a group of blocking operations at once, e.g. every read and
+ * write of a game when the user quits it.
+ *
+ * `GetFd()` is an eventfd to pass as the cancellation file descriptor
+ * of `RobustSyncRead()`, `RobustSyncWrite()` or `EpollWaiter::ReadAny()`,
+ * by any number of threads. `Cancel()` makes it readable with a single
+ * `write()`, and as those operations never read it, it stays readable
+ * and cancels every pending and later operation until `Reset()`. One
+ * fd is shared by the whole group, instead of a pipe per canceller.
+ */
+class CancellationToken {
+private:
+    int Fd_;
+    std::atomic<bool> Cancelled_ = false;
+private:
+    explicit CancellationToken(int fd) noexcept;
+public:
+    CancellationToken(const CancellationToken& other) = delete;
+    // Only before the token is shared between threads
+    CancellationToken(CancellationToken&& other) noexcept;
+    ~CancellationToken() noexcept;
+
+    [[nodiscard]] static auto CreateNew() noexcept -> std::variant<CancellationToken, SystemError>;
+
+    // Non-blocking, readable once cancelled
+    [[nodiscard]] auto GetFd() const noexcept -> int { return Fd_; }
+
+    // Any thread; only the first call makes a syscall
+    [[nodiscard]] auto Cancel() noexcept -> std::optional<SystemError>;
+    // Any thread, without a syscall
+    [[nodiscard]] auto IsCancelled() const noexcept -> bool;
+    // Makes the token reusable, once no operation uses it any more
+    [[nodiscard]] auto Reset() noexcept -> std::optional<SystemError>;
+};
@@ -0,0 +1,109 @@
+#include "cancellation_token.hpp"
+
+#include "../robust_read_write/robust_read_write.hpp"
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+
+namespace {
+using namespace std::chrono;
+
+// A RAII wrapper over a non-blocking pipe
+struct Pipe {
+    int ReadFd = -1;
+    int WriteFd = -1;
+
+    Pipe() {
+        int fds[2];
+        assert(pipe2(fds, O_NONBLOCK | O_CLOEXEC) == 0);
+        ReadFd = fds[0];
+        WriteFd = fds[1];
+    }
+    ~Pipe() {
+        close(ReadFd);
+        close(WriteFd);
+    }
+};
+
+auto CreateToken() -> CancellationToken {
+    auto tokenOrError = CancellationToken::CreateNew();
+    assert(std::holds_alternative<CancellationToken>(tokenOrError));
+    return std::move(std::get<CancellationToken>(tokenOrError));
+}
+
+auto IsReadable(int fd) -> bool {
+    auto pollFd = pollfd{.fd = fd, .events = POLLIN, .revents = 0};
+    return poll(&pollFd, 1, 0) == 1;
+}
+} // anonymous namespace
+
+
+namespace NTests {
+auto TestCancelAndReset() -> void {
+    auto token = CreateToken();
+    assert(!token.IsCancelled() && !IsReadable(token.GetFd()));
+    assert(!token.Cancel() && !token.Cancel());
+    assert(token.IsCancelled() && IsReadable(token.GetFd()));
+    // Stays readable while nobody resets it
+    assert(IsReadable(token.GetFd()));
+    assert(!token.Reset());
+    assert(!token.IsCancelled() && !IsReadable(token.GetFd()));
+    assert(!token.Reset());
+    std::cerr << "TestCancelAndReset OK\n";
+}
+
+// One `Cancel()` stops pending reads and a write blocked on a full pipe
+auto TestGroupCancellation() -> void {
+    auto token = CreateToken();
+    constexpr auto kNumReaders = 4;
+    auto pipes = std::vector<Pipe>(kNumReaders + 1);
+    auto& writePipe = pipes.back();
+    const auto pipeSize = fcntl(writePipe.WriteFd, F_SETPIPE_SZ, 4096);
+    assert(pipeSize != -1);
+    auto numCancelled = std::atomic<int>{0};
+    {
+        auto threads = std::vector<std::jthread>{};
+        for (auto i = 0; i < kNumReaders; ++i) {
+            threads.emplace_back([&, fd = pipes[i].ReadFd]() {
+                auto buf = std::array<std::byte, 8>{};
+                const auto result = RobustSyncRead(fd, buf, milliseconds{5000}, token.GetFd());
+                if (std::holds_alternative<NRobustSyncRead::OnCancellation>(result)) ++numCancelled;
+            });
+        }
+        threads.emplace_back([&]() {
+            const auto buf = std::vector<std::byte>(size_t(pipeSize) * 2);
+            const auto result = RobustSyncWrite(writePipe.WriteFd, buf, milliseconds{5000}, token.GetFd());
+            const auto* onCancellation = std::get_if<NRobustSyncWrite::OnCancellation>(&result);
+            if (onCancellation && onCancellation->NumBytesWritten == size_t(pipeSize)) ++numCancelled;
+        });
+        std::this_thread::sleep_for(milliseconds{50});
+        const auto start = steady_clock::now();
+        assert(!token.Cancel());
+        threads.clear();
+        assert(steady_clock::now() - start < milliseconds{1000});
+    }
+    assert(numCancelled == kNumReaders + 1);
+
+    // Later operations are cancelled right away
+    auto buf = std::array<std::byte, 8>{};
+    const auto result = RobustSyncRead(pipes[0].ReadFd, buf, milliseconds{5000}, token.GetFd());
+    assert(std::holds_alternative<NRobustSyncRead::OnCancellation>(result));
+    std::cerr << "TestGroupCancellation OK\n";
+}
+} // namespace NTests
+
+
+auto main() -> int {
+    using namespace NTests;
+    TestCancelAndReset();
+    TestGroupCancellation();
+    std::cerr << "All tests passed.\n";
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+
+#include <charconv>
+#include <string_view>
+
+
+// The integer that `arg` starts with, or `defaultValue` if it doesn't start with one
+inline auto ParseIntArg(std::string_view arg, int defaultValue) -> int {
+    auto value = defaultValue;
+    std::from_chars(arg.data(), arg.data() + arg.size(), value);
+    return value;
+}
@@ -0,0 +1,38 @@
+#include "frame_pool.hpp"
+
+#include <new>
+#include <utility>
+
+
+auto FramePool::ForThisThread() noexcept -> FramePool& {
+    thread_local auto pool = FramePool{};
+    return pool;
+}
+
+auto FramePool::Allocate(const size_t size) -> void* {
+    const auto numSteps = (size + kSizeStep - 1) / kSizeStep;
+    if (numSteps == 0 || numSteps > kNumSizes) return ::operator new(size);
+    auto& freeList = FreeLists_[numSteps - 1];
+    if (freeList) {
+        return std::exchange(freeList, freeList->Next);
+    }
+    const auto roundedSize = numSteps * kSizeStep;
+    if (ChunkLeft_ < roundedSize) {
+        // The rest of the previous chunk is too small, and is left unused
+        Chunks_.push_back(std::make_unique_for_overwrite<std::byte[]>(kChunkSize));
+        ChunkPos_ = Chunks_.back().get();
+        ChunkLeft_ = kChunkSize;
+    }
+    ChunkLeft_ -= roundedSize;
+    return std::exchange(ChunkPos_, ChunkPos_ + roundedSize);
+}
+
+auto FramePool::Deallocate(void* const frame, const size_t size) noexcept -> void {
+    const auto numSteps = (size + kSizeStep - 1) / kSizeStep;
+    if (numSteps == 0 || numSteps > kNumSizes) {
+        ::operator delete(frame, size);
+        return;
+    }
+    auto& freeList = FreeLists_[numSteps - 1];
+    freeList = new (frame) FreeFrame{.Next = freeList};
+}
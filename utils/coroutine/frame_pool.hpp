@@ -0,0 +1,49 @@
+#pragma once
+
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+/* The allocator of coroutine frames: a connection handled by a coroutine
+ * allocates a frame per call of each coroutine it awaits, so thousands of
+ * them would otherwise hit `operator new` for every message.
+ *
+ * Frames are rounded up to a multiple of 64 bytes and carved from big
+ * chunks; a freed frame goes to the free list of its size, where the next
+ * frame of that size is taken from. Chunks are only freed with the pool,
+ * so the memory stays at the peak of frames alive at once. Frames larger
+ * than the biggest size are left to `operator new`.
+ *
+ * One pool per thread: a frame has to be freed by the thread that
+ * allocated it, which holds for the coroutines of one `EventLoop`.
+ */
+class FramePool {
+private:
+    static constexpr auto kSizeStep = size_t{64};
+    static constexpr auto kNumSizes = size_t{64};
+    static constexpr auto kChunkSize = size_t{256} << 10;
+
+    struct FreeFrame {
+        FreeFrame* Next;
+    };
+    // Indexed by the size of the frames divided by `kSizeStep`, minus one
+    std::array<FreeFrame*, kNumSizes> FreeLists_{};
+    std::vector<std::unique_ptr<std::byte[]>> Chunks_;
+    // What is left of the last chunk
+    std::byte* ChunkPos_ = nullptr;
+    size_t ChunkLeft_ = 0;
+public:
+    FramePool() noexcept = default;
+    FramePool(const FramePool& other) = delete;
+
+    [[nodiscard]] static auto ForThisThread() noexcept -> FramePool&;
+
+    [[nodiscard]] auto Allocate(size_t size) -> void*;
+    // `size` is the one `frame` was allocated with
+    auto Deallocate(void* frame, size_t size) noexcept -> void;
+
+    [[nodiscard]] auto NumChunks() const noexcept -> size_t { return Chunks_.size(); }
+};
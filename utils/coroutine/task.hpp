@@ -0,0 +1,239 @@
+#pragma once
+
+
+#include "frame_pool.hpp"
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+
+template <class T>
+class Task;
+
+namespace NTaskDetail {
+    // What the promises of all coroutines have in common: their frames come from the `FramePool`
+    struct PooledFrame {
+        static auto operator new(const size_t size) -> void* {
+            return FramePool::ForThisThread().Allocate(size);
+        }
+        static auto operator delete(void* const frame, const size_t size) noexcept -> void {
+            FramePool::ForThisThread().Deallocate(frame, size);
+        }
+    };
+
+    struct PromiseBase : PooledFrame {
+        // Resumed once the coroutine is done
+        std::coroutine_handle<> Continuation = std::noop_coroutine();
+
+        struct FinalAwaiter {
+            auto await_ready() const noexcept -> bool { return false; }
+            template <class Promise>
+            auto await_suspend(std::coroutine_handle<Promise> done) const noexcept -> std::coroutine_handle<> {
+                return done.promise().Continuation;
+            }
+            auto await_resume() const noexcept -> void {}
+        };
+
+        auto initial_suspend() const noexcept -> std::suspend_always { return {}; }
+        auto final_suspend() const noexcept -> FinalAwaiter { return {}; }
+        // The code run by coroutines is `noexcept`, as everywhere else
+        [[noreturn]] auto unhandled_exception() const noexcept -> void { std::terminate(); }
+    };
+
+    template <class T>
+    struct Promise : PromiseBase {
+        std::optional<T> Value;
+
+        auto get_return_object() noexcept -> Task<T>;
+        template <class U>
+        auto return_value(U&& value) noexcept(std::is_nothrow_constructible_v<T, U&&>) -> void {
+            Value.emplace(std::forward<U>(value));
+        }
+    };
+
+    template <>
+    struct Promise<void> : PromiseBase {
+        auto get_return_object() noexcept -> Task<void>;
+        auto return_void() const noexcept -> void {}
+    };
+} // namespace NTaskDetail
+
+/* A coroutine that returns `T`, e.g. a state handler that sends a
+ * request, awaits the response and returns the next state, written
+ * sequentially however many operations of an `EventLoop` it awaits.
+ *
+ * It starts when it is awaited, and resumes its awaiter when it is done,
+ * without growing the stack. A task that is never awaited has to be
+ * given to a `TaskScope`, which runs it. Owns the frame of the coroutine.
+ */
+template <class T = void>
+class [[nodiscard]] Task {
+public:
+    using promise_type = NTaskDetail::Promise<T>;
+private:
+    std::coroutine_handle<promise_type> Handle_;
+private:
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept
+        : Handle_(handle)
+    {
+    }
+    friend promise_type;
+
+    struct Awaiter {
+        std::coroutine_handle<promise_type> Handle;
+
+        auto await_ready() const noexcept -> bool { return false; }
+        auto await_suspend(std::coroutine_handle<> awaiter) const noexcept -> std::coroutine_handle<> {
+            Handle.promise().Continuation = awaiter;
+            return Handle;
+        }
+        auto await_resume() const noexcept -> T {
+            if constexpr (!std::is_void_v<T>) return std::move(*Handle.promise().Value);
+        }
+    };
+public:
+    Task(const Task& other) = delete;
+    Task(Task&& other) noexcept
+        : Handle_(std::exchange(other.Handle_, nullptr))
+    {
+    }
+    auto operator=(Task&& other) noexcept -> Task& {
+        if (this != &other) {
+            if (Handle_) Handle_.destroy();
+            Handle_ = std::exchange(other.Handle_, nullptr);
+        }
+        return *this;
+    }
+    ~Task() noexcept {
+        if (Handle_) Handle_.destroy();
+    }
+
+    // Runs the coroutine until it is done, and gets what it returned
+    auto operator co_await() && noexcept -> Awaiter {
+        return Awaiter{Handle_};
+    }
+};
+
+template <class T>
+auto NTaskDetail::Promise<T>::get_return_object() noexcept -> Task<T> {
+    return Task<T>{std::coroutine_handle<Promise>::from_promise(*this)};
+}
+
+inline auto NTaskDetail::Promise<void>::get_return_object() noexcept -> Task<void> {
+    return Task<void>{std::coroutine_handle<Promise>::from_promise(*this)};
+}
+
+/* Runs tasks that nobody awaits, e.g. one per connection of a server,
+ * and owns them until they are done.
+ *
+ * The scope destroys the tasks still suspended when it is destroyed,
+ * which destroys the tasks they await in turn. This is how the tasks
+ * waiting for an `EventLoop` that won't run again are ended: the loop
+ * only keeps the handles of the suspended coroutines in its callbacks,
+ * so it must not run after the scope is destroyed.
+ */
+class TaskScope {
+private:
+    struct RootPromise;
+    // The coroutine that runs a spawned task, and frees itself when it's done
+    struct Root {
+        using promise_type = RootPromise;
+    };
+    struct RootPromise : NTaskDetail::PooledFrame {
+        TaskScope* Scope;
+        RootPromise* Prev = nullptr;
+        RootPromise* Next = nullptr;
+
+        RootPromise(TaskScope& scope, Task<void>&) noexcept
+            : Scope(&scope)
+        {
+            Next = std::exchange(Scope->Roots_, this);
+            if (Next) Next->Prev = this;
+        }
+        ~RootPromise() noexcept {
+            (Prev ? Prev->Next : Scope->Roots_) = Next;
+            if (Next) Next->Prev = Prev;
+        }
+
+        auto get_return_object() const noexcept -> Root { return {}; }
+        auto initial_suspend() const noexcept -> std::suspend_never { return {}; }
+        auto final_suspend() const noexcept -> std::suspend_never { return {}; }
+        auto return_void() const noexcept -> void {}
+        [[noreturn]] auto unhandled_exception() const noexcept -> void { std::terminate(); }
+    };
+
+    // The roots of the spawned tasks that aren't done, as an intrusive list
+    RootPromise* Roots_ = nullptr;
+public:
+    TaskScope() noexcept = default;
+    TaskScope(const TaskScope& other) = delete;
+    TaskScope(TaskScope&& other) noexcept
+        : Roots_(std::exchange(other.Roots_, nullptr))
+    {
+        for (auto* root = Roots_; root; root = root->Next) root->Scope = this;
+    }
+    ~TaskScope() noexcept {
+        while (Roots_) std::coroutine_handle<RootPromise>::from_promise(*Roots_).destroy();
+    }
+
+    // Runs `task` until its first suspension, and then from whatever resumes it
+    auto Spawn(Task<void> task) noexcept -> void {
+        static_cast<void>(RunRoot(*this, std::move(task)));
+    }
+
+    [[nodiscard]] auto NumRunning() const noexcept -> size_t {
+        auto n = size_t{0};
+        for (auto* root = Roots_; root; root = root->Next) ++n;
+        return n;
+    }
+private:
+    static auto RunRoot(TaskScope&, Task<void> task) noexcept -> Root {
+        co_await std::move(task);
+    }
+};
+
+/* Awaits an operation that reports its result to a callback, such as
+ * `EventLoop::AsyncRead()`: `start(onDone)` has to start the operation
+ * with the given callback, which resumes the awaiting coroutine.
+ *
+ * The callback must not be called from inside `start`, which holds for
+ * everything run by an `EventLoop`. It only captures the awaiter and the
+ * coroutine, so a `std::function` stores it without allocating.
+ *
+ * GCC 12 destroys the captures of a lambda written in the `co_await`
+ * expression of a coroutine twice, so a `start` that captures anything
+ * with a destructor, e.g. a `std::shared_ptr`, has to be made in a plain
+ * function that returns the awaitable, or to capture by reference.
+ */
+template <class Result, class Start>
+class CallbackAwaitable {
+private:
+    Start Start_;
+    std::optional<Result> Result_;
+public:
+    explicit CallbackAwaitable(Start start) noexcept(std::is_nothrow_move_constructible_v<Start>)
+        : Start_(std::move(start))
+    {
+    }
+
+    auto await_ready() const noexcept -> bool { return false; }
+    auto await_suspend(const std::coroutine_handle<> awaiter) noexcept -> void {
+        Start_([this, awaiter](Result result) {
+            Result_.emplace(std::move(result));
+            awaiter.resume();
+        });
+    }
+    auto await_resume() noexcept -> Result {
+        return std::move(*Result_);
+    }
+};
+
+template <class Result, class Start>
+[[nodiscard]] auto AwaitCallback(Start start) noexcept(std::is_nothrow_move_constructible_v<Start>)
+  -> CallbackAwaitable<Result, Start> {
+    return CallbackAwaitable<Result, Start>{std::move(start)};
+}
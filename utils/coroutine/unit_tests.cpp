@@ -0,0 +1,204 @@
+#include "task.hpp"
+
+#include "../event_loop/event_loop.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cctype>
+#include <cstdint>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+
+namespace {
+using namespace std::chrono;
+
+auto CreateLoop() -> EventLoop {
+    auto loopOrError = EventLoop::CreateNew();
+    assert(std::holds_alternative<EventLoop>(loopOrError));
+    return std::move(std::get<EventLoop>(loopOrError));
+}
+
+auto Read(EventLoop& loop, int fd, std::span<std::byte> to) {
+    return AwaitCallback<RobustSyncReadResult>([&loop, fd, to](EventLoop::OnReadDone onDone) {
+        loop.AsyncRead(fd, to, milliseconds{5000}, std::move(onDone));
+    });
+}
+
+auto Write(EventLoop& loop, int fd, std::span<const std::byte> from) {
+    return AwaitCallback<RobustSyncWriteResult>([&loop, fd, from](EventLoop::OnWriteDone onDone) {
+        loop.AsyncWrite(fd, from, milliseconds{5000}, std::move(onDone));
+    });
+}
+
+auto Twice(int64_t x) -> Task<int64_t> {
+    co_return 2 * x;
+}
+
+auto SumOfTwice(int n) -> Task<int64_t> {
+    auto sum = int64_t{0};
+    for (auto i = 0; i != n; ++i) sum += co_await Twice(i);
+    co_return sum;
+}
+
+// Counts its live instances, to find what the frames of coroutines destroy
+struct Counted {
+    static inline int NumAlive = 0;
+    Counted() { ++NumAlive; }
+    Counted(const Counted&) { ++NumAlive; }
+    ~Counted() { --NumAlive; }
+};
+} // anonymous namespace
+
+
+namespace NTests {
+auto TestAwaitTasks() -> void {
+    auto scope = TaskScope{};
+    auto result = int64_t{0};
+    scope.Spawn([](int64_t& result) -> Task<void> {
+        // Each of them is done at once, and resumes its awaiter
+        result = co_await SumOfTwice(10'000);
+    }(result));
+    assert(result == 99'990'000);
+    assert(scope.NumRunning() == 0);
+    std::cerr << "TestAwaitTasks OK\n";
+}
+
+// Sequential code that waits for the loop: each message is
+// read only once the previous one is written back
+auto TestResumedByLoop() -> void {
+    auto loop = CreateLoop();
+    int fds[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) == 0);
+    assert(!loop.Add(fds[0]) && !loop.Add(fds[1]));
+    auto scope = TaskScope{};
+    auto log = std::string{};
+    scope.Spawn([](EventLoop& loop, int fd, std::string& log) -> Task<void> {
+        auto buf = std::array<std::byte, 1>{};
+        for (;;) {
+            const auto read = co_await Read(loop, fd, buf);
+            if (!std::holds_alternative<NRobustSyncRead::OnSuccess>(read)) co_return;
+            log += char(buf[0]);
+            co_await Write(loop, fd, buf);
+        }
+    }(loop, fds[1], log));
+    scope.Spawn([](EventLoop& loop, int fd, std::string& log) -> Task<void> {
+        for (const auto c : std::string{"abc"}) {
+            auto buf = std::array{std::byte(c)};
+            co_await Write(loop, fd, buf);
+            assert(std::holds_alternative<NRobustSyncRead::OnSuccess>(co_await Read(loop, fd, buf)));
+            log += char(std::toupper(char(buf[0])));
+        }
+        shutdown(fd, SHUT_WR);
+    }(loop, fds[0], log));
+    // Both wait for the loop already
+    assert(log.empty() && scope.NumRunning() == 2);
+    assert(!loop.Run());
+    assert(log == "aAbBcC" && scope.NumRunning() == 0);
+    close(fds[0]);
+    close(fds[1]);
+    std::cerr << "TestResumedByLoop OK\n";
+}
+
+// The tasks still waiting are destroyed with their scope, with what their frames hold
+auto TestScopeDestroysSuspendedTasks() -> void {
+    constexpr auto kNumTasks = 3;
+    auto loop = CreateLoop();
+    auto pipes = std::array<std::array<int, 2>, kNumTasks>{};
+    {
+        auto scope = TaskScope{};
+        for (auto& pipe : pipes) {
+            assert(pipe2(pipe.data(), O_NONBLOCK | O_CLOEXEC) == 0);
+            assert(!loop.Add(pipe[0]));
+            scope.Spawn([](EventLoop& loop, int fd) -> Task<void> {
+                const auto counted = Counted{};
+                auto inner = [](EventLoop& loop, int fd, Counted) -> Task<void> {
+                    auto buf = std::array<std::byte, 1>{};
+                    co_await Read(loop, fd, buf);
+                    assert(false);
+                };
+                co_await inner(loop, fd, counted);
+            }(loop, pipe[0]));
+        }
+        assert(!loop.RunOnce(milliseconds{0}));
+        assert(Counted::NumAlive >= kNumTasks * 2 && scope.NumRunning() == kNumTasks);
+    }
+    assert(Counted::NumAlive == 0);
+    for (const auto& pipe : pipes) {
+        close(pipe[0]);
+        close(pipe[1]);
+    }
+    std::cerr << "TestScopeDestroysSuspendedTasks OK\n";
+}
+
+// Frames are reused instead of allocated again
+auto TestFramePool() -> void {
+    auto& pool = FramePool::ForThisThread();
+    const auto numChunks = pool.NumChunks();
+    for (auto i = 0; i != 100'000; ++i) {
+        auto scope = TaskScope{};
+        scope.Spawn([]() -> Task<void> { co_await Twice(1); }());
+    }
+    assert(pool.NumChunks() == std::max(numChunks, size_t{1}));
+
+    auto* small = pool.Allocate(10);
+    pool.Deallocate(small, 10);
+    assert(pool.Allocate(64) == small);
+    pool.Deallocate(small, 64);
+    auto* big = pool.Allocate(size_t{1} << 20);
+    pool.Deallocate(big, size_t{1} << 20);
+    std::cerr << "TestFramePool OK\n";
+}
+
+// One task per connection, for thousands of them, on one thread
+auto TestManyTasks() -> void {
+    constexpr auto kNumConnections = 2000;
+    constexpr auto kNumRounds = 20;
+    auto loop = CreateLoop();
+    auto scope = TaskScope{};
+    auto fds = std::vector<std::array<int, 2>>(kNumConnections);
+    auto numDone = 0;
+    for (auto& pair : fds) {
+        assert(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, pair.data()) == 0);
+        assert(!loop.Add(pair[0]) && !loop.Add(pair[1]));
+        scope.Spawn([](EventLoop& loop, int fd) -> Task<void> {
+            auto buf = std::array<std::byte, 8>{};
+            while (std::holds_alternative<NRobustSyncRead::OnSuccess>(co_await Read(loop, fd, buf))) {
+                co_await Write(loop, fd, buf);
+            }
+        }(loop, pair[1]));
+        scope.Spawn([](EventLoop& loop, int fd, int& numDone) -> Task<void> {
+            auto buf = std::array<std::byte, 8>{};
+            for (auto i = 0; i != kNumRounds; ++i) {
+                co_await Write(loop, fd, buf);
+                assert(std::holds_alternative<NRobustSyncRead::OnSuccess>(co_await Read(loop, fd, buf)));
+            }
+            shutdown(fd, SHUT_WR);
+            ++numDone;
+        }(loop, pair[0], numDone));
+    }
+    assert(!loop.Run());
+    assert(numDone == kNumConnections && scope.NumRunning() == 0);
+    for (const auto& pair : fds) {
+        close(pair[0]);
+        close(pair[1]);
+    }
+    std::cerr << "TestManyTasks OK\n";
+}
+} // namespace NTests
+
+
+auto main() -> int {
+    using namespace NTests;
+    TestAwaitTasks();
+    TestResumedByLoop();
+    TestScopeDestroysSuspendedTasks();
+    TestFramePool();
+    TestManyTasks();
+    std::cerr << "All tests passed.\n";
+}
@@ -0,0 +1,204 @@
+#include "epoll_waiter.hpp"
+
+#include "../timer/timer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <poll.h>
+#include <unistd.h>
+#include <utility>
+
+
+namespace {
+    // Events handled per `epoll_wait()` in `ReadAny()`
+    constexpr auto kMaxEvents = 64;
+
+    // Whether `fd` is readable right now
+    auto IsReadable(const int fd) noexcept -> bool {
+        auto pollFd = pollfd{
+            .fd = fd,
+            .events = POLLIN,
+            .revents = 0,
+        };
+        return poll(&pollFd, 1, 0) == 1;
+    }
+}
+
+EpollWaiter::EpollWaiter(const int epollFd) noexcept
+    : EpollFd_(epollFd)
+{
+}
+
+EpollWaiter::EpollWaiter(EpollWaiter&& other) noexcept
+    : EpollFd_(std::exchange(other.EpollFd_, -1))
+    , MaybeReadable_(std::move(other.MaybeReadable_))
+{
+}
+
+EpollWaiter& EpollWaiter::operator=(EpollWaiter&& other) noexcept {
+    std::swap(EpollFd_, other.EpollFd_);
+    std::swap(MaybeReadable_, other.MaybeReadable_);
+    return *this;
+}
+
+EpollWaiter::~EpollWaiter() noexcept {
+    if (EpollFd_ != -1) close(EpollFd_);
+}
+
+auto EpollWaiter::CreateNew() noexcept -> std::variant<EpollWaiter, SystemError> {
+    const auto epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd == -1) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "epoll_create1() syscall failed (" SOURCE_LOCATION ")",
+        };
+    }
+    return EpollWaiter{epollFd};
+}
+
+auto EpollWaiter::Add(const int fd, const uint32_t events) noexcept -> std::optional<SystemError> {
+    auto event = epoll_event{
+        .events = EPOLLIN | EPOLLRDHUP | EPOLLET | events,
+        .data = {.fd = fd},
+    };
+    if (epoll_ctl(EpollFd_, EPOLL_CTL_ADD, fd, &event) == -1) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "epoll_ctl() syscall failed (" SOURCE_LOCATION ")",
+        };
+    }
+    if (size_t(fd) >= MaybeReadable_.size()) MaybeReadable_.resize(size_t(fd) + 1);
+    // Finding out costs a `read()`, which `ReadAny()` makes anyway
+    MaybeReadable_[fd] = true;
+    return std::nullopt;
+}
+
+auto EpollWaiter::Remove(const int fd) noexcept -> std::optional<SystemError> {
+    if (epoll_ctl(EpollFd_, EPOLL_CTL_DEL, fd, nullptr) == -1) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "epoll_ctl() syscall failed (" SOURCE_LOCATION ")",
+        };
+    }
+    SetMaybeReadable(fd, false);
+    return std::nullopt;
+}
+
+auto EpollWaiter::Wait(const std::span<epoll_event> events, const std::chrono::milliseconds timeout) noexcept
+  -> std::variant<size_t, SystemError> {
+    const auto timeoutMs = timeout.count() < 0 ? -1 : int(std::min<std::chrono::milliseconds::rep>(timeout.count(), INT_MAX));
+    const auto n = epoll_wait(EpollFd_, events.data(), int(events.size()), timeoutMs);
+    if (n == -1) {
+        if (errno == EINTR) return size_t{0};
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "epoll_wait() syscall failed (" SOURCE_LOCATION ")",
+        };
+    }
+    for (auto i = 0; i != n; ++i) SetMaybeReadable(events[i].data.fd, true);
+    return size_t(n);
+}
+
+auto EpollWaiter::ReadAny(
+    const std::span<NRobustSyncReadAny::ReadOp> ops,
+    const std::chrono::milliseconds timeout,
+    const std::optional<int> cancellationFd
+) noexcept
+  -> RobustSyncReadAnyResult {
+    using namespace NRobustSyncReadAny;
+    const auto timer = Timer{timeout};
+    // The flag is only a hint for a cancellation fd, which is never read
+    // here, so it is checked before cancelling
+    auto isCancelled = [&]() {
+        if (!cancellationFd || !IsMaybeReadable(*cancellationFd)) return false;
+        if (IsReadable(*cancellationFd)) return true;
+        SetMaybeReadable(*cancellationFd, false);
+        return false;
+    };
+    auto events = std::array<epoll_event, kMaxEvents>{};
+    for (;;) {
+        // Reads until `EAGAIN`, as no new event comes for input
+        // that was already there
+        for (auto i = size_t{0}; i != ops.size(); ++i) {
+            auto& op = ops[i];
+            while (op.NumBytesRead != op.To.size() && IsMaybeReadable(op.Fd)) {
+                const auto x = read(op.Fd, &op.To[op.NumBytesRead], op.To.size() - op.NumBytesRead);
+                if (x > 0) {
+                    op.NumBytesRead += size_t(x);
+                } else if (x == 0) {
+                    return OnPrematureEof{
+                        .OpIndex = i,
+                        .WallTimeElapsed = timer.CalcElapsedTime(),
+                    };
+                } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    SetMaybeReadable(op.Fd, false);
+                } else if (errno != EINTR) {
+                    return OnSystemError{
+                        .OpIndex = i,
+                        .WallTimeElapsed = timer.CalcElapsedTime(),
+                        .Err = SystemError{
+                            .Value = std::errc{errno},
+                            .ContextMessage = "read() syscall failed (" SOURCE_LOCATION ")",
+                        },
+                    };
+                }
+            }
+            if (op.NumBytesRead == op.To.size()) {
+                return OnSuccess{
+                    .OpIndex = i,
+                    .WallTimeElapsed = timer.CalcElapsedTime(),
+                };
+            }
+        }
+
+        // Input is read before a cancellation is seen, as in `RobustSyncRead()`
+        if (isCancelled()) {
+            return OnCancellation{
+                .WallTimeElapsed = timer.CalcElapsedTime(),
+            };
+        }
+
+        const auto n = epoll_wait(EpollFd_, events.data(), kMaxEvents, timer.CalcRemainingPollTimeout());
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return OnSystemError{
+                .OpIndex = std::nullopt,
+                .WallTimeElapsed = timer.CalcElapsedTime(),
+                .Err = SystemError{
+                    .Value = std::errc{errno},
+                    .ContextMessage = "epoll_wait() syscall failed (" SOURCE_LOCATION ")",
+                },
+            };
+        } else if (n == 0) {
+            return OnTimeout{
+                .WallTimeElapsed = timer.CalcElapsedTime(),
+            };
+        }
+        for (auto e = 0; e != n; ++e) {
+            const auto fd = events[e].data.fd;
+            const auto revents = events[e].events;
+            SetMaybeReadable(fd, true);
+            if (revents & EPOLLIN) continue;
+            if (!(revents & (EPOLLERR | EPOLLHUP))) continue;
+            for (auto i = size_t{0}; i != ops.size(); ++i) {
+                if (ops[i].Fd == fd && ops[i].NumBytesRead != ops[i].To.size()) {
+                    return OnPollerrOrPollhup{
+                        .OpIndex = i,
+                        .WallTimeElapsed = timer.CalcElapsedTime(),
+                        .EpollEvents = revents,
+                    };
+                }
+            }
+        }
+    }
+}
+
+auto EpollWaiter::IsMaybeReadable(const int fd) const noexcept -> bool {
+    return size_t(fd) < MaybeReadable_.size() && MaybeReadable_[fd];
+}
+
+auto EpollWaiter::SetMaybeReadable(const int fd, const bool value) noexcept -> void {
+    if (size_t(fd) < MaybeReadable_.size()) MaybeReadable_[fd] = value;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+
+#include "../error.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <sys/epoll.h>
+#include <variant>
+#include <vector>
+
+
+namespace NRobustSyncReadAny {
+    // One of the reads of `EpollWaiter::ReadAny()`: `To.size()` bytes from
+    // `Fd`, of which `NumBytesRead` were read so far, by earlier calls too
+    struct ReadOp {
+        int Fd;
+        std::span<std::byte> To;
+        size_t NumBytesRead = 0;
+    };
+    // Indicates that the whole buffer of the operation `OpIndex` was read
+    struct OnSuccess {
+        size_t OpIndex;
+        std::chrono::nanoseconds WallTimeElapsed;
+    };
+    // Indicates that the wait was cancelled by some other
+    // event (i.e. a user pressing a "cancel" button)
+    struct OnCancellation {
+        std::chrono::nanoseconds WallTimeElapsed;
+    };
+    // Indicates that a `EOF` occurred on the file descriptor of
+    // the operation `OpIndex` before its whole buffer was read
+    struct OnPrematureEof {
+        size_t OpIndex;
+        std::chrono::nanoseconds WallTimeElapsed;
+    };
+    // Indicates that a system error occurred, while reading for
+    // the operation `OpIndex` if any
+    struct OnSystemError {
+        std::optional<size_t> OpIndex;
+        std::chrono::nanoseconds WallTimeElapsed;
+        SystemError Err;
+    };
+    // Indicates that the timeout was reached before any operation completed
+    struct OnTimeout {
+        std::chrono::nanoseconds WallTimeElapsed;
+    };
+    // Indicates that `epoll_wait()` returned `EPOLLERR` or `EPOLLHUP` without
+    // `EPOLLIN` for the file descriptor of the operation `OpIndex`
+    struct OnPollerrOrPollhup {
+        size_t OpIndex;
+        std::chrono::nanoseconds WallTimeElapsed;
+        uint32_t EpollEvents;
+    };
+    using Result = std::variant<
+        OnSuccess,
+        OnCancellation,
+        OnPrematureEof,
+        OnSystemError,
+        OnTimeout,
+        OnPollerrOrPollhup
+    >;
+}
+using RobustSyncReadAnyResult = NRobustSyncReadAny::Result;
+
+/* A long-lived epoll instance for a thread that waits on several file
+ * descriptors, e.g. the client waiting on the central server, the peer
+ * and user input at once.
+ *
+ * File descriptors are registered once, edge-triggered, instead of
+ * being passed to `poll()` on every call. The waiter remembers which of
+ * them may have unread input, from the events it saw and the reads it
+ * made, so an fd that becomes readable while nobody reads it neither
+ * makes later waits spin nor is missed when it is read from later.
+ */
+class EpollWaiter {
+private:
+    int EpollFd_;
+    // Indexed by file descriptor
+    std::vector<uint8_t> MaybeReadable_;
+private:
+    explicit EpollWaiter(int epollFd) noexcept;
+public:
+    EpollWaiter(const EpollWaiter& other) = delete;
+    EpollWaiter(EpollWaiter&& other) noexcept;
+    EpollWaiter& operator=(EpollWaiter&& other) noexcept;
+    ~EpollWaiter() noexcept;
+
+    [[nodiscard]] static auto CreateNew() noexcept -> std::variant<EpollWaiter, SystemError>;
+
+    // `nonBlockingFd` is not owned. `events` are added
+    // to `EPOLLIN | EPOLLRDHUP | EPOLLET`
+    [[nodiscard]] auto Add(int nonBlockingFd, uint32_t events = 0) noexcept -> std::optional<SystemError>;
+    [[nodiscard]] auto Remove(int fd) noexcept -> std::optional<SystemError>;
+
+    /* One `epoll_wait()` into `events`, for an event loop that handles
+     * the events itself; returns the number of events, 0 on timeout or
+     * when interrupted by a signal. A negative timeout waits forever,
+     * e.g. `wheel.CalcWaitTimeout(now).value_or(-1ms)` for a loop with a
+     * `TimingWheel`.
+     */
+    [[nodiscard]] auto Wait(std::span<epoll_event> events, std::chrono::milliseconds timeout) noexcept
+      -> std::variant<size_t, SystemError>;
+
+    /* Reads into the buffers of all the operations `ops` as input arrives,
+     * until one of them is complete. Every fd of `ops`, and
+     * `cancellationFd`, has to be added first, and each fd can appear in
+     * at most one operation.
+     *
+     * Bytes read for the other operations stay in their buffers and are
+     * counted in their `NumBytesRead`, so a later call with the same
+     * operations continues where this one stopped. As with
+     * `RobustSyncRead()`, `cancellationFd` becoming readable cancels
+     * the wait.
+     */
+    [[nodiscard]] auto ReadAny(
+        std::span<NRobustSyncReadAny::ReadOp> ops,
+        std::chrono::milliseconds timeout,
+        std::optional<int> cancellationFd = std::nullopt
+    ) noexcept
+      -> RobustSyncReadAnyResult;
+
+    [[nodiscard]] auto GetFd() const noexcept -> int { return EpollFd_; }
+private:
+    [[nodiscard]] auto IsMaybeReadable(int fd) const noexcept -> bool;
+    auto SetMaybeReadable(int fd, bool value) noexcept -> void;
+};
@@ -0,0 +1,181 @@
+#include "epoll_waiter.hpp"
+
+#include <cassert>
+#include <ctime>
+#include <fcntl.h>
+#include <iostream>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+
+namespace {
+using namespace std::chrono;
+
+// A RAII wrapper over a non-blocking pipe
+struct Pipe {
+    int ReadFd = -1;
+    int WriteFd = -1;
+
+    Pipe() {
+        int fds[2];
+        assert(pipe2(fds, O_NONBLOCK | O_CLOEXEC) == 0);
+        ReadFd = fds[0];
+        WriteFd = fds[1];
+    }
+    ~Pipe() {
+        close(ReadFd);
+        if (WriteFd != -1) close(WriteFd);
+    }
+
+    auto Write(std::string_view s) const -> void {
+        assert(write(WriteFd, s.data(), s.size()) == ssize_t(s.size()));
+    }
+};
+
+auto AsString(std::span<const std::byte> bytes) -> std::string_view {
+    return {reinterpret_cast<const char*>(bytes.data()), bytes.size()};
+}
+
+auto CpuTime() -> nanoseconds {
+    auto ts = timespec{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return seconds{ts.tv_sec} + nanoseconds{ts.tv_nsec};
+}
+
+auto CreateWaiter() -> EpollWaiter {
+    auto waiterOrError = EpollWaiter::CreateNew();
+    assert(std::holds_alternative<EpollWaiter>(waiterOrError));
+    return std::move(std::get<EpollWaiter>(waiterOrError));
+}
+} // anonymous namespace
+
+
+namespace NTests {
+using namespace NRobustSyncReadAny;
+
+// Whichever read completes first is returned, and the other keeps its progress
+auto TestFirstCompleted() -> void {
+    auto waiter = CreateWaiter();
+    const auto server = Pipe{};
+    const auto peer = Pipe{};
+    assert(!waiter.Add(server.ReadFd) && !waiter.Add(peer.ReadFd));
+    auto serverBuf = std::array<std::byte, 8>{};
+    auto peerBuf = std::array<std::byte, 4>{};
+    auto ops = std::array{
+        ReadOp{.Fd = server.ReadFd, .To = serverBuf},
+        ReadOp{.Fd = peer.ReadFd, .To = peerBuf},
+    };
+    auto writer = std::jthread{[&]() {
+        server.Write("serv");
+        std::this_thread::sleep_for(milliseconds{20});
+        peer.Write("e2e4");
+        std::this_thread::sleep_for(milliseconds{20});
+        server.Write("er!!");
+    }};
+    auto result = waiter.ReadAny(ops, milliseconds{5000});
+    assert(std::get<OnSuccess>(result).OpIndex == 1 && AsString(peerBuf) == "e2e4");
+    assert(ops[0].NumBytesRead == 4);
+
+    // Continues with the server's message, without the peer's operation
+    result = waiter.ReadAny(std::span{ops}.first(1), milliseconds{5000});
+    assert(std::get<OnSuccess>(result).OpIndex == 0 && AsString(serverBuf) == "server!!");
+    std::cerr << "TestFirstCompleted OK\n";
+}
+
+// Input that arrives on an fd nobody reads doesn't make waits spin,
+// and isn't lost for the reads that come later
+auto TestUnreadFd() -> void {
+    auto waiter = CreateWaiter();
+    const auto idle = Pipe{};
+    const auto busy = Pipe{};
+    assert(!waiter.Add(idle.ReadFd) && !waiter.Add(busy.ReadFd));
+    busy.Write("later");
+    auto idleBuf = std::array<std::byte, 1>{};
+    auto idleOps = std::array{ReadOp{.Fd = idle.ReadFd, .To = idleBuf}};
+    const auto cpuStart = CpuTime();
+    const auto start = steady_clock::now();
+    assert(std::holds_alternative<OnTimeout>(waiter.ReadAny(idleOps, milliseconds{200})));
+    assert(steady_clock::now() - start >= milliseconds{200});
+    assert(CpuTime() - cpuStart < milliseconds{50});
+
+    auto busyBuf = std::array<std::byte, 5>{};
+    auto busyOps = std::array{ReadOp{.Fd = busy.ReadFd, .To = busyBuf}};
+    assert(std::holds_alternative<OnSuccess>(waiter.ReadAny(busyOps, milliseconds{0})));
+    assert(AsString(busyBuf) == "later");
+    std::cerr << "TestUnreadFd OK\n";
+}
+
+auto TestCancellation() -> void {
+    auto waiter = CreateWaiter();
+    const auto data = Pipe{};
+    const auto cancellation = Pipe{};
+    assert(!waiter.Add(data.ReadFd) && !waiter.Add(cancellation.ReadFd));
+    auto buf = std::array<std::byte, 4>{};
+    auto ops = std::array{ReadOp{.Fd = data.ReadFd, .To = buf}};
+
+    // While waiting, after reading what has arrived
+    auto canceller = std::jthread{[&]() {
+        data.Write("ab");
+        std::this_thread::sleep_for(milliseconds{50});
+        cancellation.Write("x");
+    }};
+    auto result = waiter.ReadAny(ops, milliseconds{5000}, cancellation.ReadFd);
+    assert(std::holds_alternative<OnCancellation>(result) && ops[0].NumBytesRead == 2);
+    canceller.join();
+
+    // Right away while the cancellation fd stays readable
+    result = waiter.ReadAny(ops, milliseconds{5000}, cancellation.ReadFd);
+    assert(std::holds_alternative<OnCancellation>(result));
+
+    // Not any more once the cancellation is consumed
+    auto byte = char{};
+    assert(read(cancellation.ReadFd, &byte, 1) == 1);
+    data.Write("cd");
+    result = waiter.ReadAny(ops, milliseconds{5000}, cancellation.ReadFd);
+    assert(std::holds_alternative<OnSuccess>(result) && AsString(buf) == "abcd");
+    std::cerr << "TestCancellation OK\n";
+}
+
+auto TestHangup() -> void {
+    auto waiter = CreateWaiter();
+    auto data = Pipe{};
+    assert(!waiter.Add(data.ReadFd));
+    auto buf = std::array<std::byte, 4>{};
+    auto ops = std::array{ReadOp{.Fd = data.ReadFd, .To = buf}};
+    data.Write("a");
+    assert(std::holds_alternative<OnTimeout>(waiter.ReadAny(ops, milliseconds{10})));
+    close(std::exchange(data.WriteFd, -1));
+    const auto result = waiter.ReadAny(ops, milliseconds{5000});
+    assert(std::get<OnPollerrOrPollhup>(result).EpollEvents & EPOLLHUP);
+    assert(ops[0].NumBytesRead == 1);
+    std::cerr << "TestHangup OK\n";
+}
+
+auto TestWait() -> void {
+    auto waiter = CreateWaiter();
+    const auto data = Pipe{};
+    assert(!waiter.Add(data.ReadFd));
+    auto events = std::array<epoll_event, 4>{};
+    assert(std::get<size_t>(waiter.Wait(events, milliseconds{0})) == 0);
+    data.Write("x");
+    assert(std::get<size_t>(waiter.Wait(events, milliseconds{-1})) == 1);
+    assert(events[0].data.fd == data.ReadFd && (events[0].events & EPOLLIN));
+    // Edge-triggered: reported once
+    assert(std::get<size_t>(waiter.Wait(events, milliseconds{0})) == 0);
+    assert(!waiter.Remove(data.ReadFd) && waiter.Remove(data.ReadFd));
+    std::cerr << "TestWait OK\n";
+}
+} // namespace NTests
+
+
+auto main() -> int {
+    using namespace NTests;
+    TestFirstCompleted();
+    TestUnreadFd();
+    TestCancellation();
+    TestHangup();
+    TestWait();
+    std::cerr << "All tests passed.\n";
+}
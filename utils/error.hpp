@@ -4,7 +4,10 @@
 #include <cstring>
 #include <iostream>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <system_error>
+#include <utility>
 
 
 #define STR(x) STR2(x)
@@ -12,17 +15,66 @@
 #define SOURCE_LOCATION __FILE__ ", line " STR(__LINE__)
 
 
+/* The context message of an error, empty if there is none. A string
+ * literal, like the `"...() syscall failed (" SOURCE_LOCATION ")"` of
+ * almost every error, is only pointed to, so building, copying and
+ * returning errors doesn't allocate, e.g. on the I/O paths under a storm
+ * of failing connections. A message built at runtime, with a file name
+ * in it say, is owned.
+ *
+ * The literal constructor is `consteval`, so that only arrays which
+ * outlive every error get there: a `char` buffer on the stack doesn't
+ * compile, and has to be passed as a `std::string` to be owned.
+ */
+class ErrorContext {
+private:
+    std::string_view Literal_;
+    // Not a bare `std::string`, which can't be in the result of a `consteval` constructor
+    std::optional<std::string> Owned_;
+public:
+    ErrorContext() noexcept = default;
+    template <size_t N>
+    consteval ErrorContext(const char (&literal)[N]) noexcept
+        // Up to the terminator, wherever it is in the array
+        : Literal_(literal, std::char_traits<char>::length(literal))
+    {
+    }
+    ErrorContext(std::string owned) noexcept
+        : Owned_(std::move(owned))
+    {
+    }
+
+    [[nodiscard]] auto View() const noexcept -> std::string_view {
+        return Owned_ ? std::string_view{*Owned_} : Literal_;
+    }
+    [[nodiscard]] auto Empty() const noexcept -> bool {
+        return View().empty();
+    }
+
+    // A hidden friend, so that string literals aren't converted to be printed
+    friend auto operator<<(std::ostream& out, const ErrorContext& context) -> std::ostream& {
+        return out << context.View();
+    }
+};
+
+// Formatted only when logged
 template <class Error>
 struct ErrorWithContext {
     Error Value;
-    std::optional<std::string> ContextMessage = std::nullopt;
+    ErrorContext ContextMessage = {};
+    // The file descriptor the error is about, instead of formatting it into the context
+    std::optional<int> Fd = std::nullopt;
 };
 
 using SystemError = ErrorWithContext<std::errc>;
 template <class OStream>
 inline auto operator<<(OStream&& out, const SystemError& err) -> OStream&& {
-    if (err.ContextMessage) {
-        out << (*err.ContextMessage) << ", got the following error: ";
+    if (!err.ContextMessage.Empty()) {
+        out << err.ContextMessage;
+        if (err.Fd) out << ", file descriptor " << *err.Fd;
+        out << ", got the following error: ";
+    } else if (err.Fd) {
+        out << "file descriptor " << *err.Fd << ", got the following error: ";
     }
     const auto errorCode = std::make_error_code(err.Value);
     out << strerrorname_np(errorCode.value())
@@ -35,7 +87,7 @@ inline auto operator<<(OStream&& out, const SystemError& err) -> OStream&& {
 using GenericError = ErrorWithContext<std::string>;
 template <class OStream>
 inline auto operator<<(OStream&& out, const GenericError& err) -> OStream&& {
-    if (err.ContextMessage) {
+    if (!err.ContextMessage.Empty()) {
         out << err.ContextMessage << ", got the following error: ";
     }
     out << err.Value;
@@ -0,0 +1,385 @@
+#include "event_loop.hpp"
+
+#include "../overloaded.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#include <utility>
+
+
+namespace {
+    // Events handled per `epoll_wait()`
+    constexpr auto kMaxEvents = 64;
+
+    // Whether `fd` has any of `events` right now, hang-ups included
+    auto IsReady(const int fd, const short events) noexcept -> bool {
+        auto pollFd = pollfd{
+            .fd = fd,
+            .events = events,
+            .revents = 0,
+        };
+        return poll(&pollFd, 1, 0) == 1;
+    }
+
+    auto CalcElapsedTime(const EventLoop::Clock::time_point start) noexcept -> std::chrono::nanoseconds {
+        return EventLoop::Clock::now() - start;
+    }
+}
+
+EventLoop::EventLoop(EpollWaiter waiter) noexcept
+    : Waiter_(std::move(waiter))
+    , Wheel_(Clock::now())
+{
+}
+
+auto EventLoop::CreateNew() noexcept -> std::variant<EventLoop, SystemError> {
+    auto waiterOrErr = EpollWaiter::CreateNew();
+    if (auto* err = std::get_if<SystemError>(&waiterOrErr)) return std::move(*err);
+    return EventLoop{std::move(std::get<EpollWaiter>(waiterOrErr))};
+}
+
+auto EventLoop::Add(const int fd) noexcept -> std::optional<SystemError> {
+    if (auto err = Waiter_.Add(fd, EPOLLOUT)) return err;
+    if (size_t(fd) >= Fds_.size()) Fds_.resize(size_t(fd) + 1);
+    auto& state = Fds_[fd];
+    state.Registered = true;
+    // Finding out costs a syscall, which the first operation makes anyway
+    state.MaybeReadable = true;
+    state.MaybeWritable = true;
+    return std::nullopt;
+}
+
+auto EventLoop::Remove(const int fd) noexcept -> std::optional<SystemError> {
+    Cancel(fd);
+    if (auto err = Waiter_.Remove(fd)) return err;
+    if (auto* state = FindRegistered(fd)) *state = FdState{};
+    return std::nullopt;
+}
+
+auto EventLoop::AsyncRead(
+    const int fd,
+    const std::span<std::byte> to,
+    const std::chrono::milliseconds timeout,
+    OnReadDone onDone
+) noexcept -> void {
+    StartOp(fd, /* isOut */ false, PendingOp{
+        .Callback = std::move(onDone),
+        .To = to,
+        .Start = Clock::now(),
+        .Timeout = timeout,
+    });
+}
+
+auto EventLoop::AsyncWrite(
+    const int fd,
+    const std::span<const std::byte> from,
+    const std::chrono::milliseconds timeout,
+    OnWriteDone onDone
+) noexcept -> void {
+    StartOp(fd, /* isOut */ true, PendingOp{
+        .Callback = std::move(onDone),
+        .From = from,
+        .Start = Clock::now(),
+        .Timeout = timeout,
+    });
+}
+
+auto EventLoop::WaitReadable(const int fd, const std::chrono::milliseconds timeout, OnWaitDone onDone) noexcept -> void {
+    StartOp(fd, /* isOut */ false, PendingOp{
+        .Callback = std::move(onDone),
+        .Start = Clock::now(),
+        .Timeout = timeout,
+    });
+}
+
+auto EventLoop::WaitWritable(const int fd, const std::chrono::milliseconds timeout, OnWaitDone onDone) noexcept -> void {
+    StartOp(fd, /* isOut */ true, PendingOp{
+        .Callback = std::move(onDone),
+        .Start = Clock::now(),
+        .Timeout = timeout,
+    });
+}
+
+auto EventLoop::Cancel(const int fd) noexcept -> void {
+    auto* state = FindRegistered(fd);
+    if (!state) return;
+    for (const auto isOut : {false, true}) {
+        auto& op = isOut ? state->Out : state->In;
+        if (!std::holds_alternative<std::monostate>(op.Callback)) {
+            Post(MakeEndTask(TakeOp(fd, isOut), EEnd::Cancellation));
+        }
+    }
+}
+
+auto EventLoop::ScheduleAfter(const Clock::duration delay, Task task) -> TimerId {
+    const auto id = Wheel_.Schedule(Clock::now() + delay, kTaskTimerBit);
+    if (id.Index >= TimerTasks_.size()) TimerTasks_.resize(size_t(id.Index) + 1);
+    TimerTasks_[id.Index] = std::move(task);
+    return id;
+}
+
+auto EventLoop::CancelTimer(const TimerId id) noexcept -> bool {
+    if (!Wheel_.Cancel(id)) return false;
+    TimerTasks_[id.Index] = nullptr;
+    return true;
+}
+
+auto EventLoop::Post(Task task) -> void {
+    Posted_.push_back(std::move(task));
+}
+
+auto EventLoop::RunOnce(const std::chrono::milliseconds maxWait) noexcept -> std::optional<SystemError> {
+    RunPosted();
+    auto timeout = std::chrono::milliseconds{0};
+    // Nothing could end a wait without work, but new input of an fd
+    if (Posted_.empty() && !Stopped_ && HasWork()) {
+        const auto timerTimeout = Wheel_.CalcWaitTimeout(Clock::now());
+        timeout = maxWait.count() < 0 ? timerTimeout.value_or(maxWait)
+                                      : std::min(timerTimeout.value_or(maxWait), maxWait);
+    }
+    auto events = std::array<epoll_event, kMaxEvents>{};
+    const auto numEventsOrErr = Waiter_.Wait(events, timeout);
+    if (auto* err = std::get_if<SystemError>(&numEventsOrErr)) return *err;
+    const auto now = CoarseClock::Refresh();
+    for (auto i = size_t{0}; i != std::get<size_t>(numEventsOrErr); ++i) {
+        const auto fd = events[i].data.fd;
+        const auto happened = events[i].events;
+        // Errors and hang-ups end the operations of both
+        // directions, through the syscalls they make next
+        constexpr auto kAny = EPOLLERR | EPOLLHUP;
+        if (auto* state = FindRegistered(fd); state && (happened & (EPOLLIN | EPOLLRDHUP | kAny))) {
+            state->MaybeReadable = true;
+            Progress(fd, /* isOut */ false);
+        }
+        if (auto* state = FindRegistered(fd); state && (happened & (EPOLLOUT | kAny))) {
+            state->MaybeWritable = true;
+            Progress(fd, /* isOut */ true);
+        }
+    }
+    Wheel_.Advance(now, [this](const TimerId id, const uint64_t userData) {
+        OnTimer(id, userData);
+    });
+    if (!Stopped_) RunPosted();
+    return std::nullopt;
+}
+
+auto EventLoop::Run() noexcept -> std::optional<SystemError> {
+    while (!Stopped_ && HasWork()) {
+        if (auto err = RunOnce()) return err;
+    }
+    Stopped_ = false;
+    return std::nullopt;
+}
+
+auto EventLoop::HasWork() const noexcept -> bool {
+    return NumPendingOps_ != 0 || Wheel_.GetNumTimers() != 0 || !Posted_.empty();
+}
+
+auto EventLoop::FindRegistered(const int fd) noexcept -> FdState* {
+    if (fd < 0 || size_t(fd) >= Fds_.size() || !Fds_[fd].Registered) return nullptr;
+    return &Fds_[fd];
+}
+
+auto EventLoop::StartOp(const int fd, const bool isOut, PendingOp op) noexcept -> void {
+    auto* state = FindRegistered(fd);
+    const auto isBusy = state && !std::holds_alternative<std::monostate>((isOut ? state->Out : state->In).Callback);
+    if (!state || isBusy) {
+        auto err = state
+            ? SystemError{
+                .Value = std::errc::device_or_resource_busy,
+                .ContextMessage = "an operation in the same direction is pending (" SOURCE_LOCATION ")",
+                .Fd = fd,
+            }
+            : SystemError{
+                .Value = std::errc::bad_file_descriptor,
+                .ContextMessage = "the file descriptor was not added to the loop (" SOURCE_LOCATION ")",
+                .Fd = fd,
+            };
+        Post([callback = std::move(op.Callback), err = std::move(err)]() mutable {
+            std::visit(overloaded{
+                [](std::monostate) {},
+                [&err](OnReadDone& onDone) { onDone(NRobustSyncRead::OnSystemError{.Err = std::move(err)}); },
+                [&err](OnWriteDone& onDone) { onDone(NRobustSyncWrite::OnSystemError{.Err = std::move(err)}); },
+                [&err](OnWaitDone& onDone) { onDone(NAsyncWait::OnSystemError{.Err = std::move(err)}); },
+            }, callback);
+        });
+        return;
+    }
+    ++NumPendingOps_;
+    const auto timeout = op.Timeout;
+    (isOut ? state->Out : state->In) = std::move(op);
+    if (timeout.count() >= 0) {
+        (isOut ? state->Out : state->In).Timer =
+            Wheel_.Schedule(Clock::now() + timeout, uint64_t(fd) << 1 | isOut);
+    }
+    // A wait is for new readiness only when the fd isn't ready already,
+    // which the hint can't tell after the caller's own syscalls
+    auto& hint = isOut ? state->MaybeWritable : state->MaybeReadable;
+    if (std::holds_alternative<OnWaitDone>((isOut ? state->Out : state->In).Callback)) {
+        hint = hint && IsReady(fd, isOut ? POLLOUT : POLLIN);
+    }
+    // `Progress()` calls the callback when it completes the operation,
+    // so it runs from a posted task instead of the call that starts it
+    if (hint) {
+        Post([this, fd, isOut]() {
+            if (FindRegistered(fd)) Progress(fd, isOut);
+        });
+    }
+}
+
+auto EventLoop::Progress(const int fd, const bool isOut) noexcept -> void {
+    auto& state = Fds_[fd];
+    auto& op = isOut ? state.Out : state.In;
+    std::visit(overloaded{
+        [](std::monostate) {},
+        [this, fd](const OnReadDone&) { ProgressRead(fd); },
+        [this, fd](const OnWriteDone&) { ProgressWrite(fd); },
+        [this, fd, isOut](const OnWaitDone&) {
+            auto onDone = std::get<OnWaitDone>(TakeOp(fd, isOut).Callback);
+            onDone(NAsyncWait::OnReady{});
+        },
+    }, op.Callback);
+}
+
+auto EventLoop::ProgressRead(const int fd) noexcept -> void {
+    using namespace NRobustSyncRead;
+    auto& state = Fds_[fd];
+    auto& op = state.In;
+    while (op.NumBytesDone != op.To.size()) {
+        const auto x = read(fd, &op.To[op.NumBytesDone], op.To.size() - op.NumBytesDone);
+        if (x > 0) {
+            op.NumBytesDone += size_t(x);
+        } else if (x == 0) {
+            auto done = TakeOp(fd, /* isOut */ false);
+            std::get<OnReadDone>(done.Callback)(OnPrematureEof{
+                .NumBytesRead = done.NumBytesDone,
+                .WallTimeElapsed = CalcElapsedTime(done.Start),
+            });
+            return;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            state.MaybeReadable = false;
+            return;
+        } else if (errno != EINTR) {
+            auto err = SystemError{
+                .Value = std::errc{errno},
+                .ContextMessage = "read() syscall failed (" SOURCE_LOCATION ")",
+                .Fd = fd,
+            };
+            auto done = TakeOp(fd, /* isOut */ false);
+            std::get<OnReadDone>(done.Callback)(OnSystemError{
+                .NumBytesRead = done.NumBytesDone,
+                .WallTimeElapsed = CalcElapsedTime(done.Start),
+                .Err = std::move(err),
+            });
+            return;
+        }
+    }
+    auto done = TakeOp(fd, /* isOut */ false);
+    std::get<OnReadDone>(done.Callback)(OnSuccess{
+        .NumBytesRead = done.NumBytesDone,
+        .WallTimeElapsed = CalcElapsedTime(done.Start),
+    });
+}
+
+auto EventLoop::ProgressWrite(const int fd) noexcept -> void {
+    using namespace NRobustSyncWrite;
+    auto& state = Fds_[fd];
+    auto& op = state.Out;
+    while (op.NumBytesDone != op.From.size()) {
+        const auto x = write(fd, &op.From[op.NumBytesDone], op.From.size() - op.NumBytesDone);
+        if (x >= 0) {
+            op.NumBytesDone += size_t(x);
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            state.MaybeWritable = false;
+            return;
+        } else if (errno != EINTR) {
+            auto err = SystemError{
+                .Value = std::errc{errno},
+                .ContextMessage = "write() syscall failed (" SOURCE_LOCATION ")",
+                .Fd = fd,
+            };
+            auto done = TakeOp(fd, /* isOut */ true);
+            std::get<OnWriteDone>(done.Callback)(OnSystemError{
+                .NumBytesWritten = done.NumBytesDone,
+                .Err = std::move(err),
+            });
+            return;
+        }
+    }
+    auto done = TakeOp(fd, /* isOut */ true);
+    std::get<OnWriteDone>(done.Callback)(OnSuccess{});
+}
+
+auto EventLoop::TakeOp(const int fd, const bool isOut) noexcept -> PendingOp {
+    auto& state = Fds_[fd];
+    auto op = std::exchange(isOut ? state.Out : state.In, PendingOp{});
+    if (op.Timer) Wheel_.Cancel(*op.Timer);
+    --NumPendingOps_;
+    return op;
+}
+
+auto EventLoop::MakeEndTask(PendingOp op, const EEnd end) noexcept -> Task {
+    return [op = std::move(op), end]() mutable {
+        const auto elapsed = CalcElapsedTime(op.Start);
+        std::visit(overloaded{
+            [](std::monostate) {},
+            [&](OnReadDone& onDone) {
+                if (end == EEnd::Cancellation) {
+                    onDone(NRobustSyncRead::OnCancellation{.NumBytesRead = op.NumBytesDone, .WallTimeElapsed = elapsed});
+                } else {
+                    onDone(NRobustSyncRead::OnTimeout{.NumBytesRead = op.NumBytesDone, .WallTimeElapsed = elapsed});
+                }
+            },
+            [&](OnWriteDone& onDone) {
+                if (end == EEnd::Cancellation) {
+                    onDone(NRobustSyncWrite::OnCancellation{.NumBytesWritten = op.NumBytesDone});
+                } else {
+                    onDone(NRobustSyncWrite::OnTimeout{.NumBytesWritten = op.NumBytesDone, .Timeout = op.Timeout});
+                }
+            },
+            [&](OnWaitDone& onDone) {
+                if (end == EEnd::Cancellation) {
+                    onDone(NAsyncWait::OnCancellation{});
+                } else {
+                    onDone(NAsyncWait::OnTimeout{});
+                }
+            },
+        }, op.Callback);
+    };
+}
+
+auto EventLoop::OnTimer(const TimerId id, const uint64_t userData) noexcept -> void {
+    if (userData & kTaskTimerBit) {
+        auto task = std::exchange(TimerTasks_[id.Index], nullptr);
+        if (task) task();
+        return;
+    }
+    const auto fd = int(userData >> 1);
+    const auto isOut = bool(userData & 1);
+    auto& op = isOut ? Fds_[fd].Out : Fds_[fd].In;
+    // The wheel already released the timer
+    op.Timer = std::nullopt;
+    MakeEndTask(TakeOp(fd, isOut), EEnd::Timeout)();
+}
+
+auto EventLoop::RunPosted() noexcept -> void {
+    // Tasks posted by these ones run at the next call
+    auto posted = std::exchange(Posted_, {});
+    for (auto i = size_t{0}; i != posted.size(); ++i) {
+        posted[i]();
+        if (Stopped_) {
+            // The rest runs if the loop is run again
+            const auto rest = posted.begin() + std::ptrdiff_t(i) + 1;
+            Posted_.insert(Posted_.begin(), std::make_move_iterator(rest), std::make_move_iterator(posted.end()));
+            return;
+        }
+    }
+    // Keeps the capacity, unless the tasks posted more tasks
+    if (Posted_.empty()) {
+        posted.clear();
+        Posted_ = std::move(posted);
+    }
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+
+#include "../epoll_waiter/epoll_waiter.hpp"
+#include "../robust_read_write/robust_read_write.hpp"
+#include "../timing_wheel/timing_wheel.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <variant>
+#include <vector>
+
+
+namespace NAsyncWait {
+    // Indicates that the file descriptor became ready, or hung up
+    struct OnReady {};
+    // Indicates that the wait was cancelled with `EventLoop::Cancel()`
+    struct OnCancellation {};
+    // Indicates that the timeout was reached first
+    struct OnTimeout {};
+    // Indicates that the wait could not start, e.g. on an fd not added to the loop
+    struct OnSystemError {
+        SystemError Err;
+    };
+    using Result = std::variant<OnReady, OnCancellation, OnTimeout, OnSystemError>;
+}
+using AsyncWaitResult = NAsyncWait::Result;
+
+/* A single-threaded event loop: the non-blocking counterparts of
+ * `RobustSyncRead()` and `RobustSyncWrite()`, waits for readiness, timers
+ * and posted tasks, all serviced by one thread that never blocks
+ * anywhere but in `epoll_wait()`.
+ *
+ * File descriptors are added once and watched edge-triggered for both
+ * directions, through an `EpollWaiter`; the timeouts of the operations
+ * and the timers share one `TimingWheel`, which also gives the timeout
+ * of each wait. Each fd has at most one pending operation per direction,
+ * e.g. a read and a write of the same socket at once.
+ *
+ * Every operation ends with exactly one call of its callback, with the
+ * same results as the synchronous functions, from `RunOnce()`: never
+ * from inside the call that started it, so a callback may start the next
+ * operation or cancel others without reentrancy. Operations that fail
+ * to start report it through their callback as well. Not thread-safe.
+ */
+class EventLoop {
+public:
+    using Clock = MonotonicClock;
+    using TimerId = TimingWheel::TimerId;
+    using Task = std::function<void()>;
+    using OnReadDone = std::function<void(RobustSyncReadResult)>;
+    using OnWriteDone = std::function<void(RobustSyncWriteResult)>;
+    using OnWaitDone = std::function<void(AsyncWaitResult)>;
+private:
+    // The operation pending in one direction of a file descriptor
+    struct PendingOp {
+        std::variant<std::monostate, OnReadDone, OnWriteDone, OnWaitDone> Callback;
+        std::span<std::byte> To;
+        std::span<const std::byte> From;
+        size_t NumBytesDone = 0;
+        Clock::time_point Start;
+        std::chrono::milliseconds Timeout{0};
+        std::optional<TimerId> Timer;
+    };
+    struct FdState {
+        bool Registered = false;
+        // Hints, as in `EpollWaiter`: false only once a syscall said so
+        bool MaybeReadable = false;
+        bool MaybeWritable = false;
+        PendingOp In;
+        PendingOp Out;
+    };
+    // In the user data of the wheel's timers, the others being
+    // `fd << 1 | isOut` for the timeouts of operations
+    static constexpr auto kTaskTimerBit = uint64_t{1} << 63;
+
+    EpollWaiter Waiter_;
+    TimingWheel Wheel_;
+    // Indexed by file descriptor
+    std::vector<FdState> Fds_;
+    // Indexed by `TimerId::Index`, which the wheel keeps unique among pending timers
+    std::vector<Task> TimerTasks_;
+    std::vector<Task> Posted_;
+    size_t NumPendingOps_ = 0;
+    bool Stopped_ = false;
+private:
+    explicit EventLoop(EpollWaiter waiter) noexcept;
+public:
+    EventLoop(const EventLoop& other) = delete;
+    // Only while no callback refers to the loop
+    EventLoop(EventLoop&& other) noexcept = default;
+
+    [[nodiscard]] static auto CreateNew() noexcept -> std::variant<EventLoop, SystemError>;
+
+    // `nonBlockingFd` is not owned. Pending operations are cancelled by `Remove()`
+    [[nodiscard]] auto Add(int nonBlockingFd) noexcept -> std::optional<SystemError>;
+    [[nodiscard]] auto Remove(int fd) noexcept -> std::optional<SystemError>;
+
+    /* Reads `to.size()` bytes from `fd`, or fails, as `RobustSyncRead()`
+     * does. A negative timeout waits forever. `to` has to stay valid
+     * until `onDone` is called.
+     */
+    auto AsyncRead(int fd, std::span<std::byte> to, std::chrono::milliseconds timeout, OnReadDone onDone) noexcept -> void;
+    // Writes all of `from` to `fd`, as `RobustSyncWrite()` does
+    auto AsyncWrite(int fd, std::span<const std::byte> from, std::chrono::milliseconds timeout, OnWriteDone onDone) noexcept -> void;
+
+    /* Waits for `fd` to be readable (writable) without reading (writing),
+     * e.g. for a listening socket or a connecting one. After `OnReady`,
+     * the readiness is only reported again for new input (room), so a
+     * caller that stops before `EAGAIN` should wait again instead of
+     * assuming more will come: the wait checks the fd first.
+     */
+    auto WaitReadable(int fd, std::chrono::milliseconds timeout, OnWaitDone onDone) noexcept -> void;
+    auto WaitWritable(int fd, std::chrono::milliseconds timeout, OnWaitDone onDone) noexcept -> void;
+
+    // Ends the pending operations of `fd` with `OnCancellation`
+    auto Cancel(int fd) noexcept -> void;
+
+    auto ScheduleAfter(Clock::duration delay, Task task) -> TimerId;
+    // False if the timer already fired or was cancelled
+    auto CancelTimer(TimerId id) noexcept -> bool;
+    // Runs `task` at the next `RunOnce()`
+    auto Post(Task task) -> void;
+
+    /* Waits for events for up to `maxWait`, or less if a timer is due,
+     * and runs the callbacks of everything that completed. A negative
+     * `maxWait` waits until something happens.
+     */
+    [[nodiscard]] auto RunOnce(std::chrono::milliseconds maxWait = std::chrono::milliseconds{-1}) noexcept
+      -> std::optional<SystemError>;
+    // Runs until `Stop()` is called, or until there is nothing left to wait for
+    [[nodiscard]] auto Run() noexcept -> std::optional<SystemError>;
+    // `Run()` returns once the current callback does
+    auto Stop() noexcept -> void { Stopped_ = true; }
+
+    // Whether an operation, a timer or a posted task is pending
+    [[nodiscard]] auto HasWork() const noexcept -> bool;
+private:
+    [[nodiscard]] auto FindRegistered(int fd) noexcept -> FdState*;
+    auto StartOp(int fd, bool isOut, PendingOp op) noexcept -> void;
+    // Completes whatever `fd` can complete in the direction
+    auto Progress(int fd, bool isOut) noexcept -> void;
+    auto ProgressRead(int fd) noexcept -> void;
+    auto ProgressWrite(int fd) noexcept -> void;
+    // Takes the operation out of `fd`'s state, before its callback is called
+    auto TakeOp(int fd, bool isOut) noexcept -> PendingOp;
+    // What a pending operation gets when it ends without completing
+    enum class EEnd : uint8_t { Cancellation, Timeout };
+    [[nodiscard]] static auto MakeEndTask(PendingOp op, EEnd end) noexcept -> Task;
+    auto OnTimer(TimerId id, uint64_t userData) noexcept -> void;
+    auto RunPosted() noexcept -> void;
+};
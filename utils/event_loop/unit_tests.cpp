@@ -0,0 +1,230 @@
+#include "event_loop.hpp"
+
+#include <array>
+#include <cassert>
+#include <fcntl.h>
+#include <iostream>
+#include <string_view>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+
+namespace {
+using namespace std::chrono;
+
+// A RAII wrapper over a non-blocking pipe
+struct Pipe {
+    int ReadFd = -1;
+    int WriteFd = -1;
+
+    Pipe() {
+        int fds[2];
+        assert(pipe2(fds, O_NONBLOCK | O_CLOEXEC) == 0);
+        ReadFd = fds[0];
+        WriteFd = fds[1];
+    }
+    ~Pipe() {
+        close(ReadFd);
+        if (WriteFd != -1) close(WriteFd);
+    }
+
+    auto Write(std::string_view s) const -> void {
+        assert(write(WriteFd, s.data(), s.size()) == ssize_t(s.size()));
+    }
+};
+
+auto CreateLoop() -> EventLoop {
+    auto loopOrError = EventLoop::CreateNew();
+    assert(std::holds_alternative<EventLoop>(loopOrError));
+    return std::move(std::get<EventLoop>(loopOrError));
+}
+} // anonymous namespace
+
+
+namespace NTests {
+// A write larger than the pipe and the read of it progress together
+auto TestReadWrite() -> void {
+    auto loop = CreateLoop();
+    const auto pipe = Pipe{};
+    assert(!loop.Add(pipe.ReadFd) && !loop.Add(pipe.WriteFd));
+    auto from = std::vector<std::byte>(1 << 20);
+    for (auto i = size_t{0}; i != from.size(); ++i) from[i] = std::byte(i * 7);
+    auto to = std::vector<std::byte>(from.size());
+    auto written = false;
+    auto read = false;
+    loop.AsyncWrite(pipe.WriteFd, from, milliseconds{5000}, [&](RobustSyncWriteResult result) {
+        assert(std::holds_alternative<NRobustSyncWrite::OnSuccess>(result));
+        written = true;
+    });
+    loop.AsyncRead(pipe.ReadFd, to, milliseconds{5000}, [&](RobustSyncReadResult result) {
+        assert(std::get<NRobustSyncRead::OnSuccess>(result).NumBytesRead == to.size());
+        read = true;
+    });
+    // Never called from the call that starts the operation
+    assert(!written && !read);
+    assert(!loop.Run());
+    assert(written && read && to == from && !loop.HasWork());
+    std::cerr << "TestReadWrite OK\n";
+}
+
+auto TestEofTimeoutAndCancellation() -> void {
+    auto loop = CreateLoop();
+    auto pipe = Pipe{};
+    const auto other = Pipe{};
+    assert(!loop.Add(pipe.ReadFd) && !loop.Add(other.ReadFd));
+    auto buf = std::array<std::byte, 8>{};
+    auto otherBuf = std::array<std::byte, 8>{};
+    auto results = std::vector<RobustSyncReadResult>{};
+    auto onDone = [&](RobustSyncReadResult result) { results.push_back(result); };
+
+    loop.AsyncRead(other.ReadFd, otherBuf, milliseconds{20}, onDone);
+    const auto start = steady_clock::now();
+    assert(!loop.Run());
+    assert(results.size() == 1 && std::holds_alternative<NRobustSyncRead::OnTimeout>(results[0]));
+    assert(steady_clock::now() - start >= milliseconds{20});
+
+    loop.AsyncRead(other.ReadFd, otherBuf, milliseconds{-1}, onDone);
+    loop.Cancel(other.ReadFd);
+    pipe.Write("e2e4");
+    close(std::exchange(pipe.WriteFd, -1));
+    loop.AsyncRead(pipe.ReadFd, buf, milliseconds{5000}, onDone);
+    assert(!loop.Run());
+    assert(results.size() == 3);
+    assert(std::holds_alternative<NRobustSyncRead::OnCancellation>(results[1]));
+    assert(std::get<NRobustSyncRead::OnPrematureEof>(results[2]).NumBytesRead == 4);
+    std::cerr << "TestEofTimeoutAndCancellation OK\n";
+}
+
+// Operations that can't start report it through their callbacks
+auto TestStartErrors() -> void {
+    auto loop = CreateLoop();
+    const auto pipe = Pipe{};
+    auto buf = std::array<std::byte, 8>{};
+    auto errors = std::vector<std::errc>{};
+    auto onDone = [&](RobustSyncReadResult result) {
+        errors.push_back(std::get<NRobustSyncRead::OnSystemError>(result).Err.Value);
+    };
+    loop.AsyncRead(pipe.ReadFd, buf, milliseconds{100}, onDone);
+    assert(!loop.Add(pipe.ReadFd));
+    auto cancelled = false;
+    loop.AsyncRead(pipe.ReadFd, buf, milliseconds{-1}, [&](RobustSyncReadResult result) {
+        cancelled = std::holds_alternative<NRobustSyncRead::OnCancellation>(result);
+    });
+    loop.AsyncRead(pipe.ReadFd, buf, milliseconds{100}, onDone);
+    assert(!loop.RunOnce(milliseconds{0}));
+    assert((errors == std::vector{std::errc::bad_file_descriptor, std::errc::device_or_resource_busy}));
+    // Removing an fd with an operation cancels it
+    assert(!loop.Remove(pipe.ReadFd));
+    assert(!loop.Run() && cancelled);
+    std::cerr << "TestStartErrors OK\n";
+}
+
+// A wait reports input that is already there, even after the
+// loop saw its edge, and then only new input
+auto TestWaitReadable() -> void {
+    auto loop = CreateLoop();
+    const auto pipe = Pipe{};
+    assert(!loop.Add(pipe.ReadFd));
+    auto results = std::vector<size_t>{};
+    auto onDone = [&](AsyncWaitResult result) { results.push_back(result.index()); };
+    pipe.Write("abcd");
+    loop.WaitReadable(pipe.ReadFd, milliseconds{1000}, onDone);
+    assert(!loop.Run());
+    auto buf = std::array<char, 2>{};
+    assert(read(pipe.ReadFd, buf.data(), buf.size()) == 2);
+    // Half of the input is left, and no new edge comes for it
+    loop.WaitReadable(pipe.ReadFd, milliseconds{1000}, onDone);
+    assert(!loop.Run());
+    assert(read(pipe.ReadFd, buf.data(), buf.size()) == 2);
+    loop.WaitReadable(pipe.ReadFd, milliseconds{20}, onDone);
+    assert(!loop.Run());
+    constexpr auto kReady = AsyncWaitResult{NAsyncWait::OnReady{}}.index();
+    constexpr auto kTimeout = AsyncWaitResult{NAsyncWait::OnTimeout{}}.index();
+    assert((results == std::vector{kReady, kReady, kTimeout}));
+    std::cerr << "TestWaitReadable OK\n";
+}
+
+auto TestTimersAndPost() -> void {
+    auto loop = CreateLoop();
+    auto order = std::string{};
+    loop.ScheduleAfter(milliseconds{30}, [&]() { order += 'c'; });
+    const auto cancelled = loop.ScheduleAfter(milliseconds{10}, [&]() { order += 'x'; });
+    loop.ScheduleAfter(milliseconds{10}, [&]() {
+        order += 'b';
+        loop.Post([&]() { order += 'B'; });
+    });
+    loop.Post([&]() { order += 'a'; });
+    assert(loop.CancelTimer(cancelled) && !loop.CancelTimer(cancelled));
+    assert(!loop.Run());
+    assert(order == "abBc");
+
+    // `Stop()` leaves the rest for the next run
+    loop.Post([&]() { loop.Stop(); });
+    loop.Post([&]() { order += 'd'; });
+    assert(!loop.Run() && order == "abBc");
+    assert(!loop.Run() && order == "abBcd");
+    std::cerr << "TestTimersAndPost OK\n";
+}
+
+// Many connections serviced at once by one thread: each end
+// echoes what it reads, for a number of rounds
+auto TestManyConnections() -> void {
+    constexpr auto kNumConnections = 200;
+    constexpr auto kNumRounds = 50;
+    auto loop = CreateLoop();
+    struct Connection {
+        int Fds[2];
+        std::array<std::byte, 16> Bufs[2];
+        int NumRounds = 0;
+    };
+    auto connections = std::vector<Connection>(kNumConnections);
+    auto numDone = 0;
+    std::function<void(Connection&, int)> echo = [&](Connection& conn, const int side) {
+        const auto fd = conn.Fds[side];
+        loop.AsyncRead(fd, conn.Bufs[side], milliseconds{5000}, [&, side, fd](RobustSyncReadResult result) {
+            if (std::holds_alternative<NRobustSyncRead::OnCancellation>(result)) return;
+            assert(std::holds_alternative<NRobustSyncRead::OnSuccess>(result));
+            if (side == 0 && ++conn.NumRounds == kNumRounds) {
+                if (++numDone == kNumConnections) loop.Stop();
+                return;
+            }
+            loop.AsyncWrite(fd, conn.Bufs[side], milliseconds{5000}, [&, side](RobustSyncWriteResult result) {
+                assert(std::holds_alternative<NRobustSyncWrite::OnSuccess>(result));
+                echo(conn, side);
+            });
+        });
+    };
+    for (auto& conn : connections) {
+        assert(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, conn.Fds) == 0);
+        assert(!loop.Add(conn.Fds[0]) && !loop.Add(conn.Fds[1]));
+        echo(conn, 0);
+        echo(conn, 1);
+        assert(write(conn.Fds[0], conn.Bufs[0].data(), conn.Bufs[0].size()) == ssize_t(conn.Bufs[0].size()));
+    }
+    assert(!loop.Run());
+    assert(numDone == kNumConnections);
+    for (auto& conn : connections) {
+        assert(conn.NumRounds == kNumRounds);
+        // The echoing side still waits for the next round
+        assert(!loop.Remove(conn.Fds[1]));
+        close(conn.Fds[0]);
+        close(conn.Fds[1]);
+    }
+    assert(!loop.Run() && !loop.HasWork());
+    std::cerr << "TestManyConnections OK\n";
+}
+} // namespace NTests
+
+
+auto main() -> int {
+    using namespace NTests;
+    TestReadWrite();
+    TestEofTimeoutAndCancellation();
+    TestStartErrors();
+    TestWaitReadable();
+    TestTimersAndPost();
+    TestManyConnections();
+    std::cerr << "All tests passed.\n";
+}
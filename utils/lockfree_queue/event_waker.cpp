@@ -0,0 +1,82 @@
+#include "event_waker.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <utility>
+
+
+EventWaker::EventWaker(int fd) noexcept
+    : Fd_(fd)
+{
+}
+
+EventWaker::EventWaker(EventWaker&& other) noexcept
+    : Fd_(std::exchange(other.Fd_, -1))
+    , Sleeping_(other.Sleeping_.load(std::memory_order_relaxed))
+{
+}
+
+EventWaker::~EventWaker() noexcept {
+    if (Fd_ != -1) close(Fd_);
+}
+
+auto EventWaker::CreateNew() noexcept -> std::variant<EventWaker, SystemError> {
+    const auto fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd == -1) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "eventfd() syscall failed (" SOURCE_LOCATION ")",
+        };
+    }
+    return EventWaker{fd};
+}
+
+auto EventWaker::Wake() noexcept -> std::optional<SystemError> {
+    // Orders the caller's push before reading the flag
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!Sleeping_.load(std::memory_order_relaxed) || !Sleeping_.exchange(false, std::memory_order_acq_rel)) {
+        return std::nullopt;
+    }
+    const auto one = uint64_t{1};
+    // EAGAIN means the counter is about to overflow,
+    // so the consumer is woken anyway
+    if (write(Fd_, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "write() syscall failed for an eventfd (" SOURCE_LOCATION ")",
+        };
+    }
+    return std::nullopt;
+}
+
+auto EventWaker::PrepareToSleep() noexcept -> void {
+    Sleeping_.store(true, std::memory_order_relaxed);
+    // Orders setting the flag before the caller checks its queues
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+auto EventWaker::Consume() noexcept -> std::optional<SystemError> {
+    Sleeping_.store(false, std::memory_order_relaxed);
+    auto value = uint64_t{0};
+    if (read(Fd_, &value, sizeof(value)) == -1 && errno != EAGAIN) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "read() syscall failed for an eventfd (" SOURCE_LOCATION ")",
+        };
+    }
+    return std::nullopt;
+}
+
+auto EventWaker::WaitReadable(const std::chrono::milliseconds timeout) const noexcept -> std::optional<SystemError> {
+    auto pfd = pollfd{.fd = Fd_, .events = POLLIN, .revents = 0};
+    if (poll(&pfd, 1, int(timeout.count())) == -1 && errno != EINTR) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "poll() syscall failed for an eventfd (" SOURCE_LOCATION ")",
+        };
+    }
+    return std::nullopt;
+}
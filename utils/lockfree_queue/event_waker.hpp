@@ -0,0 +1,67 @@
+#pragma once
+
+
+#include "../error.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <variant>
+
+
+/* Wakes a consumer sleeping on an eventfd, e.g. a reactor thread in
+ * `epoll_wait()` that also owns some queues.
+ *
+ * Producers only make a syscall when the consumer announced that it is
+ * about to sleep, so a busy consumer costs them an atomic exchange. The
+ * consumer's side is:
+ *
+ *     waker.PrepareToSleep();
+ *     if (queue.IsEmpty()) {
+ *         // poll()/epoll_wait() on waker.GetFd() and other fds
+ *     }
+ *     waker.Consume();
+ *
+ * and a producer calls `Wake()` after each push. Either the consumer
+ * sees the item, or the producer sees the consumer sleeping.
+ */
+class EventWaker {
+private:
+    int Fd_;
+    std::atomic<bool> Sleeping_ = false;
+private:
+    explicit EventWaker(int fd) noexcept;
+public:
+    EventWaker(const EventWaker& other) = delete;
+    // Only before the waker is shared between threads
+    EventWaker(EventWaker&& other) noexcept;
+    ~EventWaker() noexcept;
+
+    [[nodiscard]] static auto CreateNew() noexcept -> std::variant<EventWaker, SystemError>;
+
+    // Non-blocking, readable when woken
+    [[nodiscard]] auto GetFd() const noexcept -> int { return Fd_; }
+
+    // Any thread
+    [[nodiscard]] auto Wake() noexcept -> std::optional<SystemError>;
+
+    // Consumer only
+    auto PrepareToSleep() noexcept -> void;
+    // Consumer only: clears the fd and the sleeping flag
+    [[nodiscard]] auto Consume() noexcept -> std::optional<SystemError>;
+    /* Consumer only: the whole sequence above for a consumer with no
+     * other fds to wait on. Returns right away if `isEmpty()` is false
+     * after the flag is set.
+     */
+    template <class IsEmpty>
+    [[nodiscard]] auto Sleep(IsEmpty&& isEmpty, std::chrono::milliseconds timeout) noexcept
+      -> std::optional<SystemError> {
+        PrepareToSleep();
+        if (isEmpty()) {
+            if (auto err = WaitReadable(timeout)) return err;
+        }
+        return Consume();
+    }
+private:
+    [[nodiscard]] auto WaitReadable(std::chrono::milliseconds timeout) const noexcept -> std::optional<SystemError>;
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+
+/* A bounded multi-producer single-consumer ring queue, after Dmitry
+ * Vyukov's bounded MPMC queue.
+ *
+ * Each slot carries a sequence number telling whose turn it is: a
+ * producer claims a position by advancing the tail with a CAS, writes
+ * the slot and publishes it by bumping the sequence; the consumer waits
+ * for that sequence, reads the slot and hands it to the next lap. A
+ * producer that has claimed a slot but not yet published it holds back
+ * the items behind it, so the order is the order of the claims.
+ *
+ * A single push checks the sequence of its slot only; a batch push
+ * claims a whole range at once from the consumer's head, which the
+ * consumer only advances after freeing the slots before it.
+ */
+template <class T>
+class MpscQueue {
+    static_assert(std::is_nothrow_move_assignable_v<T> && std::is_default_constructible_v<T>);
+private:
+    static constexpr auto kCacheLine = 64;
+
+    struct Slot {
+        std::atomic<size_t> Sequence;
+        T Item;
+    };
+
+    const size_t Mask_;
+    std::unique_ptr<Slot[]> Slots_;
+    alignas(kCacheLine) std::atomic<size_t> Head_ = 0;
+    alignas(kCacheLine) std::atomic<size_t> Tail_ = 0;
+public:
+    // The capacity is rounded up to a power of two
+    explicit MpscQueue(size_t capacity)
+        : Mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1)
+        , Slots_(std::make_unique<Slot[]>(Mask_ + 1))
+    {
+        for (auto i = size_t{0}; i <= Mask_; ++i) {
+            Slots_[i].Sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    [[nodiscard]] auto GetCapacity() const noexcept -> size_t { return Mask_ + 1; }
+
+    // Any thread; false if the queue is full
+    [[nodiscard]] auto TryPush(T&& item) noexcept -> bool {
+        auto tail = Tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& slot = Slots_[tail & Mask_];
+            const auto sequence = slot.Sequence.load(std::memory_order_acquire);
+            if (sequence == tail) {
+                if (Tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                    slot.Item = std::move(item);
+                    slot.Sequence.store(tail + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (sequence < tail) {
+                // The consumer hasn't freed this slot of the previous lap
+                return false;
+            } else {
+                tail = Tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Any thread: moves out a prefix of `items`, as long
+    // as there is room, and returns its length
+    [[nodiscard]] auto TryPushBatch(std::span<T> items) noexcept -> size_t {
+        auto tail = Tail_.load(std::memory_order_relaxed);
+        auto count = size_t{0};
+        for (;;) {
+            const auto head = Head_.load(std::memory_order_acquire);
+            if (tail < head) {
+                // Read before a pop that overtook it
+                tail = Tail_.load(std::memory_order_relaxed);
+                continue;
+            }
+            count = std::min(items.size(), GetCapacity() - (tail - head));
+            if (count == 0) return 0;
+            if (Tail_.compare_exchange_weak(tail, tail + count, std::memory_order_relaxed)) break;
+        }
+        for (auto i = size_t{0}; i < count; ++i) {
+            auto& slot = Slots_[(tail + i) & Mask_];
+            slot.Item = std::move(items[i]);
+            slot.Sequence.store(tail + i + 1, std::memory_order_release);
+        }
+        return count;
+    }
+
+    // Consumer only
+    [[nodiscard]] auto TryPop() noexcept -> std::optional<T> {
+        auto item = T{};
+        if (TryPopBatch(std::span{&item, 1}) == 0) return std::nullopt;
+        return item;
+    }
+
+    // Consumer only: moves up to `out.size()` published items
+    // into a prefix of `out` and returns its length
+    [[nodiscard]] auto TryPopBatch(std::span<T> out) noexcept -> size_t {
+        const auto head = Head_.load(std::memory_order_relaxed);
+        auto count = size_t{0};
+        for (; count < out.size(); ++count) {
+            auto& slot = Slots_[(head + count) & Mask_];
+            if (slot.Sequence.load(std::memory_order_acquire) != head + count + 1) break;
+            out[count] = std::move(slot.Item);
+            slot.Sequence.store(head + count + GetCapacity(), std::memory_order_release);
+        }
+        if (count > 0) Head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // A snapshot: claimed but unpublished items count as present
+    [[nodiscard]] auto IsEmpty() const noexcept -> bool {
+        return Tail_.load(std::memory_order_acquire) == Head_.load(std::memory_order_acquire);
+    }
+};
@@ -0,0 +1,160 @@
+#include "event_waker.hpp"
+#include "mpsc_queue.hpp"
+#include "spsc_queue.hpp"
+
+#include "../cli_args.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Message {
+        int64_t SentNs = 0;
+        uint32_t Producer = 0;
+    };
+
+    auto NowNs() noexcept -> int64_t {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    struct Latencies {
+        std::vector<int64_t> Ns;
+
+        auto Percentile(double p) -> int64_t {
+            if (Ns.empty()) return 0;
+            const auto k = std::min(Ns.size() - 1, size_t(p * double(Ns.size())));
+            std::nth_element(Ns.begin(), Ns.begin() + k, Ns.end());
+            return Ns[k];
+        }
+    };
+
+    auto PrintRow(std::string_view name, int producers, uint64_t messages, Clock::duration elapsed, Latencies& latencies) {
+        const auto seconds = std::chrono::duration<double>(elapsed).count();
+        std::cout << std::setw(6) << name << std::setw(11) << producers
+                  << std::setw(14) << uint64_t(double(messages) / seconds)
+                  << std::setw(10) << latencies.Percentile(0.5)
+                  << std::setw(10) << latencies.Percentile(0.99) << "\n";
+    }
+
+    /* Producers push as fast as they can, in batches of `batch`; the
+     * consumer busy-polls in batches. The latency is then mostly the
+     * time spent queued behind a full ring.
+     */
+    template <class Queue>
+    auto RunSaturated(Queue& queue, int producers, uint64_t perProducer, size_t batch) -> void {
+        auto latencies = Latencies{};
+        latencies.Ns.reserve(producers * perProducer / 64 + 1);
+        const auto start = Clock::now();
+        {
+            auto threads = std::vector<std::jthread>{};
+            for (auto p = 0; p < producers; ++p) {
+                threads.emplace_back([&queue, p, perProducer, batch]() {
+                    auto items = std::vector<Message>(batch);
+                    for (auto sent = uint64_t{0}; sent < perProducer;) {
+                        const auto count = std::min<uint64_t>(batch, perProducer - sent);
+                        const auto now = NowNs();
+                        for (auto i = size_t{0}; i < count; ++i) items[i] = Message{now, uint32_t(p)};
+                        auto pushed = size_t{0};
+                        while (pushed < count) {
+                            const auto n = queue.TryPushBatch(std::span{items}.subspan(pushed, count - pushed));
+                            if (n == 0) std::this_thread::yield();
+                            pushed += n;
+                        }
+                        sent += count;
+                    }
+                });
+            }
+            auto out = std::vector<Message>(256);
+            for (auto received = uint64_t{0}; received < producers * perProducer;) {
+                const auto count = queue.TryPopBatch(out);
+                if (count == 0) {
+                    // Lets the producers run when the cores are oversubscribed
+                    std::this_thread::yield();
+                    continue;
+                }
+                // Sampled, so that timing doesn't dominate
+                if (received / 64 != (received + count) / 64) latencies.Ns.push_back(NowNs() - out[0].SentNs);
+                received += count;
+            }
+        }
+        PrintRow(batch == 1 ? "single" : "batch", producers, producers * perProducer, Clock::now() - start, latencies);
+    }
+
+    /* Producers send one message every `interval` to a consumer sleeping
+     * on an eventfd when idle: the wake-up latency a reactor sees.
+     */
+    auto RunPaced(int producers, int perProducer, std::chrono::microseconds interval) -> void {
+        auto queue = MpscQueue<Message>{1024};
+        auto wakerOrError = EventWaker::CreateNew();
+        if (auto* err = std::get_if<SystemError>(&wakerOrError)) LogErrorAndExit(*err);
+        auto& waker = std::get<EventWaker>(wakerOrError);
+        auto latencies = Latencies{};
+        const auto start = Clock::now();
+        {
+            auto threads = std::vector<std::jthread>{};
+            for (auto p = 0; p < producers; ++p) {
+                threads.emplace_back([&, p]() {
+                    for (auto i = 0; i < perProducer; ++i) {
+                        std::this_thread::sleep_for(interval);
+                        while (!queue.TryPush(Message{NowNs(), uint32_t(p)})) std::this_thread::yield();
+                        if (auto err = waker.Wake()) LogErrorAndExit(*err);
+                    }
+                });
+            }
+            auto out = std::vector<Message>(64);
+            for (auto received = 0; received < producers * perProducer;) {
+                const auto count = queue.TryPopBatch(out);
+                const auto now = NowNs();
+                for (auto i = size_t{0}; i < count; ++i) latencies.Ns.push_back(now - out[i].SentNs);
+                received += int(count);
+                if (count == 0) {
+                    if (auto err = waker.Sleep([&]() { return queue.IsEmpty(); }, std::chrono::milliseconds{100})) {
+                        LogErrorAndExit(*err);
+                    }
+                }
+            }
+        }
+        PrintRow("wakeup", producers, uint64_t(producers) * perProducer, Clock::now() - start, latencies);
+    }
+} // anonymous namespace
+
+
+/* Usage: queue_bench [messages per producer = 1000000] [max producers = 16]
+ *
+ * Reports messages/second and the p50/p99 latency in nanoseconds from
+ * push to pop: SPSC with one producer, then MPSC with 1, 2, 4, ...
+ * producers pushing one message at a time and in batches of 32, then
+ * the latency of waking an idle consumer through the eventfd.
+ */
+auto main(int argc, char** argv) -> int {
+    const auto perProducer = uint64_t(std::max(argc > 1 ? ParseIntArg(argv[1], 1'000'000) : 1'000'000, 1));
+    const auto maxProducers = std::clamp(argc > 2 ? ParseIntArg(argv[2], 16) : 16, 1, 64);
+
+    std::cout << "  mode  producers  messages/s   p50 ns    p99 ns\n"
+              << "SPSC\n";
+    for (const auto batch : {size_t{1}, size_t{32}}) {
+        auto spsc = SpscQueue<Message>{4096};
+        RunSaturated(spsc, 1, perProducer, batch);
+    }
+    std::cout << "MPSC\n";
+    for (auto producers = 1;; producers = std::min(producers * 2, maxProducers)) {
+        for (const auto batch : {size_t{1}, size_t{32}}) {
+            auto mpsc = MpscQueue<Message>{4096};
+            RunSaturated(mpsc, producers, perProducer / producers, batch);
+        }
+        if (producers == maxProducers) break;
+    }
+    std::cout << "MPSC, idle consumer woken by eventfd\n";
+    for (auto producers = 1;; producers = std::min(producers * 2, maxProducers)) {
+        RunPaced(producers, 2000 / producers, std::chrono::microseconds{200});
+        if (producers == maxProducers) break;
+    }
+}
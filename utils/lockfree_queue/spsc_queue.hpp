@@ -0,0 +1,93 @@
+#pragma once
+
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+
+/* A bounded single-producer single-consumer ring queue.
+ *
+ * The head and tail live on their own cache lines, and each side keeps
+ * a cached copy of the other side's index, so that in the common case
+ * a push or a pop touches no cache line written by the other thread.
+ * Batch operations publish many items with a single index store.
+ */
+template <class T>
+class SpscQueue {
+    static_assert(std::is_nothrow_move_assignable_v<T> && std::is_default_constructible_v<T>);
+private:
+    static constexpr auto kCacheLine = 64;
+
+    const size_t Mask_;
+    std::unique_ptr<T[]> Slots_;
+    // Consumer side
+    alignas(kCacheLine) std::atomic<size_t> Head_ = 0;
+    size_t CachedTail_ = 0;
+    // Producer side
+    alignas(kCacheLine) std::atomic<size_t> Tail_ = 0;
+    size_t CachedHead_ = 0;
+public:
+    // The capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity)
+        : Mask_(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1)
+        , Slots_(std::make_unique<T[]>(Mask_ + 1))
+    {
+    }
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    [[nodiscard]] auto GetCapacity() const noexcept -> size_t { return Mask_ + 1; }
+
+    // Producer only; false if the queue is full
+    [[nodiscard]] auto TryPush(T&& item) noexcept -> bool {
+        return TryPushBatch(std::span{&item, 1}) == 1;
+    }
+
+    // Producer only: moves out a prefix of `items`, as
+    // long as there is room, and returns its length
+    [[nodiscard]] auto TryPushBatch(std::span<T> items) noexcept -> size_t {
+        const auto tail = Tail_.load(std::memory_order_relaxed);
+        if (tail + items.size() - CachedHead_ > GetCapacity()) {
+            CachedHead_ = Head_.load(std::memory_order_acquire);
+        }
+        const auto count = std::min(items.size(), GetCapacity() - (tail - CachedHead_));
+        for (auto i = size_t{0}; i < count; ++i) {
+            Slots_[(tail + i) & Mask_] = std::move(items[i]);
+        }
+        if (count > 0) Tail_.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer only
+    [[nodiscard]] auto TryPop() noexcept -> std::optional<T> {
+        auto item = T{};
+        if (TryPopBatch(std::span{&item, 1}) == 0) return std::nullopt;
+        return item;
+    }
+
+    // Consumer only: moves up to `out.size()` items
+    // into a prefix of `out` and returns its length
+    [[nodiscard]] auto TryPopBatch(std::span<T> out) noexcept -> size_t {
+        const auto head = Head_.load(std::memory_order_relaxed);
+        if (CachedTail_ - head < out.size()) {
+            CachedTail_ = Tail_.load(std::memory_order_acquire);
+        }
+        const auto count = std::min(out.size(), CachedTail_ - head);
+        for (auto i = size_t{0}; i < count; ++i) {
+            out[i] = std::move(Slots_[(head + i) & Mask_]);
+        }
+        if (count > 0) Head_.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+    // A snapshot, exact only on a quiescent queue
+    [[nodiscard]] auto IsEmpty() const noexcept -> bool {
+        return Tail_.load(std::memory_order_acquire) == Head_.load(std::memory_order_acquire);
+    }
+};
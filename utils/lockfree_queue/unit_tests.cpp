@@ -0,0 +1,170 @@
+#include "event_waker.hpp"
+#include "mpsc_queue.hpp"
+#include "spsc_queue.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <poll.h>
+#include <thread>
+#include <vector>
+
+
+namespace {
+struct Message {
+    uint32_t Producer = 0;
+    uint32_t Sequence = 0;
+};
+
+auto IsReadable(int fd) -> bool {
+    auto pfd = pollfd{.fd = fd, .events = POLLIN, .revents = 0};
+    return poll(&pfd, 1, 0) == 1;
+}
+} // anonymous namespace
+
+
+namespace NTests {
+auto TestCapacity() -> void {
+    auto spsc = SpscQueue<int>{5};
+    assert(spsc.GetCapacity() == 8);
+    for (auto i = 0; i < 8; ++i) assert(spsc.TryPush(int{i}));
+    assert(!spsc.TryPush(8));
+    assert(spsc.TryPop() == 0 && spsc.TryPush(8));
+
+    auto mpsc = MpscQueue<int>{4};
+    auto items = std::vector<int>{1, 2, 3, 4, 5, 6};
+    assert(mpsc.TryPushBatch(items) == 4);
+    assert(!mpsc.TryPush(7) && mpsc.TryPushBatch(items) == 0);
+    auto out = std::vector<int>(3);
+    assert(mpsc.TryPopBatch(out) == 3 && out == (std::vector<int>{1, 2, 3}));
+    assert(mpsc.TryPush(7) && mpsc.TryPushBatch(items) == 2);
+    out.resize(10);
+    assert(mpsc.TryPopBatch(out) == 4 && out[0] == 4 && out[1] == 7 && out[2] == 1 && out[3] == 2);
+    assert(!mpsc.TryPop() && mpsc.IsEmpty());
+    std::cerr << "TestCapacity OK\n";
+}
+
+// Move-only items arrive in order, whatever the mix of single and batch
+// operations on either side
+auto TestSpscOrder() -> void {
+    static constexpr auto kItems = 300'000;
+    auto queue = SpscQueue<std::unique_ptr<int>>{64};
+    auto producer = std::jthread{[&]() {
+        auto batch = std::vector<std::unique_ptr<int>>{};
+        for (auto i = 0; i < kItems;) {
+            if (i % 7 == 0) {
+                auto item = std::make_unique<int>(i);
+                while (!queue.TryPush(std::move(item))) std::this_thread::yield();
+                ++i;
+                continue;
+            }
+            batch.clear();
+            for (auto j = i; j < std::min(i + 5, kItems); ++j) batch.push_back(std::make_unique<int>(j));
+            auto pushed = size_t{0};
+            while (pushed < batch.size()) {
+                const auto count = queue.TryPushBatch(std::span{batch}.subspan(pushed));
+                if (count == 0) std::this_thread::yield();
+                pushed += count;
+            }
+            i += int(batch.size());
+        }
+    }};
+    auto out = std::vector<std::unique_ptr<int>>(9);
+    for (auto expected = 0; expected < kItems;) {
+        if (expected % 2 == 0) {
+            if (auto item = queue.TryPop()) {
+                assert(**item == expected++);
+                continue;
+            }
+        } else if (const auto count = queue.TryPopBatch(out); count > 0) {
+            for (auto i = size_t{0}; i < count; ++i) assert(*out[i] == expected++);
+            continue;
+        }
+        std::this_thread::yield();
+    }
+    assert(queue.IsEmpty());
+    std::cerr << "TestSpscOrder OK\n";
+}
+
+// Every message arrives once, and the messages of each producer in order
+auto TestMpscOrder() -> void {
+    static constexpr auto kProducers = 4;
+    static constexpr auto kPerProducer = uint32_t{100'000};
+    auto queue = MpscQueue<Message>{128};
+    auto producers = std::vector<std::jthread>{};
+    for (auto p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&queue, p]() {
+            auto batch = std::vector<Message>{};
+            for (auto seq = uint32_t{0}; seq < kPerProducer;) {
+                if (p % 2 == 0) {
+                    while (!queue.TryPush(Message{uint32_t(p), seq})) std::this_thread::yield();
+                    ++seq;
+                    continue;
+                }
+                batch.clear();
+                for (auto s = seq; s < std::min(seq + 16, kPerProducer); ++s) batch.push_back({uint32_t(p), s});
+                auto pushed = size_t{0};
+                while (pushed < batch.size()) {
+                    const auto count = queue.TryPushBatch(std::span{batch}.subspan(pushed));
+                    if (count == 0) std::this_thread::yield();
+                    pushed += count;
+                }
+                seq += uint32_t(batch.size());
+            }
+        });
+    }
+    auto next = std::vector<uint32_t>(kProducers);
+    auto out = std::vector<Message>(32);
+    for (auto received = 0; received < kProducers * int(kPerProducer);) {
+        const auto count = queue.TryPopBatch(out);
+        if (count == 0) std::this_thread::yield();
+        for (auto i = size_t{0}; i < count; ++i) {
+            assert(out[i].Sequence == next[out[i].Producer]++);
+        }
+        received += int(count);
+    }
+    for (const auto n : next) assert(n == kPerProducer);
+    std::cerr << "TestMpscOrder OK\n";
+}
+
+auto TestWaker() -> void {
+    auto wakerOrError = EventWaker::CreateNew();
+    assert(std::holds_alternative<EventWaker>(wakerOrError));
+    auto& waker = std::get<EventWaker>(wakerOrError);
+
+    // A consumer that isn't sleeping isn't woken
+    assert(!waker.Wake() && !IsReadable(waker.GetFd()));
+
+    // A consumer with work doesn't sleep
+    auto queue = MpscQueue<Message>{16};
+    assert(queue.TryPush(Message{}));
+    const auto start = std::chrono::steady_clock::now();
+    assert(!waker.Sleep([&]() { return queue.IsEmpty(); }, std::chrono::milliseconds{5000}));
+    assert(queue.TryPop());
+
+    // A sleeping consumer is woken by a push
+    auto producer = std::jthread{[&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds{50});
+        assert(queue.TryPush(Message{.Producer = 1, .Sequence = 2}));
+        assert(!waker.Wake());
+    }};
+    while (queue.IsEmpty()) {
+        assert(!waker.Sleep([&]() { return queue.IsEmpty(); }, std::chrono::milliseconds{5000}));
+    }
+    assert(queue.TryPop()->Sequence == 2);
+    assert(std::chrono::steady_clock::now() - start < std::chrono::milliseconds{4000});
+    assert(!IsReadable(waker.GetFd()));
+    std::cerr << "TestWaker OK\n";
+}
+} // namespace NTests
+
+
+auto main() -> int {
+    using namespace NTests;
+    TestCapacity();
+    TestSpscOrder();
+    TestMpscOrder();
+    TestWaker();
+    std::cerr << "All tests passed.\n";
+}
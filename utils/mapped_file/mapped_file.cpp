@@ -0,0 +1,76 @@
+#include "mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+
+MappedFile::MappedFile(const std::byte* data, size_t size) noexcept
+    : Data_(data)
+    , Size_(size)
+{
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : Data_(std::exchange(other.Data_, nullptr))
+    , Size_(std::exchange(other.Size_, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    std::swap(Data_, other.Data_);
+    std::swap(Size_, other.Size_);
+    return *this;
+}
+
+MappedFile::~MappedFile() noexcept {
+    // `Data_ == nullptr` means a moved-from state or an empty file,
+    // which can't be mapped and isn't
+    if (Data_) {
+        // TODO: log the error if `munmap()` returns `-1`
+        munmap(const_cast<std::byte*>(Data_), Size_);
+    }
+}
+
+auto MappedFile::OpenReadOnly(const std::string& path, const EAccessPattern accessPattern) noexcept
+  -> std::variant<MappedFile, SystemError> {
+    const auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return SystemError{
+            .Value = std::errc{errno},
+            .ContextMessage = "open() syscall failed for \"" + path + "\" (" SOURCE_LOCATION ")",
+        };
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        const auto err = errno;
+        close(fd);
+        return SystemError{
+            .Value = std::errc{err},
+            .ContextMessage = "fstat() syscall failed (" SOURCE_LOCATION ")",
+        };
+    }
+    const auto size = size_t(st.st_size);
+    if (size == 0) {
+        close(fd);
+        return MappedFile{nullptr, 0};
+    }
+    auto* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    const auto mmapErr = errno;
+    close(fd);
+    if (data == MAP_FAILED) {
+        return SystemError{
+            .Value = std::errc{mmapErr},
+            .ContextMessage = "mmap() syscall failed (" SOURCE_LOCATION ")",
+        };
+    }
+    const auto advice = accessPattern == EAccessPattern::Sequential ? MADV_SEQUENTIAL
+                      : accessPattern == EAccessPattern::Random ? MADV_RANDOM
+                      : MADV_NORMAL;
+    // Only a hint, so a failure is not an error
+    madvise(data, size, advice);
+    return MappedFile{static_cast<const std::byte*>(data), size};
+}
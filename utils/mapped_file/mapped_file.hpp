@@ -0,0 +1,46 @@
+#pragma once
+
+
+#include "../error.hpp"
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <variant>
+
+
+/* A read-only, shared memory mapping of a whole file.
+ *
+ * Opening costs the same regardless of the file size: nothing is read
+ * until it is touched, and the pages are shared through the page cache
+ * by every process mapping the same file.
+ */
+class MappedFile {
+public:
+    // Passed to `madvise()` so that the kernel reads ahead appropriately
+    enum class EAccessPattern {
+        Normal,
+        Sequential,
+        Random,
+    };
+private:
+    const std::byte* Data_;
+    size_t Size_;
+private:
+    MappedFile(const std::byte* data, size_t size) noexcept;
+public:
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile() noexcept;
+
+    [[nodiscard]] static auto OpenReadOnly(
+        const std::string& path,
+        EAccessPattern accessPattern = EAccessPattern::Normal
+    ) noexcept
+      -> std::variant<MappedFile, SystemError>;
+
+    [[nodiscard]] auto GetData() const noexcept -> std::span<const std::byte> {
+        return {Data_, Size_};
+    }
+};
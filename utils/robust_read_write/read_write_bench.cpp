@@ -0,0 +1,239 @@
+#include "robust_read_write.hpp"
+
+#include "../bench_helpers.hpp"
+#include "../cli_args.hpp"
+#include "../timer/clock.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <fcntl.h>
+#include <iomanip>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string_view>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+
+/* The syscalls made by `RobustSyncRead()` and `RobustSyncWrite()`,
+ * counted per thread. These definitions take precedence over the ones
+ * of libc for every call made through the dynamic linker, so the
+ * wrappers make the syscalls themselves.
+ */
+namespace {
+    thread_local auto tNumSyscalls = uint64_t{0};
+}
+
+extern "C" {
+    ssize_t read(int fd, void* buf, size_t count) {
+        ++tNumSyscalls;
+        return syscall(SYS_read, fd, buf, count);
+    }
+    ssize_t readv(int fd, const iovec* iov, int iovcnt) {
+        ++tNumSyscalls;
+        return syscall(SYS_readv, fd, iov, iovcnt);
+    }
+    ssize_t write(int fd, const void* buf, size_t count) {
+        ++tNumSyscalls;
+        return syscall(SYS_write, fd, buf, count);
+    }
+    ssize_t writev(int fd, const iovec* iov, int iovcnt) {
+        ++tNumSyscalls;
+        return syscall(SYS_writev, fd, iov, iovcnt);
+    }
+    int poll(pollfd* fds, nfds_t nfds, int timeoutMs) {
+        ++tNumSyscalls;
+        auto timeout = timespec{
+            .tv_sec = timeoutMs / 1000,
+            .tv_nsec = timeoutMs % 1000 * 1'000'000L,
+        };
+        // The kernel's sigset_t, not glibc's
+        constexpr auto kSigsetSize = size_t{8};
+        return int(syscall(SYS_ppoll, fds, nfds, timeoutMs < 0 ? nullptr : &timeout, nullptr, kSigsetSize));
+    }
+}
+
+
+namespace {
+    using namespace std::chrono;
+
+    constexpr auto kTimeout = milliseconds{10'000};
+    // Caps the bytes moved per run, for the large messages
+    constexpr auto kMaxBytesPerRun = size_t{256} << 20;
+    constexpr auto kMaxRoundTrips = 20'000;
+
+    /* Two non-blocking byte streams between the same pair of endpoints,
+     * from A to B and back, for the ping-pong. A pipe is one-way, so it
+     * takes two of them.
+     */
+    struct Channel {
+        int AToB[2];
+        int BToA[2];
+
+        Channel(int aToBRead, int aToBWrite, int bToARead, int bToAWrite) noexcept
+            : AToB{aToBRead, aToBWrite}
+            , BToA{bToARead, bToAWrite}
+        {
+        }
+        Channel(const Channel& other) = delete;
+        ~Channel() {
+            for (const auto fd : {AToB[0], AToB[1], BToA[0], BToA[1]}) {
+                if (fd != -1) close(fd);
+            }
+        }
+    };
+
+    auto CreatePipes() -> Channel {
+        int aToB[2];
+        int bToA[2];
+        Check(pipe2(aToB, O_NONBLOCK | O_CLOEXEC) == 0, "pipe2()");
+        Check(pipe2(bToA, O_NONBLOCK | O_CLOEXEC) == 0, "pipe2()");
+        return Channel{aToB[0], aToB[1], bToA[0], bToA[1]};
+    }
+
+    // Sockets are two-way, so each end is `dup()`-ed to
+    // be closed once per direction, as pipes are
+    auto CreateUnixSocketPair() -> Channel {
+        int fds[2];
+        Check(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) == 0, "socketpair()");
+        return Channel{fds[1], fds[0], dup(fds[0]), dup(fds[1])};
+    }
+
+    auto CreateLoopbackTcp() -> Channel {
+        const auto listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        Check(listener != -1, "socket()");
+        auto addr = sockaddr_in{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        auto addrLen = socklen_t{sizeof(addr)};
+        Check(bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0, "bind()");
+        Check(listen(listener, 1) == 0, "listen()");
+        Check(getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &addrLen) == 0, "getsockname()");
+        const auto client = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        Check(client != -1, "socket()");
+        Check(connect(client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0, "connect()");
+        const auto server = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        Check(server != -1, "accept4()");
+        Check(fcntl(client, F_SETFL, O_NONBLOCK) == 0, "fcntl()");
+        close(listener);
+        // Otherwise the tail of a large message can wait for an ACK
+        for (const auto fd : {client, server}) {
+            const auto one = 1;
+            Check(setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) == 0, "setsockopt()");
+        }
+        return Channel{server, client, dup(client), dup(server)};
+    }
+
+    auto ReadMessage(int fd, std::span<std::byte> to) -> void {
+        const auto result = RobustSyncRead(fd, to, kTimeout);
+        if (auto* err = std::get_if<NRobustSyncRead::OnSystemError>(&result)) LogErrorAndExit(err->Err);
+        if (!std::holds_alternative<NRobustSyncRead::OnSuccess>(result)) LogErrorAndExit("RobustSyncRead() failed");
+    }
+
+    auto WriteMessage(int fd, std::span<const std::byte> from) -> void {
+        const auto result = RobustSyncWrite(fd, from, kTimeout);
+        if (auto* err = std::get_if<NRobustSyncWrite::OnSystemError>(&result)) LogErrorAndExit(err->Err);
+        if (!std::holds_alternative<NRobustSyncWrite::OnSuccess>(result)) LogErrorAndExit("RobustSyncWrite() failed");
+    }
+
+    struct StreamStats {
+        double MegabytesPerSecond;
+        double MessagesPerSecond;
+        double ReaderSyscallsPerMessage;
+        double WriterSyscallsPerMessage;
+    };
+
+    // The writer sends `numMessages` messages back to back, as fast as the reader takes them
+    auto RunStream(const Channel& channel, size_t size, int numMessages) -> StreamStats {
+        auto writerSyscalls = uint64_t{0};
+        auto buf = std::vector<std::byte>(size);
+        const auto start = MonotonicClock::now();
+        tNumSyscalls = 0;
+        {
+            auto writer = std::jthread{[&]() {
+                const auto from = std::vector<std::byte>(size);
+                tNumSyscalls = 0;
+                for (auto i = 0; i != numMessages; ++i) WriteMessage(channel.AToB[1], from);
+                writerSyscalls = tNumSyscalls;
+            }};
+            for (auto i = 0; i != numMessages; ++i) ReadMessage(channel.AToB[0], buf);
+        }
+        const auto readerSyscalls = tNumSyscalls;
+        const auto seconds = duration<double>(MonotonicClock::now() - start).count();
+        return {
+            .MegabytesPerSecond = double(size) * numMessages / seconds / 1e6,
+            .MessagesPerSecond = numMessages / seconds,
+            .ReaderSyscallsPerMessage = double(readerSyscalls) / numMessages,
+            .WriterSyscallsPerMessage = double(writerSyscalls) / numMessages,
+        };
+    }
+
+    // Round-trip times of a message echoed back by the other end
+    auto RunPingPong(const Channel& channel, size_t size, int numRoundTrips) -> std::vector<nanoseconds> {
+        auto rtts = std::vector<nanoseconds>{};
+        rtts.reserve(size_t(numRoundTrips));
+        auto echo = std::jthread{[&]() {
+            auto buf = std::vector<std::byte>(size);
+            for (auto i = 0; i != numRoundTrips; ++i) {
+                ReadMessage(channel.AToB[0], buf);
+                WriteMessage(channel.BToA[1], buf);
+            }
+        }};
+        auto buf = std::vector<std::byte>(size);
+        for (auto i = 0; i != numRoundTrips; ++i) {
+            const auto sent = MonotonicClock::now();
+            WriteMessage(channel.AToB[1], buf);
+            ReadMessage(channel.BToA[0], buf);
+            rtts.push_back(MonotonicClock::now() - sent);
+        }
+        return rtts;
+    }
+
+    auto RunTransport(std::string_view name, auto createChannel, int numMessages, size_t maxSize) -> void {
+        std::cout << name << "\n";
+        for (auto size = size_t{1}; size <= maxSize; size *= 4) {
+            const auto count = int(std::clamp<size_t>(kMaxBytesPerRun / size, 1, size_t(numMessages)));
+            const auto stream = RunStream(createChannel(), size, count);
+            auto rtts = RunPingPong(createChannel(), size, std::min(count, kMaxRoundTrips));
+            std::cout << std::fixed << std::setprecision(1)
+                      << std::setw(8) << size
+                      << std::setw(10) << stream.MegabytesPerSecond
+                      << std::setw(12) << int64_t(stream.MessagesPerSecond)
+                      << std::setprecision(2)
+                      << std::setw(10) << stream.ReaderSyscallsPerMessage
+                      << std::setw(10) << stream.WriterSyscallsPerMessage
+                      << std::setw(10) << Percentile(rtts, 0.5)
+                      << std::setw(10) << Percentile(rtts, 0.99)
+                      << std::setw(10) << Percentile(rtts, 0.999) << "\n";
+        }
+    }
+} // anonymous namespace
+
+
+/* Usage: read_write_bench [messages per run = 100000] [max message bytes = 1048576]
+ *
+ * For a pipe, a unix socket pair and a loopback TCP connection, and
+ * message sizes from 1 byte up by a factor of 4:
+ *  - streaming: MB/s, messages/s, and the syscalls per message made by
+ *    `RobustSyncRead()` on the reader's side and by the write on the
+ *    writer's side, `poll()` included;
+ *  - ping-pong: p50/p99/p999 round-trip time in nanoseconds of a message
+ *    echoed back by another thread.
+ * Runs are capped at 256 MiB and 20000 round trips.
+ */
+auto main(int argc, char** argv) -> int {
+    const auto numMessages = std::max(argc > 1 ? ParseIntArg(argv[1], 100'000) : 100'000, 1);
+    const auto maxSize = size_t(std::clamp(argc > 2 ? ParseIntArg(argv[2], 1 << 20) : 1 << 20, 1, 1 << 30));
+
+    std::cout << "    size      MB/s    messages/s  rd sys/m  wr sys/m    p50 ns    p99 ns   p999 ns\n";
+    RunTransport("pipe", CreatePipes, numMessages, maxSize);
+    RunTransport("unix socketpair", CreateUnixSocketPair, numMessages, maxSize);
+    RunTransport("loopback TCP", CreateLoopbackTcp, numMessages, maxSize);
+}
@@ -2,190 +2,361 @@
 
 #include "../../utils/timer/timer.hpp"
 
+#include <array>
 #include <chrono>
 #include <sys/poll.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 
-auto RobustSyncRead(
-    const int fd,
-    const std::span<std::byte> to,
-    const std::chrono::milliseconds timeout,
-    const std::optional<int> cancellationFd
-) noexcept
-  -> RobustSyncReadResult {
-    using namespace NRobustSyncRead;
-    auto pollFd = std::array{
-        pollfd{
-            .fd = fd,
-            .events = POLLIN,
-            .revents = 0,
-        },
-        pollfd{
-            .fd = cancellationFd.value_or(-1),
-            .events = POLLIN,
-            .revents = 0
+namespace {
+    // Bounds the stack space of `IovecCursor`; longer
+    // sequences of buffers take more syscalls
+    constexpr auto kMaxIovecs = 64;
+
+    /* A position in a sequence of buffers, e.g. after a short `readv()`
+     * or `writev()`, and the `iovec`s of the rest, from there
+     */
+    template <class Byte>
+    class IovecCursor {
+    private:
+        std::span<const std::span<Byte>> Buffers_;
+        size_t Index_ = 0;
+        size_t Offset_ = 0;
+        std::array<iovec, kMaxIovecs> Iovecs_;
+    public:
+        explicit IovecCursor(const std::span<const std::span<Byte>> buffers) noexcept
+            : Buffers_(buffers)
+        {
+        }
+
+        // Fills `GetIovecs()`, returns the number of `iovec`s
+        auto Prepare() noexcept -> int {
+            auto count = 0;
+            auto offset = Offset_;
+            for (auto i = Index_; i != Buffers_.size() && count != kMaxIovecs; ++i, offset = 0) {
+                if (Buffers_[i].size() == offset) continue;
+                Iovecs_[count++] = iovec{
+                    .iov_base = const_cast<std::byte*>(Buffers_[i].data() + offset),
+                    .iov_len = Buffers_[i].size() - offset,
+                };
+            }
+            return count;
+        }
+
+        [[nodiscard]] auto GetIovecs() const noexcept -> const iovec* {
+            return Iovecs_.data();
+        }
+
+        auto Advance(size_t nBytes) noexcept -> void {
+            while (nBytes != 0) {
+                const auto left = Buffers_[Index_].size() - Offset_;
+                if (nBytes < left) {
+                    Offset_ += nBytes;
+                    return;
+                }
+                nBytes -= left;
+                ++Index_;
+                Offset_ = 0;
+            }
         }
     };
-    const auto nfds = cancellationFd.has_value() ? 2 : 1;
-    const auto timer = Timer{timeout};
-    auto nBytesRead = size_t{0};
-    auto remainingTime = timeout;
-    for (; nBytesRead != to.size(); remainingTime = timer.CalcRemainingTime()) {
-        const auto pollResult = poll(&pollFd[0], nfds, remainingTime.count());
-        if (pollResult == -1) {
-            if (errno == EINTR) continue;
-            else return OnSystemError{
-                .NumBytesRead = nBytesRead,
-                .WallTimeElapsed = timer.CalcElapsedTime(),
-                .Err = SystemError{
-                    .Value = std::errc{errno},
-                    .ContextMessage = "poll() syscall failed (" SOURCE_LOCATION ")",
-                },
-            };
-        } else if (pollResult == 0) {
-            return OnTimeout{
-                .NumBytesRead = nBytesRead,
-                .WallTimeElapsed = timer.CalcElapsedTime(),
-            };
-        } else { // pollResult == 1 or 2 
-            if (pollFd[0].revents & POLLIN) {  
-                const auto x = read(fd, &to[nBytesRead], to.size() - nBytesRead);
-                if (x == -1) {
-                    // Check for `EAGAIN` and `EWOULDBLOCK` in case `poll` spuriously reported
-                    // that input on `nonBlockingFd` is available
-                    if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) continue;
-                    else return OnSystemError{
-                        .NumBytesRead = nBytesRead,
-                        .WallTimeElapsed = timer.CalcElapsedTime(),
-                        .Err = SystemError{
-                            .Value = std::errc{errno},
-                            .ContextMessage = "read() syscall failed (" SOURCE_LOCATION ")",
-                        },
-                    };
-                } else if (x == 0) { // no more data available for reading
-                    // Note: at this point the loop invariant is holding:
-                    // `nBytesRead` is strictly less than `to.size()`
-                    return OnPrematureEof{
+
+    template <class Byte>
+    auto CalcTotalSize(const std::span<const std::span<Byte>> buffers) noexcept -> size_t {
+        auto size = size_t{0};
+        for (const auto buffer : buffers) size += buffer.size();
+        return size;
+    }
+
+    /* The loop of `RobustSyncRead()` and `RobustSyncReadv()`:
+     * `readSome(nBytesRead)` reads the bytes after the first `nBytesRead`
+     * ones with a syscall and returns what it returns, and
+     * `syscallFailure` is the context of an error of that syscall
+     */
+    template <class ReadSome>
+    auto RobustSyncReadLoop(
+        const int fd,
+        const size_t size,
+        const std::chrono::milliseconds timeout,
+        const std::optional<int> cancellationFd,
+        const std::chrono::nanoseconds busyPollBudget,
+        const ErrorContext& syscallFailure,
+        ReadSome&& readSome
+    ) noexcept
+      -> RobustSyncReadResult {
+        using namespace NRobustSyncRead;
+        auto pollFd = std::array{
+            pollfd{
+                .fd = fd,
+                .events = POLLIN,
+                .revents = 0,
+            },
+            pollfd{
+                .fd = cancellationFd.value_or(-1),
+                .events = POLLIN,
+                .revents = 0
+            }
+        };
+        const auto nfds = cancellationFd.has_value() ? 2 : 1;
+        const auto timer = Timer{timeout};
+        auto nBytesRead = size_t{0};
+        // Errors other than "no input yet" are left to the loop below to report
+        while (nBytesRead != size && timer.CalcElapsedTime() < busyPollBudget) {
+            const auto x = readSome(nBytesRead);
+            if (x > 0) {
+                nBytesRead += x;
+            } else if (x == 0) {
+                return OnPrematureEof{
+                    .NumBytesRead = nBytesRead,
+                    .WallTimeElapsed = timer.CalcElapsedTime(),
+                };
+            } else if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+                break;
+            }
+        }
+        while (nBytesRead != size) {
+            const auto pollResult = poll(&pollFd[0], nfds, timer.CalcRemainingPollTimeout());
+            if (pollResult == -1) {
+                if (errno == EINTR) continue;
+                else return OnSystemError{
+                    .NumBytesRead = nBytesRead,
+                    .WallTimeElapsed = timer.CalcElapsedTime(),
+                    .Err = SystemError{
+                        .Value = std::errc{errno},
+                        .ContextMessage = "poll() syscall failed (" SOURCE_LOCATION ")",
+                    },
+                };
+            } else if (pollResult == 0) {
+                return OnTimeout{
+                    .NumBytesRead = nBytesRead,
+                    .WallTimeElapsed = timer.CalcElapsedTime(),
+                };
+            } else { // pollResult == 1 or 2 
+                if (pollFd[0].revents & POLLIN) {  
+                    const auto x = readSome(nBytesRead);
+                    if (x == -1) {
+                        // Check for `EAGAIN` and `EWOULDBLOCK` in case `poll` spuriously reported
+                        // that input on `nonBlockingFd` is available
+                        if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) continue;
+                        else return OnSystemError{
+                            .NumBytesRead = nBytesRead,
+                            .WallTimeElapsed = timer.CalcElapsedTime(),
+                            .Err = SystemError{
+                                .Value = std::errc{errno},
+                                .ContextMessage = syscallFailure,
+                            },
+                        };
+                    } else if (x == 0) { // no more data available for reading
+                        // Note: at this point the loop invariant is holding:
+                        // `nBytesRead` is strictly less than `size`
+                        return OnPrematureEof{
+                            .NumBytesRead = nBytesRead,
+                            .WallTimeElapsed = timer.CalcElapsedTime(),
+                        };
+                    } else {
+                        nBytesRead += x;
+                    }
+                } else if (pollFd[0].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                    if (pollFd[0].revents == POLLNVAL) {
+                        return OnSystemError{
+                            .NumBytesRead = nBytesRead,
+                            .WallTimeElapsed = timer.CalcElapsedTime(),
+                            .Err = SystemError{
+                                .Value = std::errc{EBADF},
+                                .ContextMessage = "poll() syscall failed (" SOURCE_LOCATION "), "
+                                                  "the file descriptor was not open",
+                                .Fd = fd,
+                            }
+                        };
+                    } else {
+                        return OnPollerrOrPollhup{
+                            .NumBytesRead = nBytesRead,
+                            .WallTimeElapsed = timer.CalcElapsedTime(),
+                            .PollRevents = pollFd[0].revents,
+                        };
+                    }
+                } else if (pollFd[1].revents & POLLIN) { // cancellation
+                    return OnCancellation{
                         .NumBytesRead = nBytesRead,
                         .WallTimeElapsed = timer.CalcElapsedTime(),
                     };
-                } else {
-                    nBytesRead += x;
-                }
-            } else if (pollFd[0].revents & (POLLERR | POLLHUP | POLLNVAL)) {
-                if (pollFd[0].revents == POLLNVAL) {
+                } else { // error on cancellation fd
                     return OnSystemError{
                         .NumBytesRead = nBytesRead,
                         .WallTimeElapsed = timer.CalcElapsedTime(),
                         .Err = SystemError{
-                            .Value = std::errc{EBADF},
-                            .ContextMessage = "poll() syscall failed (" SOURCE_LOCATION "), "
-                                              "the file descriptor "
-                                              + std::to_string(fd)
-                                              + " was not open"
-                        }
-                    };
-                } else {
-                    return OnPollerrOrPollhup{
-                        .NumBytesRead = nBytesRead,
-                        .WallTimeElapsed = timer.CalcElapsedTime(),
-                        .PollRevents = pollFd[0].revents,
+                            .Value = std::errc{},
+                            .ContextMessage =
+                                "error on cancellation file descriptor (" SOURCE_LOCATION ")",
+                            .Fd = *cancellationFd,
+                        },
                     };
                 }
-            } else if (pollFd[1].revents & POLLIN) { // cancellation
-                return OnCancellation{
-                    .NumBytesRead = nBytesRead,
-                    .WallTimeElapsed = timer.CalcElapsedTime(),
-                };
-            } else { // error on cancellation fd
-                return OnSystemError{
-                    .NumBytesRead = nBytesRead,
-                    .WallTimeElapsed = timer.CalcElapsedTime(),
-                    .Err = SystemError{
-                        .Value = std::errc{},
-                        .ContextMessage =
-                            "error on cancellation file descriptor (" SOURCE_LOCATION ")",
-                    },
-                };
             }
         }
+        return OnSuccess{
+            .NumBytesRead = nBytesRead,
+            .WallTimeElapsed = timer.CalcElapsedTime(),
+        };
     }
-    return OnSuccess{
-        .NumBytesRead = nBytesRead,
-        .WallTimeElapsed = timer.CalcElapsedTime(),
-    };
-}
 
-auto RobustSyncWrite(
-    const int fd,
-    const std::span<const std::byte> from,
-    const std::chrono::milliseconds timeout
-) noexcept
-  -> RobustSyncWriteResult {
-    using namespace NRobustSyncWrite;
-    auto pollFd = pollfd{
-        .fd = fd,
-        .events = POLLOUT,
-        .revents = 0,
-    };
-    auto nBytesWritten = size_t{0};
-    auto remainingTime = timeout;
-    const auto timer = Timer{timeout};
-    for (; nBytesWritten != from.size(); remainingTime = timer.CalcRemainingTime()) {
-        const auto pollResult = poll(&pollFd, 1, remainingTime.count());
-        if (pollResult == -1) {
-            if (errno == EINTR) continue;
-            else return OnSystemError{
-                .NumBytesWritten = nBytesWritten,
-                .Err = SystemError{
-                    .Value = std::errc{errno},
-                    .ContextMessage = "poll() syscall failed (" SOURCE_LOCATION ")",
-                },
-            };
-        } else if (pollResult == 0) {
-            return OnTimeout{
-                .NumBytesWritten = nBytesWritten,
-                .Timeout = timeout,
-            };
-        } else { // pollResult == 1
-            if (pollFd.revents & POLLOUT) {
-                const auto x = write(fd, &from[nBytesWritten], from.size() - nBytesWritten);
-                if (x == -1) {
-                    // Check for `EAGAIN` and `EWOULDBLOCK` in case `poll` spuriously reported
-                    // that output on `fd` is available or the number of bytes that it is possible
-                    // to output to `fd` is smaller than `from.size() - nBytesWritten`
-                    if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) continue;
-                    else return OnSystemError{
+    // The loop of `RobustSyncWrite()` and `RobustSyncWritev()`, see above
+    template <class WriteSome>
+    auto RobustSyncWriteLoop(
+        const int fd,
+        const size_t size,
+        const std::chrono::milliseconds timeout,
+        const std::optional<int> cancellationFd,
+        const ErrorContext& syscallFailure,
+        WriteSome&& writeSome
+    ) noexcept
+      -> RobustSyncWriteResult {
+        using namespace NRobustSyncWrite;
+        auto pollFd = std::array{
+            pollfd{
+                .fd = fd,
+                .events = POLLOUT,
+                .revents = 0,
+            },
+            pollfd{
+                .fd = cancellationFd.value_or(-1),
+                .events = POLLIN,
+                .revents = 0
+            }
+        };
+        const auto nfds = cancellationFd.has_value() ? 2 : 1;
+        auto nBytesWritten = size_t{0};
+        const auto timer = Timer{timeout};
+        while (nBytesWritten != size) {
+            const auto pollResult = poll(&pollFd[0], nfds, timer.CalcRemainingPollTimeout());
+            if (pollResult == -1) {
+                if (errno == EINTR) continue;
+                else return OnSystemError{
+                    .NumBytesWritten = nBytesWritten,
+                    .Err = SystemError{
+                        .Value = std::errc{errno},
+                        .ContextMessage = "poll() syscall failed (" SOURCE_LOCATION ")",
+                    },
+                };
+            } else if (pollResult == 0) {
+                return OnTimeout{
+                    .NumBytesWritten = nBytesWritten,
+                    .Timeout = timeout,
+                };
+            } else { // pollResult == 1 or 2
+                if (pollFd[0].revents & POLLOUT) {
+                    const auto x = writeSome(nBytesWritten);
+                    if (x == -1) {
+                        // Check for `EAGAIN` and `EWOULDBLOCK` in case `poll` spuriously reported
+                        // that output on `fd` is available or the number of bytes that it is possible
+                        // to output to `fd` is smaller than `size - nBytesWritten`
+                        if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) continue;
+                        else return OnSystemError{
+                            .NumBytesWritten = nBytesWritten,
+                            .Err = SystemError{
+                                .Value = std::errc{errno},
+                                .ContextMessage = syscallFailure,
+                            },
+                        };
+                    } else { // `x` > 0 because `write()` can't return 0 when writing more than 0 bytes
+                        nBytesWritten += x;
+                    }
+                } else if (pollFd[0].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                    if (pollFd[0].revents == POLLNVAL) {
+                        return OnSystemError{
+                            .NumBytesWritten = nBytesWritten,
+                            .Err = SystemError{
+                                .Value = std::errc{EBADF},
+                                .ContextMessage = "poll() syscall failed (" SOURCE_LOCATION "), "
+                                                  "the file descriptor was not open",
+                                .Fd = fd,
+                            }
+                        };
+                    } else {
+                        return OnPollerrOrPollhup{
+                            .NumBytesWritten = nBytesWritten,
+                            .PollRevents = pollFd[0].revents,
+                        };
+                    }
+                } else if (pollFd[1].revents & POLLIN) { // cancellation
+                    return OnCancellation{
                         .NumBytesWritten = nBytesWritten,
-                        .Err = SystemError{
-                            .Value = std::errc{errno},
-                            .ContextMessage = "write() syscall failed (" SOURCE_LOCATION ")",
-                        },
                     };
-                } else { // `x` > 0 because `write()` can't return 0 when writing more than 0 bytes
-                    nBytesWritten += x;
-                }
-            } else { // `POLLERR | POLLHUP | POLLNVAL`
-                if (pollFd.revents == POLLNVAL) {
+                } else { // error on cancellation fd
                     return OnSystemError{
                         .NumBytesWritten = nBytesWritten,
                         .Err = SystemError{
-                            .Value = std::errc{EBADF},
-                            .ContextMessage = "poll() syscall failed (" SOURCE_LOCATION "), "
-                                              "the file descriptor "
-                                              + std::to_string(fd)
-                                              + " was not open"
-                        }
-                    };
-                } else {
-                    return OnPollerrOrPollhup{
-                        .NumBytesWritten = nBytesWritten,
-                        .PollRevents = pollFd.revents,
+                            .Value = std::errc{},
+                            .ContextMessage =
+                                "error on cancellation file descriptor (" SOURCE_LOCATION ")",
+                            .Fd = *cancellationFd,
+                        },
                     };
                 }
             }
         }
+        return OnSuccess{};
     }
-    return OnSuccess{};
-}
\ No newline at end of file
+} // anonymous namespace
+
+
+auto RobustSyncRead(
+    const int fd,
+    const std::span<std::byte> to,
+    const std::chrono::milliseconds timeout,
+    const std::optional<int> cancellationFd,
+    const std::chrono::nanoseconds busyPollBudget
+) noexcept
+  -> RobustSyncReadResult {
+    return RobustSyncReadLoop(fd, to.size(), timeout, cancellationFd, busyPollBudget,
+        "read() syscall failed (" SOURCE_LOCATION ")", [fd, to](const size_t nBytesRead) {
+        return read(fd, &to[nBytesRead], to.size() - nBytesRead);
+    });
+}
+
+auto RobustSyncReadv(
+    const int fd,
+    const std::span<const std::span<std::byte>> to,
+    const std::chrono::milliseconds timeout,
+    const std::optional<int> cancellationFd,
+    const std::chrono::nanoseconds busyPollBudget
+) noexcept
+  -> RobustSyncReadResult {
+    auto cursor = IovecCursor{to};
+    return RobustSyncReadLoop(fd, CalcTotalSize(to), timeout, cancellationFd, busyPollBudget,
+        "readv() syscall failed (" SOURCE_LOCATION ")", [fd, &cursor](size_t) {
+        const auto x = readv(fd, cursor.GetIovecs(), cursor.Prepare());
+        if (x > 0) cursor.Advance(size_t(x));
+        return x;
+    });
+}
+
+auto RobustSyncWrite(
+    const int fd,
+    const std::span<const std::byte> from,
+    const std::chrono::milliseconds timeout,
+    const std::optional<int> cancellationFd
+) noexcept
+  -> RobustSyncWriteResult {
+    return RobustSyncWriteLoop(fd, from.size(), timeout, cancellationFd,
+        "write() syscall failed (" SOURCE_LOCATION ")", [fd, from](const size_t nBytesWritten) {
+        return write(fd, &from[nBytesWritten], from.size() - nBytesWritten);
+    });
+}
+
+auto RobustSyncWritev(
+    const int fd,
+    const std::span<const std::span<const std::byte>> from,
+    const std::chrono::milliseconds timeout,
+    const std::optional<int> cancellationFd
+) noexcept
+  -> RobustSyncWriteResult {
+    auto cursor = IovecCursor{from};
+    return RobustSyncWriteLoop(fd, CalcTotalSize(from), timeout, cancellationFd,
+        "writev() syscall failed (" SOURCE_LOCATION ")", [fd, &cursor](size_t) {
+        const auto x = writev(fd, cursor.GetIovecs(), cursor.Prepare());
+        if (x > 0) cursor.Advance(size_t(x));
+        return x;
+    });
+}
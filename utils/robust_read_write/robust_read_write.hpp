@@ -13,38 +13,38 @@ namespace NRobustSyncRead {
     // read from `nonBlockingFd` successfully
     struct OnSuccess {
         size_t NumBytesRead;
-        std::chrono::milliseconds WallTimeElapsed;
+        std::chrono::nanoseconds WallTimeElapsed;
     };
     // Indicates that this blocking read was cancelled by some
     // other event (i.e. a user pressing a "cancel" button)
     struct OnCancellation {
         size_t NumBytesRead;
-        std::chrono::milliseconds WallTimeElapsed;
+        std::chrono::nanoseconds WallTimeElapsed;
     };
     // Indicates that a `EOF` occurred (i.e. at some point the underlying
     // `read()` syscall returned 0) before the whole buffer `to` was read
     struct OnPrematureEof {
         size_t NumBytesRead;
-        std::chrono::milliseconds WallTimeElapsed;
+        std::chrono::nanoseconds WallTimeElapsed;
     };
     // Indicates that a system error occurred
     // while reading from `nonBlockingFd`
     struct OnSystemError {
         size_t NumBytesRead;
-        std::chrono::milliseconds WallTimeElapsed;
+        std::chrono::nanoseconds WallTimeElapsed;
         SystemError Err;
     };
     // Indicates that the timeout was reached
     // before the whole buffer `to` was read
     struct OnTimeout {
         size_t NumBytesRead;
-        std::chrono::milliseconds WallTimeElapsed;
+        std::chrono::nanoseconds WallTimeElapsed;
     };
     // Indicates that an underlying `poll()` syscall returned `POLLERR`
     // or `POLLHUP` in `revents` before the whole buffer `to` was read
     struct OnPollerrOrPollhup {
         size_t NumBytesRead;
-        std::chrono::milliseconds WallTimeElapsed;
+        std::chrono::nanoseconds WallTimeElapsed;
         int PollRevents;
     };
     using Result = std::variant<
@@ -72,13 +72,32 @@ using RobustSyncReadResult = NRobustSyncRead::Result;
  * operation to be cancelled from some other place, for example, by the user
  * pressing a "cancel" button in the GUI client interface.
  * If this file descriptor becomes available for reading from, it means
- * that the `read` operation on `nonBlockingFd` has been cancelled.
+ * that the `read` operation on `nonBlockingFd` has been cancelled. The fd
+ * of a `CancellationToken` cancels a whole group of operations at once.
+ *
+ * A non-zero `busyPollBudget` trades CPU for latency: for that long,
+ * `read()` is retried in a loop instead of sleeping in `poll()`, which
+ * saves the wake-up when the bytes arrive within the budget. The
+ * cancellation file descriptor is only watched once the budget is spent.
 */
 [[nodiscard]] auto RobustSyncRead(
     int nonBlockingFd,
     std::span<std::byte> to,
     std::chrono::milliseconds timeout,
-    std::optional<int> nonBlockingCancellationFd = std::nullopt
+    std::optional<int> nonBlockingCancellationFd = std::nullopt,
+    std::chrono::nanoseconds busyPollBudget = {}
+) noexcept
+  -> RobustSyncReadResult;
+
+/* The same as `RobustSyncRead()`, but scatters the bytes read
+ * into the buffers `to`, in order, with `readv()`.
+ */
+[[nodiscard]] auto RobustSyncReadv(
+    int nonBlockingFd,
+    std::span<const std::span<std::byte>> to,
+    std::chrono::milliseconds timeout,
+    std::optional<int> nonBlockingCancellationFd = std::nullopt,
+    std::chrono::nanoseconds busyPollBudget = {}
 ) noexcept
   -> RobustSyncReadResult;
 
@@ -86,6 +105,11 @@ namespace NRobustSyncWrite {
     // Indicates that the whole buffer `from` was
     // written to `nonBlockingfd` successfully
     struct OnSuccess {};
+    // Indicates that this blocking write was cancelled
+    // by some other event, as in `RobustSyncRead()`
+    struct OnCancellation {
+        size_t NumBytesWritten;
+    };
     // Indicates that a system error occurred
     // while writing to `nonBlockingFd`
     struct OnSystemError {
@@ -104,9 +128,14 @@ namespace NRobustSyncWrite {
         size_t NumBytesWritten;
         int PollRevents;
     };
-    using Result = std::variant<OnSuccess, OnSystemError, OnTimeout, OnPollerrOrPollhup>;
+    using Result = std::variant<OnSuccess, OnCancellation, OnSystemError, OnTimeout, OnPollerrOrPollhup>;
 }
 using RobustSyncWriteResult = NRobustSyncWrite::Result;
+/* Writes the whole buffer `from` to `nonBlockingFd`, waiting for it to
+ * become writable for up to `timeout`. `nonBlockingCancellationFd`
+ * cancels the write as it does a `RobustSyncRead()`, e.g. the fd of a
+ * `CancellationToken` shared by all the operations of a game.
+ */
 [[nodiscard]] auto RobustSyncWrite(
     int nonBlockingFd,
     std::span<const std::byte> from,
@@ -114,3 +143,15 @@ using RobustSyncWriteResult = NRobustSyncWrite::Result;
     std::optional<int> nonBlockingCancellationFd = std::nullopt
 ) noexcept
   -> RobustSyncWriteResult;
+
+/* The same as `RobustSyncWrite()`, but gathers the bytes to write from
+ * the buffers `from`, in order, with `writev()`, e.g. a header and a
+ * payload, or several queued messages, in one syscall and no copy.
+ */
+[[nodiscard]] auto RobustSyncWritev(
+    int nonBlockingFd,
+    std::span<const std::span<const std::byte>> from,
+    std::chrono::milliseconds timeout,
+    std::optional<int> nonBlockingCancellationFd = std::nullopt
+) noexcept
+  -> RobustSyncWriteResult;
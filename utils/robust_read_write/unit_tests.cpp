@@ -5,9 +5,28 @@
 #include <chrono>
 #include <cstdlib>
 #include <fcntl.h>
+#include <new>
+#include <sstream>
 #include <sys/poll.h>
 #include <thread>
 #include <unistd.h>
+#include <vector>
+
+
+// Counts the allocations of each thread, to check that errors don't allocate
+thread_local auto tNumAllocations = size_t{0};
+
+auto operator new(size_t size) -> void* {
+    ++tNumAllocations;
+    if (auto* ptr = std::malloc(size == 0 ? 1 : size)) return ptr;
+    throw std::bad_alloc{};
+}
+auto operator delete(void* ptr) noexcept -> void {
+    std::free(ptr);
+}
+auto operator delete(void* ptr, size_t) noexcept -> void {
+    std::free(ptr);
+}
 
 
 namespace {
@@ -70,6 +89,7 @@ struct BasicTestParams {
     size_t NBytesForWriterToSend = kMessage.size();
     bool CloseWriterPipe = false;
     std::optional<std::chrono::milliseconds> CancellationTimeout;
+    std::chrono::nanoseconds BusyPollBudget = {};
 };
 
 struct BasicTestResult {
@@ -87,9 +107,10 @@ auto RunBasicTest(const BasicTestParams testParams) -> BasicTestResult {
         &result = testResult.ReadResult,
         fd = dataPipe.GetReadFd(),
         cancellationFd = cancellationPipe.GetReadFd(),
-        readerTimeout = testParams.ReaderTimeout
+        readerTimeout = testParams.ReaderTimeout,
+        busyPollBudget = testParams.BusyPollBudget
     ]() {
-        result = RobustSyncRead(fd, to, readerTimeout, cancellationFd);
+        result = RobustSyncRead(fd, to, readerTimeout, cancellationFd, busyPollBudget);
     }};
 
     auto writer = std::jthread([
@@ -171,6 +192,33 @@ auto TestSuccess() -> void {
     std::cerr << "TestSuccess OK\n";
 }
 
+// Both while spinning and after the budget is spent
+auto TestBusyPoll() -> void {
+    for (const auto budget : {std::chrono::milliseconds{1000}, std::chrono::milliseconds{5}}) {
+        const auto testResult = RunBasicTest({
+            .ReaderTimeout = std::chrono::milliseconds{2000},
+            .WriterSleepTime = std::chrono::milliseconds{10},
+            .BusyPollBudget = budget,
+        });
+        assert(testResult.ReadResult.has_value());
+        assert(std::holds_alternative<OnSuccess>(*testResult.ReadResult));
+        assert(testResult.Data == kMessage);
+    }
+    // An `EOF` is noticed while spinning
+    const auto testResult = RunBasicTest({
+        .ReaderTimeout = std::chrono::milliseconds{2000},
+        .WriterSleepTime = std::chrono::milliseconds{1},
+        .NBytesForWriterToSend = 3,
+        .CloseWriterPipe = true,
+        .BusyPollBudget = std::chrono::milliseconds{1000},
+    });
+    assert(testResult.ReadResult.has_value());
+    const auto* onEofPtr = std::get_if<OnPrematureEof>(&*testResult.ReadResult);
+    assert(onEofPtr && onEofPtr->NumBytesRead == 3);
+    assert(onEofPtr->WallTimeElapsed < std::chrono::milliseconds{1000});
+    std::cerr << "TestBusyPoll OK\n";
+}
+
 auto TestHangup() -> void {
     const auto testResult = RunBasicTest({
         .ReaderTimeout = std::chrono::milliseconds{1000},
@@ -201,6 +249,85 @@ auto TestNoHangup() -> void {
     assert(testResult.Data == kMessage);
     std::cerr << "TestNoHangup OK\n";
 }
+
+auto TestReadvScatter() -> void {
+    const auto pipe = std::get<Pipe>(Pipe::CreateNew());
+    auto writer = std::jthread{[fd = pipe.GetWriteFd()]() {
+        for (const auto byte : kMessage) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{5});
+            assert(write(fd, &byte, sizeof(byte)) == sizeof(byte));
+        }
+    }};
+    auto head = std::array<std::byte, 3>{};
+    auto tail = std::array<std::byte, kMessage.size() - 3>{};
+    const auto to = std::array{std::span<std::byte>{head}, std::span<std::byte>{}, std::span<std::byte>{tail}};
+    const auto result = RobustSyncReadv(pipe.GetReadFd(), to, std::chrono::milliseconds{1000});
+    assert(std::get<OnSuccess>(result).NumBytesRead == kMessage.size());
+    assert(head == kMessage.substr(0, 3) && tail == kMessage.substr(3));
+    std::cerr << "TestReadvScatter OK\n";
+}
+
+// Short writes into a small pipe resume in the middle of a buffer, across
+// more buffers than one `writev()` takes
+auto TestWritevShortWrites() -> void {
+    const auto pipe = std::get<Pipe>(Pipe::CreateNew());
+    assert(fcntl(pipe.GetWriteFd(), F_SETPIPE_SZ, 4096) != -1);
+    auto buffers = std::vector<std::vector<std::byte>>{};
+    auto expected = std::vector<std::byte>{};
+    for (auto i = 0; i < 200; ++i) {
+        auto& buffer = buffers.emplace_back(size_t(i * 37 % 1000));
+        for (auto& byte : buffer) byte = std::byte(expected.size() * 7 + 1);
+        expected.insert(expected.end(), buffer.begin(), buffer.end());
+    }
+    auto received = std::vector<std::byte>{};
+    auto reader = std::jthread{[&received, fd = pipe.GetReadFd(), size = expected.size()]() {
+        auto chunk = std::array<std::byte, 1000>{};
+        while (received.size() != size) {
+            const auto count = std::min(chunk.size(), size - received.size());
+            const auto result = RobustSyncRead(fd, std::span{chunk}.first(count), std::chrono::milliseconds{5000});
+            assert(std::holds_alternative<OnSuccess>(result));
+            received.insert(received.end(), chunk.begin(), chunk.begin() + count);
+        }
+    }};
+    auto from = std::vector<std::span<const std::byte>>{};
+    for (const auto& buffer : buffers) from.emplace_back(buffer);
+    const auto result = RobustSyncWritev(pipe.GetWriteFd(), from, std::chrono::milliseconds{5000});
+    assert(std::holds_alternative<NRobustSyncWrite::OnSuccess>(result));
+    reader.join();
+    assert(received == expected);
+    std::cerr << "TestWritevShortWrites OK\n";
+}
+
+// The context of the error is formatted only when it is logged
+auto TestErrorsDontAllocate() -> void {
+    constexpr auto kClosedFd = 1000;
+    assert(fcntl(kClosedFd, F_GETFD) == -1);
+    auto buf = std::array<std::byte, 4>{};
+    const auto numAllocations = tNumAllocations;
+    const auto readResult = RobustSyncRead(kClosedFd, buf, std::chrono::milliseconds{100});
+    const auto writeResult = RobustSyncWrite(kClosedFd, buf, std::chrono::milliseconds{100});
+    assert(tNumAllocations == numAllocations);
+
+    const auto& readErr = std::get<OnSystemError>(readResult).Err;
+    assert(readErr.Value == std::errc::bad_file_descriptor && readErr.Fd == kClosedFd);
+    assert(std::get<NRobustSyncWrite::OnSystemError>(writeResult).Err.Fd == kClosedFd);
+    auto out = std::ostringstream{};
+    out << readErr;
+    assert(out.str().find("file descriptor 1000") != std::string::npos);
+    std::cerr << "TestErrorsDontAllocate OK\n";
+}
+
+auto TestWritevTimeout() -> void {
+    const auto pipe = std::get<Pipe>(Pipe::CreateNew());
+    const auto pipeSize = fcntl(pipe.GetWriteFd(), F_SETPIPE_SZ, 4096);
+    assert(pipeSize != -1);
+    const auto header = std::array<std::byte, 16>{};
+    const auto payload = std::vector<std::byte>(size_t(pipeSize));
+    const auto from = std::array{std::span<const std::byte>{header}, std::span<const std::byte>{payload}};
+    const auto result = RobustSyncWritev(pipe.GetWriteFd(), from, std::chrono::milliseconds{100});
+    assert(std::get<NRobustSyncWrite::OnTimeout>(result).NumBytesWritten == size_t(pipeSize));
+    std::cerr << "TestWritevTimeout OK\n";
+}
 } // namespace NTests
 
 
@@ -211,7 +338,12 @@ auto main() -> int {
     TestVeryEarlyCancellation();
     TestTimeout();
     TestSuccess();
+    TestBusyPoll();
     TestHangup();
     TestNoHangup();
+    TestReadvScatter();
+    TestWritevShortWrites();
+    TestWritevTimeout();
+    TestErrorsDontAllocate();
     std::cerr << "All tests passed.\n";
 }
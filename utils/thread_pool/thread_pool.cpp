@@ -0,0 +1,188 @@
+#include "thread_pool.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+
+namespace {
+    // Rounds of looking for work before a worker goes to sleep
+    static constexpr auto kSpinRounds = 64;
+
+    // The worker running on this thread, if any
+    struct CurrentWorker {
+        const ThreadPool* Pool = nullptr;
+        int Index = -1;
+    };
+    thread_local auto tCurrentWorker = CurrentWorker{};
+    thread_local auto tRandomState = uint64_t{0};
+
+    auto NextRandom() noexcept -> uint64_t {
+        if (tRandomState == 0) {
+            tRandomState = reinterpret_cast<uintptr_t>(&tRandomState) | 1;
+        }
+        // xorshift64
+        tRandomState ^= tRandomState << 13;
+        tRandomState ^= tRandomState >> 7;
+        tRandomState ^= tRandomState << 17;
+        return tRandomState;
+    }
+
+    auto AllowedCpus() noexcept -> std::vector<int> {
+        auto cpus = std::vector<int>{};
+        auto set = cpu_set_t{};
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) != 0) return cpus;
+        for (auto cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+
+    // Best effort: an unpinned worker works all the same
+    auto PinCurrentThread(int cpu) noexcept -> void {
+        auto set = cpu_set_t{};
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+} // anonymous namespace
+
+
+auto ThreadPool::TaskGroup::Spawn(Task& task) -> void {
+    task.Group = this;
+    Pending_.fetch_add(1, std::memory_order_relaxed);
+    Pool_.Submit(task);
+}
+
+auto ThreadPool::TaskGroup::Wait() noexcept -> void {
+    const auto self = tCurrentWorker.Pool == &Pool_ ? tCurrentWorker.Index : -1;
+    while (Pending_.load(std::memory_order_acquire) != 0) {
+        if (auto* task = Pool_.FindTask(self)) {
+            Pool_.Run(*task);
+            continue;
+        }
+        // The remaining tasks of the group are running elsewhere: sleep
+        // until a group completes. Only this thread spawned into the
+        // group, so no task of it can appear in the meantime.
+        const auto completions = Pool_.Completions_.load(std::memory_order_acquire);
+        Pool_.NumWaiting_.fetch_add(1, std::memory_order_seq_cst);
+        if (Pending_.load(std::memory_order_seq_cst) != 0) {
+            Pool_.Completions_.wait(completions, std::memory_order_acquire);
+        }
+        Pool_.NumWaiting_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+ThreadPool::ThreadPool(int numWorkers, bool pinWorkers) {
+    numWorkers = std::max(numWorkers, 0);
+    for (auto i = 0; i < numWorkers; ++i) {
+        Deques_.push_back(std::make_unique<WorkStealingDeque<Task>>());
+    }
+    const auto cpus = pinWorkers ? AllowedCpus() : std::vector<int>{};
+    Threads_.reserve(numWorkers);
+    for (auto i = 0; i < numWorkers; ++i) {
+        const auto cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+        Threads_.emplace_back([this, i, cpu]() {
+            if (cpu != -1) PinCurrentThread(cpu);
+            WorkerLoop(i);
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() noexcept {
+    Stopping_.store(true, std::memory_order_seq_cst);
+    Epoch_.fetch_add(1, std::memory_order_release);
+    Epoch_.notify_all();
+    Threads_.clear();
+}
+
+auto ThreadPool::Submit(Task& task) -> void {
+    if (tCurrentWorker.Pool == this) {
+        Deques_[tCurrentWorker.Index]->Push(&task);
+    } else {
+        const auto lock = std::scoped_lock{InjectedMutex_};
+        Injected_.push_back(&task);
+        NumInjected_.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Pairs with the fence of a worker going to sleep: either
+    // it sees the task or this sees it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (NumSleeping_.load(std::memory_order_relaxed) > 0) {
+        Epoch_.fetch_add(1, std::memory_order_release);
+        Epoch_.notify_one();
+    }
+}
+
+auto ThreadPool::Run(Task& task) noexcept -> void {
+    // The task and its group may be gone as soon as the group is done
+    auto& group = *task.Group;
+    task.Execute(task);
+    if (group.Pending_.fetch_sub(1, std::memory_order_seq_cst) == 1
+        && NumWaiting_.load(std::memory_order_seq_cst) > 0)
+    {
+        Completions_.fetch_add(1, std::memory_order_release);
+        Completions_.notify_all();
+    }
+}
+
+auto ThreadPool::FindTask(const int self) noexcept -> Task* {
+    if (self != -1) {
+        if (auto* task = Deques_[self]->Pop()) return task;
+    }
+    if (NumInjected_.load(std::memory_order_relaxed) > 0) {
+        const auto lock = std::scoped_lock{InjectedMutex_};
+        if (!Injected_.empty()) {
+            // Workers take the oldest tasks, like thieves. A waiter from
+            // outside the pool takes the newest, which is most likely
+            // its own smallest one, as a worker does with its deque:
+            // taking the oldest would nest all the others on its stack.
+            auto* task = self != -1 ? Injected_.front() : Injected_.back();
+            if (self != -1) {
+                Injected_.pop_front();
+            } else {
+                Injected_.pop_back();
+            }
+            NumInjected_.fetch_sub(1, std::memory_order_relaxed);
+            return task;
+        }
+    }
+    const auto numDeques = Deques_.size();
+    if (numDeques == 0) return nullptr;
+    const auto start = NextRandom() % numDeques;
+    for (auto i = size_t{0}; i < numDeques; ++i) {
+        const auto victim = (start + i) % numDeques;
+        if (int(victim) == self) continue;
+        if (auto* task = Deques_[victim]->Steal()) return task;
+    }
+    return nullptr;
+}
+
+auto ThreadPool::HasWork() const noexcept -> bool {
+    if (NumInjected_.load(std::memory_order_relaxed) > 0) return true;
+    return std::any_of(Deques_.begin(), Deques_.end(), [](const auto& deque) { return !deque->IsEmpty(); });
+}
+
+auto ThreadPool::WorkerLoop(const int index) noexcept -> void {
+    tCurrentWorker = CurrentWorker{.Pool = this, .Index = index};
+    while (!Stopping_.load(std::memory_order_acquire)) {
+        auto* task = FindTask(index);
+        for (auto round = 0; !task && round < kSpinRounds; ++round) {
+            std::this_thread::yield();
+            task = FindTask(index);
+        }
+        if (task) {
+            Run(*task);
+            continue;
+        }
+        // A steal may fail on contention, so what decides
+        // sleeping is whether any queue is non-empty
+        const auto epoch = Epoch_.load(std::memory_order_acquire);
+        NumSleeping_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!HasWork() && !Stopping_.load(std::memory_order_relaxed)) {
+            Epoch_.wait(epoch, std::memory_order_acquire);
+        }
+        NumSleeping_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    tCurrentWorker = CurrentWorker{};
+}
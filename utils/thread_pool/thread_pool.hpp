@@ -0,0 +1,176 @@
+#pragma once
+
+
+#include "work_stealing_deque.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+/* A work-stealing pool, meant to be the one scheduler of a process: the
+ * engine, the batch tools and the server share it instead of each
+ * spawning threads of their own and oversubscribing the cores.
+ *
+ * Each worker owns a Chase-Lev deque: tasks spawned on a worker go to
+ * the bottom of its deque and are run from there, newest first, while
+ * idle workers steal the oldest ones from the top, which for a split
+ * range are the biggest. Tasks spawned from other threads go to a
+ * shared queue. A worker that finds nothing for a while sleeps on a
+ * futex (`std::atomic::wait`) and is woken by the next spawn.
+ *
+ * The pool is fork-join: a thread that waits for its tasks runs tasks
+ * in the meantime, so a waiting thread never idles while there is work
+ * and nested parallelism can't deadlock. Callers add their own thread,
+ * so `n - 1` workers keep `n` cores busy for a single caller, and a pool
+ * without workers runs everything on the waiting threads.
+ */
+class ThreadPool {
+public:
+    class TaskGroup;
+
+    // A task is owned by its spawner and must outlive the `Wait()` of its
+    // group. `Execute` must not throw.
+    struct Task {
+        void (*Execute)(Task& self) noexcept = nullptr;
+        TaskGroup* Group = nullptr;
+    };
+
+    class TaskGroup {
+        friend ThreadPool;
+    private:
+        ThreadPool& Pool_;
+        std::atomic<uint64_t> Pending_ = 0;
+    public:
+        explicit TaskGroup(ThreadPool& pool) noexcept : Pool_(pool) {}
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+        ~TaskGroup() noexcept { Wait(); }
+
+        auto Spawn(Task& task) -> void;
+        // Runs tasks of the pool, of this group or not,
+        // until every task of this group is done
+        auto Wait() noexcept -> void;
+    };
+private:
+    template <class F>
+    struct RangeTask : Task {
+        ThreadPool* Pool;
+        F* Fn;
+        uint64_t Begin;
+        uint64_t End;
+        uint64_t Grain;
+    };
+
+    template <class F>
+    struct IndexTask : Task {
+        F* Fn;
+        int Index;
+    };
+
+    std::vector<std::unique_ptr<WorkStealingDeque<Task>>> Deques_;
+
+    std::mutex InjectedMutex_;
+    std::deque<Task*> Injected_;
+    std::atomic<uint64_t> NumInjected_ = 0;
+
+    // Bumped to wake sleeping workers
+    std::atomic<uint32_t> Epoch_ = 0;
+    std::atomic<int> NumSleeping_ = 0;
+    // Bumped when a group completes, to wake its waiter
+    std::atomic<uint32_t> Completions_ = 0;
+    std::atomic<int> NumWaiting_ = 0;
+    std::atomic<bool> Stopping_ = false;
+
+    // Last, so that the workers are joined before anything is destroyed
+    std::vector<std::jthread> Threads_;
+public:
+    /* Starts `numWorkers` threads. With `pinWorkers`, worker `i` is
+     * bound to the `i`-th CPU the process may run on, which keeps the
+     * caches warm when the pool owns the machine but hurts when it
+     * doesn't.
+     */
+    explicit ThreadPool(int numWorkers, bool pinWorkers = false);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    // Every task group must be done
+    ~ThreadPool() noexcept;
+
+    [[nodiscard]] auto GetNumWorkers() const noexcept -> int { return int(Deques_.size()); }
+    // The threads working on a fork-join of one caller
+    [[nodiscard]] auto GetConcurrency() const noexcept -> int { return GetNumWorkers() + 1; }
+
+    /* Calls `f(chunkBegin, chunkEnd)` on chunks of `[begin, end)` of at
+     * most `grain` items and returns when all are done. The range is
+     * split in halves, and the halves stolen by idle workers are split
+     * again, so the load is balanced whatever the cost of each chunk.
+     * `f` must not throw.
+     */
+    template <class F>
+    auto ParallelFor(uint64_t begin, uint64_t end, uint64_t grain, F&& f) -> void {
+        if (begin < end) SplitRange(f, begin, end, std::max<uint64_t>(grain, 1));
+    }
+
+    /* Calls `f(i)` for each `i` in `[0, numTasks)`, `f(0)` on the calling
+     * thread, and returns when all are done. For jobs with per-thread
+     * state, `numTasks = GetConcurrency()` tasks that pull work from a
+     * shared counter. `f` must not throw.
+     */
+    template <class F>
+    auto ForkJoin(int numTasks, F&& f) -> void {
+        using Fn = std::remove_reference_t<F>;
+        auto tasks = std::vector<IndexTask<Fn>>(std::max(numTasks - 1, 0));
+        auto group = TaskGroup{*this};
+        for (auto i = 1; i < numTasks; ++i) {
+            auto& task = tasks[i - 1];
+            task.Execute = [](Task& self) noexcept {
+                auto& t = static_cast<IndexTask<Fn>&>(self);
+                (*t.Fn)(t.Index);
+            };
+            task.Fn = &f;
+            task.Index = i;
+            group.Spawn(task);
+        }
+        if (numTasks > 0) f(0);
+        group.Wait();
+    }
+private:
+    template <class F>
+    auto SplitRange(F& f, uint64_t begin, uint64_t end, uint64_t grain) -> void {
+        // The upper halves are offered to thieves and
+        // the lowest chunk is run by this thread
+        auto tasks = std::array<RangeTask<F>, 64>{};
+        auto group = TaskGroup{*this};
+        for (auto n = 0; end - begin > grain; ++n) {
+            const auto mid = begin + (end - begin) / 2;
+            auto& task = tasks[n];
+            task.Execute = [](Task& self) noexcept {
+                auto& t = static_cast<RangeTask<F>&>(self);
+                t.Pool->SplitRange(*t.Fn, t.Begin, t.End, t.Grain);
+            };
+            task.Pool = this;
+            task.Fn = &f;
+            task.Begin = mid;
+            task.End = end;
+            task.Grain = grain;
+            group.Spawn(task);
+            end = mid;
+        }
+        f(begin, end);
+        group.Wait();
+    }
+
+    auto Submit(Task& task) -> void;
+    auto Run(Task& task) noexcept -> void;
+    // `self` is the index of the calling worker, or -1
+    auto FindTask(int self) noexcept -> Task*;
+    auto HasWork() const noexcept -> bool;
+    auto WorkerLoop(int index) noexcept -> void;
+};
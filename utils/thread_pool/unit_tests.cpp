@@ -0,0 +1,126 @@
+#include "thread_pool.hpp"
+#include "work_stealing_deque.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+
+namespace {
+// Counts how many times each item was handed out
+struct Visits {
+    std::vector<std::atomic<int>> Counts;
+
+    explicit Visits(size_t size) : Counts(size) {}
+
+    auto AllOnce() const -> bool {
+        return std::all_of(Counts.begin(), Counts.end(), [](const auto& c) { return c.load() == 1; });
+    }
+};
+} // anonymous namespace
+
+
+namespace NTests {
+// Every item pushed comes out exactly once, whether popped by the owner
+// or stolen, also across buffer growth
+auto TestDeque() -> void {
+    static constexpr auto kItems = 200'000;
+    auto items = std::vector<int>(kItems);
+    std::iota(items.begin(), items.end(), 0);
+    auto visits = Visits{kItems};
+    auto deque = WorkStealingDeque<int>{4};
+    auto done = std::atomic<bool>{false};
+    {
+        auto thieves = std::vector<std::jthread>{};
+        for (auto i = 0; i < 3; ++i) {
+            thieves.emplace_back([&]() {
+                while (!done.load()) {
+                    if (auto* item = deque.Steal()) ++visits.Counts[*item];
+                }
+            });
+        }
+        for (auto i = 0; i < kItems; ++i) {
+            deque.Push(&items[i]);
+            if (i % 3 == 0) {
+                if (auto* item = deque.Pop()) ++visits.Counts[*item];
+            }
+        }
+        while (auto* item = deque.Pop()) ++visits.Counts[*item];
+        // Let the thieves finish a steal they started
+        while (!deque.IsEmpty()) std::this_thread::yield();
+        done.store(true);
+    }
+    assert(visits.AllOnce());
+    std::cerr << "TestDeque OK\n";
+}
+
+auto TestParallelFor() -> void {
+    for (const auto workers : {0, 1, 4}) {
+        auto pool = ThreadPool{workers};
+        for (const auto grain : {uint64_t{1}, uint64_t{7}, uint64_t{1000}}) {
+            auto visits = Visits{10'000};
+            pool.ParallelFor(100, 10'000, grain, [&](uint64_t begin, uint64_t end) {
+                assert(end - begin <= grain);
+                for (auto i = begin; i < end; ++i) ++visits.Counts[i];
+            });
+            for (auto i = 0; i < 100; ++i) ++visits.Counts[i];
+            assert(visits.AllOnce());
+        }
+        pool.ParallelFor(5, 5, 1, [](uint64_t, uint64_t) { assert(false); });
+    }
+    std::cerr << "TestParallelFor OK\n";
+}
+
+// Fork-joins inside tasks, and several threads outside the pool
+// using it at once, as the server and batch jobs do
+auto TestNestedAndShared() -> void {
+    auto pool = ThreadPool{3};
+    auto total = std::atomic<uint64_t>{0};
+    {
+        auto callers = std::vector<std::jthread>{};
+        for (auto c = 0; c < 4; ++c) {
+            callers.emplace_back([&]() {
+                pool.ForkJoin(pool.GetConcurrency(), [&](int) {
+                    pool.ParallelFor(0, 1000, 10, [&](uint64_t begin, uint64_t end) {
+                        pool.ParallelFor(begin, end, 1, [&](uint64_t b, uint64_t e) {
+                            total.fetch_add(e - b);
+                        });
+                    });
+                });
+            });
+        }
+    }
+    assert(total.load() == uint64_t{4} * 4 * 1000);
+    std::cerr << "TestNestedAndShared OK\n";
+}
+
+// Workers that went to sleep wake up for new work
+auto TestSleepAndWake() -> void {
+    auto pool = ThreadPool{4, /* pinWorkers */ true};
+    for (auto round = 0; round < 5; ++round) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{20});
+        auto visits = Visits{64};
+        pool.ParallelFor(0, 64, 1, [&](uint64_t begin, uint64_t) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+            ++visits.Counts[begin];
+        });
+        assert(visits.AllOnce());
+    }
+    std::cerr << "TestSleepAndWake OK\n";
+}
+} // namespace NTests
+
+
+auto main() -> int {
+    using namespace NTests;
+    TestDeque();
+    TestParallelFor();
+    TestNestedAndShared();
+    TestSleepAndWake();
+    std::cerr << "All tests passed.\n";
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+/* The Chase-Lev deque, with the memory orderings of Lê et al., "Correct
+ * and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013).
+ *
+ * The owner thread pushes and pops at the bottom without any
+ * read-modify-write unless one item is left; any thread may steal the
+ * oldest item at the top. The buffer grows when full, and replaced
+ * buffers are kept until destruction since a thief may still read them.
+ */
+template <class T>
+class WorkStealingDeque {
+private:
+    struct Buffer {
+        int64_t Capacity;
+        std::unique_ptr<std::atomic<T*>[]> Slots;
+
+        explicit Buffer(int64_t capacity)
+            : Capacity(capacity)
+            , Slots(std::make_unique<std::atomic<T*>[]>(capacity))
+        {
+        }
+
+        auto Get(int64_t i) const noexcept -> T* {
+            return Slots[i & (Capacity - 1)].load(std::memory_order_relaxed);
+        }
+        auto Put(int64_t i, T* item) noexcept -> void {
+            Slots[i & (Capacity - 1)].store(item, std::memory_order_relaxed);
+        }
+    };
+
+    static constexpr auto kCacheLine = 64;
+
+    alignas(kCacheLine) std::atomic<int64_t> Top_ = 0;
+    alignas(kCacheLine) std::atomic<int64_t> Bottom_ = 0;
+    std::atomic<Buffer*> Buffer_;
+    // Owned by the owner thread
+    std::vector<std::unique_ptr<Buffer>> Buffers_;
+public:
+    // `capacity` must be a power of two
+    explicit WorkStealingDeque(int64_t capacity = 256) {
+        Buffers_.push_back(std::make_unique<Buffer>(capacity));
+        Buffer_.store(Buffers_.back().get(), std::memory_order_relaxed);
+    }
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // Owner only
+    auto Push(T* item) -> void {
+        const auto b = Bottom_.load(std::memory_order_relaxed);
+        const auto t = Top_.load(std::memory_order_acquire);
+        auto* buffer = Buffer_.load(std::memory_order_relaxed);
+        if (b - t > buffer->Capacity - 1) {
+            auto grown = std::make_unique<Buffer>(buffer->Capacity * 2);
+            for (auto i = t; i < b; ++i) grown->Put(i, buffer->Get(i));
+            buffer = grown.get();
+            Buffers_.push_back(std::move(grown));
+            Buffer_.store(buffer, std::memory_order_release);
+        }
+        buffer->Put(b, item);
+        // A release store rather than the paper's release fence and
+        // relaxed store: the same on x86, and understood by sanitizers
+        Bottom_.store(b + 1, std::memory_order_release);
+    }
+
+    // Owner only: the newest item, or nullptr if empty
+    auto Pop() noexcept -> T* {
+        const auto b = Bottom_.load(std::memory_order_relaxed) - 1;
+        auto* buffer = Buffer_.load(std::memory_order_relaxed);
+        Bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t = Top_.load(std::memory_order_relaxed);
+        if (t > b) {
+            Bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        auto* item = buffer->Get(b);
+        if (t == b) {
+            // The last item: race the thieves for it
+            if (!Top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            Bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Any thread: the oldest item, or nullptr if empty or lost to a
+    // concurrent pop or steal
+    auto Steal() noexcept -> T* {
+        auto t = Top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const auto b = Bottom_.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+        auto* item = Buffer_.load(std::memory_order_acquire)->Get(t);
+        if (!Top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    // A snapshot, exact only when the deque is quiescent
+    auto IsEmpty() const noexcept -> bool {
+        return Bottom_.load(std::memory_order_relaxed) <= Top_.load(std::memory_order_relaxed);
+    }
+};
@@ -0,0 +1,109 @@
+#include "clock.hpp"
+
+#include <fstream>
+#include <string>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+
+namespace {
+    using namespace std::chrono;
+
+    // `ns = BaseNs + ((tsc - BaseTsc) * NsPerTick) >> 32`
+    struct TscCalibration {
+        bool Enabled = false;
+        uint64_t BaseTsc = 0;
+        int64_t BaseNs = 0;
+        uint64_t NsPerTick = 0;
+    };
+
+    auto SteadyNs() noexcept -> int64_t {
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+#if defined(__x86_64__)
+    auto HasInvariantTsc() noexcept -> bool {
+        auto eax = 0u, ebx = 0u, ecx = 0u, edx = 0u;
+        if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+        return edx & (1u << 8);
+    }
+
+    // The kernel falls back from the TSC when it finds it unstable or
+    // unsynchronized between cores, as it often is in virtual machines
+    auto IsKernelClocksourceTsc() noexcept -> bool {
+        try {
+            auto in = std::ifstream{"/sys/devices/system/clocksource/clocksource0/current_clocksource"};
+            auto name = std::string{};
+            return std::getline(in, name) && name == "tsc";
+        } catch (...) {
+            return false;
+        }
+    }
+
+    // A steady clock reading and the TSC at about the same moment: the
+    // middle of the tightest of a few TSC windows around the reading
+    auto ReadPair(uint64_t& tsc, int64_t& ns) noexcept -> void {
+        auto bestWindow = UINT64_MAX;
+        for (auto i = 0; i < 8; ++i) {
+            const auto before = __rdtsc();
+            const auto sample = SteadyNs();
+            const auto after = __rdtsc();
+            if (after - before < bestWindow) {
+                bestWindow = after - before;
+                tsc = before + (after - before) / 2;
+                ns = sample;
+            }
+        }
+    }
+
+    auto Calibrate() noexcept -> TscCalibration {
+        static constexpr auto kCalibrationTime = int64_t{10'000'000};
+        if (!HasInvariantTsc() || !IsKernelClocksourceTsc()) return {};
+        auto startTsc = uint64_t{0}, endTsc = uint64_t{0};
+        auto startNs = int64_t{0}, endNs = int64_t{0};
+        ReadPair(startTsc, startNs);
+        // Spinning rather than sleeping, so that the clock frequency of
+        // the core doesn't matter either way
+        while (SteadyNs() - startNs < kCalibrationTime) {}
+        ReadPair(endTsc, endNs);
+        if (endTsc <= startTsc) return {};
+        const auto nsPerTick = (static_cast<unsigned __int128>(endNs - startNs) << 32) / (endTsc - startTsc);
+        return TscCalibration{
+            .Enabled = true,
+            .BaseTsc = endTsc,
+            .BaseNs = endNs,
+            .NsPerTick = uint64_t(nsPerTick),
+        };
+    }
+#else
+    auto Calibrate() noexcept -> TscCalibration {
+        return {};
+    }
+#endif
+
+    auto GetCalibration() noexcept -> const TscCalibration& {
+        static const auto calibration = Calibrate();
+        return calibration;
+    }
+} // anonymous namespace
+
+
+auto MonotonicClock::now() noexcept -> time_point {
+#if defined(__x86_64__)
+    if (const auto& calibration = GetCalibration(); calibration.Enabled) {
+        // Reads before the base, from other cores, are clamped to it
+        const auto tsc = __rdtsc();
+        const auto ticks = tsc > calibration.BaseTsc ? tsc - calibration.BaseTsc : 0;
+        const auto ns = static_cast<unsigned __int128>(ticks) * calibration.NsPerTick >> 32;
+        return time_point{duration{calibration.BaseNs + int64_t(ns)}};
+    }
+#endif
+    return time_point{duration{SteadyNs()}};
+}
+
+auto MonotonicClock::IsTscBased() noexcept -> bool {
+    return GetCalibration().Enabled;
+}
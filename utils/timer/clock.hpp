@@ -0,0 +1,52 @@
+#pragma once
+
+
+#include <chrono>
+#include <cstdint>
+
+
+/* A steady clock in nanoseconds that reads the TSC where that is safe:
+ * the CPU reports an invariant TSC and the kernel itself uses the TSC as
+ * its clocksource, so it is synchronized across cores. The TSC is then
+ * calibrated against `steady_clock` once, on first use, which takes
+ * about 10ms; `now()` is then a `rdtsc` and a multiplication instead of
+ * a vDSO call. Elsewhere it is `steady_clock`. Either way its epoch is
+ * unspecified, so its time points are only comparable with each other.
+ */
+class MonotonicClock {
+public:
+    using rep = int64_t;
+    using period = std::nano;
+    using duration = std::chrono::nanoseconds;
+    using time_point = std::chrono::time_point<MonotonicClock>;
+    static constexpr bool is_steady = true;
+
+    static auto now() noexcept -> time_point;
+    // Whether `now()` reads the TSC
+    static auto IsTscBased() noexcept -> bool;
+};
+
+
+/* `MonotonicClock` read once per iteration of an event loop: the loop
+ * calls `Refresh()` after each wait, and everything it then runs reads
+ * `now()`, a thread-local load, for its timeouts and timestamps. Per
+ * thread; the epoch until the thread's first `Refresh()`.
+ */
+class CoarseClock {
+public:
+    using rep = MonotonicClock::rep;
+    using period = MonotonicClock::period;
+    using duration = MonotonicClock::duration;
+    using time_point = MonotonicClock::time_point;
+    static constexpr bool is_steady = true;
+private:
+    static inline thread_local time_point Now_{};
+public:
+    static auto now() noexcept -> time_point {
+        return Now_;
+    }
+
+    static auto Refresh() noexcept -> time_point {
+        return Now_ = MonotonicClock::now();
+    }
+};
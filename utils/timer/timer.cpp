@@ -1,22 +1,29 @@
 #include "timer.hpp"
 
+#include <algorithm>
+#include <climits>
+
 
 namespace {
     using namespace std::chrono;
 }
 
-Timer::Timer(const milliseconds timeout) noexcept
+Timer::Timer(const nanoseconds timeout) noexcept
     : StartTime(Clock::now())
     , Timeout(timeout)
 {
 }
 
-auto Timer::CalcElapsedTime() const -> milliseconds {
-    const auto curTime = Clock::now();
-    return duration_cast<milliseconds>(curTime - StartTime);
+auto Timer::CalcElapsedTime() const noexcept -> nanoseconds {
+    return Clock::now() - StartTime;
 }
 
-auto Timer::CalcRemainingTime() const -> milliseconds {
+auto Timer::CalcRemainingTime() const noexcept -> nanoseconds {
     const auto timeElapsed = CalcElapsedTime();
-    return Timeout < timeElapsed ? milliseconds{0} : Timeout - timeElapsed;
+    return Timeout < timeElapsed ? nanoseconds{0} : Timeout - timeElapsed;
+}
+
+auto Timer::CalcRemainingPollTimeout() const noexcept -> int {
+    const auto remaining = ceil<milliseconds>(CalcRemainingTime());
+    return int(std::min<milliseconds::rep>(remaining.count(), INT_MAX));
 }
@@ -1,16 +1,21 @@
 #pragma once
 
+#include "clock.hpp"
+
 #include <chrono>
 
 
 class Timer {
 public:
-    using Clock = std::chrono::steady_clock;
+    using Clock = MonotonicClock;
 private:
-    decltype(Clock::now()) StartTime;
-    std::chrono::milliseconds Timeout;
+    Clock::time_point StartTime;
+    std::chrono::nanoseconds Timeout;
 public:
-    explicit Timer(std::chrono::milliseconds timeout) noexcept;
-    auto CalcElapsedTime() const -> std::chrono::milliseconds;
-    auto CalcRemainingTime() const -> std::chrono::milliseconds;
+    explicit Timer(std::chrono::nanoseconds timeout) noexcept;
+    auto CalcElapsedTime() const noexcept -> std::chrono::nanoseconds;
+    auto CalcRemainingTime() const noexcept -> std::chrono::nanoseconds;
+    // The remaining time rounded up to whole milliseconds,
+    // so that a `poll()` with it doesn't time out early
+    auto CalcRemainingPollTimeout() const noexcept -> int;
 };
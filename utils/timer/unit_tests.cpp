@@ -0,0 +1,75 @@
+#include "clock.hpp"
+#include "timer.hpp"
+
+#include <cassert>
+#include <climits>
+#include <iostream>
+#include <thread>
+
+
+namespace NTests {
+using namespace std::chrono;
+
+auto TestMonotonicClock() -> void {
+    auto last = MonotonicClock::now();
+    for (auto i = 0; i < 1'000'000; ++i) {
+        const auto now = MonotonicClock::now();
+        assert(now >= last);
+        last = now;
+    }
+
+    // Runs at the rate of `steady_clock`
+    const auto steadyStart = steady_clock::now();
+    const auto start = MonotonicClock::now();
+    std::this_thread::sleep_for(milliseconds{100});
+    const auto elapsed = duration_cast<nanoseconds>(MonotonicClock::now() - start);
+    const auto steadyElapsed = duration_cast<nanoseconds>(steady_clock::now() - steadyStart);
+    assert(elapsed <= steadyElapsed && elapsed >= steadyElapsed * 99 / 100);
+
+    // The cost of a reading, for the record
+    const auto benchStart = steady_clock::now();
+    auto sum = int64_t{0};
+    for (auto i = 0; i < 10'000'000; ++i) sum += MonotonicClock::now().time_since_epoch().count() & 1;
+    const auto perCall = duration_cast<nanoseconds>(steady_clock::now() - benchStart) / 10'000'000.0;
+    std::cerr << "MonotonicClock::now(): " << (MonotonicClock::IsTscBased() ? "TSC" : "steady_clock")
+              << ", " << perCall.count() << "ns per call" << (sum < 0 ? "\n" : "") << "\n";
+    std::cerr << "TestMonotonicClock OK\n";
+}
+
+auto TestCoarseClock() -> void {
+    const auto before = MonotonicClock::now();
+    const auto refreshed = CoarseClock::Refresh();
+    assert(refreshed >= before && CoarseClock::now() == refreshed);
+    std::this_thread::sleep_for(milliseconds{5});
+    assert(CoarseClock::now() == refreshed);
+    assert(CoarseClock::Refresh() - refreshed >= milliseconds{5});
+
+    // Per thread
+    auto other = CoarseClock::time_point{};
+    std::thread{[&other]() { other = CoarseClock::now(); }}.join();
+    assert(other == CoarseClock::time_point{});
+    std::cerr << "TestCoarseClock OK\n";
+}
+
+auto TestTimer() -> void {
+    const auto timer = Timer{microseconds{1500}};
+    // Rounded up, so that `poll()` doesn't return before the timeout
+    assert(timer.CalcRemainingPollTimeout() == 2);
+    assert(timer.CalcRemainingTime() <= microseconds{1500});
+    std::this_thread::sleep_for(milliseconds{2});
+    assert(timer.CalcRemainingTime() == nanoseconds{0} && timer.CalcRemainingPollTimeout() == 0);
+    assert(timer.CalcElapsedTime() >= milliseconds{2});
+
+    assert(Timer{hours{24 * 365}}.CalcRemainingPollTimeout() == INT_MAX);
+    std::cerr << "TestTimer OK\n";
+}
+} // namespace NTests
+
+
+auto main() -> int {
+    using namespace NTests;
+    TestMonotonicClock();
+    TestCoarseClock();
+    TestTimer();
+    std::cerr << "All tests passed.\n";
+}
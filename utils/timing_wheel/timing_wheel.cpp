@@ -0,0 +1,167 @@
+#include "timing_wheel.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <utility>
+
+
+TimingWheel::TimingWheel(const Clock::time_point start, const Clock::duration tick) noexcept
+    : Start_(start)
+    , Tick_(std::max(tick, Clock::duration{1}))
+{
+    Heads_.fill(kNil);
+}
+
+auto TimingWheel::Reserve(const size_t numTimers) -> void {
+    Nodes_.reserve(numTimers);
+}
+
+auto TimingWheel::Schedule(const Clock::time_point deadline, const uint64_t userData) -> TimerId {
+    if (Heads_[kFreeList] == kNil) {
+        Nodes_.push_back(Node{
+            .Deadline = 0,
+            .UserData = 0,
+            .Prev = kNil,
+            .Next = kNil,
+            .Generation = 0,
+            .List = kFreeList,
+        });
+        Link(uint32_t(Nodes_.size() - 1), kFreeList);
+    }
+    const auto index = Heads_[kFreeList];
+    Unlink(index);
+    auto& node = Nodes_[index];
+    // Due now or overdue: the next tick
+    node.Deadline = std::max(CeilTick(deadline), CurrentTick_ + 1);
+    node.UserData = userData;
+    Place(index);
+    ++NumTimers_;
+    return TimerId{index, node.Generation};
+}
+
+auto TimingWheel::Cancel(const TimerId id) noexcept -> bool {
+    if (!IsPending(id)) return false;
+    Release(id.Index);
+    return true;
+}
+
+auto TimingWheel::Reschedule(const TimerId id, const Clock::time_point deadline) noexcept -> bool {
+    if (!IsPending(id)) return false;
+    Unlink(id.Index);
+    Nodes_[id.Index].Deadline = std::max(CeilTick(deadline), CurrentTick_ + 1);
+    Place(id.Index);
+    return true;
+}
+
+auto TimingWheel::CalcWaitTimeout(const Clock::time_point now) const noexcept -> std::optional<std::chrono::milliseconds> {
+    static constexpr auto kMaxTimeout = std::chrono::milliseconds{INT_MAX};
+    const auto tick = NextEventTick();
+    if (!tick) return std::nullopt;
+    if (*tick - CurrentTick_ > uint64_t(kMaxTimeout / Tick_) + 1) return kMaxTimeout;
+    const auto wakeUp = Start_ + Tick_ * int64_t(*tick);
+    if (wakeUp <= now) return std::chrono::milliseconds{0};
+    return std::min(std::chrono::ceil<std::chrono::milliseconds>(wakeUp - now), kMaxTimeout);
+}
+
+auto TimingWheel::FloorTick(const Clock::time_point t) const noexcept -> uint64_t {
+    return t <= Start_ ? 0 : uint64_t((t - Start_) / Tick_);
+}
+
+auto TimingWheel::CeilTick(const Clock::time_point t) const noexcept -> uint64_t {
+    if (t <= Start_) return 0;
+    const auto elapsed = t - Start_;
+    return uint64_t(elapsed / Tick_) + (elapsed % Tick_ != Clock::duration{0});
+}
+
+auto TimingWheel::NextEventTick() const noexcept -> std::optional<uint64_t> {
+    // Every timer of level `L` is in a slot after the current one, and
+    // is cascaded when the current tick reaches the start of its slot
+    auto next = std::optional<uint64_t>{};
+    for (auto level = 0; level < kNumLevels; ++level) {
+        const auto shift = kSlotBits * level;
+        const auto current = (CurrentTick_ >> shift) & (kNumSlots - 1);
+        const auto ahead = current == kNumSlots - 1 ? 0 : Occupied_[level] >> (current + 1) << (current + 1);
+        if (ahead == 0) continue;
+        const auto slot = uint64_t(std::countr_zero(ahead));
+        const auto levelSpan = uint64_t{1} << (shift + kSlotBits);
+        const auto tick = (CurrentTick_ & ~(levelSpan - 1)) | (slot << shift);
+        if (!next || tick < *next) next = tick;
+    }
+    if (!next && Heads_[kOverflowList] != kNil) {
+        const auto wheelSpan = uint64_t{1} << (kSlotBits * kNumLevels);
+        next = (CurrentTick_ & ~(wheelSpan - 1)) + wheelSpan;
+    }
+    return next;
+}
+
+auto TimingWheel::Link(const uint32_t index, const uint16_t list) noexcept -> void {
+    auto& node = Nodes_[index];
+    node.List = list;
+    node.Prev = kNil;
+    node.Next = Heads_[list];
+    if (node.Next != kNil) Nodes_[node.Next].Prev = index;
+    Heads_[list] = index;
+    if (list < kOverflowList) Occupied_[list / kNumSlots] |= uint64_t{1} << (list % kNumSlots);
+}
+
+auto TimingWheel::Unlink(const uint32_t index) noexcept -> void {
+    auto& node = Nodes_[index];
+    if (node.Prev != kNil) {
+        Nodes_[node.Prev].Next = node.Next;
+    } else {
+        Heads_[node.List] = node.Next;
+        if (node.Next == kNil && node.List < kOverflowList) {
+            Occupied_[node.List / kNumSlots] &= ~(uint64_t{1} << (node.List % kNumSlots));
+        }
+    }
+    if (node.Next != kNil) Nodes_[node.Next].Prev = node.Prev;
+}
+
+auto TimingWheel::Place(const uint32_t index) noexcept -> void {
+    // The highest group of slot bits where the deadline and the current
+    // tick differ; a deadline at the current tick goes to the current
+    // slot of level 0, which `Advance()` fires next
+    const auto deadline = Nodes_[index].Deadline;
+    const auto diff = deadline ^ CurrentTick_;
+    const auto level = diff == 0 ? 0 : (std::bit_width(diff) - 1) / kSlotBits;
+    if (level >= kNumLevels) {
+        Link(index, kOverflowList);
+        return;
+    }
+    const auto slot = (deadline >> (kSlotBits * level)) & (kNumSlots - 1);
+    Link(index, uint16_t(level * kNumSlots + slot));
+}
+
+auto TimingWheel::Release(const uint32_t index) noexcept -> void {
+    Unlink(index);
+    ++Nodes_[index].Generation;
+    Link(index, kFreeList);
+    --NumTimers_;
+}
+
+auto TimingWheel::CascadeCurrentSlots() noexcept -> void {
+    // From the top, so that timers cascaded from a level land below
+    // the slots of the lower levels that are cascaded next
+    auto cascade = [this](const uint16_t list) {
+        // Detached first, as timers may be placed back in the same list
+        auto index = std::exchange(Heads_[list], kNil);
+        if (list < kOverflowList) Occupied_[list / kNumSlots] &= ~(uint64_t{1} << (list % kNumSlots));
+        while (index != kNil) {
+            const auto next = Nodes_[index].Next;
+            Place(index);
+            index = next;
+        }
+    };
+    if ((CurrentTick_ & ((uint64_t{1} << (kSlotBits * kNumLevels)) - 1)) == 0) cascade(kOverflowList);
+    for (auto level = kNumLevels - 1; level > 0; --level) {
+        const auto shift = kSlotBits * level;
+        if (CurrentTick_ & ((uint64_t{1} << shift) - 1)) continue;
+        cascade(uint16_t(level * kNumSlots + ((CurrentTick_ >> shift) & (kNumSlots - 1))));
+    }
+}
+
+auto TimingWheel::IsPending(const TimerId id) const noexcept -> bool {
+    return id.Index < Nodes_.size()
+        && Nodes_[id.Index].Generation == id.Generation
+        && Nodes_[id.Index].List != kFreeList;
+}
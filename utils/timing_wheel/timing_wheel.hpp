@@ -0,0 +1,129 @@
+#pragma once
+
+
+#include "../timer/clock.hpp"
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+
+/* A hierarchical timing wheel (Varghese and Lauck) for the many timeouts
+ * of an event loop: idle connections, join deadlines, clock ticks.
+ *
+ * Time is counted in ticks since the wheel's start. Level `L` has 64
+ * slots of `64^L` ticks each; a timer goes to the lowest level whose
+ * slot span separates its deadline from the current tick, and is moved
+ * down a level when the current tick enters its slot, so each timer is
+ * touched at most once per level. Timers are nodes of intrusive lists
+ * in one array, so scheduling and cancelling are O(1) and allocate only
+ * when the array grows. A bitmap of non-empty slots per level finds the
+ * next tick with something to do, so `Advance()` skips idle ticks and
+ * `CalcWaitTimeout()` gives the timeout of the event loop's wait.
+ *
+ * A timer never fires early, and fires at the first `Advance()` that
+ * reaches the tick of its deadline, rounded up; one scheduled in the past
+ * fires at the next tick. Not thread-safe: owned by one event loop.
+ */
+class TimingWheel {
+public:
+    using Clock = MonotonicClock;
+
+    // Stays valid, and unique, until the timer fires or is cancelled
+    struct TimerId {
+        uint32_t Index;
+        uint32_t Generation;
+
+        auto operator==(const TimerId&) const noexcept -> bool = default;
+    };
+private:
+    static constexpr auto kSlotBits = 6;
+    static constexpr auto kNumSlots = 1 << kSlotBits;
+    // The wheel spans about 2 years with 1ms ticks
+    static constexpr auto kNumLevels = 6;
+    static constexpr auto kNil = UINT32_MAX;
+    // After the lists of the slots: timers past the span of the wheel,
+    // placed again each time the current tick wraps around it, and free nodes
+    static constexpr auto kOverflowList = uint16_t{kNumLevels * kNumSlots};
+    static constexpr auto kFreeList = uint16_t{kOverflowList + 1};
+
+    struct Node {
+        uint64_t Deadline;
+        uint64_t UserData;
+        uint32_t Prev;
+        uint32_t Next;
+        uint32_t Generation;
+        uint16_t List;
+    };
+
+    Clock::time_point Start_;
+    Clock::duration Tick_;
+    uint64_t CurrentTick_ = 0;
+    std::vector<Node> Nodes_;
+    std::array<uint32_t, kFreeList + 1> Heads_;
+    std::array<uint64_t, kNumLevels> Occupied_ = {};
+    size_t NumTimers_ = 0;
+public:
+    explicit TimingWheel(Clock::time_point start, Clock::duration tick = std::chrono::milliseconds{1}) noexcept;
+
+    // Makes room for `numTimers` timers, so that scheduling doesn't allocate
+    auto Reserve(size_t numTimers) -> void;
+
+    // `userData` is passed back when the timer fires
+    auto Schedule(Clock::time_point deadline, uint64_t userData) -> TimerId;
+    // False if the timer already fired or was cancelled
+    auto Cancel(TimerId id) noexcept -> bool;
+    // Moves the deadline of a pending timer, keeping its id; false if
+    // the timer already fired or was cancelled
+    auto Reschedule(TimerId id, Clock::time_point deadline) noexcept -> bool;
+
+    /* Fires every timer due at `now`, calling `onExpire(TimerId, userData)`
+     * in deadline order at tick granularity, and returns how many fired.
+     * `onExpire` may schedule and cancel timers, including ones due at
+     * the same tick.
+     */
+    template <class OnExpire>
+    auto Advance(Clock::time_point now, OnExpire&& onExpire) -> size_t {
+        const auto nowTick = FloorTick(now);
+        auto numFired = size_t{0};
+        for (auto tick = NextEventTick(); tick && *tick <= nowTick; tick = NextEventTick()) {
+            CurrentTick_ = *tick;
+            CascadeCurrentSlots();
+            const auto list = uint16_t(CurrentTick_ & (kNumSlots - 1));
+            while (Heads_[list] != kNil) {
+                const auto index = Heads_[list];
+                const auto id = TimerId{index, Nodes_[index].Generation};
+                const auto userData = Nodes_[index].UserData;
+                Release(index);
+                ++numFired;
+                onExpire(id, userData);
+            }
+        }
+        CurrentTick_ = std::max(CurrentTick_, nowTick);
+        return numFired;
+    }
+
+    /* The timeout for `poll()`/`epoll_wait()` so that the loop wakes up
+     * for the next `Advance()` with work, rounded up to whole
+     * milliseconds and at most `INT_MAX`; nothing if there is no timer.
+     */
+    [[nodiscard]] auto CalcWaitTimeout(Clock::time_point now) const noexcept -> std::optional<std::chrono::milliseconds>;
+
+    [[nodiscard]] auto GetNumTimers() const noexcept -> size_t { return NumTimers_; }
+private:
+    [[nodiscard]] auto FloorTick(Clock::time_point t) const noexcept -> uint64_t;
+    [[nodiscard]] auto CeilTick(Clock::time_point t) const noexcept -> uint64_t;
+    [[nodiscard]] auto NextEventTick() const noexcept -> std::optional<uint64_t>;
+
+    auto Link(uint32_t index, uint16_t list) noexcept -> void;
+    auto Unlink(uint32_t index) noexcept -> void;
+    // Puts a linked-out node into the slot for its deadline, which
+    // mustn't be before the current tick
+    auto Place(uint32_t index) noexcept -> void;
+    auto Release(uint32_t index) noexcept -> void;
+    auto CascadeCurrentSlots() noexcept -> void;
+    [[nodiscard]] auto IsPending(TimerId id) const noexcept -> bool;
+};
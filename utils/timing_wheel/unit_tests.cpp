@@ -0,0 +1,169 @@
+#include "timing_wheel.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+
+namespace {
+using Clock = TimingWheel::Clock;
+using std::chrono::milliseconds;
+
+const auto kStart = Clock::time_point{} + std::chrono::hours{1};
+
+auto At(uint64_t ms) -> Clock::time_point {
+    return kStart + milliseconds{ms};
+}
+} // anonymous namespace
+
+
+namespace NTests {
+auto TestBasic() -> void {
+    auto wheel = TimingWheel{kStart};
+    assert(!wheel.CalcWaitTimeout(kStart));
+
+    const auto a = wheel.Schedule(At(5), 1);
+    const auto b = wheel.Schedule(At(3) + std::chrono::microseconds{1}, 2);
+    assert(wheel.GetNumTimers() == 2 && !(a == b));
+    assert(wheel.CalcWaitTimeout(kStart) == milliseconds{4});
+
+    auto fired = std::vector<uint64_t>{};
+    auto onExpire = [&](TimingWheel::TimerId, uint64_t userData) { fired.push_back(userData); };
+    // Never early: the deadline of `b` is rounded up to 4ms
+    assert(wheel.Advance(At(3), onExpire) == 0);
+    assert(wheel.Advance(At(4), onExpire) == 1 && fired == std::vector<uint64_t>{2});
+    assert(wheel.CalcWaitTimeout(At(4)) == milliseconds{1});
+    // Late wake-ups see a zero timeout
+    assert(wheel.CalcWaitTimeout(At(9)) == milliseconds{0});
+    assert(wheel.Advance(At(9), onExpire) == 1 && fired.back() == 1);
+    assert(wheel.GetNumTimers() == 0 && !wheel.CalcWaitTimeout(At(9)));
+
+    // Fired and cancelled ids are stale, even when their node is reused
+    assert(!wheel.Cancel(a) && !wheel.Reschedule(b, At(20)));
+    const auto c = wheel.Schedule(At(15), 3);
+    assert(!wheel.Cancel(a) && !wheel.Cancel(b));
+    assert(wheel.Reschedule(c, At(30)) && wheel.Advance(At(29), onExpire) == 0);
+    assert(wheel.Cancel(c) && !wheel.Cancel(c) && wheel.GetNumTimers() == 0);
+    assert(wheel.Advance(At(100), onExpire) == 0);
+
+    // Overdue timers fire at the next tick
+    wheel.Schedule(At(50), 4);
+    assert(wheel.CalcWaitTimeout(At(100)) == milliseconds{1});
+    assert(wheel.Advance(At(100), onExpire) == 0 && wheel.Advance(At(101), onExpire) == 1);
+    std::cerr << "TestBasic OK\n";
+}
+
+auto TestCoarseTick() -> void {
+    auto wheel = TimingWheel{kStart, std::chrono::seconds{1}};
+    wheel.Schedule(At(1500), 0);
+    // The wake-up is at the tick of the rounded-up deadline
+    assert(wheel.CalcWaitTimeout(At(200)) == milliseconds{1800});
+    auto count = size_t{0};
+    auto onExpire = [&](TimingWheel::TimerId, uint64_t) { ++count; };
+    assert(wheel.Advance(At(1999), onExpire) == 0 && wheel.Advance(At(2000), onExpire) == 1);
+
+    // Far timers don't overflow the timeout
+    wheel.Schedule(Clock::time_point::max(), 0);
+    assert(wheel.CalcWaitTimeout(At(2000)) == milliseconds{INT_MAX});
+    std::cerr << "TestCoarseTick OK\n";
+}
+
+// Expiry callbacks cancel and schedule timers, also ones due at the same tick
+auto TestReentrancy() -> void {
+    auto wheel = TimingWheel{kStart};
+    auto ids = std::vector<TimingWheel::TimerId>{};
+    for (auto i = 0; i < 4; ++i) ids.push_back(wheel.Schedule(At(10), uint64_t(i)));
+    auto fired = std::vector<uint64_t>{};
+    auto onExpire = [&](TimingWheel::TimerId id, uint64_t userData) {
+        fired.push_back(userData);
+        assert(!wheel.Cancel(id));
+        if (userData < 4) {
+            // Cancels the others due now, and replaces them
+            for (const auto other : ids) wheel.Cancel(other);
+            wheel.Schedule(At(0), 100 + userData);
+            wheel.Schedule(At(64 * 64), 200 + userData);
+        }
+    };
+    assert(wheel.Advance(At(10), onExpire) == 1 && fired.size() == 1);
+    assert(wheel.Advance(At(11), onExpire) == 1 && fired.back() == 100 + fired.front());
+    assert(wheel.Advance(At(64 * 64 - 1), onExpire) == 0);
+    assert(wheel.Advance(At(64 * 64), onExpire) == 1 && fired.back() == 200 + fired.front());
+    assert(wheel.GetNumTimers() == 0);
+    std::cerr << "TestReentrancy OK\n";
+}
+
+// Against a sorted map, with deadlines and jumps of every magnitude, up
+// to past the span of the wheel
+auto TestRandomized() -> void {
+    auto rng = std::mt19937_64{42};
+    auto wheel = TimingWheel{kStart};
+    struct Pending {
+        TimingWheel::TimerId Id;
+        uint64_t Deadline;
+    };
+    auto pending = std::map<uint64_t, Pending>{};
+    auto now = uint64_t{0};
+    auto nextUserData = uint64_t{0};
+    // Up to 4 times the span of the wheel, 2^36 ticks
+    auto randomDelay = [&]() {
+        const auto bits = std::uniform_int_distribution<int>{0, 38}(rng);
+        return rng() & ((uint64_t{1} << bits) - 1);
+    };
+    auto numFired = size_t{0};
+    for (auto round = 0; round < 20'000; ++round) {
+        const auto action = rng() % 8;
+        if (action < 4) {
+            const auto deadline = now + randomDelay();
+            const auto userData = nextUserData++;
+            const auto id = wheel.Schedule(At(deadline), userData);
+            pending.emplace(userData, Pending{id, std::max(deadline, now + 1)});
+        } else if (action == 4 && !pending.empty()) {
+            const auto it = std::next(pending.begin(), ptrdiff_t(rng() % pending.size()));
+            assert(wheel.Cancel(it->second.Id) && !wheel.Cancel(it->second.Id));
+            pending.erase(it);
+        } else if (action == 5 && !pending.empty()) {
+            const auto it = std::next(pending.begin(), ptrdiff_t(rng() % pending.size()));
+            const auto deadline = now + randomDelay();
+            assert(wheel.Reschedule(it->second.Id, At(deadline)));
+            it->second.Deadline = std::max(deadline, now + 1);
+        } else {
+            auto earliest = UINT64_MAX;
+            for (const auto& [_, p] : pending) earliest = std::min(earliest, p.Deadline);
+            const auto timeout = wheel.CalcWaitTimeout(At(now));
+            assert(timeout.has_value() == !pending.empty());
+            // Never sleeps past a deadline
+            if (timeout) assert(now + uint64_t(timeout->count()) <= earliest);
+
+            // Mostly short jumps, so that most timers fire on time
+            now += action == 6 ? randomDelay() >> 8 : (timeout ? uint64_t(timeout->count()) : 1);
+            auto lastDeadline = uint64_t{0};
+            const auto count = wheel.Advance(At(now), [&](TimingWheel::TimerId id, uint64_t userData) {
+                const auto it = pending.find(userData);
+                assert(it != pending.end() && it->second.Id == id);
+                assert(it->second.Deadline <= now && it->second.Deadline >= lastDeadline);
+                lastDeadline = it->second.Deadline;
+                pending.erase(it);
+            });
+            numFired += count;
+            for (const auto& [_, p] : pending) assert(p.Deadline > now);
+        }
+        assert(wheel.GetNumTimers() == pending.size());
+    }
+    assert(numFired > 1000 && now > uint64_t{1} << 36);
+    std::cerr << "TestRandomized OK\n";
+}
+} // namespace NTests
+
+
+auto main() -> int {
+    using namespace NTests;
+    TestBasic();
+    TestCoarseTick();
+    TestReentrancy();
+    TestRandomized();
+    std::cerr << "All tests passed.\n";
+}